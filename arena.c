@@ -0,0 +1,166 @@
+/*
+ * arena.c
+ *
+ * Scratch-memory arena used for the expression engines' growable
+ * operator and value stacks.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+
+#define ARENA_ALIGN 16
+
+/* Block header is padded so data starts aligned */
+#define HEADER_SIZE ((sizeof(ArenaBlock) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+#define BLOCK_DATA(b) ((char *)(b) + HEADER_SIZE)
+
+static size_t alignUp(size_t n)
+{
+    return (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+/* ============================================================
+ * Helper: newBlock
+ * Makes a block with room for 'size' bytes current: a
+ * large enough spare if there is one, otherwise a fresh block at
+ * least twice the size of the current one.
+ * ============================================================ */
+static ArenaBlock *newBlock(Arena *arena, size_t size)
+{
+    ArenaBlock **link = &arena->spare;
+    ArenaBlock *b;
+    size_t cap;
+
+    while (*link != NULL) {
+        if ((*link)->cap >= size) {
+            b = *link;
+            *link = b->next;
+            b->used = 0;
+            b->next = arena->current;
+            arena->current = b;
+            return b;
+        }
+        link = &(*link)->next;
+    }
+
+    cap = ARENA_MIN_BLOCK;
+    if (arena->current != NULL && cap < arena->current->cap * 2)
+        cap = arena->current->cap * 2;
+    while (cap < size) {
+        if (cap > ((size_t)-1 - HEADER_SIZE) / 2)
+            return NULL;
+        cap *= 2;
+    }
+
+    b = malloc(HEADER_SIZE + cap);
+    if (b == NULL)
+        return NULL;
+    b->cap = cap;
+    b->used = 0;
+    b->next = arena->current;
+    arena->current = b;
+    return b;
+}
+
+/* ============================================================
+ * Function: arenaAlloc
+ * ============================================================ */
+void *arenaAlloc(Arena *arena, size_t size)
+{
+    ArenaBlock *b = arena->current;
+    void *p;
+
+    size = alignUp(size ? size : 1);
+    if (size == 0)
+        return NULL;  /* Overflowed while aligning */
+
+    if (b == NULL || b->cap - b->used < size) {
+        b = newBlock(arena, size);
+        if (b == NULL)
+            return NULL;
+    }
+    p = BLOCK_DATA(b) + b->used;
+    b->used += size;
+    return p;
+}
+
+/* ============================================================
+ * Function: arenaGrow
+ * ============================================================ */
+void *arenaGrow(Arena *arena, void *ptr, size_t oldSize, size_t newSize)
+{
+    ArenaBlock *b = arena->current;
+    void *moved;
+
+    if (ptr == NULL)
+        return arenaAlloc(arena, newSize);
+
+    oldSize = alignUp(oldSize);
+    if (alignUp(newSize) <= oldSize)
+        return ptr;
+
+    /* Last allocation in the current block: extend in place */
+    if (b != NULL && (char *)ptr + oldSize == BLOCK_DATA(b) + b->used &&
+        alignUp(newSize) - oldSize <= b->cap - b->used) {
+        b->used += alignUp(newSize) - oldSize;
+        return ptr;
+    }
+
+    moved = arenaAlloc(arena, newSize);
+    if (moved != NULL)
+        memcpy(moved, ptr, oldSize);
+    return moved;
+}
+
+/* ============================================================
+ * Function: arenaMark / arenaRelease
+ * Blocks opened after the mark go to the spare list.
+ * ============================================================ */
+ArenaMark arenaMark(const Arena *arena)
+{
+    ArenaMark mark;
+
+    mark.block = arena->current;
+    mark.used = (arena->current != NULL) ? arena->current->used : 0;
+    return mark;
+}
+
+void arenaRelease(Arena *arena, ArenaMark mark)
+{
+    while (arena->current != mark.block) {
+        ArenaBlock *b = arena->current;
+        arena->current = b->next;
+        b->next = arena->spare;
+        arena->spare = b;
+    }
+    if (arena->current != NULL)
+        arena->current->used = mark.used;
+}
+
+/* ============================================================
+ * Function: arenaFree
+ * ============================================================ */
+void arenaFree(Arena *arena)
+{
+    ArenaBlock *lists[2];
+    int i;
+
+    lists[0] = arena->current;
+    lists[1] = arena->spare;
+    for (i = 0; i < 2; i++) {
+        while (lists[i] != NULL) {
+            ArenaBlock *next = lists[i]->next;
+            free(lists[i]);
+            lists[i] = next;
+        }
+    }
+    arena->current = NULL;
+    arena->spare = NULL;
+}
@@ -0,0 +1,78 @@
+/*
+ * arena.h
+ *
+ * Header file for the scratch-memory arena.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/* Smallest block the arena requests from malloc */
+#define ARENA_MIN_BLOCK (64 * 1024)
+
+/* Per-thread storage class for the default scratch arenas */
+#if defined(__GNUC__)
+#define PE1_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define PE1_THREAD_LOCAL __declspec(thread)
+#else
+#define PE1_THREAD_LOCAL _Thread_local
+#endif
+
+/* One malloc'd block; allocations are bumped from 'used' */
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;    /* Older block (or next spare) */
+    size_t cap;
+    size_t used;
+} ArenaBlock;
+
+/*
+ * Bump allocator. Memory is handed back with arenaRelease, which
+ * keeps the blocks for reuse, so steady-state work (one expression
+ * after another) does no malloc/free at all.
+ */
+typedef struct {
+    ArenaBlock *current;
+    ArenaBlock *spare;
+} Arena;
+
+/* Position to release back to */
+typedef struct {
+    ArenaBlock *block;
+    size_t used;
+} ArenaMark;
+
+/* Zero-initialized Arena is ready to use */
+#define ARENA_INIT { NULL, NULL }
+
+/*
+ * Allocates 'size' bytes (16-byte aligned).
+ * Returns NULL if out of memory.
+ */
+void *arenaAlloc(Arena *arena, size_t size);
+
+/*
+ * Grows the most recent allocation in place when possible,
+ * otherwise moves it to a new allocation (the old bytes are
+ * reclaimed at the next release). Returns NULL if out of memory,
+ * leaving ptr valid.
+ */
+void *arenaGrow(Arena *arena, void *ptr, size_t oldSize, size_t newSize);
+
+/* Current position */
+ArenaMark arenaMark(const Arena *arena);
+
+/* Frees everything allocated since 'mark', keeping the blocks */
+void arenaRelease(Arena *arena, ArenaMark mark);
+
+/* Returns all blocks to malloc */
+void arenaFree(Arena *arena);
+
+#endif
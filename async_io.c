@@ -0,0 +1,544 @@
+/*
+ * async_io.c
+ *
+ * Asynchronous sequential file I/O over a fixed pool of buffers.
+ * The stream's user only ever copies into or out of the buffer of
+ * the current block; the blocks after it (reader) or before it
+ * (writer) are in flight meanwhile. Completions are checked when
+ * the user reaches their buffer: a short transfer is finished with
+ * pread / pwrite, an error fails the stream.
+ *
+ * The io_uring backend is driven with the raw system calls (no
+ * liburing): one submission per block, the buffers registered once
+ * so the kernel does not map them again for every transfer. The
+ * portable backend is one thread per stream running the submitted
+ * transfers in order.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "async_io.h"
+#include "phase_stats.h"
+
+#if defined(__linux__) && !defined(PE1_NO_IO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+#endif
+
+/* Start of a slot's buffer */
+#define SLOT_BUFFER(s, slot) ((s)->buffers + (size_t)(slot) * ASYNC_IO_BLOCK_SIZE)
+
+/* ============================================================
+ * Helpers: failStream / transfer
+ * transfer moves len bytes at 'off' with pread / pwrite, retrying
+ * short transfers. Returns the bytes moved (fewer only at the end
+ * of a file being read) or -errno.
+ * ============================================================ */
+static void failStream(AsyncStream *s, int error)
+{
+    if (!s->failed) {
+        s->failed = 1;
+        s->error = error;
+    }
+}
+
+static ssize_t transfer(int fd, int writing, char *buf, size_t len, off_t off)
+{
+    size_t done = 0;
+
+    while (done < len) {
+        ssize_t n = writing ? pwrite(fd, buf + done, len - done, off + (off_t)done)
+                            : pread(fd, buf + done, len - done, off + (off_t)done);
+
+        if (n > 0)
+            done += (size_t)n;
+        else if (n == 0 && !writing)
+            break;
+        else if (n == 0)
+            return -EIO;
+        else if (errno != EINTR)
+            return -errno;
+    }
+    return (ssize_t)done;
+}
+
+#ifdef HAVE_IO_URING
+/* ============================================================
+ * io_uring backend
+ * ============================================================ */
+static int ringEnter(int fd, unsigned submit, unsigned wait)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, submit, wait,
+                        wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+}
+
+static void ringFree(AsyncStream *s)
+{
+    if (s->ring.sqes != NULL)
+        munmap(s->ring.sqes, s->ring.sqesLen);
+    if (s->ring.cqMap != NULL && s->ring.cqMap != s->ring.sqMap)
+        munmap(s->ring.cqMap, s->ring.cqMapLen);
+    if (s->ring.sqMap != NULL)
+        munmap(s->ring.sqMap, s->ring.sqMapLen);
+    close(s->ring.fd);
+    s->ring.fd = -1;
+}
+
+/*
+ * Creates the ring and registers the buffers. Returns 0 if either
+ * fails (old kernel, io_uring disabled, memlock limit), leaving
+ * the stream to the thread backend.
+ */
+static int ringSetup(AsyncStream *s)
+{
+    struct io_uring_params p;
+    struct iovec iov[ASYNC_IO_DEPTH];
+    char *sq, *cq;
+    int i;
+
+    memset(&p, 0, sizeof(p));
+    s->ring.fd = (int)syscall(__NR_io_uring_setup, ASYNC_IO_DEPTH, &p);
+    if (s->ring.fd < 0) {
+        s->ring.fd = -1;
+        return 0;
+    }
+
+    s->ring.sqMapLen = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    s->ring.cqMapLen = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) && s->ring.cqMapLen > s->ring.sqMapLen)
+        s->ring.sqMapLen = s->ring.cqMapLen;
+    s->ring.sqesLen = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    sq = mmap(NULL, s->ring.sqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+              s->ring.fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        close(s->ring.fd);
+        s->ring.fd = -1;
+        return 0;
+    }
+    s->ring.sqMap = sq;
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+        cq = sq;
+    else
+        cq = mmap(NULL, s->ring.cqMapLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  s->ring.fd, IORING_OFF_CQ_RING);
+    s->ring.sqes = mmap(NULL, s->ring.sqesLen, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        s->ring.fd, IORING_OFF_SQES);
+    s->ring.cqMap = (cq == MAP_FAILED) ? NULL : cq;
+    if (s->ring.sqes == MAP_FAILED)
+        s->ring.sqes = NULL;
+    if (s->ring.cqMap == NULL || s->ring.sqes == NULL) {
+        ringFree(s);
+        return 0;
+    }
+
+    s->ring.sqHead = (unsigned *)(sq + p.sq_off.head);
+    s->ring.sqTail = (unsigned *)(sq + p.sq_off.tail);
+    s->ring.sqMask = (unsigned *)(sq + p.sq_off.ring_mask);
+    s->ring.sqArray = (unsigned *)(sq + p.sq_off.array);
+    s->ring.cqHead = (unsigned *)(cq + p.cq_off.head);
+    s->ring.cqTail = (unsigned *)(cq + p.cq_off.tail);
+    s->ring.cqMask = (unsigned *)(cq + p.cq_off.ring_mask);
+    s->ring.cqes = cq + p.cq_off.cqes;
+
+    for (i = 0; i < ASYNC_IO_DEPTH; i++) {
+        iov[i].iov_base = SLOT_BUFFER(s, i);
+        iov[i].iov_len = ASYNC_IO_BLOCK_SIZE;
+    }
+    if (syscall(__NR_io_uring_register, s->ring.fd, IORING_REGISTER_BUFFERS,
+                iov, ASYNC_IO_DEPTH) != 0) {
+        ringFree(s);
+        return 0;
+    }
+    return 1;
+}
+
+/* Queues one transfer of a registered buffer and submits it */
+static void ringSubmit(AsyncStream *s, int slot)
+{
+    unsigned tail = *s->ring.sqTail;
+    unsigned idx = tail & *s->ring.sqMask;
+    struct io_uring_sqe *sqe = (struct io_uring_sqe *)s->ring.sqes + idx;
+    int r;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = s->writing ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+    sqe->fd = s->fd;
+    sqe->off = (unsigned long long)s->offset[slot];
+    sqe->addr = (unsigned long long)(uintptr_t)SLOT_BUFFER(s, slot);
+    sqe->len = (unsigned)s->length[slot];
+    sqe->buf_index = (unsigned short)slot;
+    sqe->user_data = (unsigned long long)slot;
+    s->ring.sqArray[idx] = idx;
+    __atomic_store_n(s->ring.sqTail, tail + 1, __ATOMIC_RELEASE);
+
+    while ((r = ringEnter(s->ring.fd, 1, 0)) < 0 && errno == EINTR)
+        ;
+    if (r < 0) {
+        failStream(s, errno);
+        s->result[slot] = -errno;
+        s->finished[slot] = 1;
+    }
+}
+
+/* Takes every completion the kernel has posted */
+static void ringReap(AsyncStream *s)
+{
+    unsigned head = *s->ring.cqHead;
+    unsigned tail = __atomic_load_n(s->ring.cqTail, __ATOMIC_ACQUIRE);
+
+    while (head != tail) {
+        const struct io_uring_cqe *cqe =
+            (const struct io_uring_cqe *)s->ring.cqes + (head & *s->ring.cqMask);
+        int slot = (int)cqe->user_data;
+
+        s->result[slot] = cqe->res;
+        s->finished[slot] = 1;
+        head++;
+    }
+    __atomic_store_n(s->ring.cqHead, head, __ATOMIC_RELEASE);
+}
+
+static void ringWait(AsyncStream *s, int slot)
+{
+    ringReap(s);
+    while (!s->finished[slot]) {
+        if (ringEnter(s->ring.fd, 0, 1) < 0 && errno != EINTR) {
+            failStream(s, errno);
+            s->result[slot] = -errno;
+            s->finished[slot] = 1;
+            break;
+        }
+        ringReap(s);
+    }
+}
+#endif /* HAVE_IO_URING */
+
+/* ============================================================
+ * Thread backend
+ * The I/O thread runs the queued slots in order; finished and
+ * result are shared with it under the lock.
+ * ============================================================ */
+static void *ioThread(void *arg)
+{
+    AsyncStream *s = arg;
+
+    pthread_mutex_lock(&s->lock);
+    for (;;) {
+        int slot;
+        ssize_t r;
+
+        while (s->queueHead == s->queueTail && !s->stopping)
+            pthread_cond_wait(&s->changed, &s->lock);
+        if (s->queueHead == s->queueTail)
+            break;
+        slot = s->queue[s->queueHead++ % ASYNC_IO_DEPTH];
+        pthread_mutex_unlock(&s->lock);
+
+        r = transfer(s->fd, s->writing, SLOT_BUFFER(s, slot), s->length[slot], s->offset[slot]);
+
+        pthread_mutex_lock(&s->lock);
+        s->result[slot] = r;
+        s->finished[slot] = 1;
+        pthread_cond_broadcast(&s->changed);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return NULL;
+}
+
+static int threadSetup(AsyncStream *s)
+{
+    pthread_mutex_init(&s->lock, NULL);
+    pthread_cond_init(&s->changed, NULL);
+    s->queueHead = s->queueTail = 0;
+    s->stopping = 0;
+    if (pthread_create(&s->thread, NULL, ioThread, s) != 0) {
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->changed);
+        return 0;
+    }
+    s->threaded = 1;
+    return 1;
+}
+
+static void threadFree(AsyncStream *s)
+{
+    pthread_mutex_lock(&s->lock);
+    s->stopping = 1;
+    pthread_cond_broadcast(&s->changed);
+    pthread_mutex_unlock(&s->lock);
+    pthread_join(s->thread, NULL);
+    pthread_mutex_destroy(&s->lock);
+    pthread_cond_destroy(&s->changed);
+    s->threaded = 0;
+}
+
+/* ============================================================
+ * Helpers: submitSlot / waitSlot
+ * waitSlot returns once a submitted slot has completed, finishes a
+ * short transfer, records an error and marks the slot READY.
+ * ============================================================ */
+static void submitSlot(AsyncStream *s, int slot, size_t len)
+{
+    s->length[slot] = len;
+    s->offset[slot] = s->nextOffset;
+    s->nextOffset += (off_t)len;
+    s->state[slot] = ASYNC_SLOT_BUSY;
+#ifdef HAVE_IO_URING
+    if (s->ring.fd >= 0) {
+        s->finished[slot] = 0;
+        ringSubmit(s, slot);
+        return;
+    }
+#endif
+    pthread_mutex_lock(&s->lock);
+    s->finished[slot] = 0;
+    s->queue[s->queueTail++ % ASYNC_IO_DEPTH] = slot;
+    pthread_cond_broadcast(&s->changed);
+    pthread_mutex_unlock(&s->lock);
+}
+
+static void waitSlot(AsyncStream *s, int slot)
+{
+    ssize_t r;
+
+    if (s->state[slot] != ASYNC_SLOT_BUSY)
+        return;
+#ifdef HAVE_IO_URING
+    if (s->ring.fd >= 0)
+        ringWait(s, slot);
+    else
+#endif
+    {
+        pthread_mutex_lock(&s->lock);
+        while (!s->finished[slot])
+            pthread_cond_wait(&s->changed, &s->lock);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    r = s->result[slot];
+    if (r >= 0 && (size_t)r < s->length[slot]) {
+        ssize_t more = transfer(s->fd, s->writing, SLOT_BUFFER(s, slot) + r,
+                                s->length[slot] - (size_t)r, s->offset[slot] + (off_t)r);
+
+        r = (more < 0) ? more : r + more;
+    }
+    if (r < 0) {
+        failStream(s, (int)-r);
+        r = 0;
+    }
+    s->result[slot] = r;
+    s->state[slot] = ASYNC_SLOT_READY;
+}
+
+/* ============================================================
+ * Helper: openStream
+ * ============================================================ */
+static int openStream(AsyncStream *s, int fd, int writing)
+{
+    void *buffers;
+    int i;
+
+    memset(s, 0, sizeof(*s));
+    s->fd = fd;
+    s->writing = writing;
+    s->ring.fd = -1;
+    s->nextOffset = lseek(fd, 0, SEEK_CUR);
+    if (s->nextOffset < 0)
+        return -1;
+    if (posix_memalign(&buffers, ASYNC_IO_ALIGN, (size_t)ASYNC_IO_DEPTH * ASYNC_IO_BLOCK_SIZE) != 0)
+        return -1;
+    s->buffers = buffers;
+    for (i = 0; i < ASYNC_IO_DEPTH; i++)
+        s->state[i] = ASYNC_SLOT_FREE;
+
+#ifdef HAVE_IO_URING
+    if (ringSetup(s))
+        return 0;
+#endif
+    if (threadSetup(s))
+        return 0;
+    free(s->buffers);
+    s->buffers = NULL;
+    return -1;
+}
+
+/* ============================================================
+ * Functions: asyncOpenReader / asyncOpenWriter
+ * ============================================================ */
+int asyncOpenReader(AsyncStream *s, int fd)
+{
+    struct stat st;
+    int i;
+
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || openStream(s, fd, 0) != 0)
+        return -1;
+    s->endOffset = (st.st_size > s->nextOffset) ? st.st_size : s->nextOffset;
+
+    /* Read ahead into every buffer */
+    for (i = 0; i < ASYNC_IO_DEPTH && s->nextOffset < s->endOffset; i++) {
+        off_t left = s->endOffset - s->nextOffset;
+
+        submitSlot(s, i, (left < ASYNC_IO_BLOCK_SIZE) ? (size_t)left : ASYNC_IO_BLOCK_SIZE);
+    }
+    return 0;
+}
+
+int asyncOpenWriter(AsyncStream *s, int fd)
+{
+    struct stat st;
+    int flags = fcntl(fd, F_GETFL);
+
+    /* Appending would ignore the offsets, and blocks may land in any order */
+    if (flags < 0 || (flags & O_APPEND) || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+        return -1;
+    return openStream(s, fd, 1);
+}
+
+/* ============================================================
+ * Function: asyncRead
+ * A consumed buffer is resubmitted at once for the block
+ * ASYNC_IO_DEPTH further on.
+ * ============================================================ */
+size_t asyncRead(AsyncStream *s, void *dst, size_t n)
+{
+    while (!s->failed && n > 0) {
+        int slot = (int)(s->current % ASYNC_IO_DEPTH);
+        size_t avail;
+
+        if (s->state[slot] == ASYNC_SLOT_FREE)
+            return 0;   /* End of file */
+        if (s->state[slot] == ASYNC_SLOT_BUSY) {
+            uint64_t t = STATS_START();
+
+            waitSlot(s, slot);
+            STATS_STOP(STATS_READ, t, (size_t)s->result[slot], 0);
+        }
+
+        avail = (size_t)s->result[slot] - s->pos;
+        if (avail > 0) {
+            if (avail > n)
+                avail = n;
+            memcpy(dst, SLOT_BUFFER(s, slot) + s->pos, avail);
+            s->pos += avail;
+            return avail;
+        }
+
+        s->state[slot] = ASYNC_SLOT_FREE;
+        if (s->nextOffset < s->endOffset) {
+            off_t left = s->endOffset - s->nextOffset;
+
+            submitSlot(s, slot, (left < ASYNC_IO_BLOCK_SIZE) ? (size_t)left : ASYNC_IO_BLOCK_SIZE);
+        }
+        s->current++;
+        s->pos = 0;
+    }
+    return 0;
+}
+
+/* ============================================================
+ * Function: asyncWrite
+ * ============================================================ */
+int asyncWrite(AsyncStream *s, const void *src, size_t n)
+{
+    const char *p = src;
+
+    while (!s->failed && n > 0) {
+        int slot = (int)(s->current % ASYNC_IO_DEPTH);
+        size_t room;
+
+        /* The buffer comes back from the write before last */
+        if (s->state[slot] != ASYNC_SLOT_FREE) {
+            uint64_t t = STATS_START();
+            size_t len = s->length[slot];
+
+            waitSlot(s, slot);
+            STATS_STOP(STATS_WRITE, t, 0, len);
+            s->state[slot] = ASYNC_SLOT_FREE;
+        }
+
+        room = ASYNC_IO_BLOCK_SIZE - s->pos;
+        if (room > n)
+            room = n;
+        memcpy(SLOT_BUFFER(s, slot) + s->pos, p, room);
+        s->pos += room;
+        p += room;
+        n -= room;
+
+        if (s->pos == ASYNC_IO_BLOCK_SIZE) {
+            submitSlot(s, slot, ASYNC_IO_BLOCK_SIZE);
+            s->current++;
+            s->pos = 0;
+        }
+    }
+    return !s->failed;
+}
+
+/* ============================================================
+ * Function: asyncClose
+ * ============================================================ */
+int asyncClose(AsyncStream *s)
+{
+    off_t position = s->nextOffset;
+    int slot = (int)(s->current % ASYNC_IO_DEPTH);
+    int i;
+
+    if (s->writing && !s->failed && s->pos > 0) {
+        submitSlot(s, slot, s->pos);
+        s->current++;
+        s->pos = 0;
+        position = s->nextOffset;
+    } else if (!s->writing && s->state[slot] != ASYNC_SLOT_FREE) {
+        /* Reader: just after the last byte handed out */
+        position = s->offset[slot] + (off_t)s->pos;
+    }
+
+    for (i = 0; i < ASYNC_IO_DEPTH; i++) {
+        uint64_t t = STATS_START();
+        int wasBusy = s->state[i] == ASYNC_SLOT_BUSY;
+        size_t len = s->length[i];
+
+        waitSlot(s, i);
+        if (wasBusy && s->writing)
+            STATS_STOP(STATS_WRITE, t, 0, len);
+    }
+
+#ifdef HAVE_IO_URING
+    if (s->ring.fd >= 0)
+        ringFree(s);
+#endif
+    if (s->threaded)
+        threadFree(s);
+    free(s->buffers);
+    s->buffers = NULL;
+
+    lseek(s->fd, position, SEEK_SET);
+    if (s->failed) {
+        errno = s->error;
+        return -1;
+    }
+    return 0;
+}
+
+/* ============================================================
+ * Function: asyncBackendName
+ * ============================================================ */
+const char *asyncBackendName(const AsyncStream *s)
+{
+    return (s->ring.fd >= 0) ? "io_uring" : "thread";
+}
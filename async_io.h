@@ -0,0 +1,123 @@
+/*
+ * async_io.h
+ *
+ * Header file for asynchronous sequential file I/O. A stream keeps
+ * ASYNC_IO_DEPTH fixed buffers in flight, so processing one block
+ * overlaps the disk reading the next ones (or writing the previous
+ * ones). On Linux the buffers are registered once with an io_uring;
+ * elsewhere, where io_uring is unavailable or when built with
+ * -DPE1_NO_IO_URING, one I/O thread per stream does the same with
+ * pread / pwrite.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef ASYNC_IO_H
+#define ASYNC_IO_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+/* Bytes per buffer (one read or write) */
+#define ASYNC_IO_BLOCK_SIZE (1 << 20)
+
+/* Buffers per stream, all of them in flight when I/O is the bottleneck */
+#define ASYNC_IO_DEPTH 8
+
+/* Alignment of the buffers (page size) */
+#define ASYNC_IO_ALIGN 4096
+
+/* Where a buffer is, as seen by the stream's user */
+typedef enum {
+    ASYNC_SLOT_FREE,        /* Writer: can be filled; reader: past the end */
+    ASYNC_SLOT_BUSY,        /* Submitted, maybe not completed yet */
+    ASYNC_SLOT_READY        /* Completed and checked; result holds the bytes */
+} AsyncSlotState;
+
+/*
+ * One file read or written front to back. Buffers are used in
+ * turn: block n always goes through buffer n % ASYNC_IO_DEPTH, so
+ * blocks complete in any order but are consumed in file order.
+ * Use only through the functions below, from one thread.
+ */
+typedef struct {
+    int fd;
+    int writing;
+    int failed;                 /* A read or write failed */
+    int error;                  /* The first error (an errno value) */
+    char *buffers;              /* ASYNC_IO_DEPTH * ASYNC_IO_BLOCK_SIZE bytes */
+    size_t length[ASYNC_IO_DEPTH];      /* Bytes requested of each buffer */
+    off_t offset[ASYNC_IO_DEPTH];       /* File offset of each buffer */
+    ssize_t result[ASYNC_IO_DEPTH];     /* Bytes done, or -errno */
+    int finished[ASYNC_IO_DEPTH];       /* Set by the backend on completion */
+    AsyncSlotState state[ASYNC_IO_DEPTH];
+    unsigned long current;      /* Block being consumed (reader) / filled (writer) */
+    size_t pos;                 /* Bytes consumed / filled in it */
+    off_t nextOffset;           /* File offset of the next block submitted */
+    off_t endOffset;            /* Reader: file size when opened */
+
+    /* io_uring backend (ring.fd < 0 when not in use) */
+    struct {
+        int fd;
+        void *sqMap, *cqMap, *sqes;
+        size_t sqMapLen, cqMapLen, sqesLen;
+        unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+        unsigned *cqHead, *cqTail, *cqMask;
+        void *cqes;
+    } ring;
+
+    /* I/O thread backend */
+    int threaded;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    int queue[ASYNC_IO_DEPTH];  /* Submitted slots, in order */
+    unsigned queueHead, queueTail;
+    int stopping;
+} AsyncStream;
+
+/*
+ * Opens a stream reading fd, a regular file, from its current
+ * position to the end it has now, and starts the first reads.
+ * Returns 0 on success, -1 if fd is not a regular file or the
+ * stream could not be set up (the caller reads it some other way).
+ */
+int asyncOpenReader(AsyncStream *s, int fd);
+
+/*
+ * Opens a stream writing fd, a regular file not opened for
+ * appending, from its current position. Returns 0 on success, -1
+ * otherwise (as asyncOpenReader).
+ */
+int asyncOpenWriter(AsyncStream *s, int fd);
+
+/*
+ * Copies up to n bytes of the file into dst, waiting only if the
+ * next block has not arrived yet. Returns the bytes copied, 0 at
+ * the end of the file or after an error (s->failed).
+ */
+size_t asyncRead(AsyncStream *s, void *dst, size_t n);
+
+/*
+ * Copies n bytes into the stream's buffers; every full buffer is
+ * submitted, waiting only if all of them are still in flight.
+ * Returns 1, or 0 once a write has failed.
+ */
+int asyncWrite(AsyncStream *s, const void *src, size_t n);
+
+/*
+ * Writes out what is left (writer), waits for everything in
+ * flight and releases the stream. The file position of fd is left
+ * after the last byte read or written. Returns 0, or -1 with errno
+ * set if any read or write failed.
+ */
+int asyncClose(AsyncStream *s);
+
+/* Backend of an open stream: "io_uring" or "thread" */
+const char *asyncBackendName(const AsyncStream *s);
+
+#endif
@@ -0,0 +1,757 @@
+/*
+ * batch.c
+ *
+ * Non-interactive batch mode. Reads newline-delimited records through
+ * large buffered reads and writes one result per line, no prompts.
+ * With several threads the input is cut into chunks that a thread
+ * pool processes in any order; a reorder buffer writes the results
+ * back in input order.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "async_io.h"
+#include "batch.h"
+#include "expression.h"
+#include "expr_cache.h"
+#include "expr_parallel.h"
+#include "phase_stats.h"
+#include "string_ops.h"
+#include "string_stream.h"
+#include "thread_pool.h"
+
+/* Buffered line reader over a FILE, or over an AsyncStream */
+typedef struct {
+    FILE *in;
+    AsyncStream *async;     /* Non-NULL: reads come from it instead of in */
+    char *buf;
+    size_t cap;     /* Allocated size of buf (one byte kept for '\0') */
+    size_t start;   /* Start of the unread data */
+    size_t end;     /* End of the unread data */
+    int eof;
+    int streamLong; /* Lines that fill the buffer are left to streamRecord */
+    int longLine;   /* readLine stopped at such a line */
+} LineReader;
+
+/* Where results go: a FILE, or an AsyncStream over its descriptor */
+typedef struct {
+    FILE *file;
+    AsyncStream *async;
+} BatchSink;
+
+/* Growable scratch buffer for per-record output */
+typedef struct {
+    char *data;
+    size_t cap;
+} Scratch;
+
+/* Results of a run of records, written out in one go */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+    int failed;     /* A record's result was lost (out of memory) */
+} Output;
+
+/*
+ * Everything one thread needs to process records; each worker has
+ * its own, so nothing is shared between threads while evaluating.
+ */
+typedef struct {
+    Scratch scratch;
+    ExprCache cacheStorage;
+    ExprCache *cache;
+    ExprValue value;    /* Big values reuse their limbs */
+    ParallelEvaluator parallelStorage;
+    ParallelEvaluator *parallel;    /* BATCH_REDUCE only */
+} BatchWorker;
+
+struct ParallelRun;
+
+/* A block of input records and, once processed, their results */
+typedef struct {
+    struct ParallelRun *run;
+    char *input;        /* Records, each NUL-terminated */
+    size_t inputLen;
+    size_t inputCap;
+    size_t records;
+    Output output;
+    int done;           /* Guarded by run->lock */
+    int failed;
+} BatchChunk;
+
+/* State shared by the reader/writer and the workers */
+typedef struct ParallelRun {
+    BatchMode mode;
+    BatchWorker *workers;   /* Indexed by pool worker; the last is the caller's */
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+} ParallelRun;
+
+/* ============================================================
+ * Function: initBatchOptions
+ * ============================================================ */
+void initBatchOptions(BatchOptions *opts)
+{
+    opts->cacheCapacity = EXPR_CACHE_DEFAULT_CAPACITY;
+    opts->threads = 1;
+    opts->asyncIo = 1;
+}
+
+/* ============================================================
+ * Function: parseBatchMode
+ * Maps a command-line mode name to a BatchMode.
+ * ============================================================ */
+int parseBatchMode(const char *name, BatchMode *mode)
+{
+    if (strcmp(name, "eval") == 0)
+        *mode = BATCH_EVAL;
+    else if (strcmp(name, "reduce") == 0)
+        *mode = BATCH_REDUCE;
+    else if (strcmp(name, "compress") == 0)
+        *mode = BATCH_COMPRESS;
+    else if (strcmp(name, "expand") == 0)
+        *mode = BATCH_EXPAND;
+    else
+        return 0;
+    return 1;
+}
+
+/* ============================================================
+ * Helper: initReader / freeReader
+ * ============================================================ */
+static int initReader(LineReader *r, FILE *in)
+{
+    r->in = in;
+    r->async = NULL;
+    r->cap = BATCH_BUFFER_SIZE;
+    r->buf = malloc(r->cap);
+    r->start = r->end = 0;
+    r->eof = 0;
+    r->streamLong = 0;
+    r->longLine = 0;
+    return r->buf != NULL ? 0 : -1;
+}
+
+static void freeReader(LineReader *r)
+{
+    free(r->buf);
+    r->buf = NULL;
+}
+
+/* ============================================================
+ * Helper: fillReader
+ * Reads more input after the unread data (room permitting).
+ * ============================================================ */
+static void fillReader(LineReader *r)
+{
+    size_t got;
+
+    if (r->async != NULL) {
+        /* Times only the waits, itself */
+        got = asyncRead(r->async, r->buf + r->end, r->cap - 1 - r->end);
+    } else {
+        uint64_t t = STATS_START();
+
+        got = fread(r->buf + r->end, 1, r->cap - 1 - r->end, r->in);
+        STATS_STOP(STATS_READ, t, got, 0);
+    }
+    r->end += got;
+    if (got == 0)
+        r->eof = 1;
+}
+
+/* ============================================================
+ * Helper: readLine
+ * Returns the next record (NUL-terminated in place, newline and
+ * any trailing '\r' removed) or NULL at end of input.
+ * Lines longer than the buffer grow it, unless r->streamLong is
+ * set: readLine then returns NULL with r->longLine set and the
+ * start of the line left in the buffer for streamRecord.
+ * ============================================================ */
+static char *readLine(LineReader *r, size_t *len)
+{
+    size_t scanned = r->start;
+
+    for (;;) {
+        char *nl = memchr(r->buf + scanned, '\n', r->end - scanned);
+
+        if (nl != NULL || (r->eof && r->end > r->start)) {
+            char *line = r->buf + r->start;
+            size_t n = (nl != NULL) ? (size_t)(nl - line) : r->end - r->start;
+
+            r->start += n + (nl != NULL);
+            if (n > 0 && line[n - 1] == '\r')
+                n--;
+            line[n] = '\0';  /* Safe: cap always leaves one spare byte */
+            *len = n;
+            return line;
+        }
+        if (r->eof)
+            return NULL;
+
+        /* Need more data: slide the partial line to the front */
+        scanned = r->end;
+        if (r->start > 0) {
+            memmove(r->buf, r->buf + r->start, r->end - r->start);
+            scanned -= r->start;
+            r->end -= r->start;
+            r->start = 0;
+        }
+        if (r->end + 1 >= r->cap) {
+            char *grown;
+
+            if (r->streamLong) {
+                r->longLine = 1;
+                return NULL;
+            }
+            if ((grown = realloc(r->buf, r->cap * 2)) == NULL)
+                return NULL;
+            r->buf = grown;
+            r->cap *= 2;
+        }
+        fillReader(r);
+    }
+}
+
+/* ============================================================
+ * Helper: reserveScratch
+ * Ensures the scratch buffer holds at least 'need' bytes.
+ * ============================================================ */
+static char *reserveScratch(Scratch *s, size_t need)
+{
+    if (need > s->cap) {
+        size_t cap = s->cap ? s->cap : 256;
+        char *grown;
+
+        while (cap < need)
+            cap *= 2;
+        grown = realloc(s->data, cap);
+        if (grown == NULL)
+            return NULL;
+        s->data = grown;
+        s->cap = cap;
+    }
+    return s->data;
+}
+
+/* ============================================================
+ * Helpers: initWorker / freeWorker
+ * ============================================================ */
+static void initWorker(BatchWorker *w, BatchMode mode, const BatchOptions *opts)
+{
+    w->scratch.data = NULL;
+    w->scratch.cap = 0;
+    w->cache = NULL;
+    w->parallel = NULL;
+    initExprValue(&w->value);
+    if (mode == BATCH_EVAL && opts->cacheCapacity > 0 &&
+        exprCacheInit(&w->cacheStorage, opts->cacheCapacity))
+        w->cache = &w->cacheStorage;
+    /* Without threads, reduce mode evaluates sequentially */
+    if (mode == BATCH_REDUCE && parallelInit(&w->parallelStorage, opts->threads))
+        w->parallel = &w->parallelStorage;
+}
+
+static void freeWorker(BatchWorker *w)
+{
+    if (w->cache != NULL)
+        exprCacheFree(w->cache);
+    if (w->parallel != NULL)
+        parallelFree(w->parallel);
+    freeExprValue(&w->value);
+    free(w->scratch.data);
+}
+
+/* ============================================================
+ * Helpers: Output buffer
+ * Appends never fail silently: on out of memory 'failed' is set
+ * and the record's output is dropped.
+ * ============================================================ */
+static void outBytes(Output *o, const char *s, size_t n)
+{
+    if (o->len + n > o->cap) {
+        size_t cap = o->cap ? o->cap : 4096;
+        char *grown;
+
+        while (cap < o->len + n)
+            cap *= 2;
+        grown = realloc(o->data, cap);
+        if (grown == NULL) {
+            o->failed = 1;
+            return;
+        }
+        o->data = grown;
+        o->cap = cap;
+    }
+    memcpy(o->data + o->len, s, n);
+    o->len += n;
+}
+
+static void outText(Output *o, const char *s)
+{
+    outBytes(o, s, strlen(s));
+}
+
+/* ============================================================
+ * Helper: processRecord
+ * Applies the batch operation to one record and appends the result.
+ * ============================================================ */
+static void processRecord(BatchMode mode, const char *line, size_t len,
+                          BatchWorker *w, Output *out)
+{
+    ExprStatus status;
+    ExprValue *value = &w->value;
+    char text[96];
+    int offset;
+    char *buf;
+
+    switch (mode) {
+        case BATCH_EVAL:
+        case BATCH_REDUCE:
+            /* Repeated lines hit the cache; the rest take the fused pass */
+            if (w->parallel != NULL)
+                status = evaluateParallel(w->parallel, line, value, &offset);
+            else if (w->cache != NULL)
+                status = exprCacheEvaluate(w->cache, line, value, &offset);
+            else
+                status = evaluateInfix(line, value, &offset);
+            if (status == EXPR_OK && !value->isBig) {
+                sprintf(text, "%lld\n", value->small);
+                outText(out, text);
+            } else if (status == EXPR_OK) {
+                if ((buf = reserveScratch(&w->scratch, exprValueTextSize(value))) == NULL ||
+                    exprValueToText(value, buf) == 0) {
+                    outText(out, "error: out of memory\n");
+                } else {
+                    outText(out, buf);
+                    outBytes(out, "\n", 1);
+                }
+            } else {
+                sprintf(text, "error: %s at offset %d\n",
+                        exprStatusMessage(status), offset);
+                outText(out, text);
+            }
+            break;
+
+        case BATCH_COMPRESS:
+            /* Compressed form is never longer than the input */
+            if (!isValidString(line)) {
+                outText(out, "error: invalid string\n");
+            } else if ((buf = reserveScratch(&w->scratch, len + 1)) == NULL) {
+                outText(out, "error: out of memory\n");
+            } else {
+                compressString(line, buf);
+                outText(out, buf);
+                outBytes(out, "\n", 1);
+            }
+            break;
+
+        case BATCH_EXPAND:
+            if (!isValidCompressedString(line)) {
+                outText(out, "error: invalid compressed string\n");
+            } else {
+                size_t n = expandedSize(line, strlen(line));
+
+                if (n == (size_t)-1 ||
+                    (buf = reserveScratch(&w->scratch, n + 1)) == NULL) {
+                    outText(out, "error: out of memory\n");
+                } else {
+                    expandString(line, buf);
+                    outBytes(out, buf, n);
+                    outBytes(out, "\n", 1);
+                }
+            }
+            break;
+    }
+}
+
+/* ============================================================
+ * Helper: flushOutput
+ * Writes and empties the buffer. Returns 0 on a write error.
+ * ============================================================ */
+static int flushOutput(Output *o, BatchSink *out)
+{
+    int ok = !o->failed;
+
+    if (o->len == 0) {
+        /* Nothing to write (data may still be NULL) */
+    } else if (out->async != NULL) {
+        ok &= asyncWrite(out->async, o->data, o->len);
+    } else {
+        uint64_t t = STATS_START();
+
+        ok &= fwrite(o->data, 1, o->len, out->file) == o->len;
+        STATS_STOP(STATS_WRITE, t, 0, o->len);
+    }
+    o->len = 0;
+    o->failed = 0;
+    return ok;
+}
+
+/* ============================================================
+ * Helper: streamPiece
+ * Feeds [p, end) to the record's stream (finishes it if p is
+ * NULL), straight into the output buffer; whenever that fills up
+ * it is written out and *flushed set. Returns the stream status.
+ * ============================================================ */
+typedef struct {
+    BatchMode mode;
+    CompressStream compress;
+    ExpandStream expand;
+} RecordStream;
+
+static StreamStatus streamPiece(RecordStream *rs, const char *p, const char *end,
+                                Output *o, BatchSink *sink, int *ok, int *flushed)
+{
+    StreamStatus status;
+
+    for (;;) {
+        char *out = o->data + o->len;
+        char *outEnd = o->data + o->cap;
+
+        if (rs->mode == BATCH_COMPRESS)
+            status = (p != NULL) ? compressStreamFeed(&rs->compress, &p, end, &out, outEnd)
+                                 : compressStreamFinish(&rs->compress, &out, outEnd);
+        else
+            status = (p != NULL) ? expandStreamFeed(&rs->expand, &p, end, &out, outEnd)
+                                 : expandStreamFinish(&rs->expand, &out, outEnd);
+        o->len = (size_t)(out - o->data);
+        if (status != STREAM_FULL)
+            return status;
+        *ok &= flushOutput(o, sink);
+        *flushed = 1;
+    }
+}
+
+/* ============================================================
+ * Helper: streamRecord
+ * Compresses / expands the line readLine stopped at (one too long
+ * for the buffer) through a stream, reading and writing it a
+ * buffer at a time, so it takes constant memory however long it
+ * is. Like readLine it stops at the newline, drops a '\r' before
+ * it and ends the record at a NUL. An invalid record whose output
+ * was partly written already gets " error: ..." at the end of its
+ * line instead of a line of its own. Returns 0 on a write error.
+ * ============================================================ */
+static int streamRecord(BatchMode mode, LineReader *r, Output *o, BatchSink *sink)
+{
+    RecordStream rs;
+    StreamStatus status = STREAM_OK;
+    int ok = 1, flushed = 0, stopped = 0, lineDone = 0;
+
+    r->longLine = 0;
+    rs.mode = mode;
+    compressStreamInit(&rs.compress);
+    expandStreamInit(&rs.expand);
+
+    /* The whole buffer is this record's output room */
+    ok &= flushOutput(o, sink);
+    if (o->cap < BATCH_BUFFER_SIZE) {
+        char *grown = realloc(o->data, BATCH_BUFFER_SIZE);
+
+        if (grown == NULL)
+            return 0;
+        o->data = grown;
+        o->cap = BATCH_BUFFER_SIZE;
+    }
+
+    while (!lineDone) {
+        char *p = r->buf + r->start;
+        char *nl = memchr(p, '\n', r->end - r->start);
+        char *stop = (nl != NULL) ? nl : r->buf + r->end;
+        char *next = (nl != NULL) ? nl + 1 : stop;
+        char *zero;
+
+        /* A '\r' is dropped before the newline (or at the end of
+         * the input), so one at the end of the data waits for more */
+        if (stop > p && stop[-1] == '\r' && (nl != NULL || r->eof))
+            stop--;
+        else if (stop > p && stop[-1] == '\r')
+            next = --stop;
+
+        if (!stopped && (zero = memchr(p, '\0', (size_t)(stop - p))) != NULL) {
+            if (status == STREAM_OK)
+                status = streamPiece(&rs, p, zero, o, sink, &ok, &flushed);
+            stopped = 1;
+        }
+        if (!stopped && status == STREAM_OK)
+            status = streamPiece(&rs, p, stop, o, sink, &ok, &flushed);
+        r->start = (size_t)(next - r->buf);
+
+        if (nl != NULL || r->eof) {
+            lineDone = 1;
+        } else {
+            memmove(r->buf, r->buf + r->start, r->end - r->start);
+            r->end -= r->start;
+            r->start = 0;
+            fillReader(r);
+        }
+    }
+
+    if (status == STREAM_OK)
+        status = streamPiece(&rs, NULL, NULL, o, sink, &ok, &flushed);
+    if (status == STREAM_OK) {
+        outBytes(o, "\n", 1);
+    } else {
+        if (!flushed)
+            o->len = 0;
+        else
+            outBytes(o, " ", 1);
+        outText(o, (mode == BATCH_COMPRESS) ? "error: invalid string\n"
+                                            : "error: invalid compressed string\n");
+    }
+    statsPoll(stderr);
+    return ok;
+}
+
+/* ============================================================
+ * Helper: runSerial
+ * Single thread: read record -> process -> write result.
+ * ============================================================ */
+static int runSerial(BatchMode mode, LineReader *reader, BatchSink *out,
+                     const BatchOptions *opts)
+{
+    BatchWorker worker;
+    Output output = { NULL, 0, 0, 0 };
+    char *line;
+    size_t len;
+    int ok = 1;
+
+    initWorker(&worker, mode, opts);
+    for (;;) {
+        if ((line = readLine(reader, &len)) == NULL) {
+            if (!reader->longLine)
+                break;
+            ok &= streamRecord(mode, reader, &output, out);
+            continue;
+        }
+        processRecord(mode, line, len, &worker, &output);
+        if (output.len >= BATCH_BUFFER_SIZE)
+            ok &= flushOutput(&output, out);
+        statsPoll(stderr);
+    }
+    ok &= flushOutput(&output, out);
+
+    freeWorker(&worker);
+    free(output.data);
+    return ok;
+}
+
+/* ============================================================
+ * Helper: fillChunk
+ * Copies whole records from the reader into the chunk, each one
+ * NUL-terminated, until about BATCH_CHUNK_SIZE bytes are queued.
+ * Returns the number of records (0 at end of input, or when the
+ * next line is left to streamRecord).
+ * ============================================================ */
+static size_t fillChunk(LineReader *reader, BatchChunk *chunk)
+{
+    char *line;
+    size_t len;
+
+    chunk->inputLen = 0;
+    chunk->records = 0;
+    while (chunk->inputLen < BATCH_CHUNK_SIZE &&
+           (line = readLine(reader, &len)) != NULL) {
+        len = strlen(line);  /* A record ends at its first NUL, as in processRecord */
+        if (chunk->inputLen + len + 1 > chunk->inputCap) {
+            size_t cap = chunk->inputCap ? chunk->inputCap : BATCH_CHUNK_SIZE;
+            char *grown;
+
+            while (cap < chunk->inputLen + len + 1)
+                cap *= 2;
+            grown = realloc(chunk->input, cap);
+            if (grown == NULL) {
+                chunk->failed = 1;
+                break;
+            }
+            chunk->input = grown;
+            chunk->inputCap = cap;
+        }
+        memcpy(chunk->input + chunk->inputLen, line, len + 1);
+        chunk->inputLen += len + 1;
+        chunk->records++;
+    }
+    return chunk->records;
+}
+
+/* ============================================================
+ * Helper: processChunk (pool task)
+ * Evaluates a chunk with the running thread's own state, then
+ * marks it done for the writer.
+ * ============================================================ */
+static void processChunk(void *arg, int worker)
+{
+    BatchChunk *chunk = arg;
+    ParallelRun *run = chunk->run;
+    BatchWorker *w = &run->workers[worker];
+    const char *p = chunk->input;
+    const char *end = chunk->input + chunk->inputLen;
+
+    while (p < end) {
+        size_t len = strlen(p);
+
+        processRecord(run->mode, p, len, w, &chunk->output);
+        p += len + 1;
+    }
+
+    pthread_mutex_lock(&run->lock);
+    chunk->done = 1;
+    pthread_cond_broadcast(&run->finished);
+    pthread_mutex_unlock(&run->lock);
+}
+
+/* ============================================================
+ * Helper: runParallel
+ * The calling thread reads chunks and hands them to the pool; up
+ * to 'window' chunks are in flight. Results are written from the
+ * reorder buffer strictly in input order: chunk n is written only
+ * after chunks 0..n-1, however the workers finish. A compress /
+ * expand line too long for the reader is streamed by the calling
+ * thread once every chunk before it is written.
+ * ============================================================ */
+static int runParallel(BatchMode mode, LineReader *reader, BatchSink *out,
+                       const BatchOptions *opts)
+{
+    ParallelRun run;
+    ThreadPool pool;
+    BatchChunk *chunks;
+    int threads = opts->threads > 0 ? opts->threads : poolCpuCount();
+    int window = threads * BATCH_CHUNKS_PER_THREAD;
+    Output streamed = { NULL, 0, 0, 0 };
+    unsigned long submitted = 0, written = 0;
+    int inputDone = 0;
+    int ok = 1;
+    int i;
+
+    if (!poolInit(&pool, threads, exprReleaseScratch))
+        return runSerial(mode, reader, out, opts);
+
+    chunks = calloc((size_t)window, sizeof(BatchChunk));
+    run.workers = malloc((size_t)(threads + 1) * sizeof(BatchWorker));
+    if (chunks == NULL || run.workers == NULL) {
+        poolFree(&pool);
+        free(chunks);
+        free(run.workers);
+        return 0;
+    }
+    run.mode = mode;
+    pthread_mutex_init(&run.lock, NULL);
+    pthread_cond_init(&run.finished, NULL);
+    for (i = 0; i <= threads; i++)
+        initWorker(&run.workers[i], mode, opts);
+
+
+    for (;;) {
+        BatchChunk *chunk;
+
+        /* Keep the window full (up to a line to stream) */
+        while (!inputDone && !reader->longLine && submitted - written < (unsigned long)window) {
+            chunk = &chunks[submitted % (unsigned long)window];
+            chunk->run = &run;
+            chunk->done = 0;
+            if (fillChunk(reader, chunk) == 0) {
+                inputDone = !reader->longLine;
+                break;
+            }
+            if (!poolSubmit(&pool, processChunk, chunk))
+                processChunk(chunk, threads);   /* Out of memory: run it here */
+            submitted++;
+        }
+
+        /* A line too long for a chunk streams here, after the chunks before it */
+        if (written == submitted && reader->longLine) {
+            ok &= streamRecord(mode, reader, &streamed, out);
+            ok &= flushOutput(&streamed, out);
+            continue;
+        }
+        if (written == submitted)
+            break;
+
+        /* Write the oldest chunk once it is done */
+        chunk = &chunks[written % (unsigned long)window];
+        pthread_mutex_lock(&run.lock);
+        while (!chunk->done)
+            pthread_cond_wait(&run.finished, &run.lock);
+        pthread_mutex_unlock(&run.lock);
+
+        if (chunk->failed)
+            ok = 0;
+        ok &= flushOutput(&chunk->output, out);
+        chunk->failed = 0;
+        written++;
+        statsPoll(stderr);
+    }
+
+    poolFree(&pool);
+    for (i = 0; i <= threads; i++)
+        freeWorker(&run.workers[i]);
+    for (i = 0; i < window; i++) {
+        free(chunks[i].input);
+        free(chunks[i].output.data);
+    }
+    pthread_mutex_destroy(&run.lock);
+    pthread_cond_destroy(&run.finished);
+    free(streamed.data);
+    free(chunks);
+    free(run.workers);
+    return ok;
+}
+
+/* ============================================================
+ * Function: runBatch
+ * ============================================================ */
+int runBatch(BatchMode mode, FILE *in, FILE *out, const BatchOptions *opts)
+{
+    LineReader reader;
+    BatchSink sink;
+    AsyncStream inStream, outStream;
+    int ok;
+
+    if (initReader(&reader, in) != 0)
+        return -1;
+    setvbuf(out, NULL, _IOFBF, BATCH_BUFFER_SIZE);
+    reader.streamLong = (mode == BATCH_COMPRESS || mode == BATCH_EXPAND);
+    sink.file = out;
+    sink.async = NULL;
+
+    /*
+     * Regular files are read and written through async streams on
+     * their descriptors: only when nothing is buffered in the FILE
+     * (ftell is at the descriptor's position) and, for the output,
+     * once whatever it holds is flushed.
+     */
+    if (opts->asyncIo) {
+        off_t position = lseek(fileno(in), 0, SEEK_CUR);
+
+        if (position >= 0 && ftello(in) == position &&
+            asyncOpenReader(&inStream, fileno(in)) == 0)
+            reader.async = &inStream;
+        if (fflush(out) == 0 && asyncOpenWriter(&outStream, fileno(out)) == 0)
+            sink.async = &outStream;
+    }
+
+    /* Reduce mode spends its threads inside each record */
+    if (opts->threads == 1 || mode == BATCH_REDUCE)
+        ok = runSerial(mode, &reader, &sink, opts);
+    else
+        ok = runParallel(mode, &reader, &sink, opts);
+
+    if (reader.async != NULL && asyncClose(reader.async) != 0)
+        ok = 0;
+    if (sink.async != NULL && asyncClose(sink.async) != 0)
+        ok = 0;
+    if (!ok || ferror(in) || !reader.eof || fflush(out) != 0 || ferror(out))
+        ok = 0;
+
+    freeReader(&reader);
+    return ok ? 0 : -1;
+}
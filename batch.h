@@ -0,0 +1,67 @@
+/*
+ * batch.h
+ *
+ * Header file for the non-interactive batch mode.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+
+/* Size of each buffered read/write in batch mode */
+#define BATCH_BUFFER_SIZE (1 << 20)
+
+/* Input bytes per parallel work unit */
+#define BATCH_CHUNK_SIZE (64 * 1024)
+
+/* Chunks in flight per thread (bounds the reorder buffer) */
+#define BATCH_CHUNKS_PER_THREAD 4
+
+/* Operation applied to every input record */
+typedef enum {
+    BATCH_EVAL,
+    BATCH_REDUCE,       /* eval, each record split over all threads */
+    BATCH_COMPRESS,
+    BATCH_EXPAND
+} BatchMode;
+
+/* Tunables for a batch run */
+typedef struct {
+    int cacheCapacity;      /* Expression cache entries per thread (0 disables) */
+    int threads;            /* Worker threads; 1 = serial, 0 = one per CPU */
+    int asyncIo;            /* Regular files through async_io.h (default 1) */
+} BatchOptions;
+
+/*
+ * Fills in the default options.
+ */
+void initBatchOptions(BatchOptions *opts);
+
+/*
+ * Parses a mode name ("eval", "reduce", "compress", "expand").
+ * Returns 1 and stores the mode if recognized, 0 otherwise.
+ */
+int parseBatchMode(const char *name, BatchMode *mode);
+
+/*
+ * Reads newline-delimited records from 'in' and writes one result
+ * per line to 'out', without prompts. Invalid records produce an
+ * inline "error: ..." line. Output order matches input order for
+ * any thread count. With opts->asyncIo, a regular input or output
+ * file is read ahead / written behind through an AsyncStream, so
+ * the disk works while the records are processed. In compress and
+ * expand mode, a line longer than BATCH_BUFFER_SIZE is streamed
+ * through string_stream.h in constant memory; if it turns out
+ * invalid after part of its result was written, the line ends in
+ * " error: ..." instead.
+ * Returns 0 on success, -1 on an I/O error.
+ */
+int runBatch(BatchMode mode, FILE *in, FILE *out, const BatchOptions *opts);
+
+#endif
@@ -0,0 +1,117 @@
+/*
+ * bench_binary.c
+ *
+ * Decoding the binary run-length format against expanding the
+ * decimal text form on the same corpora as bench_compress. Both
+ * sides validate their input as they would on untrusted data:
+ * text goes through isValidCompressedRange, expandedSize and
+ * expandRange; binary through binaryDecode (which checks every
+ * block). Speed is given per decoded byte, and sizes of both
+ * encoded forms are printed.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -pthread -I. bench/bench_binary.c string_ops.c string_binary.c char_class.c phase_stats.c -o bench_binary
+ *   ./bench_binary [MB per corpus]
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "string_binary.h"
+#include "string_ops.h"
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Same generator as bench_compress */
+static void makeCorpus(char *buf, size_t len, const char *alphabet, unsigned maxRun)
+{
+    size_t n = strlen(alphabet), i = 0;
+    unsigned seed = 17;
+    char prev = 0;
+
+    while (i < len) {
+        unsigned run;
+        char c;
+
+        do {
+            seed = seed * 1103515245u + 12345u;
+            c = alphabet[(seed >> 16) % n];
+        } while (maxRun == 1 && c == prev);
+        seed = seed * 1103515245u + 12345u;
+        run = 1 + (seed >> 16) % maxRun;
+        while (run-- > 0 && i < len)
+            buf[i++] = c;
+        prev = c;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct {
+        const char *name;
+        const char *alphabet;
+        unsigned maxRun;
+    } CORPORA[] = {
+        { "no runs", "abcdefghijklmnopqrstuvwxyz", 1 },
+        { "genome", "ACGT", 4 },
+        { "log-like", "abcdeXYZ", 40 },
+        { "long runs", "ab", 100000 },
+    };
+    size_t len = (size_t)((argc > 1) ? atol(argv[1]) : 256) << 20;
+    char *in = malloc(len);
+    char *text = malloc(len);
+    unsigned char *bin = malloc(binaryEncodedBound(len));
+    char *out = malloc(len + 16);
+    size_t i;
+
+    if (in == NULL || text == NULL || bin == NULL || out == NULL)
+        return 1;
+    memset(out, 0, len);    /* Fault the pages in before timing */
+    printf("%zu MB per corpus\n", len >> 20);
+    printf("%-10s %10s %10s %12s %12s %8s\n", "corpus", "text MB", "binary MB",
+           "text", "binary", "speedup");
+
+    for (i = 0; i < sizeof(CORPORA) / sizeof(CORPORA[0]); i++) {
+        size_t textLen, binLen, n;
+        double t0, tText, tBin;
+        int same;
+
+        makeCorpus(in, len, CORPORA[i].alphabet, CORPORA[i].maxRun);
+        textLen = compressRange(in, len, text);
+        binLen = binaryEncodeRange(in, len, bin);
+
+        t0 = nowSeconds();
+        n = (isValidCompressedRange(text, textLen) && expandedSize(text, textLen) == len)
+            ? expandRange(text, textLen, out) : 0;
+        tText = nowSeconds() - t0;
+        same = n == len && memcmp(out, in, len) == 0;
+
+        memset(out, 0, len);
+        t0 = nowSeconds();
+        n = binaryDecode(bin, binLen, out);
+        tBin = nowSeconds() - t0;
+        same &= n == len && memcmp(out, in, len) == 0;
+
+        printf("%-10s %10.1f %10.1f %7.2f GB/s %7.2f GB/s %7.2fx %s\n", CORPORA[i].name,
+               (double)textLen / (1024.0 * 1024.0), (double)binLen / (1024.0 * 1024.0),
+               (double)len / 1e9 / tText, (double)len / 1e9 / tBin, tText / tBin,
+               same ? "" : "OUTPUT DIFFERS");
+    }
+
+    free(in);
+    free(text);
+    free(bin);
+    free(out);
+    return 0;
+}
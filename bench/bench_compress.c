@@ -0,0 +1,164 @@
+/*
+ * bench_compress.c
+ *
+ * Throughput of compressRange / expandRange against the original
+ * byte-at-a-time compressString (sprintf counts) and expandString
+ * on a few generated corpora: text with no runs, genome-like data
+ * (short runs of ACGT), log-like data (mixed short and long runs)
+ * and very long runs. Every output is checked against the original
+ * implementation; expansion speed is given per expanded byte.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -pthread -I. bench/bench_compress.c string_ops.c char_class.c phase_stats.c -o bench_compress
+ *   ./bench_compress [MB per corpus]
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "string_ops.h"
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* The compressString this repo started with, for reference */
+static size_t compressOriginal(const char *input, size_t len, char *output)
+{
+    size_t i = 0, j = 0;
+
+    while (i < len) {
+        size_t count = 1;
+
+        while (i + 1 < len && input[i] == input[i + 1]) {
+            count++;
+            i++;
+        }
+        if (count > 1)
+            j += (size_t)sprintf(&output[j], "%zu", count);
+        output[j++] = input[i];
+        i++;
+    }
+    return j;
+}
+
+/* The expandString this repo started with, for reference */
+static size_t expandOriginal(const char *input, size_t len, char *output)
+{
+    size_t i = 0, j = 0;
+
+    while (i < len) {
+        size_t count = 0;
+
+        while (isdigit((unsigned char)input[i])) {
+            count = count * 10 + (size_t)(input[i] - '0');
+            i++;
+        }
+        if (count == 0)
+            count = 1;
+        while (count-- > 0)
+            output[j++] = input[i];
+        i++;
+    }
+    return j;
+}
+
+/*
+ * Fills buf with runs of letters from 'alphabet', each run
+ * 1..maxRun long (no two neighbouring runs share a letter when
+ * maxRun is 1, so the text has no runs at all).
+ */
+static void makeCorpus(char *buf, size_t len, const char *alphabet, unsigned maxRun)
+{
+    size_t n = strlen(alphabet), i = 0;
+    unsigned seed = 17;
+    char prev = 0;
+
+    while (i < len) {
+        unsigned run;
+        char c;
+
+        do {
+            seed = seed * 1103515245u + 12345u;
+            c = alphabet[(seed >> 16) % n];
+        } while (maxRun == 1 && c == prev);
+        seed = seed * 1103515245u + 12345u;
+        run = 1 + (seed >> 16) % maxRun;
+        while (run-- > 0 && i < len)
+            buf[i++] = c;
+        prev = c;
+    }
+}
+
+static double timeKernel(size_t (*fn)(const char *, size_t, char *),
+                         const char *in, size_t len, char *out, size_t *outLen)
+{
+    double t0 = nowSeconds();
+
+    *outLen = fn(in, len, out);
+    return nowSeconds() - t0;
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct {
+        const char *name;
+        const char *alphabet;
+        unsigned maxRun;
+    } CORPORA[] = {
+        { "no runs", "abcdefghijklmnopqrstuvwxyz", 1 },
+        { "genome", "ACGT", 4 },
+        { "log-like", "abcdeXYZ", 40 },
+        { "long runs", "ab", 100000 },
+    };
+    size_t len = (size_t)((argc > 1) ? atol(argv[1]) : 256) << 20;
+    char *in = malloc(len);
+    char *ref = malloc(len);
+    char *out = malloc(len);
+    size_t i;
+
+    if (in == NULL || ref == NULL || out == NULL)
+        return 1;
+    memset(ref, 0, len);    /* Fault the pages in before timing */
+    memset(out, 0, len);
+    printf("%zu MB per corpus, kernel: %s\n", len >> 20, compressKernelName());
+    printf("%-10s %-8s %12s %12s %8s\n", "corpus", "", "original", "new", "speedup");
+
+    for (i = 0; i < sizeof(CORPORA) / sizeof(CORPORA[0]); i++) {
+        size_t refLen, outLen, packedLen;
+        double tRef, tNew;
+
+        makeCorpus(in, len, CORPORA[i].alphabet, CORPORA[i].maxRun);
+        tRef = timeKernel(compressOriginal, in, len, ref, &refLen);
+        tNew = timeKernel(compressRange, in, len, out, &outLen);
+
+        printf("%-10s %-8s %9.2f GB/s %7.2f GB/s %7.2fx %s\n", CORPORA[i].name, "compress",
+               (double)len / 1e9 / tRef, (double)len / 1e9 / tNew, tRef / tNew,
+               (refLen == outLen && memcmp(ref, out, refLen) == 0) ? "" : "OUTPUT DIFFERS");
+
+        /* Expand the compressed corpus back into ref / out */
+        memcpy(in, out, outLen);
+        packedLen = outLen;
+        tRef = timeKernel(expandOriginal, in, packedLen, ref, &refLen);
+        tNew = timeKernel(expandRange, in, packedLen, out, &outLen);
+
+        printf("%-10s %-8s %9.2f GB/s %7.2f GB/s %7.2fx %s\n", "", "expand",
+               (double)len / 1e9 / tRef, (double)len / 1e9 / tNew, tRef / tNew,
+               (refLen == len && outLen == len && memcmp(ref, out, len) == 0) ? "" : "OUTPUT DIFFERS");
+    }
+
+    free(in);
+    free(ref);
+    free(out);
+    return 0;
+}
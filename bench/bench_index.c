@@ -0,0 +1,114 @@
+/*
+ * bench_index.c
+ *
+ * Cost of building a RunIndex over a large compressed string and
+ * of random indexCharAt / indexExpandSlice lookups into it, next
+ * to expanding the whole string once. Every lookup is checked
+ * against the full expansion.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -pthread -I. bench/bench_index.c string_ops.c string_index.c char_class.c phase_stats.c -o bench_index
+ *   ./bench_index [expanded MB] [lookups]
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "string_index.h"
+#include "string_ops.h"
+
+/* Length of every slice read */
+#define SLICE_SIZE 256
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static unsigned seed = 29;
+
+static size_t nextRandom(void)
+{
+    seed = seed * 1103515245u + 12345u;
+    return seed >> 4;
+}
+
+/* Log-like runs of 1..40 letters */
+static void makeInput(char *buf, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len) {
+        size_t run = 1 + nextRandom() % 40;
+        char c = (char)('a' + nextRandom() % 6);
+
+        while (run-- > 0 && i < len)
+            buf[i++] = c;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t len = (size_t)((argc > 1) ? atol(argv[1]) : 256) << 20;
+    long lookups = (argc > 2) ? atol(argv[2]) : 1000000;
+    char *in = malloc(len), *text = malloc(len), *out = malloc(len);
+    char slice[SLICE_SIZE];
+    size_t textLen, n;
+    double t0, tExpand, tBuild, tChar, tSlice;
+    RunIndex index;
+    long i, wrong = 0;
+
+    if (in == NULL || text == NULL || out == NULL)
+        return 1;
+    makeInput(in, len);
+    textLen = compressRange(in, len, text);
+    memset(out, 0, len);    /* Fault the pages in before timing */
+
+    t0 = nowSeconds();
+    n = expandRange(text, textLen, out);
+    tExpand = nowSeconds() - t0;
+    wrong += n != len || memcmp(out, in, len) != 0;
+
+    t0 = nowSeconds();
+    if (!buildRunIndex(&index, text, textLen))
+        return 1;
+    tBuild = nowSeconds() - t0;
+
+    t0 = nowSeconds();
+    for (i = 0; i < lookups; i++) {
+        n = nextRandom() % len;
+        wrong += indexCharAt(&index, n) != in[n];
+    }
+    tChar = nowSeconds() - t0;
+
+    t0 = nowSeconds();
+    for (i = 0; i < lookups; i++) {
+        n = nextRandom() % (len - SLICE_SIZE);
+        wrong += indexExpandSlice(&index, n, n + SLICE_SIZE, slice) != SLICE_SIZE ||
+                 memcmp(slice, in + n, SLICE_SIZE) != 0;
+    }
+    tSlice = nowSeconds() - t0;
+
+    printf("%zu MB expanded, %.1f MB compressed, %zu samples\n", len >> 20,
+           (double)textLen / (1024.0 * 1024.0), index.count);
+    printf("full expansion   %10.2f ms\n", tExpand * 1e3);
+    printf("build index      %10.2f ms\n", tBuild * 1e3);
+    printf("indexCharAt      %10.0f ns/lookup\n", tChar * 1e9 / (double)lookups);
+    printf("indexExpandSlice %10.0f ns/lookup (%d bytes)\n", tSlice * 1e9 / (double)lookups, SLICE_SIZE);
+    if (wrong > 0)
+        printf("%ld WRONG RESULTS\n", wrong);
+
+    freeRunIndex(&index);
+    free(in);
+    free(text);
+    free(out);
+    return 0;
+}
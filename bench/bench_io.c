@@ -0,0 +1,224 @@
+/*
+ * bench_io.c
+ *
+ * End-to-end throughput of runBatch on large files with plain
+ * buffered stdio (--io=sync) and with the async streams of
+ * async_io.h, against the raw bandwidth of reading the input and of
+ * copying it. Before every run the input is dropped from the page
+ * cache (posix_fadvise), and the time includes syncing the output
+ * to disk, so the figures are disk-to-disk. Both modes must give
+ * the same output.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -pthread -I. bench/bench_io.c arena.c bigint.c expression.c expr_cache.c expr_optimize.c expr_parallel.c string_ops.c string_stream.c batch.c thread_pool.c async_io.c char_class.c phase_stats.c -o bench_io
+ *   ./bench_io [MB] [threads]
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "batch.h"
+
+/* Bytes per read / write of the raw baselines */
+#define RAW_BLOCK (1 << 20)
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double megabytes(size_t n)
+{
+    return (double)n / (1024.0 * 1024.0);
+}
+
+/* Writes a file to disk and drops it from the page cache */
+static void evict(FILE *f)
+{
+    fflush(f);
+    fdatasync(fileno(f));
+    posix_fadvise(fileno(f), 0, 0, POSIX_FADV_DONTNEED);
+}
+
+/* Size of a file and an FNV-1a hash of its contents */
+static unsigned long long hashFile(FILE *f, size_t *size)
+{
+    static char buf[RAW_BLOCK];
+    unsigned long long h = 1469598103934665603ull;
+    size_t n, i;
+
+    *size = 0;
+    rewind(f);
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        for (i = 0; i < n; i++)
+            h = (h ^ (unsigned char)buf[i]) * 1099511628211ull;
+        *size += n;
+    }
+    return h;
+}
+
+/* ============================================================
+ * Inputs: letter lines of about 4 KB in runs of 1..40 (a ratio
+ * near 0.15), and expressions of 2..25 operands
+ * ============================================================ */
+static void writeLetters(FILE *f, size_t bytes)
+{
+    unsigned seed = 3;
+    size_t written = 0, col = 0;
+
+    while (written < bytes) {
+        size_t run;
+        char c;
+
+        seed = seed * 1103515245u + 12345u;
+        c = (char)('a' + (seed >> 16) % 26);
+        run = 1 + (seed >> 8) % 40;
+        while (run-- > 0) {
+            fputc(c, f);
+            written++;
+            col++;
+        }
+        if (col >= 4096) {
+            fputc('\n', f);
+            written++;
+            col = 0;
+        }
+    }
+    fputc('\n', f);
+}
+
+static void writeExpressions(FILE *f, size_t bytes)
+{
+    static const char OPS[] = "+-*+%*+/";
+    unsigned seed = 7;
+    long start = ftell(f);
+
+    while ((size_t)(ftell(f) - start) < bytes) {
+        int terms, t;
+
+        seed = seed * 1103515245u + 12345u;
+        terms = 2 + (int)((seed >> 16) % 24);
+        for (t = 0; t < terms; t++) {
+            seed = seed * 1103515245u + 12345u;
+            if (t > 0)
+                fputc(OPS[(seed >> 16) & 7], f);
+            fprintf(f, "%u", ((seed >> 8) % 997) + 1);
+        }
+        fputc('\n', f);
+    }
+}
+
+/* ============================================================
+ * Raw baselines: read the input; copy it to another file
+ * ============================================================ */
+static double timeRaw(FILE *in, int copy)
+{
+    static char buf[RAW_BLOCK];
+    FILE *out = copy ? tmpfile() : NULL;
+    double t0;
+    ssize_t n;
+
+    if (copy && out == NULL)
+        exit(1);
+    evict(in);
+    lseek(fileno(in), 0, SEEK_SET);
+    t0 = nowSeconds();
+    while ((n = read(fileno(in), buf, sizeof(buf))) > 0)
+        if (copy && write(fileno(out), buf, (size_t)n) != n)
+            exit(1);
+    if (copy)
+        fdatasync(fileno(out));
+    t0 = nowSeconds() - t0;
+    if (copy)
+        fclose(out);
+    return t0;
+}
+
+/* ============================================================
+ * Helper: timeBatch
+ * One runBatch from disk to disk; the output is left in *out.
+ * ============================================================ */
+static double timeBatch(BatchMode mode, FILE *in, FILE **out, int asyncIo, int threads)
+{
+    BatchOptions opts;
+    double t0;
+
+    initBatchOptions(&opts);
+    opts.cacheCapacity = 0;
+    opts.threads = threads;
+    opts.asyncIo = asyncIo;
+    if ((*out = tmpfile()) == NULL)
+        exit(1);
+    evict(in);
+    rewind(in);
+
+    t0 = nowSeconds();
+    if (runBatch(mode, in, *out, &opts) != 0)
+        exit(1);
+    fflush(*out);
+    fdatasync(fileno(*out));
+    return nowSeconds() - t0;
+}
+
+/* Runs one workload both ways and prints two rows */
+static FILE *compareModes(const char *name, BatchMode mode, FILE *in, size_t inLen, int threads)
+{
+    FILE *syncOut, *asyncOut;
+    double tSync = timeBatch(mode, in, &syncOut, 0, threads);
+    double tAsync = timeBatch(mode, in, &asyncOut, 1, threads);
+    size_t syncLen, asyncLen;
+    int same = hashFile(syncOut, &syncLen) == hashFile(asyncOut, &asyncLen) && syncLen == asyncLen;
+
+    printf("%-10s %-6s %9.3fs %10.1f %10.1f\n", name, "sync", tSync,
+           megabytes(inLen) / tSync, megabytes(syncLen) / tSync);
+    printf("%-10s %-6s %9.3fs %10.1f %10.1f %6.2fx %s\n", name, "async", tAsync,
+           megabytes(inLen) / tAsync, megabytes(asyncLen) / tAsync, tSync / tAsync,
+           same ? "" : "OUTPUT DIFFERS");
+    fclose(asyncOut);
+    return syncOut;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t bytes = (size_t)((argc > 1) ? atol(argv[1]) : 512) << 20;
+    int threads = (argc > 2) ? atoi(argv[2]) : 1;
+    FILE *letters = tmpfile(), *exprs = tmpfile(), *packed;
+    size_t lettersLen, exprsLen, packedLen;
+    double t;
+
+    if (letters == NULL || exprs == NULL)
+        return 1;
+    writeLetters(letters, bytes);
+    writeExpressions(exprs, bytes / 4);
+    hashFile(letters, &lettersLen);
+    hashFile(exprs, &exprsLen);
+
+    printf("%.0f MB of letters, %.0f MB of expressions, %d thread(s)\n",
+           megabytes(lettersLen), megabytes(exprsLen), threads);
+    printf("%-10s %-6s %10s %10s %10s\n", "workload", "io", "time", "MB/s in", "MB/s out");
+    t = timeRaw(letters, 0);
+    printf("%-10s %-6s %9.3fs %10.1f\n", "raw read", "-", t, megabytes(lettersLen) / t);
+    t = timeRaw(letters, 1);
+    printf("%-10s %-6s %9.3fs %10.1f %10.1f\n", "raw copy", "-", t,
+           megabytes(lettersLen) / t, megabytes(lettersLen) / t);
+
+    packed = compareModes("compress", BATCH_COMPRESS, letters, lettersLen, threads);
+    hashFile(packed, &packedLen);
+    fclose(compareModes("expand", BATCH_EXPAND, packed, packedLen, threads));
+    fclose(compareModes("eval", BATCH_EVAL, exprs, exprsLen, threads));
+
+    fclose(packed);
+    fclose(letters);
+    fclose(exprs);
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * bench_jit.c
+ *
+ * Compares the token interpreter (evaluateCompiledRow) with the
+ * JIT (jitEvaluate) on the same compiled expressions. Before timing,
+ * the JIT must give the interpreter's result on every row (edge rows
+ * included: overflow, division by zero, INT_MIN / -1); otherwise
+ * the bench stops with status 1.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -pthread -I. bench/bench_jit.c arena.c bigint.c expression.c expr_optimize.c expr_jit.c char_class.c phase_stats.c -o bench_jit
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "expression.h"
+#include "expr_optimize.h"
+#include "expr_jit.h"
+
+#define ROWS 1024
+#define DEFAULT_ITERATIONS 10000000L
+
+static const char *VAR_NAMES[] = { "x", "y", "z" };
+
+static const char *EXPRESSIONS[] = {
+    "x + 5",
+    "(x * 3 + y) % 7 - z / (y + 2) * 2",
+    "(x*y+z)*(x*y+z) - (x*y+z)%97 + x*x*x - y*y + 1000",
+    "((x+1)*(y+2)*(z+3) + (x+4)*(y+5)) / ((z%13)+1) - x*y*z % 1009"
+};
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Edge rows, copied over the first random ones */
+static const int EDGE_ROWS[][3] = {
+    { INT_MAX, INT_MAX, INT_MAX }, { INT_MIN, -1, 0 }, { INT_MIN, INT_MIN, -1 },
+    { 0, -2, -3 }, { -1, 0, 12 }
+};
+
+/* ============================================================
+ * Helper: countMismatches
+ * Rows on which native code and interpreter disagree (printing
+ * the first one).
+ * ============================================================ */
+static int countMismatches(const char *text, const CompiledExpr *expr, JitExpr *jit,
+                           int rows[][3])
+{
+    static char ta[4096], tb[4096];
+    ExprValue a = EXPR_VALUE_INIT, b = EXPR_VALUE_INIT;
+    int mismatches = 0;
+    int r;
+
+    for (r = 0; r < ROWS; r++) {
+        ExprStatus sa = evaluateCompiledRow(expr, rows[r], &a);
+        ExprStatus sb = jitEvaluate(jit, rows[r], &b);
+
+        if (sa == sb && (sa != EXPR_OK || (exprValueToText(&a, ta) && exprValueToText(&b, tb) &&
+                                           strcmp(ta, tb) == 0)))
+            continue;
+        if (mismatches++ == 0)
+            fprintf(stderr, "%s: x=%d y=%d z=%d: interpreter %s, jit %s\n", text, rows[r][0],
+                    rows[r][1], rows[r][2], sa == EXPR_OK ? ta : "error", sb == EXPR_OK ? tb : "error");
+    }
+    freeExprValue(&a);
+    freeExprValue(&b);
+    return mismatches;
+}
+
+int main(int argc, char *argv[])
+{
+    static int rows[ROWS][3];
+    long iterations = (argc > 1) ? atol(argv[1]) : DEFAULT_ITERATIONS;
+    size_t e;
+    int r;
+
+    srand(124);
+    for (r = 0; r < ROWS; r++) {
+        rows[r][0] = rand() % 10000;
+        rows[r][1] = rand() % 10000;
+        rows[r][2] = rand() % 10000;
+    }
+    memcpy(rows, EDGE_ROWS, sizeof(EDGE_ROWS));
+
+    printf("%-62s %12s %12s %8s\n", "expression", "interp ns/op", "jit ns/op", "speedup");
+
+    for (e = 0; e < sizeof(EXPRESSIONS) / sizeof(EXPRESSIONS[0]); e++) {
+        CompiledExpr expr = COMPILED_INIT;
+        JitExpr jit;
+        ExprValue value = EXPR_VALUE_INIT;
+        volatile long long sink = 0;
+        double t0, interp, native;
+        long i;
+
+        if (compileExpression(EXPRESSIONS[e], VAR_NAMES, 3, &expr, NULL) != EXPR_OK)
+            return 1;
+        optimizeCompiled(&expr);
+
+        t0 = nowSeconds();
+        for (i = 0; i < iterations; i++) {
+            evaluateCompiledRow(&expr, rows[i & (ROWS - 1)], &value);
+            sink += value.small;
+        }
+        interp = nowSeconds() - t0;
+
+        jitInit(&jit, &expr, 0);
+        if (!jitCompile(&jit)) {
+            printf("%-62s %12.2f %12s\n", EXPRESSIONS[e], interp * 1e9 / iterations, "n/a");
+            freeCompiled(&expr);
+            continue;
+        }
+        if (countMismatches(EXPRESSIONS[e], &expr, &jit, rows) != 0) {
+            fprintf(stderr, "bench_jit: JIT and interpreter disagree\n");
+            return 1;
+        }
+        t0 = nowSeconds();
+        for (i = 0; i < iterations; i++) {
+            jitEvaluate(&jit, rows[i & (ROWS - 1)], &value);
+            sink += value.small;
+        }
+        native = nowSeconds() - t0;
+        jitFree(&jit);
+        freeCompiled(&expr);
+        freeExprValue(&value);
+
+        printf("%-62s %12.2f %12.2f %7.1fx\n", EXPRESSIONS[e],
+               interp * 1e9 / iterations, native * 1e9 / iterations, interp / native);
+        (void)sink;
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*
+ * bench_reduce.c
+ *
+ * Scaling of evaluateParallel on one huge expression: a sum of
+ * products with a few / and % terms and parenthesized groups is
+ * evaluated with evaluateInfix and then with 2, 4, ... 64 threads.
+ * Every parallel result is checked against the sequential one.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -pthread -I. bench/bench_reduce.c arena.c bigint.c expression.c expr_parallel.c thread_pool.c char_class.c phase_stats.c -o bench_reduce
+ *   ./bench_reduce [operands] [max threads]
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "expr_parallel.h"
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Builds "a*b+c*d-...": mostly products of two operands, every
+ * 16th term divided or reduced modulo a third one, every 1024th
+ * term wrapped in parentheses with a nested sum.
+ */
+static char *makeExpression(long operands)
+{
+    static const char SUM_OPS[] = "++-+";
+    char *expr = malloc((size_t)operands * 12 + 64);
+    char *p = expr;
+    unsigned seed = 11;
+    long i = 0;
+
+    if (expr == NULL)
+        return NULL;
+    while (i < operands) {
+        seed = seed * 1103515245u + 12345u;
+        if (i > 0)
+            *p++ = SUM_OPS[(seed >> 16) & 3];
+        if (i % 1024 == 512) {
+            p += sprintf(p, "(%u+%u*%u)", (seed >> 8) % 997 + 1,
+                         (seed >> 4) % 991 + 1, (seed >> 12) % 983 + 1);
+            i += 3;
+        } else if (i % 16 == 8) {
+            p += sprintf(p, "%u*%u%c%u", (seed >> 8) % 997 + 1,
+                         (seed >> 4) % 991 + 1, (seed & 1) ? '/' : '%',
+                         (seed >> 12) % 89 + 1);
+            i += 3;
+        } else {
+            p += sprintf(p, "%u*%u", (seed >> 8) % 997 + 1, (seed >> 4) % 991 + 1);
+            i += 2;
+        }
+    }
+    *p = '\0';
+    return expr;
+}
+
+/* Decimal text of a value (malloc'd) */
+static char *valueText(const ExprValue *v)
+{
+    char *text = malloc(exprValueTextSize(v));
+
+    if (text != NULL)
+        exprValueToText(v, text);
+    return text;
+}
+
+int main(int argc, char *argv[])
+{
+    long operands = (argc > 1) ? atol(argv[1]) : 4000000;
+    int maxThreads = (argc > 2) ? atoi(argv[2]) : 64;
+    char *expr = makeExpression(operands);
+    char *reference;
+    ExprValue value = EXPR_VALUE_INIT;
+    double t0, base;
+    int threads;
+
+    if (expr == NULL)
+        return 1;
+    printf("%ld operands (%.1f MB)\n", operands, (double)strlen(expr) / (1024.0 * 1024.0));
+    printf("%7s %10s %10s %8s\n", "threads", "time", "MB/s", "speedup");
+
+    t0 = nowSeconds();
+    if (evaluateInfix(expr, &value, NULL) != EXPR_OK)
+        return 1;
+    base = nowSeconds() - t0;
+    reference = valueText(&value);
+    if (reference == NULL)
+        return 1;
+    printf("%7s %9.3fs %10.1f %7.2fx\n", "seq", base,
+           (double)strlen(expr) / (1024.0 * 1024.0) / base, 1.0);
+
+    for (threads = 2; threads <= maxThreads; threads *= 2) {
+        ParallelEvaluator pe;
+        ExprStatus status;
+        char *result;
+        double elapsed;
+        int same;
+
+        if (!parallelInit(&pe, threads))
+            return 1;
+        t0 = nowSeconds();
+        status = evaluateParallel(&pe, expr, &value, NULL);
+        elapsed = nowSeconds() - t0;
+        parallelFree(&pe);
+
+        result = (status == EXPR_OK) ? valueText(&value) : NULL;
+        same = result != NULL && strcmp(result, reference) == 0;
+        free(result);
+
+        printf("%7d %9.3fs %10.1f %7.2fx %s\n", threads, elapsed,
+               (double)strlen(expr) / (1024.0 * 1024.0) / elapsed,
+               base / elapsed, same ? "" : "RESULT DIFFERS");
+    }
+
+    freeExprValue(&value);
+    free(reference);
+    free(expr);
+    return 0;
+}
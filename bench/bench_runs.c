@@ -0,0 +1,105 @@
+/*
+ * bench_runs.c
+ *
+ * compareCompressed and letterHistogram on two large compressed
+ * strings that differ only near the end, against expanding both
+ * and working on the expansions (memcmp / a counting loop). The
+ * results of both ways are checked against each other.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -pthread -I. bench/bench_runs.c string_ops.c string_runs.c char_class.c phase_stats.c -o bench_runs
+ *   ./bench_runs [expanded MB]
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "string_ops.h"
+#include "string_runs.h"
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Log-like runs of 1..200 letters */
+static void makeInput(char *buf, size_t len)
+{
+    unsigned seed = 31;
+    size_t i = 0;
+
+    while (i < len) {
+        size_t run;
+        char c;
+
+        seed = seed * 1103515245u + 12345u;
+        c = (char)('a' + (seed >> 16) % 6);
+        run = 1 + (seed >> 8) % 200;
+        while (run-- > 0 && i < len)
+            buf[i++] = c;
+    }
+}
+
+static int sign(int x)
+{
+    return (x > 0) - (x < 0);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t len = (size_t)((argc > 1) ? atol(argv[1]) : 256) << 20;
+    char *in = malloc(len), *textA = malloc(len), *textB = malloc(len);
+    char *outA = malloc(len), *outB = malloc(len);
+    size_t lenA, lenB, i;
+    size_t direct[256] = { 0 }, expanded[256] = { 0 };
+    double t0, tDirect, tExpanded;
+    int cmpDirect, cmpExpanded;
+
+    if (in == NULL || textA == NULL || textB == NULL || outA == NULL || outB == NULL)
+        return 1;
+    makeInput(in, len);
+    lenA = compressRange(in, len, textA);
+    in[len - 2] = (in[len - 2] == 'z') ? 'y' : 'z';
+    lenB = compressRange(in, len, textB);
+    memset(outA, 0, len);   /* Fault the pages in before timing */
+    memset(outB, 0, len);
+    printf("%zu MB expanded, %.1f MB compressed\n", len >> 20, (double)lenA / (1024.0 * 1024.0));
+    printf("%-10s %14s %14s %8s\n", "", "expanded", "compressed", "speedup");
+
+    t0 = nowSeconds();
+    expandRange(textA, lenA, outA);
+    expandRange(textB, lenB, outB);
+    cmpExpanded = sign(memcmp(outA, outB, len));
+    tExpanded = nowSeconds() - t0;
+    t0 = nowSeconds();
+    cmpDirect = sign(compareCompressed(textA, lenA, textB, lenB));
+    tDirect = nowSeconds() - t0;
+    printf("%-10s %11.2f ms %11.2f ms %7.2fx %s\n", "compare", tExpanded * 1e3, tDirect * 1e3,
+           tExpanded / tDirect, (cmpDirect == cmpExpanded) ? "" : "RESULTS DIFFER");
+
+    t0 = nowSeconds();
+    expandRange(textA, lenA, outA);
+    for (i = 0; i < len; i++)
+        expanded[(unsigned char)outA[i]]++;
+    tExpanded = nowSeconds() - t0;
+    t0 = nowSeconds();
+    letterHistogram(textA, lenA, direct);
+    tDirect = nowSeconds() - t0;
+    printf("%-10s %11.2f ms %11.2f ms %7.2fx %s\n", "histogram", tExpanded * 1e3, tDirect * 1e3,
+           tExpanded / tDirect, memcmp(direct, expanded, sizeof(direct)) == 0 ? "" : "RESULTS DIFFER");
+
+    free(in);
+    free(textA);
+    free(textB);
+    free(outA);
+    free(outB);
+    return 0;
+}
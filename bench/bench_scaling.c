@@ -0,0 +1,127 @@
+/*
+ * bench_scaling.c
+ *
+ * Shows that expression cost grows linearly with size now that the
+ * stacks are arena-backed: generates expressions from 1 MB up to
+ * 100 MB (long operator chains and deep nesting) and reports the
+ * throughput of the fused evaluator and of compile + evaluate.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -pthread -I. bench/bench_scaling.c arena.c bigint.c expression.c char_class.c phase_stats.c -o bench_scaling
+ *   ./bench_scaling [max MB]
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "expression.h"
+
+#define MB (1024UL * 1024UL)
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* "12*3+45*6-7*8+..." of about 'size' bytes */
+static char *makeChain(size_t size)
+{
+    static const char OPS[] = "+-*+%*+/";
+    char *buf = malloc(size + 16);
+    size_t n = 0;
+    unsigned seed = 1;
+
+    if (buf == NULL)
+        return NULL;
+    while (n < size) {
+        seed = seed * 1103515245u + 12345u;
+        if (n > 0)
+            buf[n++] = OPS[(seed >> 16) & 7];
+        n += (size_t)sprintf(buf + n, "%u", ((seed >> 8) % 97) + 1);
+    }
+    buf[n] = '\0';
+    return buf;
+}
+
+/* "(1+(2+(3+ ... )))": nesting depth grows with size */
+static char *makeNested(size_t size)
+{
+    size_t depth = size / 4;
+    char *buf = malloc(depth * 4 + 2);
+    size_t i, n = 0;
+
+    if (buf == NULL)
+        return NULL;
+    for (i = 0; i < depth; i++) {
+        buf[n++] = '(';
+        buf[n++] = (char)('1' + i % 9);
+        buf[n++] = '+';
+    }
+    buf[n++] = '1';
+    for (i = 0; i < depth; i++)
+        buf[n++] = ')';
+    buf[n] = '\0';
+    return buf;
+}
+
+static void run(const char *shape, char *expr)
+{
+    CompiledExpr compiled = COMPILED_INIT;
+    size_t len = strlen(expr);
+    double t0, fused, compiledTime;
+    ExprValue result = EXPR_VALUE_INIT, value = EXPR_VALUE_INIT;
+    int offset, same;
+
+    t0 = nowSeconds();
+    evaluateInfix(expr, &result, &offset);
+    fused = nowSeconds() - t0;
+
+    t0 = nowSeconds();
+    if (compileInfix(expr, &compiled))
+        evaluateCompiled(&compiled, &value);
+    compiledTime = nowSeconds() - t0;
+
+    same = result.isBig ? (value.isBig && bigCompare(&result.big, &value.big) == 0)
+                        : (!value.isBig && result.small == value.small);
+
+    printf("%-7s %8.1f MB %10.3f s %9.1f MB/s %10.3f s %9.1f MB/s %s\n",
+           shape, (double)len / MB,
+           fused, (double)len / MB / fused,
+           compiledTime, (double)len / MB / compiledTime,
+           same ? "" : "MISMATCH");
+    freeCompiled(&compiled);
+    freeExprValue(&result);
+    freeExprValue(&value);
+}
+
+int main(int argc, char *argv[])
+{
+    size_t maxMb = (argc > 1) ? (size_t)atol(argv[1]) : 100;
+    size_t mb;
+
+    printf("%-7s %11s %12s %14s %12s %14s\n",
+           "shape", "size", "fused", "fused rate", "compile+eval", "rate");
+
+    for (mb = 1; mb <= maxMb; mb *= 10) {
+        char *chain = makeChain(mb * MB);
+        char *nested = makeNested(mb * MB);
+
+        if (chain == NULL || nested == NULL) {
+            fprintf(stderr, "out of memory at %lu MB\n", (unsigned long)mb);
+            return 1;
+        }
+        run("chain", chain);
+        run("nested", nested);
+        free(chain);
+        free(nested);
+    }
+    return 0;
+}
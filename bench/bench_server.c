@@ -0,0 +1,465 @@
+/*
+ * bench_server.c
+ *
+ * Load generator for server mode (server.h). For each operation
+ * (eval, compress, expand) and pipeline depth, every connection
+ * keeps that many requests in flight on its own thread for the
+ * run time; the report gives requests per second and the p50 /
+ * p99 / max round trip of one request, from its send to its
+ * response. Every response is checked against the kernels. By
+ * default a server is started in this process on a temporary
+ * socket; --socket connects to a running "pe1 serve" instead.
+ * --spawn times a fresh "pe1 eval" process per record, the cost
+ * the server saves.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -pthread -I. bench/bench_server.c server.c arena.c bigint.c expression.c string_ops.c char_class.c phase_stats.c -o bench_server
+ *   ./bench_server [--socket=PATH] [--connections=N] [--time=SECONDS] [--spawn=./pe1]
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "expression.h"
+#include "server.h"
+#include "string_ops.h"
+
+/* Distinct records per operation, sent round-robin */
+#define RECORD_COUNT 64
+
+/* Bytes taken per recv */
+#define RECV_SIZE (64 * 1024)
+
+/* Processes started by --spawn */
+#define SPAWN_COUNT 200
+
+extern char **environ;
+
+/* Encoded requests of one operation and the payloads they must get back */
+typedef struct {
+    const char *name;
+    unsigned char *frames[RECORD_COUNT];
+    size_t frameLen[RECORD_COUNT];
+    char *expected[RECORD_COUNT];
+    size_t expectedLen[RECORD_COUNT];
+} Workload;
+
+/* One connection's run */
+typedef struct {
+    pthread_t thread;
+    const char *path;
+    const Workload *work;
+    int depth;
+    double seconds;
+    unsigned long long done;
+    double *latency;        /* Round trips in seconds, one per response */
+    size_t latencyCount;
+    size_t latencyCap;
+    int failed;
+} Client;
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static unsigned nextRandom(unsigned *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 8;
+}
+
+/* ============================================================
+ * Workloads: short records, the size of a typical request
+ * ============================================================ */
+static void addRecord(Workload *w, int i, ServerOp op, const char *text, size_t len,
+                      const char *expected, size_t expectedLen)
+{
+    w->frames[i] = malloc(SERVER_HEADER_SIZE + len);
+    w->expected[i] = malloc(expectedLen + 1);
+    if (w->frames[i] == NULL || w->expected[i] == NULL)
+        exit(1);
+    serverPutHeader(w->frames[i], op, len);
+    memcpy(w->frames[i] + SERVER_HEADER_SIZE, text, len);
+    w->frameLen[i] = SERVER_HEADER_SIZE + len;
+    memcpy(w->expected[i], expected, expectedLen);
+    w->expectedLen[i] = expectedLen;
+}
+
+/* Expressions of 3 to 10 operands, some parenthesized */
+static void makeEvalWorkload(Workload *w)
+{
+    unsigned seed = 7;
+    int i;
+
+    w->name = "eval";
+    for (i = 0; i < RECORD_COUNT; i++) {
+        char expr[256], value[32];
+        int operands = 3 + (int)(nextRandom(&seed) % 8), k, n = 0, open = 0;
+        long long result;
+
+        for (k = 0; k < operands; k++) {
+            if (k > 0)
+                n += sprintf(expr + n, " %c ", "+-*/%"[nextRandom(&seed) % 5]);
+            if (k + 1 < operands && nextRandom(&seed) % 4 == 0) {
+                expr[n++] = '(';
+                open++;
+            }
+            n += sprintf(expr + n, "%u", 1 + nextRandom(&seed) % 999);
+            if (open > 0 && nextRandom(&seed) % 3 == 0) {
+                expr[n++] = ')';
+                open--;
+            }
+        }
+        while (open-- > 0)
+            expr[n++] = ')';
+        if (evaluateInfixInt64(expr, (size_t)n, &result, NULL) != EXPR_OK)
+            exit(1);
+        addRecord(w, i, SERVER_EVAL, expr, (size_t)n, value, (size_t)sprintf(value, "%lld", result));
+    }
+}
+
+/* Strings of 16 to 80 letters in runs of 1 to 12 */
+static void makeStringWorkloads(Workload *compress, Workload *expand)
+{
+    unsigned seed = 11;
+    int i;
+
+    compress->name = "compress";
+    expand->name = "expand";
+    for (i = 0; i < RECORD_COUNT; i++) {
+        char text[96], packed[96];
+        size_t len = 0, target = 16 + nextRandom(&seed) % 65, n;
+
+        while (len < target) {
+            char c = (char)('a' + nextRandom(&seed) % 4);
+            size_t run = 1 + nextRandom(&seed) % 12;
+
+            if (len > 0 && text[len - 1] == c)
+                continue;
+            while (run-- > 0 && len < target)
+                text[len++] = c;
+        }
+        n = compressRange(text, len, packed);
+        addRecord(compress, i, SERVER_COMPRESS, text, len, packed, n);
+        addRecord(expand, i, SERVER_EXPAND, packed, n, text, len);
+    }
+}
+
+/* ============================================================
+ * Helpers: connectTo / sendAll
+ * ============================================================ */
+static int connectTo(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int sendAll(int fd, const unsigned char *p, size_t len)
+{
+    while (len > 0) {
+        ssize_t sent = send(fd, p, len, MSG_NOSIGNAL);
+
+        if (sent <= 0)
+            return 0;
+        p += sent;
+        len -= (size_t)sent;
+    }
+    return 1;
+}
+
+/* ============================================================
+ * Helper: runClient
+ * Sends 'depth' requests, then one more for each response, until
+ * the time is up; then takes the responses still in flight.
+ * ============================================================ */
+static void *runClient(void *arg)
+{
+    Client *c = arg;
+    const Workload *w = c->work;
+    double *sentAt = malloc((size_t)c->depth * sizeof(double));
+    unsigned char *buf = malloc(RECV_SIZE);
+    size_t have = 0, pos = 0;
+    unsigned long long sent = 0, received = 0;
+    double stop = nowSeconds() + c->seconds;
+    int fd = connectTo(c->path);
+
+    if (fd < 0 || sentAt == NULL || buf == NULL) {
+        c->failed = 1;
+        goto done;
+    }
+
+    for (;;) {
+        size_t len, idx;
+
+        /* Keep the pipeline full while there is time */
+        while (sent - received < (unsigned long long)c->depth && nowSeconds() < stop) {
+            idx = sent % RECORD_COUNT;
+            sentAt[sent % (unsigned long long)c->depth] = nowSeconds();
+            if (!sendAll(fd, w->frames[idx], w->frameLen[idx])) {
+                c->failed = 1;
+                goto done;
+            }
+            sent++;
+        }
+        if (received == sent)
+            break;
+
+        /* Next response: header, then payload */
+        while (have - pos < SERVER_HEADER_SIZE ||
+               have - pos < SERVER_HEADER_SIZE + serverPayloadLength(buf + pos)) {
+            ssize_t got;
+
+            if (pos > 0) {
+                memmove(buf, buf + pos, have - pos);
+                have -= pos;
+                pos = 0;
+            }
+            got = recv(fd, buf + have, RECV_SIZE - have, 0);
+            if (got <= 0) {
+                c->failed = 1;
+                goto done;
+            }
+            have += (size_t)got;
+        }
+        len = serverPayloadLength(buf + pos);
+        idx = received % RECORD_COUNT;
+        if (buf[pos] != SERVER_OK || len != w->expectedLen[idx] ||
+            memcmp(buf + pos + SERVER_HEADER_SIZE, w->expected[idx], len) != 0) {
+            c->failed = 1;
+            goto done;
+        }
+        pos += SERVER_HEADER_SIZE + len;
+
+        if (c->latencyCount == c->latencyCap) {
+            size_t cap = c->latencyCap ? c->latencyCap * 2 : 4096;
+            double *grown = realloc(c->latency, cap * sizeof(double));
+
+            if (grown == NULL) {
+                c->failed = 1;
+                goto done;
+            }
+            c->latency = grown;
+            c->latencyCap = cap;
+        }
+        c->latency[c->latencyCount++] = nowSeconds() - sentAt[received % (unsigned long long)c->depth];
+        received++;
+    }
+    c->done = received;
+
+done:
+    if (fd >= 0)
+        close(fd);
+    free(sentAt);
+    free(buf);
+    return NULL;
+}
+
+static int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* ============================================================
+ * Helper: runLoad
+ * One row of the report: 'connections' clients at 'depth'.
+ * ============================================================ */
+static int runLoad(const char *path, const Workload *w, int connections, int depth, double seconds)
+{
+    Client *clients = calloc((size_t)connections, sizeof(Client));
+    double *all = NULL;
+    size_t total = 0, k;
+    unsigned long long done = 0;
+    double t0, elapsed;
+    int i, failed = 0;
+
+    if (clients == NULL)
+        return 0;
+    t0 = nowSeconds();
+    for (i = 0; i < connections; i++) {
+        clients[i].path = path;
+        clients[i].work = w;
+        clients[i].depth = depth;
+        clients[i].seconds = seconds;
+        if (pthread_create(&clients[i].thread, NULL, runClient, &clients[i]) != 0)
+            return 0;
+    }
+    for (i = 0; i < connections; i++) {
+        pthread_join(clients[i].thread, NULL);
+        failed |= clients[i].failed;
+        done += clients[i].done;
+        total += clients[i].latencyCount;
+    }
+    elapsed = nowSeconds() - t0;
+
+    if (!failed && total > 0 && (all = malloc(total * sizeof(double))) != NULL) {
+        for (i = 0, k = 0; i < connections; i++) {
+            memcpy(all + k, clients[i].latency, clients[i].latencyCount * sizeof(double));
+            k += clients[i].latencyCount;
+        }
+        qsort(all, total, sizeof(double), compareDoubles);
+        printf("%-9s %5d %6d %12.0f %10.1f %10.1f %10.1f\n", w->name, connections, depth,
+               (double)done / elapsed, all[total / 2] * 1e6,
+               all[(size_t)((double)total * 0.99)] * 1e6, all[total - 1] * 1e6);
+    }
+    for (i = 0; i < connections; i++)
+        free(clients[i].latency);
+    free(clients);
+    free(all);
+    if (failed)
+        fprintf(stderr, "%s: wrong or missing response at depth %d\n", w->name, depth);
+    return !failed;
+}
+
+/* ============================================================
+ * Helper: timeSpawn
+ * Average time to run "pe1 eval" on one record in a new process.
+ * ============================================================ */
+static double timeSpawn(const char *pe1, const Workload *w)
+{
+    char *args[3];
+    double t0 = nowSeconds();
+    int i;
+
+    args[0] = (char *)pe1;
+    args[1] = "eval";
+    args[2] = NULL;
+    for (i = 0; i < SPAWN_COUNT; i++) {
+        const unsigned char *frame = w->frames[i % RECORD_COUNT];
+        posix_spawn_file_actions_t actions;
+        int in[2], out[2], status;
+        char result[64];
+        pid_t pid;
+
+        if (pipe(in) != 0 || pipe(out) != 0)
+            return -1;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, in[0], 0);
+        posix_spawn_file_actions_adddup2(&actions, out[1], 1);
+        posix_spawn_file_actions_addclose(&actions, in[1]);
+        posix_spawn_file_actions_addclose(&actions, out[0]);
+        if (posix_spawn(&pid, pe1, &actions, NULL, args, environ) != 0)
+            return -1;
+        posix_spawn_file_actions_destroy(&actions);
+        close(in[0]);
+        close(out[1]);
+        if (write(in[1], frame + SERVER_HEADER_SIZE, serverPayloadLength(frame)) < 0 ||
+            write(in[1], "\n", 1) < 0)
+            return -1;
+        close(in[1]);
+        while (read(out[0], result, sizeof(result)) > 0)
+            ;
+        close(out[0]);
+        waitpid(pid, &status, 0);
+    }
+    return (nowSeconds() - t0) / SPAWN_COUNT;
+}
+
+/* Server started in this process when no --socket is given */
+static void *serveInProcess(void *path)
+{
+    if (runServer(path) != 0)
+        perror("runServer");
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    static const int DEPTHS[] = { 1, 4, 16, 64, 256 };
+    Workload works[3];
+    const char *path = NULL, *spawnPath = NULL;
+    char ownPath[64];
+    pthread_t server;
+    double seconds = 1.0;
+    int connections = 1;
+    int a, i, d, ok = 1;
+
+    for (a = 1; a < argc; a++) {
+        if (strncmp(argv[a], "--socket=", 9) == 0)
+            path = argv[a] + 9;
+        else if (strncmp(argv[a], "--connections=", 14) == 0)
+            connections = atoi(argv[a] + 14);
+        else if (strncmp(argv[a], "--time=", 7) == 0)
+            seconds = atof(argv[a] + 7);
+        else if (strncmp(argv[a], "--spawn=", 8) == 0)
+            spawnPath = argv[a] + 8;
+        else {
+            fprintf(stderr, "Usage: %s [--socket=PATH] [--connections=N] [--time=SECONDS] "
+                            "[--spawn=PE1]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (connections < 1)
+        connections = 1;
+
+    makeEvalWorkload(&works[0]);
+    makeStringWorkloads(&works[1], &works[2]);
+
+    if (path == NULL) {
+        /* The load threads must not take the server's SIGTERM */
+        sigset_t block;
+
+        snprintf(ownPath, sizeof(ownPath), "/tmp/bench_server.%d.sock", (int)getpid());
+        path = ownPath;
+        sigemptyset(&block);
+        sigaddset(&block, SIGTERM);
+        if (pthread_create(&server, NULL, serveInProcess, ownPath) != 0)
+            return 1;
+        pthread_sigmask(SIG_BLOCK, &block, NULL);
+        for (i = 0; i < 1000; i++) {
+            int fd = connectTo(ownPath);
+
+            if (fd >= 0) {
+                close(fd);
+                break;
+            }
+            usleep(1000);
+        }
+    }
+
+    printf("%-9s %5s %6s %12s %10s %10s %10s\n", "op", "conns", "depth", "requests/s",
+           "p50 us", "p99 us", "max us");
+    for (i = 0; i < 3 && ok; i++)
+        for (d = 0; d < (int)(sizeof(DEPTHS) / sizeof(DEPTHS[0])) && ok; d++)
+            ok = runLoad(path, &works[i], connections, DEPTHS[d], seconds);
+
+    if (ok && spawnPath != NULL) {
+        double perJob = timeSpawn(spawnPath, &works[0]);
+
+        if (perJob < 0)
+            printf("could not run %s\n", spawnPath);
+        else
+            printf("%s eval, one process per record: %.1f us per record\n", spawnPath, perJob * 1e6);
+    }
+
+    if (path == ownPath) {
+        pthread_kill(server, SIGTERM);
+        pthread_join(server, NULL);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,117 @@
+/*
+ * bench_string_threads.c
+ *
+ * Scaling of compressParallel and planExpansion / expandPlanned on
+ * one large log-like string with 1, 2, 4, ... threads, against
+ * validating and compressing / expanding on one thread. Results
+ * are checked against compressRange / expandRange.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -pthread -I. bench/bench_string_threads.c string_ops.c string_parallel.c thread_pool.c char_class.c phase_stats.c -o bench_string_threads
+ *   ./bench_string_threads [MB] [max threads]
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "string_parallel.h"
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Runs of 1..64 letters, with a very long run every few MB */
+static void makeInput(char *buf, size_t len)
+{
+    unsigned seed = 23;
+    size_t i = 0;
+
+    while (i < len) {
+        size_t run;
+        char c;
+
+        seed = seed * 1103515245u + 12345u;
+        c = (char)('a' + (seed >> 16) % 6);
+        run = 1 + (seed >> 8) % 64;
+        if ((seed & 0xFFFF) == 7)
+            run = 4u << 20;
+        while (run-- > 0 && i < len)
+            buf[i++] = c;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    size_t len = (size_t)((argc > 1) ? atol(argv[1]) : 512) << 20;
+    int maxThreads = (argc > 2) ? atoi(argv[2]) : 64;
+    char *in = malloc(len), *ref = malloc(len), *out = malloc(len), *back = malloc(len);
+    size_t refLen;
+    double t0, baseCompress, baseExpand;
+    int threads;
+
+    if (in == NULL || ref == NULL || out == NULL || back == NULL)
+        return 1;
+    makeInput(in, len);
+    memset(out, 0, len);    /* Fault the pages in before timing */
+    memset(back, 0, len);
+
+    /* Sequential baseline: validate, (size,) then run the kernel */
+    t0 = nowSeconds();
+    if (!isValidStringRange(in, len))
+        return 1;
+    refLen = compressRange(in, len, ref);
+    baseCompress = nowSeconds() - t0;
+    t0 = nowSeconds();
+    if (!isValidCompressedRange(ref, refLen) || expandedSize(ref, refLen) != len)
+        return 1;
+    expandRange(ref, refLen, back);
+    baseExpand = nowSeconds() - t0;
+
+    printf("%zu MB -> %.1f MB compressed\n", len >> 20, (double)refLen / (1024.0 * 1024.0));
+    printf("%7s %14s %8s %14s %8s\n", "threads", "compress", "speedup", "expand", "speedup");
+    printf("%7s %9.2f GB/s %7.2fx %9.2f GB/s %7.2fx\n", "seq",
+           (double)len / 1e9 / baseCompress, 1.0, (double)len / 1e9 / baseExpand, 1.0);
+
+    for (threads = 1; threads <= maxThreads; threads *= 2) {
+        ThreadPool pool;
+        ExpandPlan plan;
+        double tc, te;
+        size_t n;
+        int same;
+
+        if (!poolInit(&pool, threads, NULL))
+            return 1;
+        t0 = nowSeconds();
+        n = compressParallel(&pool, in, len, out);
+        tc = nowSeconds() - t0;
+        same = n == refLen && memcmp(out, ref, refLen) == 0;
+
+        t0 = nowSeconds();
+        if (!planExpansion(&pool, ref, refLen, &plan))
+            return 1;
+        expandPlanned(&pool, &plan, back);
+        te = nowSeconds() - t0;
+        same &= plan.total == len && memcmp(back, in, len) == 0;
+        freeExpandPlan(&plan);
+        poolFree(&pool);
+
+        printf("%7d %9.2f GB/s %7.2fx %9.2f GB/s %7.2fx %s\n", threads,
+               (double)len / 1e9 / tc, baseCompress / tc,
+               (double)len / 1e9 / te, baseExpand / te, same ? "" : "OUTPUT DIFFERS");
+    }
+
+    free(in);
+    free(ref);
+    free(out);
+    free(back);
+    return 0;
+}
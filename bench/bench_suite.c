@@ -0,0 +1,583 @@
+/*
+ * bench_suite.c
+ *
+ * Microbenchmarks for every exported function of expression.h and
+ * string_ops.h, and the entry points of pe1.h, each on the corpora
+ * from corpus.c that matter to it. Every benchmark is named
+ * "function/corpus" and reported as the median ns per call of
+ * --repeat timed runs and input bytes per second, as JSON on
+ * stdout. With --baseline, the run is also compared with a saved
+ * JSON report: the table goes to stderr and the exit status is 1
+ * if any benchmark got slower by more than --threshold percent.
+ *
+ * Build (from the repo root):
+ *   make bench
+ *   ./bench_suite > baseline.json
+ *   ./bench_suite --baseline=baseline.json > current.json
+ *
+ * Options:
+ *   --filter=TEXT      only benchmarks whose name contains TEXT
+ *   --time=SECONDS     minimum length of each timed run (default 0.2)
+ *   --repeat=N         timed runs per benchmark, median kept (default 5)
+ *   --baseline=FILE    compare with a saved report
+ *   --threshold=PCT    slowdown counted as a regression (default 10)
+ *   --list             print the benchmark names and exit
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "corpus.h"
+#include "expression.h"
+#include "pe1.h"
+#include "string_ops.h"
+
+/* Most timed runs per benchmark */
+#define MAX_REPEAT 99
+
+/* Corpus sizes in bytes (large_counts expands about 1000x) */
+#define LETTER_CORPUS_SIZE (1 << 20)
+#define COUNT_CORPUS_SIZE (16 * 1024)
+#define EXPR_CORPUS_SIZE (64 * 1024)
+#define BIG_CORPUS_SIZE (8 * 1024)
+
+/* Seed of every corpus: reports from different runs stay comparable */
+#define CORPUS_SEED 2024
+
+/* Everything a benchmark may need about one corpus */
+typedef struct {
+    int ready;
+    char *text;         /* The corpus itself */
+    size_t len;
+    char *packed;       /* Compressed form (letters: compressRange; counts: text) */
+    size_t packedLen;
+    size_t expanded;    /* expandedSize of packed */
+    char *postfix;      /* Expressions: infixToPostfix of text */
+    size_t postfixLen;
+    CompiledExpr compiled;
+    ExprValue value;    /* Expressions: value of text */
+} Input;
+
+/* One call of the function under test; returns the input bytes it read */
+typedef size_t (*BenchFn)(Input *in);
+
+typedef struct {
+    const char *function;
+    BenchFn run;
+    CorpusKind corpora[5];
+    int corpusCount;    /* 0: needs no corpus */
+} BenchCase;
+
+static Input inputs[CORPUS_KIND_COUNT];
+static char *out;       /* Output buffer, large enough for every benchmark */
+static size_t outSize;
+static volatile size_t sink;    /* Keeps results alive */
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* ============================================================
+ * Helper: prepareInput
+ * ============================================================ */
+static Input *prepareInput(CorpusKind kind)
+{
+    Input *in = &inputs[kind];
+    size_t size, need;
+
+    if (in->ready)
+        return in;
+    switch (kind) {
+        case CORPUS_LARGE_COUNTS: size = COUNT_CORPUS_SIZE; break;
+        case CORPUS_OPERATOR_CHAIN:
+        case CORPUS_DEEP_NESTING: size = EXPR_CORPUS_SIZE; break;
+        case CORPUS_BIG_VALUES: size = BIG_CORPUS_SIZE; break;
+        default: size = LETTER_CORPUS_SIZE; break;
+    }
+    in->text = malloc(size + 1);
+    in->packed = malloc(size + 1);
+    in->postfix = malloc(2 * size + 1);
+    if (in->text == NULL || in->packed == NULL || in->postfix == NULL) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+    in->len = makeCorpus(kind, size, CORPUS_SEED + (unsigned)kind, in->text);
+    initCompiled(&in->compiled);
+    initExprValue(&in->value);
+
+    if (kind >= CORPUS_OPERATOR_CHAIN) {
+        infixToPostfix(in->text, in->postfix);
+        in->postfixLen = strlen(in->postfix);
+        if (!compileInfix(in->text, &in->compiled) ||
+            evaluateInfix(in->text, &in->value, NULL) != EXPR_OK) {
+            fprintf(stderr, "%s: corpus does not evaluate\n", corpusName(kind));
+            exit(2);
+        }
+        need = (size_t)in->compiled.count * MAX_TOKEN_TEXT + 1;
+        if (exprValueTextSize(&in->value) > need)
+            need = exprValueTextSize(&in->value);
+    } else {
+        if (kind == CORPUS_LARGE_COUNTS) {
+            memcpy(in->packed, in->text, in->len + 1);
+            in->packedLen = in->len;
+        } else {
+            in->packedLen = compressRange(in->text, in->len, in->packed);
+            in->packed[in->packedLen] = '\0';
+        }
+        in->expanded = expandedSize(in->packed, in->packedLen);
+        need = in->expanded + 1;
+    }
+
+    if (need > outSize) {
+        free(out);
+        outSize = need;
+        out = malloc(outSize);
+        if (out == NULL) {
+            fprintf(stderr, "out of memory\n");
+            exit(2);
+        }
+    }
+    in->ready = 1;
+    return in;
+}
+
+/* ============================================================
+ * string_ops.h
+ * ============================================================ */
+static size_t runIsValidString(Input *in) { sink += (size_t)isValidString(in->text); return in->len; }
+static size_t runIsValidStringRange(Input *in) { sink += (size_t)isValidStringRange(in->text, in->len); return in->len; }
+static size_t runCheckString(Input *in) { sink += checkString(in->text, in->len); return in->len; }
+static size_t runCompressString(Input *in) { compressString(in->text, out); sink += (size_t)out[0]; return in->len; }
+static size_t runCompressRange(Input *in) { sink += compressRange(in->text, in->len, out); return in->len; }
+static size_t runIsValidCompressedString(Input *in) { sink += (size_t)isValidCompressedString(in->packed); return in->packedLen; }
+static size_t runIsValidCompressedRange(Input *in) { sink += (size_t)isValidCompressedRange(in->packed, in->packedLen); return in->packedLen; }
+static size_t runCheckCompressed(Input *in) { sink += checkCompressed(in->packed, in->packedLen); return in->packedLen; }
+static size_t runExpandedSize(Input *in) { sink += expandedSize(in->packed, in->packedLen); return in->packedLen; }
+static size_t runExpandString(Input *in) { expandString(in->packed, out); sink += (size_t)out[0]; return in->packedLen; }
+static size_t runExpandStringBounded(Input *in) { sink += expandStringBounded(in->packed, out, outSize); return in->packedLen; }
+static size_t runExpandRange(Input *in) { sink += expandRange(in->packed, in->packedLen, out); return in->packedLen; }
+
+static size_t runReadCompressedRun(Input *in)
+{
+    size_t i = 0, total = 0;
+    char letter;
+
+    while (i < in->packedLen)
+        total += readCompressedRun(in->packed, &i, &letter);
+    sink += total;
+    return in->packedLen;
+}
+
+/* Writes every run of the corpus again; the runs are read beforehand */
+static size_t runCompressRun(Input *in)
+{
+    static size_t *counts = NULL;
+    static char *letters = NULL;
+    static size_t runs = 0;
+    static const Input *owner = NULL;
+    size_t r, j = 0;
+
+    if (owner != in) {
+        size_t i = 0;
+
+        free(counts);
+        free(letters);
+        counts = malloc(in->packedLen * sizeof(size_t));
+        letters = malloc(in->packedLen);
+        if (counts == NULL || letters == NULL)
+            exit(2);
+        for (runs = 0; i < in->packedLen; runs++)
+            counts[runs] = readCompressedRun(in->packed, &i, &letters[runs]);
+        owner = in;
+    }
+    for (r = 0; r < runs; r++)
+        j += compressRun(letters[r], counts[r], out + j);
+    sink += j;
+    return in->len;
+}
+
+static size_t runCompressKernelName(Input *in) { (void)in; sink += (size_t)compressKernelName()[0]; return 0; }
+
+/* ============================================================
+ * expression.h
+ * ============================================================ */
+static size_t runIsValidInfix(Input *in) { sink += (size_t)isValidInfix(in->text); return in->len; }
+static size_t runCheckInfix(Input *in) { sink += checkInfix(in->text, in->len); return in->len; }
+static size_t runInfixToPostfix(Input *in) { infixToPostfix(in->text, out); sink += (size_t)out[0]; return in->len; }
+
+static size_t runEvaluatePostfix(Input *in)
+{
+    sink += (size_t)evaluatePostfix(in->postfix, &in->value);
+    return in->postfixLen;
+}
+
+static size_t runCompileInfix(Input *in) { sink += (size_t)compileInfix(in->text, &in->compiled); return in->len; }
+
+static size_t runCompileExpression(Input *in)
+{
+    sink += (size_t)compileExpression(in->text, NULL, 0, &in->compiled, NULL);
+    return in->len;
+}
+
+static size_t runEvaluateCompiled(Input *in) { sink += (size_t)evaluateCompiled(&in->compiled, &in->value); return in->len; }
+
+static size_t runEvaluateCompiledRow(Input *in)
+{
+    static const int noVars[1] = { 0 };
+
+    sink += (size_t)evaluateCompiledRow(&in->compiled, noVars, &in->value);
+    return in->len;
+}
+
+static size_t runCompiledToPostfix(Input *in) { compiledToPostfix(&in->compiled, out); sink += (size_t)out[0]; return in->len; }
+static size_t runEvaluateInfix(Input *in) { sink += (size_t)evaluateInfix(in->text, &in->value, NULL); return in->len; }
+
+static size_t runEvaluateInfixRange(Input *in)
+{
+    sink += (size_t)evaluateInfixRange(in->text, in->len, &in->value, NULL);
+    return in->len;
+}
+
+static size_t runEvaluateInfixInt64(Input *in)
+{
+    long long r;
+
+    sink += (size_t)evaluateInfixInt64(in->text, in->len, &r, NULL);
+    return in->len;
+}
+
+static size_t runPe1Compress(Input *in)
+{
+    size_t n;
+
+    sink += (size_t)pe1Compress(in->text, in->len, out, outSize, &n, NULL) + n;
+    return in->len;
+}
+
+static size_t runPe1Expand(Input *in)
+{
+    size_t n;
+
+    sink += (size_t)pe1Expand(in->packed, in->packedLen, out, outSize, &n, NULL) + n;
+    return in->packedLen;
+}
+
+static size_t runPe1Evaluate(Input *in)
+{
+    long long r;
+
+    sink += (size_t)pe1Evaluate(in->text, in->len, &r, NULL);
+    return in->len;
+}
+
+static size_t runInitFreeCompiled(Input *in)
+{
+    CompiledExpr expr;
+
+    (void)in;
+    initCompiled(&expr);
+    sink += (size_t)expr.count;
+    freeCompiled(&expr);
+    return 0;
+}
+
+/* initExprValue + copyExprValue + freeExprValue: a fresh copy each call */
+static size_t runInitFreeExprValue(Input *in)
+{
+    ExprValue value;
+
+    initExprValue(&value);
+    sink += (size_t)copyExprValue(&value, &in->value);
+    freeExprValue(&value);
+    return 0;
+}
+
+/* Copies into a value whose storage is reused */
+static size_t runCopyExprValue(Input *in)
+{
+    static ExprValue copy = EXPR_VALUE_INIT;
+
+    sink += (size_t)copyExprValue(&copy, &in->value);
+    return 0;
+}
+
+/* a + v - v: one add and one subtract, a ends where it started */
+static size_t runCombineExprValues(Input *in)
+{
+    static ExprValue a = EXPR_VALUE_INIT;
+
+    copyExprValue(&a, &in->value);
+    sink += (size_t)combineExprValues(&a, '+', &in->value);
+    sink += (size_t)combineExprValues(&a, '-', &in->value);
+    return 0;
+}
+
+static size_t runExprValueTextSize(Input *in) { sink += exprValueTextSize(&in->value); return 0; }
+static size_t runExprValueToText(Input *in) { sink += exprValueToText(&in->value, out); return 0; }
+
+static size_t runExprStatusMessage(Input *in)
+{
+    int s;
+
+    (void)in;
+    for (s = EXPR_OK; s <= EXPR_ERR_TOO_DEEP; s++)
+        sink += (size_t)exprStatusMessage((ExprStatus)s)[0];
+    return 0;
+}
+
+/* exprScratchArena + exprReleaseScratch around one 64 KB allocation */
+static size_t runScratchArena(Input *in)
+{
+    (void)in;
+    sink += (size_t)(arenaAlloc(exprScratchArena(), 64 * 1024) != NULL);
+    exprReleaseScratch();
+    return 0;
+}
+
+static size_t runIsOperator(Input *in)
+{
+    size_t i, n = 0;
+
+    for (i = 0; i < in->len; i++)
+        n += (size_t)isOperator(in->text[i]);
+    sink += n;
+    return in->len;
+}
+
+static size_t runPrecedence(Input *in)
+{
+    size_t i, n = 0;
+
+    for (i = 0; i < in->len; i++)
+        n += (size_t)precedence(in->text[i]);
+    sink += n;
+    return in->len;
+}
+
+#define LETTERS { CORPUS_NO_RUNS, CORPUS_MIXED_RUNS, CORPUS_LONG_RUNS, CORPUS_GENOME }, 4
+#define PACKED { CORPUS_NO_RUNS, CORPUS_MIXED_RUNS, CORPUS_LONG_RUNS, CORPUS_GENOME, CORPUS_LARGE_COUNTS }, 5
+#define EXPRESSIONS { CORPUS_OPERATOR_CHAIN, CORPUS_DEEP_NESTING, CORPUS_BIG_VALUES }, 3
+
+static const BenchCase CASES[] = {
+    { "isValidString", runIsValidString, LETTERS },
+    { "isValidStringRange", runIsValidStringRange, LETTERS },
+    { "checkString", runCheckString, LETTERS },
+    { "compressString", runCompressString, LETTERS },
+    { "compressRange", runCompressRange, LETTERS },
+    { "compressRun", runCompressRun, { CORPUS_MIXED_RUNS, CORPUS_LONG_RUNS }, 2 },
+    { "compressKernelName", runCompressKernelName, { CORPUS_NO_RUNS }, 0 },
+    { "isValidCompressedString", runIsValidCompressedString, PACKED },
+    { "isValidCompressedRange", runIsValidCompressedRange, PACKED },
+    { "checkCompressed", runCheckCompressed, PACKED },
+    { "readCompressedRun", runReadCompressedRun, PACKED },
+    { "expandedSize", runExpandedSize, PACKED },
+    { "expandString", runExpandString, PACKED },
+    { "expandStringBounded", runExpandStringBounded, PACKED },
+    { "expandRange", runExpandRange, PACKED },
+
+    { "isValidInfix", runIsValidInfix, EXPRESSIONS },
+    { "checkInfix", runCheckInfix, EXPRESSIONS },
+    { "infixToPostfix", runInfixToPostfix, EXPRESSIONS },
+    { "evaluatePostfix", runEvaluatePostfix, EXPRESSIONS },
+    { "compileInfix", runCompileInfix, EXPRESSIONS },
+    { "compileExpression", runCompileExpression, EXPRESSIONS },
+    { "evaluateCompiled", runEvaluateCompiled, EXPRESSIONS },
+    { "evaluateCompiledRow", runEvaluateCompiledRow, EXPRESSIONS },
+    { "compiledToPostfix", runCompiledToPostfix, EXPRESSIONS },
+    { "evaluateInfix", runEvaluateInfix, EXPRESSIONS },
+    { "evaluateInfixRange", runEvaluateInfixRange, EXPRESSIONS },
+    { "evaluateInfixInt64", runEvaluateInfixInt64, { CORPUS_OPERATOR_CHAIN }, 1 },
+    { "initCompiled+freeCompiled", runInitFreeCompiled, { CORPUS_NO_RUNS }, 0 },
+    { "initExprValue+freeExprValue", runInitFreeExprValue, { CORPUS_BIG_VALUES }, 1 },
+    { "copyExprValue", runCopyExprValue, { CORPUS_BIG_VALUES }, 1 },
+    { "combineExprValues", runCombineExprValues, { CORPUS_BIG_VALUES }, 1 },
+    { "exprValueTextSize", runExprValueTextSize, { CORPUS_BIG_VALUES }, 1 },
+    { "exprValueToText", runExprValueToText, { CORPUS_BIG_VALUES }, 1 },
+    { "exprStatusMessage", runExprStatusMessage, { CORPUS_NO_RUNS }, 0 },
+    { "exprScratchArena+exprReleaseScratch", runScratchArena, { CORPUS_NO_RUNS }, 0 },
+    { "isOperator", runIsOperator, { CORPUS_OPERATOR_CHAIN }, 1 },
+    { "precedence", runPrecedence, { CORPUS_OPERATOR_CHAIN }, 1 },
+
+    { "pe1Compress", runPe1Compress, LETTERS },
+    { "pe1Expand", runPe1Expand, PACKED },
+    { "pe1Evaluate", runPe1Evaluate, { CORPUS_OPERATOR_CHAIN }, 1 },
+};
+
+static int compareDoubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* ============================================================
+ * Helper: measure
+ * Times one call, then 'repeat' runs of enough calls to fill
+ * minTime each, and returns the median ns per call: one run slowed
+ * by the rest of the machine does not move it.
+ * ============================================================ */
+static double measure(BenchFn run, Input *in, double minTime, int repeat, long *iterations,
+                      size_t *bytes)
+{
+    double runs[MAX_REPEAT], t0, once;
+    long i, n;
+    int r;
+
+    t0 = nowSeconds();
+    *bytes = run(in);
+    once = nowSeconds() - t0;
+
+    n = (once > 0) ? (long)(minTime / once) + 1 : 1000000L;
+    if (n > 100000000L)
+        n = 100000000L;
+    for (r = 0; r < repeat; r++) {
+        t0 = nowSeconds();
+        for (i = 0; i < n; i++)
+            run(in);
+        runs[r] = (nowSeconds() - t0) * 1e9 / (double)n;
+    }
+    *iterations = n;
+    qsort(runs, (size_t)repeat, sizeof(runs[0]), compareDoubles);
+    return (repeat % 2) ? runs[repeat / 2] : (runs[repeat / 2 - 1] + runs[repeat / 2]) / 2;
+}
+
+/* ============================================================
+ * Helper: baselineNs
+ * ns_per_op of a benchmark in a saved report, or -1.
+ * ============================================================ */
+static double baselineNs(const char *report, const char *name)
+{
+    char key[256];
+    const char *p, *v;
+
+    sprintf(key, "\"name\": \"%s\"", name);
+    p = strstr(report, key);
+    if (p == NULL)
+        return -1;
+    v = strstr(p, "\"ns_per_op\": ");
+    if (v == NULL || memchr(p, '}', (size_t)(v - p)) != NULL)
+        return -1;
+    return atof(v + strlen("\"ns_per_op\": "));
+}
+
+static char *readFile(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    char *data;
+    long size;
+
+    if (f == NULL)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data = malloc((size_t)size + 1);
+    if (data != NULL) {
+        data[fread(data, 1, (size_t)size, f)] = '\0';
+    }
+    fclose(f);
+    return data;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filter = NULL, *baselinePath = NULL;
+    double minTime = 0.2, threshold = 10.0;
+    char *baseline = NULL;
+    int repeat = 5, listOnly = 0, first = 1, regressions = 0, a;
+    size_t c;
+
+    for (a = 1; a < argc; a++) {
+        if (strncmp(argv[a], "--filter=", 9) == 0)
+            filter = argv[a] + 9;
+        else if (strncmp(argv[a], "--time=", 7) == 0)
+            minTime = atof(argv[a] + 7);
+        else if (strncmp(argv[a], "--repeat=", 9) == 0)
+            repeat = atoi(argv[a] + 9);
+        else if (strncmp(argv[a], "--baseline=", 11) == 0)
+            baselinePath = argv[a] + 11;
+        else if (strncmp(argv[a], "--threshold=", 12) == 0)
+            threshold = atof(argv[a] + 12);
+        else if (strcmp(argv[a], "--list") == 0)
+            listOnly = 1;
+        else
+            repeat = 0;
+        if (repeat < 1 || repeat > MAX_REPEAT) {
+            fprintf(stderr, "usage: %s [--filter=TEXT] [--time=SECONDS] [--repeat=N] "
+                            "[--baseline=FILE] [--threshold=PCT] [--list]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (baselinePath != NULL) {
+        baseline = readFile(baselinePath);
+        if (baseline == NULL) {
+            perror(baselinePath);
+            return 2;
+        }
+        fprintf(stderr, "%-48s %12s %12s %8s\n", "benchmark", "baseline ns", "ns", "change");
+    }
+
+    if (!listOnly)
+        printf("{\n  \"kernel\": \"%s\",\n  \"benchmarks\": [", compressKernelName());
+
+    for (c = 0; c < sizeof(CASES) / sizeof(CASES[0]); c++) {
+        const BenchCase *bc = &CASES[c];
+        int k, count = bc->corpusCount ? bc->corpusCount : 1;
+
+        for (k = 0; k < count; k++) {
+            char name[128];
+            long iterations;
+            size_t bytes;
+            double ns, old;
+
+            if (bc->corpusCount > 0)
+                sprintf(name, "%s/%s", bc->function, corpusName(bc->corpora[k]));
+            else
+                sprintf(name, "%s", bc->function);
+            if (filter != NULL && strstr(name, filter) == NULL)
+                continue;
+            if (listOnly) {
+                printf("%s\n", name);
+                continue;
+            }
+
+            ns = measure(bc->run, prepareInput(bc->corpora[k]), minTime, repeat, &iterations, &bytes);
+            printf("%s\n    {\"name\": \"%s\", \"bytes\": %zu, \"iterations\": %ld, "
+                   "\"repeats\": %d, \"ns_per_op\": %.2f, \"bytes_per_sec\": %.0f}",
+                   first ? "" : ",", name, bytes, iterations, repeat, ns,
+                   (double)bytes * 1e9 / ns);
+            fflush(stdout);
+            first = 0;
+
+            if (baseline != NULL) {
+                old = baselineNs(baseline, name);
+                if (old <= 0) {
+                    fprintf(stderr, "%-48s %12s %12.1f %8s\n", name, "-", ns, "new");
+                } else {
+                    double change = (ns - old) * 100.0 / old;
+                    int slower = change > threshold;
+
+                    regressions += slower;
+                    fprintf(stderr, "%-48s %12.1f %12.1f %+7.1f%%%s\n", name, old, ns, change,
+                            slower ? "  REGRESSION" : "");
+                }
+            }
+        }
+    }
+
+    if (!listOnly)
+        printf("\n  ]\n}\n");
+    if (baseline != NULL) {
+        fprintf(stderr, "%d regression(s) beyond %.0f%%\n", regressions, threshold);
+        free(baseline);
+    }
+    return regressions > 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * bench_threads.c
+ *
+ * Scaling of the parallel batch evaluator: runs the same file of
+ * generated expressions through runBatch with 1, 2, 4, ... 64
+ * threads and reports throughput and speedup over one thread.
+ * The output of every run is checked against the 1-thread output,
+ * so it also shows that results come back in input order.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -pthread -I. bench/bench_threads.c arena.c bigint.c expression.c expr_cache.c expr_optimize.c expr_parallel.c string_ops.c string_stream.c batch.c thread_pool.c async_io.c char_class.c phase_stats.c -o bench_threads
+ *   ./bench_threads [lines] [max threads]
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "batch.h"
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/*
+ * Writes 'lines' distinct expressions of varying length (a few
+ * operators up to a few hundred), so chunks cost different amounts
+ * and work stealing has something to balance.
+ */
+static void writeInput(FILE *f, long lines)
+{
+    static const char OPS[] = "+-*+%*+/";
+    unsigned seed = 7;
+    long i;
+
+    for (i = 0; i < lines; i++) {
+        int terms, t;
+
+        seed = seed * 1103515245u + 12345u;
+        terms = 2 + (int)((seed >> 16) % ((i % 64 == 0) ? 400 : 24));
+        for (t = 0; t < terms; t++) {
+            seed = seed * 1103515245u + 12345u;
+            if (t > 0)
+                fputc(OPS[(seed >> 16) & 7], f);
+            fprintf(f, "%u", ((seed >> 8) % 997) + 1);
+        }
+        fputc('\n', f);
+    }
+}
+
+/* Reads a whole stream into memory; *len receives its size */
+static char *slurp(FILE *f, size_t *len)
+{
+    long size;
+    char *data;
+
+    fflush(f);
+    size = ftell(f);
+    rewind(f);
+    data = malloc((size_t)size + 1);
+    if (data == NULL || fread(data, 1, (size_t)size, f) != (size_t)size) {
+        free(data);
+        return NULL;
+    }
+    *len = (size_t)size;
+    return data;
+}
+
+int main(int argc, char *argv[])
+{
+    long lines = (argc > 1) ? atol(argv[1]) : 2000000;
+    int maxThreads = (argc > 2) ? atoi(argv[2]) : 64;
+    FILE *in = tmpfile();
+    char *reference = NULL;
+    size_t referenceLen = 0, inputLen;
+    double base = 0.0;
+    int threads;
+
+    if (in == NULL)
+        return 1;
+    writeInput(in, lines);
+    inputLen = (size_t)ftell(in);
+
+    printf("%d lines (%.1f MB), cache off\n", (int)lines, (double)inputLen / (1024.0 * 1024.0));
+    printf("%7s %10s %12s %10s %8s\n", "threads", "time", "lines/s", "MB/s", "speedup");
+
+    for (threads = 1; threads <= maxThreads; threads *= 2) {
+        BatchOptions opts;
+        FILE *out = tmpfile();
+        char *result;
+        size_t resultLen;
+        double t0, elapsed;
+        int same;
+
+        if (out == NULL)
+            return 1;
+        initBatchOptions(&opts);
+        opts.cacheCapacity = 0;  /* Every line is evaluated */
+        opts.threads = threads;
+
+        rewind(in);
+        t0 = nowSeconds();
+        if (runBatch(BATCH_EVAL, in, out, &opts) != 0)
+            return 1;
+        elapsed = nowSeconds() - t0;
+
+        result = slurp(out, &resultLen);
+        fclose(out);
+        if (result == NULL)
+            return 1;
+        if (reference == NULL) {
+            reference = result;
+            referenceLen = resultLen;
+            base = elapsed;
+            same = 1;
+        } else {
+            same = resultLen == referenceLen && memcmp(result, reference, resultLen) == 0;
+            free(result);
+        }
+
+        printf("%7d %9.3fs %12.0f %10.1f %7.2fx %s\n", threads, elapsed,
+               (double)lines / elapsed, (double)inputLen / (1024.0 * 1024.0) / elapsed,
+               base / elapsed, same ? "" : "OUTPUT DIFFERS");
+    }
+
+    free(reference);
+    fclose(in);
+    return 0;
+}
@@ -0,0 +1,177 @@
+/*
+ * bench_validate.c
+ *
+ * Throughput of checkString, checkCompressed and checkInfix (class
+ * table + SIMD blocks) against the original validators, which call
+ * isalpha / isdigit / isspace on every byte, on long valid inputs
+ * (so the whole input is read). Results are checked against each
+ * other.
+ *
+ * Build (from the repo root):
+ *   gcc -O2 -pthread -I. bench/bench_validate.c arena.c bigint.c expression.c string_ops.c char_class.c phase_stats.c -o bench_validate
+ *   ./bench_validate [MB]
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "expression.h"
+#include "string_ops.h"
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* The isValidStringRange this repo started with, for reference */
+static int validStringOriginal(const char *str, size_t len)
+{
+    size_t i;
+
+    for (i = 0; i < len; i++) {
+        if (!isalpha((unsigned char)str[i]))
+            return 0;
+    }
+    return len > 0;
+}
+
+/* The isValidCompressedRange this repo started with, for reference */
+static int validCompressedOriginal(const char *str, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len) {
+        if (isdigit((unsigned char)str[i])) {
+            if (str[i] == '0')
+                return 0;
+            if (str[i] == '1' && (i + 1 == len || !isdigit((unsigned char)str[i + 1])))
+                return 0;
+            while (i < len && isdigit((unsigned char)str[i]))
+                i++;
+        }
+        if (i == len || !isalpha((unsigned char)str[i]))
+            return 0;
+        i++;
+    }
+    return len > 0;
+}
+
+/* The isValidInfix this repo started with, for reference */
+static int validInfixOriginal(const char *p, size_t len)
+{
+    const char *end = p + len;
+    int parenDepth = 0, expectOperand = 1, inNumber = 0;
+
+    for (; p < end; p++) {
+        char c = *p;
+
+        if (isspace((unsigned char)c)) {
+            inNumber = 0;
+            continue;
+        }
+        if (isdigit((unsigned char)c)) {
+            if (!expectOperand && !inNumber)
+                return 0;
+            inNumber = 1;
+            expectOperand = 0;
+        } else if (isalpha((unsigned char)c)) {
+            return 0;
+        } else if (isOperator(c)) {
+            if (expectOperand)
+                return 0;
+            inNumber = 0;
+            expectOperand = 1;
+        } else if (c == '(') {
+            if (!expectOperand)
+                return 0;
+            inNumber = 0;
+            parenDepth++;
+        } else if (c == ')') {
+            if (expectOperand || --parenDepth < 0)
+                return 0;
+            inNumber = 0;
+        } else {
+            return 0;
+        }
+    }
+    return parenDepth == 0 && !expectOperand;
+}
+
+static void report(const char *name, size_t len, double tOld, double tNew, int same)
+{
+    printf("%-12s %9.2f GB/s %9.2f GB/s %7.2fx %s\n", name,
+           (double)len / 1e9 / tOld, (double)len / 1e9 / tNew, tOld / tNew,
+           same ? "" : "RESULTS DIFFER");
+}
+
+int main(int argc, char *argv[])
+{
+    size_t len = (size_t)((argc > 1) ? atol(argv[1]) : 256) << 20;
+    char *text = malloc(len), *packed = malloc(len), *expr = malloc(len);
+    size_t packedLen, exprLen = 0, i;
+    unsigned seed = 37;
+    double t0, tOld, tNew;
+    int oldOk, newOk;
+
+    if (text == NULL || packed == NULL || expr == NULL)
+        return 1;
+
+    /* Letters in runs of 1..8, their compressed form, and "12 + 345 * (6 - 78) ..." */
+    for (i = 0; i < len; ) {
+        size_t run;
+        char c;
+
+        seed = seed * 1103515245u + 12345u;
+        c = (char)('a' + (seed >> 16) % 26);
+        run = 1 + (seed >> 8) % 8;
+        while (run-- > 0 && i < len)
+            text[i++] = c;
+    }
+    packedLen = compressRange(text, len, packed);
+    while (exprLen + 16 < len) {
+        seed = seed * 1103515245u + 12345u;
+        exprLen += (size_t)sprintf(expr + exprLen, "%u %c ", 1 + (seed >> 16) % 999, "+-*/%"[(seed >> 8) % 5]);
+    }
+    expr[exprLen++] = '7';
+
+    printf("%zu MB, kernel: %s\n", len >> 20, classifyKernelName());
+    printf("%-12s %14s %14s %8s\n", "", "original", "new", "speedup");
+
+    t0 = nowSeconds();
+    oldOk = validStringOriginal(text, len);
+    tOld = nowSeconds() - t0;
+    t0 = nowSeconds();
+    newOk = checkString(text, len) == CHECK_VALID;
+    tNew = nowSeconds() - t0;
+    report("string", len, tOld, tNew, oldOk && newOk);
+
+    t0 = nowSeconds();
+    oldOk = validCompressedOriginal(packed, packedLen);
+    tOld = nowSeconds() - t0;
+    t0 = nowSeconds();
+    newOk = checkCompressed(packed, packedLen) == CHECK_VALID;
+    tNew = nowSeconds() - t0;
+    report("compressed", packedLen, tOld, tNew, oldOk && newOk);
+
+    t0 = nowSeconds();
+    oldOk = validInfixOriginal(expr, exprLen);
+    tOld = nowSeconds() - t0;
+    t0 = nowSeconds();
+    newOk = checkInfix(expr, exprLen) == CHECK_VALID;
+    tNew = nowSeconds() - t0;
+    report("infix", exprLen, tOld, tNew, oldOk && newOk);
+
+    free(text);
+    free(packed);
+    free(expr);
+    return 0;
+}
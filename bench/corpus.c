@@ -0,0 +1,170 @@
+/*
+ * corpus.c
+ *
+ * Deterministic corpus generator. Randomness comes from one LCG
+ * seeded by the caller, never from rand() or the clock.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "corpus.h"
+
+static const char *const CORPUS_NAMES[CORPUS_KIND_COUNT] = {
+    "no_runs", "mixed_runs", "long_runs", "genome",
+    "large_counts",
+    "operator_chain", "deep_nesting", "big_values"
+};
+
+/* Next value of the generator, 0 .. 2^24 - 1 */
+static unsigned nextRandom(unsigned *state)
+{
+    *state = *state * 1103515245u + 12345u;
+    return (*state >> 8) & 0xFFFFFF;
+}
+
+const char *corpusName(CorpusKind kind)
+{
+    return ((unsigned)kind < CORPUS_KIND_COUNT) ? CORPUS_NAMES[kind] : "unknown";
+}
+
+/* ============================================================
+ * Helper: makeRuns
+ * Runs of minRun..maxRun letters from alphabet; neighbouring runs
+ * never share a letter, so every run stays separate.
+ * ============================================================ */
+static size_t makeRuns(char *buf, size_t size, unsigned *state, const char *alphabet,
+                       unsigned minRun, unsigned maxRun)
+{
+    size_t n = strlen(alphabet), i = 0;
+    char prev = 0;
+
+    while (i < size) {
+        unsigned run = minRun + nextRandom(state) % (maxRun - minRun + 1);
+        char c;
+
+        do {
+            c = alphabet[nextRandom(state) % n];
+        } while (c == prev);
+        while (run-- > 0 && i < size)
+            buf[i++] = c;
+        prev = c;
+    }
+    return i;
+}
+
+/* ============================================================
+ * Helper: makeLargeCounts
+ * ============================================================ */
+static size_t makeLargeCounts(char *buf, size_t size, unsigned *state)
+{
+    size_t i = 0;
+    char prev = 0;
+
+    while (i + 5 <= size) {
+        char c;
+
+        do {
+            c = (char)('a' + nextRandom(state) % 26);
+        } while (c == prev);
+        i += (size_t)sprintf(buf + i, "%u%c", 1000 + nextRandom(state) % 9000, c);
+        prev = c;
+    }
+    if (i == 0 && size > 0)
+        buf[i++] = 'a';
+    return i;
+}
+
+/* ============================================================
+ * Helper: makeChain
+ * "n op n op ... n" with operands of 1..maxDigits digits.
+ * ============================================================ */
+static size_t makeChain(char *buf, size_t size, unsigned *state, const char *ops, int maxDigits)
+{
+    size_t i = 0;
+
+    for (;;) {
+        char number[24];
+        int digits = 1 + (int)(nextRandom(state) % (unsigned)maxDigits), k;
+        size_t need;
+
+        number[0] = (char)('1' + nextRandom(state) % 9);
+        for (k = 1; k < digits; k++)
+            number[k] = (char)('0' + nextRandom(state) % 10);
+        need = (size_t)digits + ((i > 0) ? 3 : 0);
+        if (i + need > size)
+            break;
+        if (i > 0) {
+            buf[i++] = ' ';
+            buf[i++] = ops[nextRandom(state) % strlen(ops)];
+            buf[i++] = ' ';
+        }
+        memcpy(buf + i, number, (size_t)digits);
+        i += (size_t)digits;
+    }
+    if (i == 0 && size > 0)
+        buf[i++] = '1';
+    return i;
+}
+
+/* ============================================================
+ * Helper: makeNesting
+ * depth '(' then "1", then depth times " op n)"; each level takes
+ * at most 8 bytes (a '(' and " op nnn)").
+ * ============================================================ */
+static size_t makeNesting(char *buf, size_t size, unsigned *state)
+{
+    size_t depth = (size > 1) ? (size - 1) / 8 : 0, i = 0, d;
+
+    for (d = 0; d < depth; d++)
+        buf[i++] = '(';
+    buf[i++] = '1';
+    for (d = 0; d < depth; d++)
+        i += (size_t)sprintf(buf + i, " %c %u)", "+-*/%"[nextRandom(state) % 5],
+                             1 + nextRandom(state) % 999);
+    return i;
+}
+
+/* ============================================================
+ * Function: makeCorpus
+ * ============================================================ */
+size_t makeCorpus(CorpusKind kind, size_t size, unsigned seed, char *buf)
+{
+    unsigned state = seed;
+    size_t len = 0;
+
+    switch (kind) {
+        case CORPUS_NO_RUNS:
+            len = makeRuns(buf, size, &state, "abcdefghijklmnopqrstuvwxyz", 1, 1);
+            break;
+        case CORPUS_MIXED_RUNS:
+            len = makeRuns(buf, size, &state, "abcdeXYZ", 1, 40);
+            break;
+        case CORPUS_LONG_RUNS:
+            len = makeRuns(buf, size, &state, "ab", 10000, 100000);
+            break;
+        case CORPUS_GENOME:
+            len = makeRuns(buf, size, &state, "ACGT", 1, 4);
+            break;
+        case CORPUS_LARGE_COUNTS:
+            len = makeLargeCounts(buf, size, &state);
+            break;
+        case CORPUS_OPERATOR_CHAIN:
+            len = makeChain(buf, size, &state, "+-*/%", 4);
+            break;
+        case CORPUS_DEEP_NESTING:
+            len = makeNesting(buf, size, &state);
+            break;
+        case CORPUS_BIG_VALUES:
+            len = makeChain(buf, size, &state, "*", 18);
+            break;
+        default:
+            break;
+    }
+    buf[len] = '\0';
+    return len;
+}
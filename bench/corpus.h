@@ -0,0 +1,45 @@
+/*
+ * corpus.h
+ *
+ * Deterministic test inputs for the benchmarks: the same kind,
+ * size and seed always give the same bytes, on every machine.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stddef.h>
+
+typedef enum {
+    /* Letters (valid compressString input) */
+    CORPUS_NO_RUNS,         /* No two neighbours alike */
+    CORPUS_MIXED_RUNS,      /* Runs of 1..40, log-like */
+    CORPUS_LONG_RUNS,       /* Runs of 10000..100000 */
+    CORPUS_GENOME,          /* ACGT, runs of 1..4 */
+
+    /* Compressed text (valid expandString input) */
+    CORPUS_LARGE_COUNTS,    /* Every run 1000..9999 long: about 1000x on expansion */
+
+    /* Infix expressions (valid isValidInfix input) */
+    CORPUS_OPERATOR_CHAIN,  /* "123 + 45 * 6 - 789 / 12 % 34 ..." */
+    CORPUS_DEEP_NESTING,    /* "(((1 + 2) * 3) - 4)", nested as deep as size allows */
+    CORPUS_BIG_VALUES,      /* Products of 18-digit numbers (BigInt results) */
+
+    CORPUS_KIND_COUNT
+} CorpusKind;
+
+/* Short name of a kind ("long_runs", "deep_nesting", ...) */
+const char *corpusName(CorpusKind kind);
+
+/*
+ * Writes a corpus of about 'size' bytes (never more) into buf and
+ * NUL-terminates it; buf needs size + 1 bytes. Returns its length.
+ */
+size_t makeCorpus(CorpusKind kind, size_t size, unsigned seed, char *buf);
+
+#endif
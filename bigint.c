@@ -0,0 +1,1041 @@
+/*
+ * bigint.c
+ *
+ * Arbitrary-precision integers for results that do not fit in
+ * 64 bits. Magnitudes are arrays of 32-bit limbs:
+ *   - multiplication is schoolbook for short operands and
+ *     Karatsuba above KARATSUBA_THRESHOLD limbs
+ *   - division is Knuth's algorithm D, or a Newton reciprocal
+ *     (a handful of multiplications) when both the divisor and the
+ *     quotient are long
+ *   - decimal conversion splits the number in halves by powers of
+ *     10^(9 * 2^k), so long conversions also ride on fast multiply
+ *     and divide
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "bigint.h"
+
+typedef unsigned long long BigWide;
+
+#define LIMB_BITS 32
+
+/* Below this many limbs schoolbook multiplication is faster */
+#define KARATSUBA_THRESHOLD 32
+
+/* Newton division once divisor and quotient both reach this many limbs */
+#define NEWTON_THRESHOLD 400
+
+/* Extra quotient bits computed by Newton division */
+#define NEWTON_GUARD_BITS 32
+
+/* Decimal digits per 10^9 chunk */
+#define CHUNK_DIGITS 9
+#define CHUNK_BASE   1000000000u
+
+/* Decimal conversions longer than this split in halves */
+#define DECIMAL_SPLIT_LIMBS 48
+
+/* Powers 10^(9 * 2^k), built on demand by decimal conversion */
+#define MAX_POWERS 48
+
+typedef struct {
+    BigInt power[MAX_POWERS];
+    int count;
+} PowerTable;
+
+/* ============================================================
+ * Magnitude helpers (limb arrays)
+ * ============================================================ */
+static size_t trimmed(const BigLimb *a, size_t n)
+{
+    while (n > 0 && a[n - 1] == 0)
+        n--;
+    return n;
+}
+
+static int compareMag(const BigLimb *a, size_t an, const BigLimb *b, size_t bn)
+{
+    if (an != bn)
+        return an < bn ? -1 : 1;
+    while (an-- > 0) {
+        if (a[an] != b[an])
+            return a[an] < b[an] ? -1 : 1;
+    }
+    return 0;
+}
+
+static int leadingZeros(BigLimb x)
+{
+    int n = 0;
+
+    while (!(x & 0x80000000u)) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+}
+
+/* r = a + b for an >= bn; r holds an limbs. Returns the carry. */
+static BigLimb addMag(BigLimb *r, const BigLimb *a, size_t an,
+                      const BigLimb *b, size_t bn)
+{
+    BigWide carry = 0;
+    size_t i;
+
+    for (i = 0; i < bn; i++) {
+        carry += (BigWide)a[i] + b[i];
+        r[i] = (BigLimb)carry;
+        carry >>= LIMB_BITS;
+    }
+    for (; i < an; i++) {
+        carry += a[i];
+        r[i] = (BigLimb)carry;
+        carry >>= LIMB_BITS;
+    }
+    return (BigLimb)carry;
+}
+
+/* r = a - b for a >= b (an >= bn); r holds an limbs. Returns the borrow. */
+static BigLimb subMag(BigLimb *r, const BigLimb *a, size_t an,
+                      const BigLimb *b, size_t bn)
+{
+    BigLimb borrow = 0;
+    size_t i;
+
+    for (i = 0; i < bn; i++) {
+        BigWide d = (BigWide)a[i] - b[i] - borrow;
+        r[i] = (BigLimb)d;
+        borrow = (BigLimb)(d >> 63);
+    }
+    for (; i < an; i++) {
+        BigWide d = (BigWide)a[i] - borrow;
+        r[i] = (BigLimb)d;
+        borrow = (BigLimb)(d >> 63);
+    }
+    return borrow;
+}
+
+/* r[0..rn) += a[0..an) for an <= rn */
+static void addInto(BigLimb *r, size_t rn, const BigLimb *a, size_t an)
+{
+    BigWide carry = 0;
+    size_t i;
+
+    for (i = 0; i < an; i++) {
+        carry += (BigWide)r[i] + a[i];
+        r[i] = (BigLimb)carry;
+        carry >>= LIMB_BITS;
+    }
+    for (; carry != 0 && i < rn; i++) {
+        carry += r[i];
+        r[i] = (BigLimb)carry;
+        carry >>= LIMB_BITS;
+    }
+}
+
+/* r[0..rn) -= a[0..an) for an <= rn and r >= a */
+static void subFrom(BigLimb *r, size_t rn, const BigLimb *a, size_t an)
+{
+    BigLimb borrow = subMag(r, r, an, a, an);
+    size_t i;
+
+    for (i = an; borrow != 0 && i < rn; i++) {
+        borrow = (r[i] == 0);
+        r[i]--;
+    }
+}
+
+/* r = a << s (0 <= s < 32), n limbs. Returns the bits shifted out. */
+static BigLimb shiftLeftMag(BigLimb *r, const BigLimb *a, size_t n, int s)
+{
+    BigLimb out = 0;
+    size_t i;
+
+    if (s == 0) {
+        memmove(r, a, n * sizeof(BigLimb));
+        return 0;
+    }
+    for (i = 0; i < n; i++) {
+        BigLimb x = a[i];
+        r[i] = (x << s) | out;
+        out = x >> (LIMB_BITS - s);
+    }
+    return out;
+}
+
+/* r = a >> s (0 <= s < 32), n limbs */
+static void shiftRightMag(BigLimb *r, const BigLimb *a, size_t n, int s)
+{
+    size_t i;
+
+    if (s == 0) {
+        memmove(r, a, n * sizeof(BigLimb));
+        return;
+    }
+    for (i = 0; i < n; i++) {
+        BigLimb hi = (i + 1 < n) ? a[i + 1] << (LIMB_BITS - s) : 0;
+        r[i] = (a[i] >> s) | hi;
+    }
+}
+
+/* ============================================================
+ * Multiplication
+ * ============================================================ */
+
+/* r = a * b, r holds an + bn limbs (must not overlap a or b) */
+static void mulSchool(BigLimb *r, const BigLimb *a, size_t an,
+                      const BigLimb *b, size_t bn)
+{
+    size_t i, j;
+
+    memset(r, 0, (an + bn) * sizeof(BigLimb));
+    for (i = 0; i < bn; i++) {
+        BigWide carry = 0;
+        BigLimb m = b[i];
+
+        if (m == 0)
+            continue;
+        for (j = 0; j < an; j++) {
+            carry += (BigWide)a[j] * m + r[i + j];
+            r[i + j] = (BigLimb)carry;
+            carry >>= LIMB_BITS;
+        }
+        r[i + an] = (BigLimb)carry;
+    }
+}
+
+/* Scratch limbs karatsuba needs for n-limb operands */
+static size_t karatsubaScratch(size_t n)
+{
+    size_t total = 0;
+
+    while (n >= KARATSUBA_THRESHOLD) {
+        size_t h = n - n / 2;
+        total += 4 * (h + 1);
+        n = h + 1;
+    }
+    return total;
+}
+
+/* ============================================================
+ * Helper: karatsuba
+ * r = a * b for two n-limb operands (r holds 2n limbs).
+ * With a = a1 B^m + a0 and b = b1 B^m + b0:
+ *   a b = z2 B^2m + (z1 - z2 - z0) B^m + z0
+ * where z0 = a0 b0, z2 = a1 b1, z1 = (a0 + a1)(b0 + b1):
+ * three half-size products instead of four.
+ * ============================================================ */
+static void karatsuba(BigLimb *r, const BigLimb *a, const BigLimb *b,
+                      size_t n, BigLimb *scratch)
+{
+    size_t m = n / 2;
+    size_t h = n - m;
+    BigLimb *sa = scratch;
+    BigLimb *sb = sa + (h + 1);
+    BigLimb *z1 = sb + (h + 1);
+    BigLimb *next = z1 + 2 * (h + 1);
+
+    if (n < KARATSUBA_THRESHOLD) {
+        mulSchool(r, a, n, b, n);
+        return;
+    }
+
+    sa[h] = addMag(sa, a + m, h, a, m);
+    sb[h] = addMag(sb, b + m, h, b, m);
+    karatsuba(z1, sa, sb, h + 1, next);
+    karatsuba(r, a, b, m, next);
+    karatsuba(r + 2 * m, a + m, b + m, h, next);
+
+    subFrom(z1, 2 * (h + 1), r, 2 * m);
+    subFrom(z1, 2 * (h + 1), r + 2 * m, 2 * h);
+    addInto(r + m, 2 * n - m, z1, 2 * (h + 1));
+}
+
+/* ============================================================
+ * Helper: mulMag
+ * r = a * b for an >= bn >= 1 (r holds an + bn limbs and must not
+ * overlap a or b). Unbalanced operands are multiplied in bn-limb
+ * slices of a. Returns 0 if out of memory.
+ * ============================================================ */
+static int mulMag(BigLimb *r, const BigLimb *a, size_t an,
+                  const BigLimb *b, size_t bn)
+{
+    size_t need, off;
+    BigLimb *scratch, *slice;
+    int ok = 1;
+
+    if (bn < KARATSUBA_THRESHOLD) {
+        mulSchool(r, a, an, b, bn);
+        return 1;
+    }
+
+    need = karatsubaScratch(bn);
+    scratch = malloc((need + (an == bn ? 0 : 2 * bn)) * sizeof(BigLimb));
+    if (scratch == NULL)
+        return 0;
+
+    if (an == bn) {
+        karatsuba(r, a, b, bn, scratch);
+        free(scratch);
+        return 1;
+    }
+
+    slice = scratch + need;
+    memset(r, 0, (an + bn) * sizeof(BigLimb));
+    for (off = 0; ok && off < an; off += bn) {
+        size_t sn = (an - off < bn) ? an - off : bn;
+
+        if (sn == bn)
+            karatsuba(slice, a + off, b, bn, scratch);
+        else
+            ok = mulMag(slice, b, bn, a + off, sn);
+        if (ok)
+            addInto(r + off, an + bn - off, slice, sn + bn);
+    }
+    free(scratch);
+    return ok;
+}
+
+/* ============================================================
+ * Division helpers (magnitudes)
+ * ============================================================ */
+
+/* q = a / d for one limb d (q may alias a). Returns the remainder. */
+static BigLimb divMagLimb(BigLimb *q, const BigLimb *a, size_t an, BigLimb d)
+{
+    BigWide rem = 0;
+    size_t i = an;
+
+    while (i-- > 0) {
+        BigWide cur = (rem << LIMB_BITS) | a[i];
+        q[i] = (BigLimb)(cur / d);
+        rem = cur % d;
+    }
+    return (BigLimb)rem;
+}
+
+/* ============================================================
+ * Helper: divMagKnuth
+ * Knuth's algorithm D: q = a / b (an - bn + 1 limbs) and
+ * r = a % b (bn limbs, may be NULL) for an >= bn >= 2.
+ * Returns 0 if out of memory.
+ * ============================================================ */
+static int divMagKnuth(BigLimb *q, BigLimb *r, const BigLimb *a, size_t an,
+                       const BigLimb *b, size_t bn)
+{
+    int s = leadingZeros(b[bn - 1]);
+    BigLimb *u = malloc((an + 1 + bn) * sizeof(BigLimb));
+    BigLimb *v;
+    size_t i, j;
+
+    if (u == NULL)
+        return 0;
+    v = u + an + 1;
+
+    /* Normalize so the divisor's top bit is set */
+    shiftLeftMag(v, b, bn, s);
+    u[an] = shiftLeftMag(u, a, an, s);
+
+    for (j = an - bn + 1; j-- > 0; ) {
+        BigWide num = ((BigWide)u[j + bn] << LIMB_BITS) | u[j + bn - 1];
+        BigWide qhat = num / v[bn - 1];
+        BigWide rhat = num % v[bn - 1];
+        BigWide carry = 0;
+        BigWide t;
+        BigLimb borrow = 0;
+
+        while (qhat > 0xFFFFFFFFu ||
+               qhat * v[bn - 2] > ((rhat << LIMB_BITS) | u[j + bn - 2])) {
+            qhat--;
+            rhat += v[bn - 1];
+            if (rhat > 0xFFFFFFFFu)
+                break;
+        }
+
+        /* u[j..j+bn] -= qhat * v */
+        for (i = 0; i < bn; i++) {
+            BigWide p = qhat * v[i] + carry;
+            carry = p >> LIMB_BITS;
+            t = (BigWide)u[i + j] - (BigLimb)p - borrow;
+            u[i + j] = (BigLimb)t;
+            borrow = (BigLimb)(t >> 63);
+        }
+        t = (BigWide)u[j + bn] - carry - borrow;
+        u[j + bn] = (BigLimb)t;
+
+        /* Estimate was one too large: add v back */
+        if (t >> 63) {
+            qhat--;
+            carry = 0;
+            for (i = 0; i < bn; i++) {
+                carry += (BigWide)u[i + j] + v[i];
+                u[i + j] = (BigLimb)carry;
+                carry >>= LIMB_BITS;
+            }
+            u[j + bn] += (BigLimb)carry;
+        }
+        q[j] = (BigLimb)qhat;
+    }
+
+    if (r != NULL)
+        shiftRightMag(r, u, bn, s);
+    free(u);
+    return 1;
+}
+
+/* ============================================================
+ * Function: bigInit / bigFree / bigSwap
+ * ============================================================ */
+void bigInit(BigInt *x)
+{
+    memset(x, 0, sizeof(*x));
+}
+
+void bigFree(BigInt *x)
+{
+    free(x->limbs);
+    bigInit(x);
+}
+
+void bigSwap(BigInt *a, BigInt *b)
+{
+    BigInt t = *a;
+    *a = *b;
+    *b = t;
+}
+
+/* ============================================================
+ * Helper: reserve
+ * Makes room for n limbs, keeping the current ones.
+ * ============================================================ */
+static int reserve(BigInt *x, size_t n)
+{
+    size_t cap;
+    BigLimb *grown;
+
+    if (n <= x->cap)
+        return 1;
+    cap = (x->cap * 2 > n) ? x->cap * 2 : n;
+    if (cap < 4)
+        cap = 4;
+    grown = realloc(x->limbs, cap * sizeof(BigLimb));
+    if (grown == NULL)
+        return 0;
+    x->limbs = grown;
+    x->cap = cap;
+    return 1;
+}
+
+/* Replaces x's limbs with an n-limb array it takes ownership of */
+static void adopt(BigInt *x, BigLimb *limbs, size_t n, int negative)
+{
+    free(x->limbs);
+    x->limbs = limbs;
+    x->cap = n;
+    x->len = trimmed(limbs, n);
+    x->negative = negative && x->len > 0;
+}
+
+static size_t bitLength(const BigInt *x)
+{
+    if (x->len == 0)
+        return 0;
+    return x->len * LIMB_BITS - (size_t)leadingZeros(x->limbs[x->len - 1]);
+}
+
+/* ============================================================
+ * Function: bigSetLong / bigCopy / bigIsZero / bigToLong
+ * ============================================================ */
+int bigSetLong(BigInt *x, long long value)
+{
+    unsigned long long mag = (value < 0) ? 0ULL - (unsigned long long)value
+                                         : (unsigned long long)value;
+
+    if (!reserve(x, 2))
+        return 0;
+    x->limbs[0] = (BigLimb)mag;
+    x->limbs[1] = (BigLimb)(mag >> LIMB_BITS);
+    x->len = trimmed(x->limbs, 2);
+    x->negative = (value < 0);
+    return 1;
+}
+
+int bigCopy(BigInt *dst, const BigInt *src)
+{
+    if (dst == src)
+        return 1;
+    if (!reserve(dst, src->len))
+        return 0;
+    if (src->len > 0)
+        memcpy(dst->limbs, src->limbs, src->len * sizeof(BigLimb));
+    dst->len = src->len;
+    dst->negative = src->negative;
+    return 1;
+}
+
+int bigIsZero(const BigInt *x)
+{
+    return x->len == 0;
+}
+
+int bigToLong(const BigInt *x, long long *value)
+{
+    unsigned long long mag;
+
+    if (x->len > 2)
+        return 0;
+    mag = (x->len > 0) ? x->limbs[0] : 0;
+    if (x->len == 2)
+        mag |= (unsigned long long)x->limbs[1] << LIMB_BITS;
+
+    if (!x->negative && mag <= 0x7FFFFFFFFFFFFFFFULL)
+        *value = (long long)mag;
+    else if (x->negative && mag <= 0x8000000000000000ULL)
+        *value = (mag == 0x8000000000000000ULL) ? (-0x7FFFFFFFFFFFFFFFLL - 1)
+                                                : -(long long)mag;
+    else
+        return 0;
+    return 1;
+}
+
+int bigCompare(const BigInt *a, const BigInt *b)
+{
+    int c;
+
+    if (a->negative != b->negative)
+        return a->negative ? -1 : 1;
+    c = compareMag(a->limbs, a->len, b->limbs, b->len);
+    return a->negative ? -c : c;
+}
+
+/* ============================================================
+ * Helper: addSigned
+ * r = a + b, with b's sign given separately so subtraction is
+ * the same code.
+ * ============================================================ */
+static int addSigned(BigInt *r, const BigInt *a, const BigInt *b, int bNegative)
+{
+    const BigInt *x = a, *y = b;
+    int xNeg = a->negative, yNeg = bNegative;
+    size_t xl, yl;
+
+    if (compareMag(a->limbs, a->len, b->limbs, b->len) < 0) {
+        x = b;
+        y = a;
+        xNeg = bNegative;
+        yNeg = a->negative;
+    }
+    xl = x->len;
+    yl = y->len;
+
+    if (xNeg == yNeg) {
+        if (!reserve(r, xl + 1))
+            return 0;
+        r->limbs[xl] = addMag(r->limbs, x->limbs, xl, y->limbs, yl);
+        r->len = trimmed(r->limbs, xl + 1);
+    } else {
+        if (!reserve(r, xl))
+            return 0;
+        subMag(r->limbs, x->limbs, xl, y->limbs, yl);
+        r->len = trimmed(r->limbs, xl);
+    }
+    r->negative = xNeg && r->len > 0;
+    return 1;
+}
+
+int bigAdd(BigInt *r, const BigInt *a, const BigInt *b)
+{
+    return addSigned(r, a, b, b->negative);
+}
+
+int bigSub(BigInt *r, const BigInt *a, const BigInt *b)
+{
+    return addSigned(r, a, b, !b->negative);
+}
+
+/* ============================================================
+ * Function: bigMul
+ * ============================================================ */
+int bigMul(BigInt *r, const BigInt *a, const BigInt *b)
+{
+    const BigInt *x = a, *y = b;
+    int negative = a->negative != b->negative;
+    BigLimb *product;
+    size_t n;
+
+    if (a->len == 0 || b->len == 0) {
+        r->len = 0;
+        r->negative = 0;
+        return 1;
+    }
+    if (x->len < y->len) {
+        x = b;
+        y = a;
+    }
+
+    /* One-limb factor: multiply in place */
+    if (y->len == 1) {
+        BigLimb m = y->limbs[0];
+        size_t xl = x->len;
+        BigWide carry = 0;
+        size_t i;
+
+        if (!reserve(r, xl + 1))
+            return 0;
+        for (i = 0; i < xl; i++) {
+            carry += (BigWide)x->limbs[i] * m;
+            r->limbs[i] = (BigLimb)carry;
+            carry >>= LIMB_BITS;
+        }
+        r->limbs[xl] = (BigLimb)carry;
+        r->len = trimmed(r->limbs, xl + 1);
+        r->negative = negative;
+        return 1;
+    }
+
+    n = x->len + y->len;
+    product = malloc(n * sizeof(BigLimb));
+    if (product == NULL)
+        return 0;
+    if (!mulMag(product, x->limbs, x->len, y->limbs, y->len)) {
+        free(product);
+        return 0;
+    }
+    adopt(r, product, n, negative);
+    return 1;
+}
+
+/* ============================================================
+ * Helpers: shiftLeft / shiftRight
+ * r = a * 2^bits and r = a / 2^bits (magnitudes, sign kept).
+ * ============================================================ */
+static int shiftLeft(BigInt *r, const BigInt *a, size_t bits)
+{
+    size_t limbs = bits / LIMB_BITS;
+    int s = (int)(bits % LIMB_BITS);
+    size_t n = a->len;
+    size_t i;
+
+    if (n == 0) {
+        r->len = 0;
+        r->negative = 0;
+        return 1;
+    }
+    if (!reserve(r, n + limbs + 1))
+        return 0;
+
+    /* Top down, so r may alias a */
+    r->limbs[n + limbs] = s ? a->limbs[n - 1] >> (LIMB_BITS - s) : 0;
+    for (i = n; i-- > 0; ) {
+        BigLimb lo = (s && i > 0) ? a->limbs[i - 1] >> (LIMB_BITS - s) : 0;
+        r->limbs[i + limbs] = (a->limbs[i] << s) | lo;
+    }
+    memset(r->limbs, 0, limbs * sizeof(BigLimb));
+    r->len = trimmed(r->limbs, n + limbs + 1);
+    r->negative = a->negative;
+    return 1;
+}
+
+static int shiftRight(BigInt *r, const BigInt *a, size_t bits)
+{
+    size_t limbs = bits / LIMB_BITS;
+    int s = (int)(bits % LIMB_BITS);
+    size_t n = a->len;
+    size_t m;
+
+    if (limbs >= n) {
+        r->len = 0;
+        r->negative = 0;
+        return 1;
+    }
+    m = n - limbs;
+    if (!reserve(r, m))
+        return 0;
+    shiftRightMag(r->limbs, a->limbs + limbs, m, s);
+    r->len = trimmed(r->limbs, m);
+    r->negative = a->negative && r->len > 0;
+    return 1;
+}
+
+/* ============================================================
+ * Helper: reciprocal
+ * x ~ 2^(2p) / d for a d of exactly p bits, within a few units.
+ * The top h bits of d give a half-precision reciprocal y
+ * (recursively); one Newton step doubles its precision:
+ *     x = y 2^(p-h) + y (2^(p+h) - d y) / 2^(2h)
+ * Both products are p x h bits. Short divisors are divided exactly.
+ * ============================================================ */
+static int reciprocal(BigInt *x, const BigInt *d, size_t p)
+{
+    BigInt y = BIGINT_INIT;
+    BigInt e = BIGINT_INIT;
+    BigInt t = BIGINT_INIT;
+    size_t h;
+    int ok;
+
+    if (p < (size_t)NEWTON_THRESHOLD * LIMB_BITS) {
+        ok = bigSetLong(&t, 1) && shiftLeft(&t, &t, 2 * p) &&
+             bigDivMod(x, NULL, &t, d);
+        bigFree(&t);
+        return ok;
+    }
+
+    h = p / 2 + 1;
+    ok = shiftRight(&t, d, p - h) &&
+         reciprocal(&y, &t, h) &&
+         bigMul(&e, d, &y) &&
+         bigSetLong(&t, 1) && shiftLeft(&t, &t, p + h) &&
+         bigSub(&e, &t, &e) &&
+         bigMul(&t, &y, &e) &&
+         shiftRight(&t, &t, 2 * h) &&
+         shiftLeft(x, &y, p - h) &&
+         bigAdd(x, x, &t);
+
+    bigFree(&y);
+    bigFree(&e);
+    bigFree(&t);
+    return ok;
+}
+
+/* ============================================================
+ * Helper: divNewton
+ * q = a / b, r = a % b for a >= b > 0 via q ~ a * (1 / b):
+ * the reciprocal of b's top p bits (p = quotient bits plus guard
+ * bits) times the top bits of a gives a quotient off by at most a
+ * few units, which the remainder then corrects.
+ * ============================================================ */
+static int divNewton(BigInt *q, BigInt *r, const BigInt *a, const BigInt *b)
+{
+    BigInt top = BIGINT_INIT;
+    BigInt inv = BIGINT_INIT;
+    BigInt t = BIGINT_INIT;
+    BigInt one = BIGINT_INIT;
+    size_t n = bitLength(a);
+    size_t l = bitLength(b);
+    size_t p = n - l + NEWTON_GUARD_BITS;
+    size_t drop = (n > p + NEWTON_GUARD_BITS) ? n - p - NEWTON_GUARD_BITS : 0;
+    int ok;
+
+    if (p >= l)
+        ok = shiftLeft(&top, b, p - l);
+    else
+        ok = shiftRight(&top, b, l - p);
+
+    /* Bits of a below 'drop' cannot change the quotient estimate */
+    ok = ok && reciprocal(&inv, &top, p) &&
+         shiftRight(&t, a, drop) &&
+         bigMul(&t, &t, &inv) &&
+         shiftRight(q, &t, p + l - drop) &&
+         bigMul(&t, q, b) &&
+         bigSub(r, a, &t) &&
+         bigSetLong(&one, 1);
+
+    while (ok && r->negative)
+        ok = bigSub(q, q, &one) && bigAdd(r, r, b);
+    while (ok && compareMag(r->limbs, r->len, b->limbs, b->len) >= 0)
+        ok = bigAdd(q, q, &one) && bigSub(r, r, b);
+
+    bigFree(&top);
+    bigFree(&inv);
+    bigFree(&t);
+    bigFree(&one);
+    return ok;
+}
+
+/* ============================================================
+ * Function: bigDivMod
+ * Picks the single-limb loop, algorithm D or Newton division by
+ * operand size. Results are built in fresh storage, so q and r
+ * may alias a or b.
+ * ============================================================ */
+int bigDivMod(BigInt *q, BigInt *r, const BigInt *a, const BigInt *b)
+{
+    int qNeg = a->negative != b->negative;
+    int rNeg = a->negative;
+    size_t an = a->len;
+    size_t bn = b->len;
+    size_t qn;
+    BigInt quot = BIGINT_INIT;
+    BigInt rem = BIGINT_INIT;
+    int ok = 1;
+
+    if (compareMag(a->limbs, an, b->limbs, bn) < 0) {
+        if (r != NULL && !bigCopy(r, a))
+            return 0;
+        if (q != NULL) {
+            q->len = 0;
+            q->negative = 0;
+        }
+        return 1;
+    }
+
+    qn = an - bn + 1;
+    if (bn >= NEWTON_THRESHOLD && qn >= NEWTON_THRESHOLD) {
+        BigInt x = *a;
+        BigInt y = *b;
+
+        x.negative = y.negative = 0;
+        ok = divNewton(&quot, &rem, &x, &y);
+    } else {
+        ok = reserve(&quot, qn) && reserve(&rem, bn);
+        if (ok && bn == 1)
+            rem.limbs[0] = divMagLimb(quot.limbs, a->limbs, an, b->limbs[0]);
+        else if (ok)
+            ok = divMagKnuth(quot.limbs, rem.limbs, a->limbs, an, b->limbs, bn);
+        if (ok) {
+            quot.len = trimmed(quot.limbs, qn);
+            rem.len = trimmed(rem.limbs, bn);
+        }
+    }
+
+    if (ok) {
+        quot.negative = qNeg && quot.len > 0;
+        rem.negative = rNeg && rem.len > 0;
+        if (q != NULL)
+            bigSwap(q, &quot);
+        if (r != NULL)
+            bigSwap(r, &rem);
+    }
+    bigFree(&quot);
+    bigFree(&rem);
+    return ok;
+}
+
+/* ============================================================
+ * Helper: powerOfTen
+ * Returns 10^(9 * 2^k) from the table, squaring its way up to it.
+ * ============================================================ */
+static const BigInt *powerOfTen(PowerTable *table, int k)
+{
+    while (table->count <= k) {
+        BigInt *p = &table->power[table->count];
+        int ok;
+
+        bigInit(p);
+        if (table->count == 0)
+            ok = bigSetLong(p, CHUNK_BASE);
+        else
+            ok = bigMul(p, &table->power[table->count - 1],
+                        &table->power[table->count - 1]);
+        if (!ok) {
+            bigFree(p);
+            return NULL;
+        }
+        table->count++;
+    }
+    return &table->power[k];
+}
+
+static void freePowers(PowerTable *table)
+{
+    int i;
+
+    for (i = 0; i < table->count; i++)
+        bigFree(&table->power[i]);
+    table->count = 0;
+}
+
+/* ============================================================
+ * Helper: parseDecimal
+ * x = value of 'count' digits. Long inputs split as
+ *   high * 10^(9 * 2^k) + low
+ * with the low part the largest such block shorter than the input.
+ * ============================================================ */
+static int parseDecimal(BigInt *x, const char *digits, size_t count,
+                        PowerTable *table)
+{
+    size_t chunk, i;
+
+    if (count > (size_t)DECIMAL_SPLIT_LIMBS * CHUNK_DIGITS) {
+        BigInt low = BIGINT_INIT;
+        const BigInt *power;
+        size_t lowDigits = CHUNK_DIGITS;
+        int k = 0;
+        int ok;
+
+        while (lowDigits * 2 < count) {
+            lowDigits *= 2;
+            k++;
+        }
+        power = powerOfTen(table, k);
+        ok = power != NULL &&
+             parseDecimal(x, digits, count - lowDigits, table) &&
+             parseDecimal(&low, digits + count - lowDigits, lowDigits, table) &&
+             bigMul(x, x, power) &&
+             bigAdd(x, x, &low);
+        bigFree(&low);
+        return ok;
+    }
+
+    /* x = x * 10^9 + chunk, with a short first chunk */
+    x->len = 0;
+    x->negative = 0;
+    if (!reserve(x, count / CHUNK_DIGITS + 2))
+        return 0;
+
+    chunk = count % CHUNK_DIGITS;
+    if (chunk == 0)
+        chunk = CHUNK_DIGITS;
+    for (i = 0; i < count; i += chunk, chunk = CHUNK_DIGITS) {
+        BigWide carry = 0;
+        BigLimb scale = 1;
+        size_t j;
+
+        for (j = 0; j < chunk; j++) {
+            carry = carry * 10 + (BigWide)(digits[i + j] - '0');
+            scale *= 10;
+        }
+        for (j = 0; j < x->len; j++) {
+            carry += (BigWide)x->limbs[j] * scale;
+            x->limbs[j] = (BigLimb)carry;
+            carry >>= LIMB_BITS;
+        }
+        if (carry != 0)
+            x->limbs[x->len++] = (BigLimb)carry;
+    }
+    return 1;
+}
+
+int bigSetDecimal(BigInt *x, const char *digits, size_t count)
+{
+    PowerTable table;
+    int ok;
+
+    table.count = 0;
+    ok = parseDecimal(x, digits, count, &table);
+    freePowers(&table);
+    return ok;
+}
+
+/* ============================================================
+ * Helper: writeDecimal
+ * Writes the magnitude of x at out, left-padded with zeros to
+ * 'width' digits (0 = no padding). Returns the digit count, or
+ * (size_t)-1 if out of memory. Long numbers split as
+ *   x = high * 10^(9 * 2^k) + low
+ * with low written at exactly 9 * 2^k digits.
+ * ============================================================ */
+static size_t writeDecimal(const BigInt *x, size_t width, char *out,
+                           PowerTable *table)
+{
+    size_t n = x->len;
+
+    if (n > DECIMAL_SPLIT_LIMBS) {
+        BigInt high = BIGINT_INIT;
+        BigInt low = BIGINT_INIT;
+        const BigInt *power = NULL;
+        size_t lowDigits = CHUNK_DIGITS;
+        size_t highWidth, written = (size_t)-1;
+        int k = 0;
+
+        /* Largest power with at most half of x's limbs */
+        while ((power = powerOfTen(table, k + 1)) != NULL && power->len * 2 <= n) {
+            lowDigits *= 2;
+            k++;
+        }
+        power = powerOfTen(table, k);
+        if (power != NULL && bigDivMod(&high, &low, x, power)) {
+            highWidth = (width > lowDigits) ? width - lowDigits : 0;
+            written = writeDecimal(&high, highWidth, out, table);
+            if (written != (size_t)-1 &&
+                writeDecimal(&low, lowDigits, out + written, table) != (size_t)-1)
+                written += lowDigits;
+            else
+                written = (size_t)-1;
+        }
+        bigFree(&high);
+        bigFree(&low);
+        return written;
+    } else {
+        /* Peel 10^9 chunks off the low end, then print high to low */
+        /* A limb yields at most 32 / log2(10^9) < 1.08 chunks */
+        BigLimb *work = malloc((2 * n + n / 8 + 2) * sizeof(BigLimb));
+        BigLimb *chunks;
+        size_t chunkCount = 0;
+        size_t len = 0;
+        size_t digits, i;
+        char text[CHUNK_DIGITS];
+
+        if (work == NULL)
+            return (size_t)-1;
+        chunks = work + n;
+        if (n > 0)
+            memcpy(work, x->limbs, n * sizeof(BigLimb));
+        while (n > 0) {
+            chunks[chunkCount++] = divMagLimb(work, work, n, CHUNK_BASE);
+            n = trimmed(work, n);
+        }
+
+        /* Digits of the top chunk without leading zeros */
+        digits = 0;
+        if (chunkCount > 0) {
+            BigLimb c = chunks[chunkCount - 1];
+            while (c > 0) {
+                text[digits++] = (char)('0' + c % 10);
+                c /= 10;
+            }
+        }
+        digits += (chunkCount > 0) ? (chunkCount - 1) * CHUNK_DIGITS : 0;
+
+        for (; len + digits < width; len++)
+            out[len] = '0';
+        if (chunkCount == 0 && width == 0)
+            out[len++] = '0';
+
+        if (chunkCount > 0) {
+            size_t top = digits - (chunkCount - 1) * CHUNK_DIGITS;
+            while (top > 0)
+                out[len++] = text[--top];
+        }
+        for (i = chunkCount - (chunkCount > 0); i-- > 0; ) {
+            BigLimb c = chunks[i];
+            int j;
+
+            for (j = CHUNK_DIGITS - 1; j >= 0; j--) {
+                out[len + (size_t)j] = (char)('0' + c % 10);
+                c /= 10;
+            }
+            len += CHUNK_DIGITS;
+        }
+        free(work);
+        return len;
+    }
+}
+
+/* ============================================================
+ * Function: bigDecimalSize / bigToDecimal
+ * A 32-bit limb holds under 9.64 decimal digits.
+ * ============================================================ */
+size_t bigDecimalSize(const BigInt *x)
+{
+    return x->len * 10 + 3;
+}
+
+size_t bigToDecimal(const BigInt *x, char *out)
+{
+    PowerTable table;
+    BigInt mag = *x;
+    size_t sign = x->negative ? 1 : 0;
+    size_t n;
+
+    table.count = 0;
+    mag.negative = 0;
+    if (sign)
+        out[0] = '-';
+    n = writeDecimal(&mag, 0, out + sign, &table);
+    freePowers(&table);
+
+    if (n == (size_t)-1) {
+        out[0] = '\0';
+        return 0;
+    }
+    out[sign + n] = '\0';
+    return sign + n;
+}
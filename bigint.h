@@ -0,0 +1,84 @@
+/*
+ * bigint.h
+ *
+ * Header file for arbitrary-precision integers.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef BIGINT_H
+#define BIGINT_H
+
+#include <stddef.h>
+
+/* One 32-bit digit of a magnitude */
+typedef unsigned int BigLimb;
+
+/*
+ * Signed integer of any size, stored as sign + magnitude with the
+ * least significant limb first and no leading zero limbs (zero has
+ * len 0). The limb array is owned by the struct and reused when a
+ * new value is assigned. Initialize with bigInit or BIGINT_INIT.
+ */
+typedef struct {
+    BigLimb *limbs;
+    size_t len;
+    size_t cap;
+    int negative;
+} BigInt;
+
+#define BIGINT_INIT { NULL, 0, 0, 0 }
+
+/*
+ * Functions returning int return 1 on success and 0 if out of
+ * memory. Results may alias operands.
+ */
+
+void bigInit(BigInt *x);
+void bigFree(BigInt *x);
+
+int bigSetLong(BigInt *x, long long value);
+
+/* Sets x from 'count' decimal digits (no sign) */
+int bigSetDecimal(BigInt *x, const char *digits, size_t count);
+
+int bigCopy(BigInt *dst, const BigInt *src);
+void bigSwap(BigInt *a, BigInt *b);
+
+int bigIsZero(const BigInt *x);
+
+/* Returns <0, 0 or >0 as a is less than, equal to or greater than b */
+int bigCompare(const BigInt *a, const BigInt *b);
+
+/*
+ * Stores x in *value and returns 1 if it fits in a long long,
+ * returns 0 otherwise.
+ */
+int bigToLong(const BigInt *x, long long *value);
+
+int bigAdd(BigInt *r, const BigInt *a, const BigInt *b);
+int bigSub(BigInt *r, const BigInt *a, const BigInt *b);
+
+/* Schoolbook for short operands, Karatsuba above that */
+int bigMul(BigInt *r, const BigInt *a, const BigInt *b);
+
+/*
+ * Truncating division, as in C: q = a / b, r = a % b (either may be
+ * NULL, and they must differ). b must not be zero. Long divisions
+ * use a Newton reciprocal, so they cost a few multiplications.
+ */
+int bigDivMod(BigInt *q, BigInt *r, const BigInt *a, const BigInt *b);
+
+/* Bytes bigToDecimal needs for x, sign and terminator included */
+size_t bigDecimalSize(const BigInt *x);
+
+/*
+ * Writes x in decimal (with '-' if negative) and a terminator.
+ * Returns the length, or 0 if out of memory.
+ */
+size_t bigToDecimal(const BigInt *x, char *out);
+
+#endif
@@ -0,0 +1,300 @@
+/*
+ * char_class.c
+ *
+ * Character classes for the validators. The table answers one byte
+ * with one load; the block kernels turn 64 bytes into bit masks
+ * with range compares (16 or 32 bytes per instruction), so long
+ * inputs are checked a block at a time and the first bad byte is
+ * found with ctz.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <string.h>
+#include "char_class.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#define A CC_ALPHA
+#define D CC_DIGIT
+#define S CC_SPACE
+#define O CC_OPERATOR
+#define P CC_PAREN
+
+const unsigned char CHAR_CLASS[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, S, S, S, S, S, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    S, 0, 0, 0, 0, O, 0, 0, P, P, O, O, 0, O, 0, O,
+    D, D, D, D, D, D, D, D, D, D, 0, 0, 0, 0, 0, 0,
+    0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, 0,
+    0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A,
+    A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, 0
+    /* 0x80 - 0xFF: no class */
+};
+
+#undef A
+#undef D
+#undef S
+#undef O
+#undef P
+
+/* Classifies one CLASS_BLOCK-byte block */
+typedef void (*ClassifyKernel)(const char *s, BlockClasses *classes);
+
+/* Length of the leading run of letters */
+typedef size_t (*SpanKernel)(const char *s, size_t len);
+
+/* The kernels of one instruction set */
+typedef struct {
+    const char *name;
+    ClassifyKernel classify;
+    SpanKernel spanAlpha;
+} ClassKernels;
+
+/* ============================================================
+ * Scalar kernel
+ * ============================================================ */
+static void classifyScalar(const char *s, BlockClasses *classes)
+{
+    uint64_t alpha = 0, digit = 0, zero = 0, one = 0;
+    int k;
+
+    for (k = 0; k < CLASS_BLOCK; k++) {
+        unsigned char cc = CHAR_CLASS[(unsigned char)s[k]];
+
+        alpha |= (uint64_t)(cc & CC_ALPHA) << k;
+        digit |= (uint64_t)((cc & CC_DIGIT) >> 1) << k;
+        zero |= (uint64_t)(s[k] == '0') << k;
+        one |= (uint64_t)(s[k] == '1') << k;
+    }
+    classes->alpha = alpha;
+    classes->digit = digit;
+    classes->zero = zero;
+    classes->one = one;
+}
+
+static size_t spanAlphaScalar(const char *s, size_t len)
+{
+    size_t i = 0;
+
+    while (i < len && IS_ALPHA(s[i]))
+        i++;
+    return i;
+}
+
+#ifdef HAVE_X86_SIMD
+
+/*
+ * Letters are the bytes whose lower-cased form (c | 0x20) lies in
+ * 'a'..'z'; digits lie in '0'..'9'. Bytes from 0x80 up compare as
+ * negative, so the signed range compares reject them.
+ */
+__attribute__((target("sse2")))
+static void classifySse2(const char *s, BlockClasses *classes)
+{
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i belowA = _mm_set1_epi8('a' - 1), aboveZ = _mm_set1_epi8('z' + 1);
+    const __m128i below0 = _mm_set1_epi8('0' - 1), above9 = _mm_set1_epi8('9' + 1);
+    const __m128i zeros = _mm_set1_epi8('0'), ones = _mm_set1_epi8('1');
+    uint64_t alpha = 0, digit = 0, zero = 0, one = 0;
+    int k;
+
+    for (k = 0; k < CLASS_BLOCK; k += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + k));
+        __m128i lower = _mm_or_si128(v, caseBit);
+
+        alpha |= (uint64_t)(unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpgt_epi8(lower, belowA), _mm_cmplt_epi8(lower, aboveZ))) << k;
+        digit |= (uint64_t)(unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpgt_epi8(v, below0), _mm_cmplt_epi8(v, above9))) << k;
+        zero |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, zeros)) << k;
+        one |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, ones)) << k;
+    }
+    classes->alpha = alpha;
+    classes->digit = digit;
+    classes->zero = zero;
+    classes->one = one;
+}
+
+__attribute__((target("avx2")))
+static void classifyAvx2(const char *s, BlockClasses *classes)
+{
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i belowA = _mm256_set1_epi8('a' - 1), aboveZ = _mm256_set1_epi8('z' + 1);
+    const __m256i below0 = _mm256_set1_epi8('0' - 1), above9 = _mm256_set1_epi8('9' + 1);
+    const __m256i zeros = _mm256_set1_epi8('0'), ones = _mm256_set1_epi8('1');
+    uint64_t alpha = 0, digit = 0, zero = 0, one = 0;
+    int k;
+
+    for (k = 0; k < CLASS_BLOCK; k += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(s + k));
+        __m256i lower = _mm256_or_si256(v, caseBit);
+
+        alpha |= (uint64_t)(unsigned)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpgt_epi8(lower, belowA), _mm256_cmpgt_epi8(aboveZ, lower))) << k;
+        digit |= (uint64_t)(unsigned)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpgt_epi8(v, below0), _mm256_cmpgt_epi8(above9, v))) << k;
+        zero |= (uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zeros)) << k;
+        one |= (uint64_t)(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, ones)) << k;
+    }
+    classes->alpha = alpha;
+    classes->digit = digit;
+    classes->zero = zero;
+    classes->one = one;
+}
+
+__attribute__((target("sse2")))
+static size_t spanAlphaSse2(const char *s, size_t len)
+{
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i belowA = _mm_set1_epi8('a' - 1), aboveZ = _mm_set1_epi8('z' + 1);
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i lower = _mm_or_si128(_mm_loadu_si128((const __m128i *)(s + i)), caseBit);
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpgt_epi8(lower, belowA), _mm_cmplt_epi8(lower, aboveZ)));
+
+        if (mask != 0xFFFFu)
+            return i + (size_t)__builtin_ctz(~mask);
+    }
+    return i + spanAlphaScalar(s + i, len - i);
+}
+
+__attribute__((target("avx2")))
+static size_t spanAlphaAvx2(const char *s, size_t len)
+{
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i belowA = _mm256_set1_epi8('a' - 1), aboveZ = _mm256_set1_epi8('z' + 1);
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i lower = _mm256_or_si256(_mm256_loadu_si256((const __m256i *)(s + i)), caseBit);
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpgt_epi8(lower, belowA), _mm256_cmpgt_epi8(aboveZ, lower)));
+
+        if (mask != 0xFFFFFFFFu)
+            return i + (size_t)__builtin_ctz(~mask);
+    }
+    return i + spanAlphaScalar(s + i, len - i);
+}
+
+#endif /* HAVE_X86_SIMD */
+
+static const ClassKernels SCALAR_KERNELS = { "scalar", classifyScalar, spanAlphaScalar };
+#ifdef HAVE_X86_SIMD
+static const ClassKernels SSE2_KERNELS = { "sse2", classifySse2, spanAlphaSse2 };
+static const ClassKernels AVX2_KERNELS = { "avx2", classifyAvx2, spanAlphaAvx2 };
+#endif
+
+/* Widest first */
+static const ClassKernels *const CLASS_KERNELS[] = {
+#ifdef HAVE_X86_SIMD
+    &AVX2_KERNELS, &SSE2_KERNELS,
+#endif
+    &SCALAR_KERNELS
+};
+
+#define CLASS_KERNEL_COUNT (sizeof(CLASS_KERNELS) / sizeof(CLASS_KERNELS[0]))
+
+/* Kernels in use; read and written atomically, NULL until first needed */
+static const ClassKernels *chosen = NULL;
+
+/* ============================================================
+ * Helper: kernelsSupported
+ * ============================================================ */
+static int kernelsSupported(const ClassKernels *k)
+{
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (k == &AVX2_KERNELS)
+        return __builtin_cpu_supports("avx2");
+    if (k == &SSE2_KERNELS)
+        return __builtin_cpu_supports("sse2");
+#endif
+    return k == &SCALAR_KERNELS;
+}
+
+/* ============================================================
+ * Helper: selectKernels
+ * Picks the widest kernels the CPU supports. The choice is one
+ * pointer, read and written atomically: threads racing on the
+ * first call all store the same value, and none can see a
+ * half-written one.
+ * ============================================================ */
+static const ClassKernels *selectKernels(void)
+{
+    const ClassKernels *k = __atomic_load_n(&chosen, __ATOMIC_ACQUIRE);
+    size_t i;
+
+    if (k == NULL) {
+        for (i = 0; k == NULL; i++)
+            if (kernelsSupported(CLASS_KERNELS[i]))
+                k = CLASS_KERNELS[i];
+        __atomic_store_n(&chosen, k, __ATOMIC_RELEASE);
+    }
+    return k;
+}
+
+const char *classifyKernelName(void)
+{
+    return selectKernels()->name;
+}
+
+/* ============================================================
+ * Function: classifyUseKernel
+ * ============================================================ */
+int classifyUseKernel(const char *name)
+{
+    size_t i;
+
+    for (i = 0; i < CLASS_KERNEL_COUNT; i++) {
+        if (strcmp(CLASS_KERNELS[i]->name, name) == 0 && kernelsSupported(CLASS_KERNELS[i])) {
+            __atomic_store_n(&chosen, CLASS_KERNELS[i], __ATOMIC_RELEASE);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ============================================================
+ * Function: classifyBlock
+ * ============================================================ */
+void classifyBlock(const char *s, BlockClasses *classes)
+{
+    selectKernels()->classify(s, classes);
+}
+
+/* ============================================================
+ * Function: lowestSetBit
+ * ============================================================ */
+int lowestSetBit(uint64_t mask)
+{
+#ifdef __GNUC__
+    return __builtin_ctzll(mask);
+#else
+    int k = 0;
+
+    while ((mask & 1) == 0) {
+        mask >>= 1;
+        k++;
+    }
+    return k;
+#endif
+}
+
+/* ============================================================
+ * Function: spanAlpha
+ * 16 or 32 bytes per compare; the tail is checked with the table.
+ * ============================================================ */
+size_t spanAlpha(const char *s, size_t len)
+{
+    return selectKernels()->spanAlpha(s, len);
+}
@@ -0,0 +1,69 @@
+/*
+ * char_class.h
+ *
+ * Header file for the shared character classification used by
+ * every validator: a 256-entry class table for byte-at-a-time
+ * checks (the C locale's isalpha / isdigit / isspace, without the
+ * libc calls), and SIMD classification of 64-byte blocks.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef CHAR_CLASS_H
+#define CHAR_CLASS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Class bits of CHAR_CLASS entries */
+#define CC_ALPHA    0x01    /* A-Z a-z */
+#define CC_DIGIT    0x02    /* 0-9 */
+#define CC_SPACE    0x04    /* ' ' \t \n \v \f \r */
+#define CC_OPERATOR 0x08    /* + - * / % */
+#define CC_PAREN    0x10    /* ( ) */
+
+extern const unsigned char CHAR_CLASS[256];
+
+#define CHAR_IS(c, classes) (CHAR_CLASS[(unsigned char)(c)] & (classes))
+#define IS_ALPHA(c) CHAR_IS(c, CC_ALPHA)
+#define IS_DIGIT(c) CHAR_IS(c, CC_DIGIT)
+#define IS_SPACE(c) CHAR_IS(c, CC_SPACE)
+
+/* Returned by the check* validators for valid input */
+#define CHECK_VALID ((size_t)-1)
+
+/* Bytes classified per classifyBlock call */
+#define CLASS_BLOCK 64
+
+/* Bit k of each mask describes byte k of a block */
+typedef struct {
+    uint64_t alpha;
+    uint64_t digit;
+    uint64_t zero;      /* '0' */
+    uint64_t one;       /* '1' */
+} BlockClasses;
+
+/* Classifies the CLASS_BLOCK bytes at s (all must be readable) */
+void classifyBlock(const char *s, BlockClasses *classes);
+
+/* Index of the lowest set bit of a non-zero mask */
+int lowestSetBit(uint64_t mask);
+
+/* Length of the leading run of letters in s[0..len) */
+size_t spanAlpha(const char *s, size_t len);
+
+/* Name of the classifyBlock kernel in use ("avx2", "sse2", "scalar") */
+const char *classifyKernelName(void);
+
+/*
+ * Makes classifyBlock and spanAlpha use the kernels of that name
+ * from now on, e.g. to compare them with each other. Returns 1, or
+ * 0 (nothing changed) if the name is unknown or the CPU lacks the
+ * instructions. Not meant to be called while other threads validate.
+ */
+int classifyUseKernel(const char *name);
+
+#endif
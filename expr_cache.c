@@ -0,0 +1,289 @@
+/*
+ * expr_cache.c
+ *
+ * Bounded LRU cache of compiled (and optimized) expressions and
+ * their results.
+ * Keys are the expression text with whitespace removed, so
+ * "5 + 3" and "5+3" share one entry.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "expr_cache.h"
+#include "expr_optimize.h"
+#include "phase_stats.h"
+
+#define NO_ENTRY (-1)
+
+/* FNV-1a */
+#define HASH_OFFSET 2166136261UL
+#define HASH_PRIME  16777619UL
+
+/* ============================================================
+ * Function: exprCacheInit / exprCacheFree
+ * ============================================================ */
+int exprCacheInit(ExprCache *cache, int capacity)
+{
+    int buckets = 1;
+    int i;
+
+    memset(cache, 0, sizeof(*cache));
+    if (capacity < 1)
+        capacity = 1;
+    while (buckets < 2 * capacity)
+        buckets *= 2;
+
+    cache->entries = calloc((size_t)capacity, sizeof(ExprCacheEntry));
+    cache->buckets = malloc((size_t)buckets * sizeof(int));
+    if (cache->entries == NULL || cache->buckets == NULL) {
+        exprCacheFree(cache);
+        return 0;
+    }
+    for (i = 0; i < buckets; i++)
+        cache->buckets[i] = NO_ENTRY;
+
+    cache->bucketMask = buckets - 1;
+    cache->capacity = capacity;
+    cache->lruHead = cache->lruTail = NO_ENTRY;
+    return 1;
+}
+
+void exprCacheFree(ExprCache *cache)
+{
+    int i;
+
+    if (cache->entries != NULL) {
+        for (i = 0; i < cache->count; i++) {
+            free(cache->entries[i].key);  /* Tokens share the allocation */
+            freeExprValue(&cache->entries[i].result);
+        }
+    }
+    free(cache->entries);
+    free(cache->buckets);
+    free(cache->scratch);
+    freeCompiled(&cache->compiled);
+    memset(cache, 0, sizeof(*cache));
+}
+
+/* ============================================================
+ * Helper: normalize
+ * Copies expr without whitespace into the scratch buffer and
+ * hashes it. Whitespace between two digits is significant (it
+ * makes "1 2" invalid), so such input is reported as not
+ * cacheable by returning 0.
+ * ============================================================ */
+static int normalize(ExprCache *cache, const char *expr,
+                     size_t *len, unsigned long *hash)
+{
+    size_t need = strlen(expr) + 1;
+    unsigned long h = HASH_OFFSET;
+    size_t n = 0;
+    int spaceAfterDigit = 0;
+    const char *p;
+
+    if (need > cache->scratchCap) {
+        char *grown = realloc(cache->scratch, need);
+        if (grown == NULL)
+            return 0;
+        cache->scratch = grown;
+        cache->scratchCap = need;
+    }
+
+    for (p = expr; *p != '\0'; p++) {
+        char c = *p;
+
+        if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            if (n > 0 && cache->scratch[n - 1] >= '0' && cache->scratch[n - 1] <= '9')
+                spaceAfterDigit = 1;
+            continue;
+        }
+        if (spaceAfterDigit && c >= '0' && c <= '9')
+            return 0;
+        spaceAfterDigit = 0;
+
+        cache->scratch[n++] = c;
+        h = ((h ^ (unsigned char)c) * HASH_PRIME) & 0xFFFFFFFFUL;
+    }
+    cache->scratch[n] = '\0';
+
+    *len = n;
+    *hash = h;
+    return 1;
+}
+
+/* ============================================================
+ * Helper: findEntry
+ * Returns the index of the entry matching the scratch key,
+ * or NO_ENTRY.
+ * ============================================================ */
+static int findEntry(const ExprCache *cache, size_t len, unsigned long hash)
+{
+    int i = cache->buckets[hash & (unsigned long)cache->bucketMask];
+
+    while (i != NO_ENTRY) {
+        const ExprCacheEntry *e = &cache->entries[i];
+        if (e->hash == hash && e->keyLen == len &&
+            memcmp(e->key, cache->scratch, len) == 0)
+            return i;
+        i = e->chainNext;
+    }
+    return NO_ENTRY;
+}
+
+/* ============================================================
+ * Helpers: LRU list maintenance
+ * ============================================================ */
+static void lruUnlink(ExprCache *cache, int i)
+{
+    ExprCacheEntry *e = &cache->entries[i];
+
+    if (e->lruPrev != NO_ENTRY)
+        cache->entries[e->lruPrev].lruNext = e->lruNext;
+    else
+        cache->lruHead = e->lruNext;
+    if (e->lruNext != NO_ENTRY)
+        cache->entries[e->lruNext].lruPrev = e->lruPrev;
+    else
+        cache->lruTail = e->lruPrev;
+}
+
+static void lruPushFront(ExprCache *cache, int i)
+{
+    ExprCacheEntry *e = &cache->entries[i];
+
+    e->lruPrev = NO_ENTRY;
+    e->lruNext = cache->lruHead;
+    if (cache->lruHead != NO_ENTRY)
+        cache->entries[cache->lruHead].lruPrev = i;
+    cache->lruHead = i;
+    if (cache->lruTail == NO_ENTRY)
+        cache->lruTail = i;
+}
+
+/* ============================================================
+ * Helper: chainRemove
+ * Unlinks entry i from its hash bucket.
+ * ============================================================ */
+static void chainRemove(ExprCache *cache, int i)
+{
+    int *link = &cache->buckets[cache->entries[i].hash & (unsigned long)cache->bucketMask];
+
+    while (*link != i)
+        link = &cache->entries[*link].chainNext;
+    *link = cache->entries[i].chainNext;
+}
+
+/* ============================================================
+ * Helper: insertEntry
+ * Stores the scratch key with its compiled form and result,
+ * evicting the least recently used entry when full.
+ * ============================================================ */
+static void insertEntry(ExprCache *cache, size_t len, unsigned long hash,
+                        const CompiledExpr *compiled, const ExprValue *result)
+{
+    size_t tokenBytes = (size_t)compiled->count * sizeof(Token);
+    size_t keyBytes = (len + 1 + sizeof(Token) - 1) / sizeof(Token) * sizeof(Token);
+    char *block = malloc(keyBytes + tokenBytes);
+    ExprValue stored = EXPR_VALUE_INIT;
+    ExprCacheEntry *e;
+    int i;
+
+    /* Caching is best-effort */
+    if (block == NULL || !copyExprValue(&stored, result)) {
+        free(block);
+        freeExprValue(&stored);
+        return;
+    }
+
+    if (cache->count < cache->capacity) {
+        i = cache->count++;
+    } else {
+        i = cache->lruTail;
+        lruUnlink(cache, i);
+        chainRemove(cache, i);
+        free(cache->entries[i].key);
+        freeExprValue(&cache->entries[i].result);
+    }
+
+    e = &cache->entries[i];
+    e->key = block;
+    memcpy(e->key, cache->scratch, len + 1);
+    e->keyLen = len;
+    e->hash = hash;
+    e->tokens = (Token *)(block + keyBytes);
+    memcpy(e->tokens, compiled->tokens, tokenBytes);
+    e->tokenCount = compiled->count;
+    e->maxDepth = compiled->maxDepth;
+    e->tempCount = compiled->tempCount;
+    e->result = stored;
+
+    e->chainNext = cache->buckets[hash & (unsigned long)cache->bucketMask];
+    cache->buckets[hash & (unsigned long)cache->bucketMask] = i;
+    lruPushFront(cache, i);
+}
+
+/* ============================================================
+ * Function: exprCacheEvaluate
+ * normalize -> lookup -> (hit) move to front
+ *                     -> (miss) compile + evaluate + insert
+ * ============================================================ */
+ExprStatus exprCacheEvaluate(ExprCache *cache, const char *expr,
+                             ExprValue *result, int *errorOffset)
+{
+    uint64_t t = STATS_START();
+    ExprStatus status;
+    unsigned long hash;
+    size_t len;
+    int i;
+
+    if (expr == NULL || !normalize(cache, expr, &len, &hash))
+        return evaluateInfix(expr, result, errorOffset);
+
+    i = findEntry(cache, len, hash);
+    if (i != NO_ENTRY) {
+        cache->hits++;
+        STATS_COUNT(STATS_CACHE_HITS, 1);
+        if (i != cache->lruHead) {
+            lruUnlink(cache, i);
+            lruPushFront(cache, i);
+        }
+        status = copyExprValue(result, &cache->entries[i].result)
+            ? EXPR_OK : EXPR_ERR_NO_MEMORY;
+        STATS_STOP(STATS_EVAL_CACHED, t, len, 0);
+        return status;
+    }
+
+    cache->misses++;
+    STATS_COUNT(STATS_CACHE_MISSES, 1);
+    status = compileExpression(expr, NULL, 0, &cache->compiled, errorOffset);
+    if (status == EXPR_ERR_NUMBER_TOO_LARGE)
+        return evaluateInfix(expr, result, errorOffset);
+    if (status == EXPR_OK && !optimizeCompiled(&cache->compiled))
+        status = EXPR_ERR_NO_MEMORY;
+    if (status == EXPR_OK)
+        status = evaluateCompiled(&cache->compiled, result);
+    if (status == EXPR_OK)
+        insertEntry(cache, len, hash, &cache->compiled, result);
+    STATS_STOP(STATS_EVAL_CACHED, t, len, 0);
+    return status;
+}
+
+/* ============================================================
+ * Function: exprCacheFind
+ * ============================================================ */
+const ExprCacheEntry *exprCacheFind(ExprCache *cache, const char *expr)
+{
+    unsigned long hash;
+    size_t len;
+    int i;
+
+    if (expr == NULL || !normalize(cache, expr, &len, &hash))
+        return NULL;
+    i = findEntry(cache, len, hash);
+    return (i != NO_ENTRY) ? &cache->entries[i] : NULL;
+}
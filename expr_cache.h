@@ -0,0 +1,76 @@
+/*
+ * expr_cache.h
+ *
+ * Header file for the expression result cache.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef EXPR_CACHE_H
+#define EXPR_CACHE_H
+
+#include <stddef.h>
+#include "expression.h"
+
+#define EXPR_CACHE_DEFAULT_CAPACITY 4096
+
+/* One cached expression */
+typedef struct {
+    char *key;              /* Whitespace-normalized expression text */
+    size_t keyLen;
+    unsigned long hash;
+    Token *tokens;          /* Optimized postfix (stored with the key) */
+    int tokenCount;
+    int maxDepth;           /* As in CompiledExpr */
+    int tempCount;
+    ExprValue result;
+    int lruPrev, lruNext;   /* Recency list (head = most recent) */
+    int chainNext;          /* Next entry in the same hash bucket */
+} ExprCacheEntry;
+
+/* Bounded LRU cache keyed by normalized expression text */
+typedef struct {
+    ExprCacheEntry *entries;
+    int *buckets;
+    int bucketMask;
+    int capacity;
+    int count;
+    int lruHead, lruTail;
+    CompiledExpr compiled;  /* Reused for every miss */
+    char *scratch;          /* Normalization buffer */
+    size_t scratchCap;
+    unsigned long hits;     /* Also reported by --stats (phase_stats.h) */
+    unsigned long misses;
+} ExprCache;
+
+/*
+ * Initializes a cache holding up to 'capacity' expressions.
+ * Returns 1 on success, 0 if out of memory.
+ */
+int exprCacheInit(ExprCache *cache, int capacity);
+
+/* Releases all memory held by the cache */
+void exprCacheFree(ExprCache *cache);
+
+/*
+ * Evaluates an expression through the cache. Hits cost one
+ * normalization pass and a hash lookup; misses are validated,
+ * compiled, optimized (optimizeCompiled: constants folded, repeated
+ * subexpressions computed once) and evaluated, then stored. Invalid
+ * expressions, and literals too
+ * long to compile, are never cached. Same return convention as
+ * evaluateInfix.
+ */
+ExprStatus exprCacheEvaluate(ExprCache *cache, const char *expr,
+                             ExprValue *result, int *errorOffset);
+
+/*
+ * Returns the cached entry for an expression, or NULL.
+ * Does not change the hit/miss counters or recency.
+ */
+const ExprCacheEntry *exprCacheFind(ExprCache *cache, const char *expr);
+
+#endif
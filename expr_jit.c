@@ -0,0 +1,481 @@
+/*
+ * expr_jit.c
+ *
+ * Translates a compiled expression into x86-64 machine code.
+ * The operand stack is allocated to registers: stack slot d always
+ * lives in JIT_REGS[d], literals are kept symbolic until needed so
+ * "x + 5" becomes a single add-immediate, and temporaries of an
+ * optimized program live in the native stack frame.
+ * Arithmetic is 64-bit; every step that can overflow is followed by
+ * a jo to a stub that returns JIT_OVERFLOW.
+ * Programs deeper than the register file stay on the interpreter.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "expr_jit.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+#define HAVE_JIT 1
+#include <sys/mman.h>
+#endif
+
+#ifdef HAVE_JIT
+
+/* x86-64 register numbers */
+#define RAX 0
+#define RCX 1
+#define RDX 2
+#define RBX 3
+#define RSP 4
+#define RSI 6
+#define RDI 7
+#define R8  8
+#define R9  9
+#define R10 10
+#define R11 11
+#define R12 12
+#define R13 13
+#define R14 14
+#define R15 15
+
+/*
+ * Register for each operand stack slot. The first six are
+ * caller-saved; the rest are saved in the prologue when used.
+ * RAX/RDX are reserved for idiv, RDI holds the vars pointer.
+ */
+static const int JIT_REGS[] = { R8, R9, R10, R11, RSI, RCX, RBX, R12, R13, R14, R15 };
+#define JIT_REG_COUNT    ((int)(sizeof(JIT_REGS) / sizeof(JIT_REGS[0])))
+#define JIT_SCRATCH_REGS 6
+
+/* Worst-case bytes per token (two imm64 loads and the division
+ * sequence) plus prologue, epilogue and overflow stub */
+#define JIT_BYTES_PER_TOKEN 64
+#define JIT_FIXED_BYTES     128
+
+/* Machine code being assembled */
+typedef struct {
+    unsigned char *buf;
+    size_t len;
+    size_t cap;
+    int overflow;
+} CodeBuffer;
+
+/* ============================================================
+ * Encoding helpers
+ * ============================================================ */
+static void emitByte(CodeBuffer *cb, int b)
+{
+    if (cb->len >= cb->cap) {
+        cb->overflow = 1;
+        return;
+    }
+    cb->buf[cb->len++] = (unsigned char)b;
+}
+
+static void emitImm32(CodeBuffer *cb, int v)
+{
+    unsigned u = (unsigned)v;
+
+    emitByte(cb, u & 0xFF);
+    emitByte(cb, (u >> 8) & 0xFF);
+    emitByte(cb, (u >> 16) & 0xFF);
+    emitByte(cb, (u >> 24) & 0xFF);
+}
+
+static void emitImm64(CodeBuffer *cb, long long v)
+{
+    unsigned long long u = (unsigned long long)v;
+    int i;
+
+    for (i = 0; i < 8; i++)
+        emitByte(cb, (int)((u >> (8 * i)) & 0xFF));
+}
+
+static int fitsImm32(long long v)
+{
+    return v >= -0x80000000LL && v <= 0x7FFFFFFFLL;
+}
+
+/* REX.W prefix (64-bit operands) with the high bits of reg and rm */
+static void emitRex(CodeBuffer *cb, int reg, int rm)
+{
+    emitByte(cb, 0x48 | ((reg >> 3) << 2) | (rm >> 3));
+}
+
+/* op r/m64, r64 (register-direct) */
+static void emitRegReg(CodeBuffer *cb, int opcode, int reg, int rm)
+{
+    emitRex(cb, reg, rm);
+    emitByte(cb, opcode);
+    emitByte(cb, 0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/* Group opcode with /ext on a register (neg, idiv, ...) */
+static void emitGroup(CodeBuffer *cb, int opcode, int ext, int rm)
+{
+    emitRex(cb, 0, rm);
+    emitByte(cb, opcode);
+    emitByte(cb, 0xC0 | (ext << 3) | (rm & 7));
+}
+
+static void emitMovImm(CodeBuffer *cb, int reg, long long value)
+{
+    if (value == 0) {
+        emitRegReg(cb, 0x31, reg, reg);  /* xor reg, reg */
+    } else if (fitsImm32(value)) {
+        emitGroup(cb, 0xC7, 0, reg);     /* mov reg, simm32 */
+        emitImm32(cb, (int)value);
+    } else {
+        emitRex(cb, 0, reg);             /* mov reg, imm64 */
+        emitByte(cb, 0xB8 + (reg & 7));
+        emitImm64(cb, value);
+    }
+}
+
+/*
+ * reg <-> [base + disp32]: 0x8B loads, 0x89 stores, 0x63 loads a
+ * sign-extended 32-bit value (movsxd).
+ */
+static void emitMem(CodeBuffer *cb, int opcode, int reg, int base, int disp)
+{
+    emitRex(cb, reg, base);
+    emitByte(cb, opcode);
+    emitByte(cb, 0x80 | ((reg & 7) << 3) | (base & 7));
+    if ((base & 7) == RSP)
+        emitByte(cb, 0x24);  /* SIB: [rsp] */
+    emitImm32(cb, disp);
+}
+
+static void emitPush(CodeBuffer *cb, int reg)
+{
+    if (reg >= 8)
+        emitByte(cb, 0x41);
+    emitByte(cb, 0x50 + (reg & 7));
+}
+
+static void emitPop(CodeBuffer *cb, int reg)
+{
+    if (reg >= 8)
+        emitByte(cb, 0x41);
+    emitByte(cb, 0x58 + (reg & 7));
+}
+
+/* Short jump with a rel8 to patch; returns the rel8 position */
+static size_t emitJump(CodeBuffer *cb, int opcode)
+{
+    emitByte(cb, opcode);
+    emitByte(cb, 0);
+    return cb->len - 1;
+}
+
+static void patchJump(CodeBuffer *cb, size_t at)
+{
+    if (!cb->overflow)
+        cb->buf[at] = (unsigned char)(cb->len - (at + 1));
+}
+
+/* jo rel32 back to the overflow stub at offset 'stub' */
+static void emitOverflowCheck(CodeBuffer *cb, size_t stub)
+{
+    emitByte(cb, 0x0F);
+    emitByte(cb, 0x80);
+    emitImm32(cb, (int)((long)stub - (long)(cb->len + 4)));
+}
+
+/* Frees the frame, restores saved registers and returns */
+static void emitEpilogue(CodeBuffer *cb, int frame, int saved)
+{
+    int i;
+
+    if (frame > 0) {
+        emitByte(cb, 0x48);                  /* add rsp, frame */
+        emitByte(cb, 0x81);
+        emitByte(cb, 0xC4);
+        emitImm32(cb, frame);
+    }
+    for (i = saved - 1; i >= 0; i--)
+        emitPop(cb, JIT_REGS[JIT_SCRATCH_REGS + i]);
+    emitByte(cb, 0xC3);                      /* ret */
+}
+
+/* ============================================================
+ * Helper: emitDivide
+ * a = a / b (or a % b) in place, with the evaluator's rules:
+ * b == 0 -> 0; b == -1 -> -a (or 0), so idiv never traps, and
+ * -LLONG_MIN goes to the overflow stub.
+ * ============================================================ */
+static void emitDivide(CodeBuffer *cb, int a, int b, int isMod, size_t stub)
+{
+    size_t toZero, toNeg, done1, done2;
+
+    emitRegReg(cb, 0x89, a, RAX);            /* mov rax, a */
+    emitRegReg(cb, 0x85, b, b);              /* test b, b */
+    toZero = emitJump(cb, 0x74);             /* jz zero */
+    emitRex(cb, 0, b);                       /* cmp b, -1 */
+    emitByte(cb, 0x83);
+    emitByte(cb, 0xF8 | (b & 7));
+    emitByte(cb, 0xFF);
+    toNeg = emitJump(cb, 0x74);              /* je neg */
+    emitByte(cb, 0x48);                      /* cqo */
+    emitByte(cb, 0x99);
+    emitGroup(cb, 0xF7, 7, b);               /* idiv b */
+    emitRegReg(cb, 0x89, isMod ? RDX : RAX, a);
+    done1 = emitJump(cb, 0xEB);
+
+    patchJump(cb, toNeg);
+    if (isMod) {
+        emitRegReg(cb, 0x31, a, a);          /* x % -1 == 0 */
+    } else {
+        emitGroup(cb, 0xF7, 3, a);           /* neg a */
+        emitOverflowCheck(cb, stub);
+    }
+    done2 = emitJump(cb, 0xEB);
+
+    patchJump(cb, toZero);
+    emitRegReg(cb, 0x31, a, a);              /* xor a, a */
+
+    patchJump(cb, done1);
+    patchJump(cb, done2);
+}
+
+/* ============================================================
+ * Helper: generateCode
+ * One pass over the tokens. Each operand stack slot is either in
+ * its register or a pending literal (isConst) that is only loaded
+ * when an instruction needs it in a register. The overflow stub is
+ * emitted first so every jo is a backward jump; returns the offset
+ * of the entry point that follows it.
+ * ============================================================ */
+static size_t generateCode(const CompiledExpr *expr, CodeBuffer *cb)
+{
+    int isConst[JIT_REG_COUNT];
+    long long constValue[JIT_REG_COUNT];
+    int frame = ((expr->tempCount * 8) + 15) & ~15;
+    int saved = expr->maxDepth - JIT_SCRATCH_REGS;
+    size_t stub = cb->len;
+    size_t entry;
+    int top = -1;
+    int i;
+
+    /* Overflow stub: unwind and return JIT_OVERFLOW */
+    emitRex(cb, 0, RAX);
+    emitByte(cb, 0xB8 + RAX);
+    emitImm64(cb, JIT_OVERFLOW);
+    emitEpilogue(cb, frame, saved);
+
+    /* Prologue: save callee-saved registers we use, reserve temps */
+    entry = cb->len;
+    for (i = 0; i < saved; i++)
+        emitPush(cb, JIT_REGS[JIT_SCRATCH_REGS + i]);
+    if (frame > 0) {
+        emitByte(cb, 0x48);                  /* sub rsp, frame */
+        emitByte(cb, 0x81);
+        emitByte(cb, 0xEC);
+        emitImm32(cb, frame);
+    }
+
+    for (i = 0; i < expr->count; i++) {
+        const Token *t = &expr->tokens[i];
+        int a, b;
+
+        switch (t->op) {
+            case OP_PUSH:
+                top++;
+                isConst[top] = 1;
+                constValue[top] = t->value;
+                continue;
+            case OP_VAR:
+                top++;
+                isConst[top] = 0;
+                emitMem(cb, 0x63, JIT_REGS[top], RDI, (int)t->value * 4);
+                continue;
+            case OP_LOAD:
+                top++;
+                isConst[top] = 0;
+                emitMem(cb, 0x8B, JIT_REGS[top], RSP, (int)t->value * 8);
+                continue;
+            case OP_STORE:
+                if (isConst[top]) {
+                    emitMovImm(cb, JIT_REGS[top], constValue[top]);
+                    isConst[top] = 0;
+                }
+                emitMem(cb, 0x89, JIT_REGS[top], RSP, (int)t->value * 8);
+                continue;
+        }
+
+        /* Binary operator on slots top-1 (a) and top (b) */
+        a = JIT_REGS[top - 1];
+        b = JIT_REGS[top];
+        if (isConst[top - 1]) {
+            emitMovImm(cb, a, constValue[top - 1]);
+            isConst[top - 1] = 0;
+        }
+
+        if (isConst[top] && fitsImm32(constValue[top]) && t->op == OP_ADD) {
+            emitGroup(cb, 0x81, 0, a);               /* add a, simm32 */
+            emitImm32(cb, (int)constValue[top]);
+            emitOverflowCheck(cb, stub);
+        } else if (isConst[top] && fitsImm32(constValue[top]) && t->op == OP_SUB) {
+            emitGroup(cb, 0x81, 5, a);               /* sub a, simm32 */
+            emitImm32(cb, (int)constValue[top]);
+            emitOverflowCheck(cb, stub);
+        } else if (isConst[top] && fitsImm32(constValue[top]) && t->op == OP_MUL) {
+            emitRex(cb, a, a);                       /* imul a, a, simm32 */
+            emitByte(cb, 0x69);
+            emitByte(cb, 0xC0 | ((a & 7) << 3) | (a & 7));
+            emitImm32(cb, (int)constValue[top]);
+            emitOverflowCheck(cb, stub);
+        } else {
+            if (isConst[top])
+                emitMovImm(cb, b, constValue[top]);
+
+            switch (t->op) {
+                case OP_ADD:
+                    emitRegReg(cb, 0x01, b, a);
+                    emitOverflowCheck(cb, stub);
+                    break;
+                case OP_SUB:
+                    emitRegReg(cb, 0x29, b, a);
+                    emitOverflowCheck(cb, stub);
+                    break;
+                case OP_MUL:                         /* imul a, b */
+                    emitRex(cb, a, b);
+                    emitByte(cb, 0x0F);
+                    emitByte(cb, 0xAF);
+                    emitByte(cb, 0xC0 | ((a & 7) << 3) | (b & 7));
+                    emitOverflowCheck(cb, stub);
+                    break;
+                case OP_DIV: emitDivide(cb, a, b, 0, stub); break;
+                default:     emitDivide(cb, a, b, 1, stub); break;
+            }
+        }
+        top--;
+    }
+
+    /* Result into rax */
+    if (top < 0)
+        emitMovImm(cb, RAX, 0);
+    else if (isConst[top])
+        emitMovImm(cb, RAX, constValue[top]);
+    else
+        emitRegReg(cb, 0x89, JIT_REGS[top], RAX);
+
+    emitEpilogue(cb, frame, saved);
+    return entry;
+}
+
+#endif /* HAVE_JIT */
+
+/* ============================================================
+ * Function: jitAvailable
+ * ============================================================ */
+int jitAvailable(void)
+{
+#ifdef HAVE_JIT
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/* ============================================================
+ * Function: jitInit
+ * ============================================================ */
+void jitInit(JitExpr *jit, const CompiledExpr *expr, long threshold)
+{
+    memset(jit, 0, sizeof(*jit));
+    jit->expr = expr;
+    jit->threshold = threshold;
+}
+
+/* ============================================================
+ * Function: jitCompile
+ * Assembles into a writable mapping, then flips it to
+ * read+execute (never writable and executable at once).
+ * ============================================================ */
+int jitCompile(JitExpr *jit)
+{
+#ifdef HAVE_JIT
+    CodeBuffer cb;
+    long page = 4096;
+    size_t size, entry;
+    void *mem;
+
+    if (jit->native != NULL)
+        return 1;
+    if (jit->failed || jit->expr->maxDepth > JIT_REG_COUNT) {
+        jit->failed = 1;
+        return 0;
+    }
+
+    size = JIT_FIXED_BYTES + (size_t)jit->expr->count * JIT_BYTES_PER_TOKEN;
+    size = (size + (size_t)page - 1) / (size_t)page * (size_t)page;
+    mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) {
+        jit->failed = 1;
+        return 0;
+    }
+
+    cb.buf = mem;
+    cb.len = 0;
+    cb.cap = size;
+    cb.overflow = 0;
+    entry = generateCode(jit->expr, &cb);
+
+    if (cb.overflow || mprotect(mem, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(mem, size);
+        jit->failed = 1;
+        return 0;
+    }
+
+    jit->code = mem;
+    jit->codeSize = size;
+    jit->native = (JitFunction)((char *)mem + entry);
+    return 1;
+#else
+    jit->failed = 1;
+    return 0;
+#endif
+}
+
+/* ============================================================
+ * Function: jitEvaluate
+ * Native code when available; otherwise (or on overflow) the
+ * interpreter, which also counts evaluations towards the compile
+ * threshold.
+ * ============================================================ */
+ExprStatus jitEvaluate(JitExpr *jit, const int *vars, ExprValue *result)
+{
+    long long value;
+
+    if (jit->native == NULL && jit->threshold != JIT_NEVER && !jit->failed &&
+        jit->evaluations++ >= (unsigned long)jit->threshold)
+        jitCompile(jit);
+
+    if (jit->native != NULL && (value = jit->native(vars)) != JIT_OVERFLOW) {
+        result->isBig = 0;
+        result->small = value;
+        return EXPR_OK;
+    }
+    return evaluateCompiledRow(jit->expr, vars, result);
+}
+
+/* ============================================================
+ * Function: jitFree
+ * ============================================================ */
+void jitFree(JitExpr *jit)
+{
+#ifdef HAVE_JIT
+    if (jit->code != NULL)
+        munmap(jit->code, jit->codeSize);
+#endif
+    jit->code = NULL;
+    jit->native = NULL;
+}
@@ -0,0 +1,74 @@
+/*
+ * expr_jit.h
+ *
+ * Header file for the x86-64 JIT backend.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef EXPR_JIT_H
+#define EXPR_JIT_H
+
+#include <stddef.h>
+#include "expression.h"
+
+/* Evaluations before a JitExpr compiles itself */
+#define JIT_DEFAULT_THRESHOLD 1000
+
+/* Threshold value that keeps a JitExpr on the interpreter */
+#define JIT_NEVER (-1L)
+
+/*
+ * Native form of a compiled expression: vars[i] = variable i.
+ * Computes in 64-bit registers and returns JIT_OVERFLOW as soon as
+ * a step overflows; the row is then re-run on the interpreter, which
+ * continues with BigInts. (A genuine LLONG_MIN result takes the
+ * same path.)
+ */
+typedef long long (*JitFunction)(const int *vars);
+
+#define JIT_OVERFLOW (-0x7FFFFFFFFFFFFFFFLL - 1)
+
+/* A compiled expression that switches to native code when hot */
+typedef struct {
+    const CompiledExpr *expr;   /* Program (must outlive the JitExpr) */
+    JitFunction native;         /* NULL while interpreted */
+    void *code;                 /* Executable mapping */
+    size_t codeSize;
+    long threshold;             /* 0 = compile at once, JIT_NEVER = never */
+    unsigned long evaluations;
+    int failed;                 /* Program not supported by the JIT */
+} JitExpr;
+
+/*
+ * Returns 1 if native code generation is available on this build
+ * (Linux x86-64), 0 otherwise.
+ */
+int jitAvailable(void);
+
+/*
+ * Prepares a JitExpr for expr. It runs on the interpreter until it
+ * has been evaluated 'threshold' times, then compiles itself.
+ */
+void jitInit(JitExpr *jit, const CompiledExpr *expr, long threshold);
+
+/*
+ * Compiles to native code now.
+ * Returns 1 if native code is in use, 0 if the program stays on the
+ * interpreter (unsupported platform, too deep, or out of memory).
+ */
+int jitCompile(JitExpr *jit);
+
+/*
+ * Evaluates one row (same semantics and return convention as
+ * evaluateCompiledRow).
+ */
+ExprStatus jitEvaluate(JitExpr *jit, const int *vars, ExprValue *result);
+
+/* Releases the native code, if any */
+void jitFree(JitExpr *jit);
+
+#endif
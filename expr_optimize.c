@@ -0,0 +1,285 @@
+/*
+ * expr_optimize.c
+ *
+ * Constant folding and common-subexpression elimination.
+ * The postfix program is rebuilt as a DAG (identical nodes are
+ * shared through a hash table), folded, and re-emitted with
+ * temporaries for nodes used more than once.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "expr_optimize.h"
+
+#define NO_NODE (-1)
+
+/* Working memory kept on the C stack (programs of about 64 tokens) */
+#define OPTIMIZE_LOCAL_BYTES 8192
+
+/* One DAG node; children always have smaller ids than parents */
+typedef struct {
+    unsigned char op;
+    long long value;
+    int left, right;    /* NO_NODE for leaves */
+} Node;
+
+/* Working state of one optimization */
+typedef struct {
+    Node *nodes;
+    int count;
+    int *table;         /* Open-addressed hash of node ids */
+    int tableMask;
+} Dag;
+
+/* ============================================================
+ * Helper: hashNode
+ * ============================================================ */
+static unsigned hashNode(unsigned char op, long long value, int left, int right)
+{
+    unsigned h = 2166136261u;
+
+    h = (h ^ op) * 16777619u;
+    h = (h ^ (unsigned)value) * 16777619u;
+    h = (h ^ (unsigned)((unsigned long long)value >> 32)) * 16777619u;
+    h = (h ^ (unsigned)left) * 16777619u;
+    h = (h ^ (unsigned)right) * 16777619u;
+    return h ^ (h >> 15);
+}
+
+/* ============================================================
+ * Helper: intern
+ * Returns the id of the node (op, value, left, right), creating
+ * it only if an identical node does not exist yet.
+ * ============================================================ */
+static int intern(Dag *dag, unsigned char op, long long value, int left, int right)
+{
+    unsigned slot = hashNode(op, value, left, right) & (unsigned)dag->tableMask;
+    Node *n;
+
+    while (dag->table[slot] != NO_NODE) {
+        n = &dag->nodes[dag->table[slot]];
+        if (n->op == op && n->value == value && n->left == left && n->right == right)
+            return dag->table[slot];
+        slot = (slot + 1) & (unsigned)dag->tableMask;
+    }
+
+    n = &dag->nodes[dag->count];
+    n->op = op;
+    n->value = value;
+    n->left = left;
+    n->right = right;
+    dag->table[slot] = dag->count;
+    return dag->count++;
+}
+
+/* ============================================================
+ * Helper: foldConstants
+ * Computes a op b with the evaluator's semantics (division/modulo
+ * by zero -> 0). Returns 0 if the result does not fit in 64 bits;
+ * such steps are left for the evaluator, which switches to BigInts.
+ * ============================================================ */
+static int foldConstants(unsigned char op, long long a, long long b, long long *out)
+{
+    switch (op) {
+        case OP_ADD: return !__builtin_add_overflow(a, b, out);
+        case OP_SUB: return !__builtin_sub_overflow(a, b, out);
+        case OP_MUL: return !__builtin_mul_overflow(a, b, out);
+        case OP_DIV:
+            if (b == -1)
+                return !__builtin_sub_overflow(0LL, a, out);
+            *out = (b != 0) ? a / b : 0;
+            return 1;
+        default:
+            *out = (b != 0 && b != -1) ? a % b : 0;
+            return 1;
+    }
+}
+
+/* ============================================================
+ * Helper: buildDag
+ * Replays the postfix program on a stack of node ids.
+ * Returns the root id.
+ * ============================================================ */
+static int buildDag(Dag *dag, const CompiledExpr *expr, int *stack)
+{
+    int top = -1;
+    int i;
+
+    for (i = 0; i < expr->count; i++) {
+        const Token *t = &expr->tokens[i];
+        const Node *l, *r;
+        int left, right;
+        long long folded;
+
+        if (t->op == OP_PUSH || t->op == OP_VAR) {
+            stack[++top] = intern(dag, t->op, t->value, NO_NODE, NO_NODE);
+            continue;
+        }
+
+        right = stack[top--];
+        left = stack[top];
+        l = &dag->nodes[left];
+        r = &dag->nodes[right];
+
+        if (l->op == OP_PUSH && r->op == OP_PUSH &&
+            foldConstants(t->op, l->value, r->value, &folded)) {
+            stack[top] = intern(dag, OP_PUSH, folded, NO_NODE, NO_NODE);
+            continue;
+        }
+
+        /* Canonical operand order lets a+b and b+a share a node */
+        if ((t->op == OP_ADD || t->op == OP_MUL) && left > right) {
+            int tmp = left;
+            left = right;
+            right = tmp;
+        }
+        stack[top] = intern(dag, t->op, 0, left, right);
+    }
+    return stack[0];
+}
+
+/* ============================================================
+ * Helper: emitProgram
+ * Post-order walk from the root (iterative, so deep expressions
+ * cannot overflow the C stack). A node with more than one parent
+ * is stored in a temporary the first time and loaded afterwards.
+ * Returns 0 if the result would not be smaller than out->capacity.
+ * ============================================================ */
+static int emitProgram(const Dag *dag, int root, const int *refs, int *temp,
+                       int *work, CompiledExpr *out)
+{
+    int limit = out->capacity;
+    int top = -1;
+    int depth = 0;
+
+    out->count = 0;
+    out->maxDepth = 0;
+    out->tempCount = 0;
+
+    /* Work items: id * 2 + expanded flag */
+    work[++top] = root * 2;
+
+    while (top >= 0) {
+        int item = work[top--];
+        int id = item / 2;
+        const Node *n = &dag->nodes[id];
+        Token *t;
+
+        if (!(item & 1) && n->left != NO_NODE && temp[id] == NO_NODE) {
+            work[++top] = item | 1;
+            work[++top] = n->right * 2;
+            work[++top] = n->left * 2;
+            continue;
+        }
+
+        if (out->count >= limit)
+            return 0;
+        t = &out->tokens[out->count++];
+
+        if (temp[id] != NO_NODE) {
+            t->op = OP_LOAD;
+            t->value = temp[id];
+            depth++;
+        } else if (n->left == NO_NODE) {
+            t->op = n->op;
+            t->value = n->value;
+            depth++;
+        } else {
+            t->op = n->op;
+            t->value = 0;
+            depth--;
+            if (refs[id] > 1) {
+                temp[id] = out->tempCount++;
+                if (out->count >= limit)
+                    return 0;
+                t = &out->tokens[out->count++];
+                t->op = OP_STORE;
+                t->value = temp[id];
+            }
+        }
+        if (depth > out->maxDepth)
+            out->maxDepth = depth;
+    }
+    return 1;
+}
+
+/* ============================================================
+ * Function: optimizeCompiled
+ * build DAG (folding on the way) -> count parents -> re-emit
+ * All working arrays share one block, on the C stack for short
+ * programs (the common case of a cache miss), so those cost no
+ * malloc at all. The result is copied over the original tokens.
+ * ============================================================ */
+int optimizeCompiled(CompiledExpr *expr)
+{
+    long long local[OPTIMIZE_LOCAL_BYTES / sizeof(long long)];
+    Dag dag;
+    CompiledExpr optimized = COMPILED_INIT;
+    int *stack, *refs, *temp;
+    char *reachable, *block;
+    size_t bytes;
+    int tableSize = 1;
+    int n = expr->count;
+    int root, i;
+
+    if (n == 0 || expr->tempCount > 0)
+        return 1;  /* Empty or already optimized */
+
+    while (tableSize < 2 * n)
+        tableSize *= 2;
+
+    /* Nodes and tokens first (8-byte aligned), then the int arrays */
+    bytes = (size_t)n * (sizeof(Node) + sizeof(Token) + 5 * sizeof(int) + 1) +
+            (size_t)tableSize * sizeof(int);
+    block = (bytes <= sizeof(local)) ? (char *)local : malloc(bytes);
+    if (block == NULL)
+        return 0;
+    dag.nodes = (Node *)block;
+    optimized.tokens = (Token *)(dag.nodes + n);
+    optimized.capacity = n;
+    dag.table = (int *)(optimized.tokens + n);
+    stack = dag.table + tableSize;      /* 3n: also the emit work list */
+    refs = stack + 3 * n;
+    temp = refs + n;
+    reachable = (char *)(temp + n);
+    memset(refs, 0, (size_t)n * sizeof(int));
+    memset(reachable, 0, (size_t)n);
+
+    dag.count = 0;
+    dag.tableMask = tableSize - 1;
+    for (i = 0; i < tableSize; i++)
+        dag.table[i] = NO_NODE;
+
+    root = buildDag(&dag, expr, stack);
+
+    /* Parent counts over the nodes still reachable after folding */
+    reachable[root] = 1;
+    for (i = root; i >= 0; i--) {
+        const Node *node = &dag.nodes[i];
+
+        temp[i] = NO_NODE;
+        if (!reachable[i] || node->left == NO_NODE)
+            continue;
+        reachable[node->left] = reachable[node->right] = 1;
+        refs[node->left]++;
+        refs[node->right]++;
+    }
+
+    /* Keep the original unless the new program is smaller */
+    if (emitProgram(&dag, root, refs, temp, stack, &optimized) &&
+        optimized.count < expr->count) {
+        memcpy(expr->tokens, optimized.tokens, (size_t)optimized.count * sizeof(Token));
+        expr->count = optimized.count;
+        expr->maxDepth = optimized.maxDepth;
+        expr->tempCount = optimized.tempCount;
+    }
+
+    if (block != (char *)local)
+        free(block);
+    return 1;
+}
@@ -0,0 +1,29 @@
+/*
+ * expr_optimize.h
+ *
+ * Header file for the compiled-expression optimizer.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef EXPR_OPTIMIZE_H
+#define EXPR_OPTIMIZE_H
+
+#include "expression.h"
+
+/*
+ * Rewrites a compiled expression into an equivalent, smaller one:
+ *   - constant subtrees are folded into a single literal
+ *   - identical subexpressions are computed once, kept in a
+ *     temporary (OP_STORE) and reused (OP_LOAD)
+ * Worth calling when one compiled expression is evaluated many
+ * times (evaluateColumns, repeated evaluateCompiledRow).
+ * Returns 1 on success (expr possibly unchanged), 0 if out of memory
+ * (expr untouched).
+ */
+int optimizeCompiled(CompiledExpr *expr);
+
+#endif
@@ -0,0 +1,515 @@
+/*
+ * expr_parallel.c
+ *
+ * Multi-threaded evaluation of a single large expression.
+ * A span is split at its top-level operators with two parallel
+ * scans (parenthesis depth per segment, then operator positions at
+ * depth 0); the operands are grouped into chunks of about equal
+ * size, every chunk is folded by a pool worker, and the chunk
+ * results are combined on the calling thread. The implicit tree is
+ * one level per precedence / parenthesis level, and only large
+ * operands are split again, while the SplitBudget lasts.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "expr_parallel.h"
+
+/* One slice of a span for the parenthesis / operator scans */
+typedef struct {
+    TaskGroup *group;
+    const char *start;
+    const char *end;
+    long delta;             /* Pass 1: depth change over the slice */
+    long minDepth;          /* Pass 1: lowest depth, relative to the start */
+    long depth;             /* Pass 2: absolute depth at the start */
+    int additive;           /* Pass 2: look for + - (else * / %) */
+    const char **found;     /* Pass 2: top-level operators */
+    size_t count;
+    size_t cap;
+    int failed;
+} ScanSegment;
+
+/* Operands of a span, separated by top-level operators */
+typedef struct {
+    const char *start;
+    const char *end;
+    const char **ops;       /* Operator positions, in order */
+    size_t count;           /* Operands = count + 1 */
+    int additive;
+} Level;
+
+/* v = v op first, then v = v * rest (when hasRest) */
+typedef struct {
+    char op;
+    ExprValue first;
+    ExprValue rest;
+    int hasRest;
+} MulGroup;
+
+/* A run of consecutive operands folded by one task */
+typedef struct {
+    TaskGroup *group;
+    const Level *level;
+    size_t first;
+    size_t last;            /* One past the last operand */
+    int isBig;              /* Single operand split again by the caller */
+    ExprStatus status;
+    ExprValue sum;          /* Additive level: signed sum */
+    MulGroup *groups;       /* Multiplicative level */
+    size_t groupCount;
+    size_t groupCap;
+} ReduceChunk;
+
+/* What is left for splitting spans (used by the calling thread only) */
+typedef struct {
+    size_t scanLeft;        /* Bytes the depth / operator scans may still read */
+} SplitBudget;
+
+static ExprStatus evalSpan(ParallelEvaluator *pe, const char *s, const char *e,
+                           ExprValue *result, SplitBudget *budget, int level);
+
+/* ============================================================
+ * Helpers: scan tasks
+ * ============================================================ */
+static void scanDepth(void *arg, int worker)
+{
+    ScanSegment *seg = arg;
+    long depth = 0, minDepth = 0;
+    const char *p;
+
+    (void)worker;
+    for (p = seg->start; p < seg->end; p++) {
+        if (*p == '(') {
+            depth++;
+        } else if (*p == ')') {
+            depth--;
+            if (depth < minDepth)
+                minDepth = depth;
+        }
+    }
+    seg->delta = depth;
+    seg->minDepth = minDepth;
+    poolFinishTask(seg->group);
+}
+
+static void scanOperators(void *arg, int worker)
+{
+    ScanSegment *seg = arg;
+    long depth = seg->depth;
+    const char *p;
+
+    (void)worker;
+    seg->count = 0;
+    for (p = seg->start; p < seg->end; p++) {
+        char c = *p;
+        int match;
+
+        if (c == '(') {
+            depth++;
+            continue;
+        }
+        if (c == ')') {
+            depth--;
+            continue;
+        }
+        if (depth != 0)
+            continue;
+        match = seg->additive ? (c == '+' || c == '-')
+                              : (c == '*' || c == '/' || c == '%');
+        if (!match)
+            continue;
+
+        if (seg->count == seg->cap) {
+            size_t cap = seg->cap ? seg->cap * 2 : 256;
+            const char **grown = realloc(seg->found, cap * sizeof(*grown));
+
+            if (grown == NULL) {
+                seg->failed = 1;
+                break;
+            }
+            seg->found = grown;
+            seg->cap = cap;
+        }
+        seg->found[seg->count++] = p;
+    }
+    poolFinishTask(seg->group);
+}
+
+/* ============================================================
+ * Helper: collectOperators
+ * Fills level->ops with the top-level operators of one class.
+ * Returns 0 if out of memory.
+ * ============================================================ */
+static int collectOperators(ParallelEvaluator *pe, ScanSegment *segs, int n,
+                            int additive, Level *level)
+{
+    size_t total = 0;
+    int i;
+
+    for (i = 0; i < n; i++) {
+        segs[i].additive = additive;
+        segs[i].failed = 0;
+    }
+    poolRunTasks(&pe->pool, scanOperators, segs, sizeof(ScanSegment), (size_t)n);
+
+    for (i = 0; i < n; i++) {
+        if (segs[i].failed)
+            return 0;
+        total += segs[i].count;
+    }
+
+    level->additive = additive;
+    level->count = total;
+    level->ops = NULL;
+    if (total == 0)
+        return 1;
+    level->ops = malloc(total * sizeof(*level->ops));
+    if (level->ops == NULL)
+        return 0;
+    total = 0;
+    for (i = 0; i < n; i++) {
+        if (segs[i].count > 0)
+            memcpy(level->ops + total, segs[i].found, segs[i].count * sizeof(*level->ops));
+        total += segs[i].count;
+    }
+    return 1;
+}
+
+/* ============================================================
+ * Helpers: operands of a level
+ * ============================================================ */
+static const char *operandStart(const Level *level, size_t k)
+{
+    return k == 0 ? level->start : level->ops[k - 1] + 1;
+}
+
+static const char *operandEnd(const Level *level, size_t k)
+{
+    return k == level->count ? level->end : level->ops[k];
+}
+
+/* Operator applied to operand k ('+' / '*' for the first one) */
+static char operandOp(const Level *level, size_t k)
+{
+    if (k == 0)
+        return level->additive ? '+' : '*';
+    return *level->ops[k - 1];
+}
+
+/* ============================================================
+ * Helper: foldOperand
+ * Merges the value of operand k into the chunk.
+ * ============================================================ */
+static ExprStatus foldOperand(ReduceChunk *chunk, size_t k, const ExprValue *v)
+{
+    char op = operandOp(chunk->level, k);
+    MulGroup *g;
+
+    if (chunk->level->additive)
+        return combineExprValues(&chunk->sum, op, v);
+
+    if (op == '*' && chunk->groupCount > 0) {
+        g = &chunk->groups[chunk->groupCount - 1];
+        if (g->hasRest)
+            return combineExprValues(&g->rest, '*', v);
+        g->hasRest = 1;
+        return copyExprValue(&g->rest, v) ? EXPR_OK : EXPR_ERR_NO_MEMORY;
+    }
+
+    if (chunk->groupCount == chunk->groupCap) {
+        size_t cap = chunk->groupCap ? chunk->groupCap * 2 : 16;
+        MulGroup *grown = realloc(chunk->groups, cap * sizeof(MulGroup));
+
+        if (grown == NULL)
+            return EXPR_ERR_NO_MEMORY;
+        chunk->groups = grown;
+        chunk->groupCap = cap;
+    }
+    g = &chunk->groups[chunk->groupCount++];
+    g->op = op;
+    g->hasRest = 0;
+    initExprValue(&g->first);
+    initExprValue(&g->rest);
+    return copyExprValue(&g->first, v) ? EXPR_OK : EXPR_ERR_NO_MEMORY;
+}
+
+/* ============================================================
+ * Helper: reduceChunk (pool task)
+ * Big chunks are left to the calling thread.
+ * ============================================================ */
+static void reduceChunk(void *arg, int worker)
+{
+    ReduceChunk *chunk = arg;
+    const Level *level = chunk->level;
+    ExprValue v = EXPR_VALUE_INIT;
+    size_t k;
+
+    (void)worker;
+    for (k = chunk->first; k < chunk->last && !chunk->isBig && chunk->status == EXPR_OK; k++) {
+        const char *s = operandStart(level, k);
+
+        chunk->status = evaluateInfixRange(s, (size_t)(operandEnd(level, k) - s), &v, NULL);
+        if (chunk->status == EXPR_OK)
+            chunk->status = foldOperand(chunk, k, &v);
+    }
+    freeExprValue(&v);
+    poolFinishTask(chunk->group);
+}
+
+/* ============================================================
+ * Helper: appendChunk
+ * Returns 0 if out of memory.
+ * ============================================================ */
+static int appendChunk(ReduceChunk **chunks, size_t *count, size_t *cap,
+                       const Level *level, size_t first, size_t last, int isBig)
+{
+    ReduceChunk *c;
+
+    if (*count == *cap) {
+        size_t newCap = *cap ? *cap * 2 : 64;
+        ReduceChunk *grown = realloc(*chunks, newCap * sizeof(ReduceChunk));
+
+        if (grown == NULL)
+            return 0;
+        *chunks = grown;
+        *cap = newCap;
+    }
+    c = &(*chunks)[(*count)++];
+    memset(c, 0, sizeof(*c));
+    c->level = level;
+    c->first = first;
+    c->last = last;
+    c->isBig = isBig;
+    c->status = EXPR_OK;
+    initExprValue(&c->sum);
+    return 1;
+}
+
+/* ============================================================
+ * Helper: planChunks
+ * Cuts the operands into runs of about 'target' bytes; an operand
+ * that is large on its own gets a chunk of its own (isBig).
+ * Returns the chunk count, 0 if out of memory.
+ * ============================================================ */
+static size_t planChunks(const Level *level, size_t target, ReduceChunk **out)
+{
+    ReduceChunk *chunks = NULL;
+    size_t count = 0, cap = 0;
+    size_t first = 0, bytes = 0;
+    int ok = 1;
+    size_t k;
+
+    for (k = 0; k <= level->count && ok; k++) {
+        size_t size = (size_t)(operandEnd(level, k) - operandStart(level, k));
+
+        if (size > target && size >= PARALLEL_MIN_SIZE) {
+            if (k > first)
+                ok = appendChunk(&chunks, &count, &cap, level, first, k, 0);
+            ok = ok && appendChunk(&chunks, &count, &cap, level, k, k + 1, 1);
+            first = k + 1;
+            bytes = 0;
+            continue;
+        }
+        bytes += size + 1;
+        if (bytes >= target || k == level->count) {
+            ok = appendChunk(&chunks, &count, &cap, level, first, k + 1, 0);
+            first = k + 1;
+            bytes = 0;
+        }
+    }
+    if (!ok) {
+        free(chunks);
+        return 0;
+    }
+    *out = chunks;
+    return count;
+}
+
+/* ============================================================
+ * Helper: reduceLevel
+ * Evaluates every operand of the level and combines them.
+ * Chunks of small operands run on the pool while the calling
+ * thread splits the big operands again (their scans join the
+ * same pool).
+ * ============================================================ */
+static ExprStatus reduceLevel(ParallelEvaluator *pe, const Level *level,
+                              ExprValue *result, SplitBudget *budget, int nesting)
+{
+    size_t target = (size_t)(level->end - level->start) /
+                    (size_t)(pe->threads * PARALLEL_CHUNKS_PER_THREAD) + 1;
+    ReduceChunk *chunks;
+    TaskGroup group;
+    size_t count;
+    ExprStatus status = EXPR_OK;
+    ExprValue v = EXPR_VALUE_INIT;
+    size_t i, j, step;
+
+    count = planChunks(level, target, &chunks);
+    if (count == 0)
+        return EXPR_ERR_NO_MEMORY;
+
+    poolStartTasks(&pe->pool, &group, reduceChunk, chunks, sizeof(ReduceChunk), count);
+    for (i = 0; i < count; i++) {
+        ReduceChunk *c = &chunks[i];
+        const char *s = operandStart(level, c->first);
+
+        if (!c->isBig)
+            continue;
+        c->status = evalSpan(pe, s, operandEnd(level, c->first), &v, budget, nesting + 1);
+        if (c->status == EXPR_OK)
+            c->status = foldOperand(c, c->first, &v);
+    }
+    poolWaitTasks(&group);
+
+    for (i = 0; i < count && status == EXPR_OK; i++)
+        status = chunks[i].status;
+
+    if (status == EXPR_OK && level->additive) {
+        /* Balanced pairwise sum of the chunk sums */
+        for (step = 1; step < count && status == EXPR_OK; step *= 2) {
+            for (i = 0; i + step < count && status == EXPR_OK; i += 2 * step)
+                status = combineExprValues(&chunks[i].sum, '+', &chunks[i + step].sum);
+        }
+        if (status == EXPR_OK && !copyExprValue(result, &chunks[0].sum))
+            status = EXPR_ERR_NO_MEMORY;
+    } else if (status == EXPR_OK) {
+        /* Left to right over the groups: v = (v op first) * rest */
+        v.isBig = 0;
+        v.small = 1;
+        for (i = 0; i < count && status == EXPR_OK; i++) {
+            for (j = 0; j < chunks[i].groupCount && status == EXPR_OK; j++) {
+                MulGroup *g = &chunks[i].groups[j];
+
+                status = combineExprValues(&v, g->op, &g->first);
+                if (status == EXPR_OK && g->hasRest)
+                    status = combineExprValues(&v, '*', &g->rest);
+            }
+        }
+        if (status == EXPR_OK && !copyExprValue(result, &v))
+            status = EXPR_ERR_NO_MEMORY;
+    }
+
+    for (i = 0; i < count; i++) {
+        freeExprValue(&chunks[i].sum);
+        for (j = 0; j < chunks[i].groupCount; j++) {
+            freeExprValue(&chunks[i].groups[j].first);
+            freeExprValue(&chunks[i].groups[j].rest);
+        }
+        free(chunks[i].groups);
+    }
+    freeExprValue(&v);
+    free(chunks);
+    return status;
+}
+
+/* ============================================================
+ * Helper: evalSpan
+ * Evaluates [s, e): balanced parentheses are checked with the
+ * depth scan, then the span is split at + - or, failing that,
+ * at * / %. A span with neither is a single operand, unwrapped
+ * if it is "( ... )". Anything else (short spans, unbalanced
+ * parentheses, a spent budget, 'level' past PARALLEL_MAX_LEVELS)
+ * is evaluated sequentially. Every split is charged its scans,
+ * up to three passes over the span.
+ * ============================================================ */
+static ExprStatus evalSpan(ParallelEvaluator *pe, const char *s, const char *e,
+                           ExprValue *result, SplitBudget *budget, int level)
+{
+    int n = pe->threads;
+    size_t slice = (size_t)(e - s) / (size_t)n + 1;
+    ScanSegment *segs;
+    Level ops;
+    long depth = 0;
+    int balanced = 1;
+    ExprStatus status;
+    int i;
+
+    if ((size_t)(e - s) < PARALLEL_MIN_SIZE || level >= PARALLEL_MAX_LEVELS ||
+        budget->scanLeft < 3 * (size_t)(e - s))
+        return evaluateInfixRange(s, (size_t)(e - s), result, NULL);
+    budget->scanLeft -= 3 * (size_t)(e - s);
+
+    segs = calloc((size_t)n, sizeof(ScanSegment));
+    if (segs == NULL)
+        return EXPR_ERR_NO_MEMORY;
+    for (i = 0; i < n; i++) {
+        segs[i].start = s + (size_t)i * slice < e ? s + (size_t)i * slice : e;
+        segs[i].end = segs[i].start + slice < e ? segs[i].start + slice : e;
+    }
+
+    poolRunTasks(&pe->pool, scanDepth, segs, sizeof(ScanSegment), (size_t)n);
+    for (i = 0; i < n; i++) {
+        segs[i].depth = depth;
+        if (depth + segs[i].minDepth < 0)
+            balanced = 0;
+        depth += segs[i].delta;
+    }
+
+    ops.start = s;
+    ops.end = e;
+    ops.ops = NULL;
+    ops.count = 0;
+    if (!balanced || depth != 0) {
+        status = evaluateInfixRange(s, (size_t)(e - s), result, NULL);
+    } else if (!collectOperators(pe, segs, n, 1, &ops) ||
+               (ops.count == 0 && !collectOperators(pe, segs, n, 0, &ops))) {
+        status = EXPR_ERR_NO_MEMORY;
+    } else if (ops.count > 0) {
+        status = reduceLevel(pe, &ops, result, budget, level);
+    } else {
+        /* One operand: peel "( ... )" or parse the literal */
+        while (s < e && (*s == ' ' || (*s >= '\t' && *s <= '\r')))
+            s++;
+        while (e > s && (e[-1] == ' ' || (e[-1] >= '\t' && e[-1] <= '\r')))
+            e--;
+        if (e - s >= 2 && *s == '(' && e[-1] == ')')
+            status = evalSpan(pe, s + 1, e - 1, result, budget, level + 1);
+        else
+            status = evaluateInfixRange(s, (size_t)(e - s), result, NULL);
+    }
+
+    for (i = 0; i < n; i++)
+        free(segs[i].found);
+    free(segs);
+    free((void *)ops.ops);
+    return status;
+}
+
+/* ============================================================
+ * Function: parallelInit / parallelFree
+ * ============================================================ */
+int parallelInit(ParallelEvaluator *pe, int threads)
+{
+    pe->threads = threads > 0 ? threads : poolCpuCount();
+    return poolInit(&pe->pool, pe->threads, exprReleaseScratch);
+}
+
+void parallelFree(ParallelEvaluator *pe)
+{
+    poolFree(&pe->pool);
+}
+
+/* ============================================================
+ * Function: evaluateParallel
+ * ============================================================ */
+ExprStatus evaluateParallel(ParallelEvaluator *pe, const char *expr,
+                            ExprValue *result, int *errorOffset)
+{
+    SplitBudget budget;
+    size_t len;
+
+    if (expr == NULL || pe->threads < 2 || (len = strlen(expr)) < PARALLEL_MIN_SIZE)
+        return evaluateInfix(expr, result, errorOffset);
+
+    budget.scanLeft = PARALLEL_MAX_SCANS * 3 * len;
+    if (evalSpan(pe, expr, expr + len, result, &budget, 0) == EXPR_OK)
+        return EXPR_OK;
+    /* Invalid (or out of memory): the sequential pass reports exactly */
+    return evaluateInfix(expr, result, errorOffset);
+}
@@ -0,0 +1,64 @@
+/*
+ * expr_parallel.h
+ *
+ * Header file for multi-threaded evaluation of one large expression.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef EXPR_PARALLEL_H
+#define EXPR_PARALLEL_H
+
+#include "expression.h"
+#include "thread_pool.h"
+
+/* Spans shorter than this are evaluated by a single thread */
+#define PARALLEL_MIN_SIZE (64 * 1024)
+
+/* Work units per thread when reducing a chain of operands */
+#define PARALLEL_CHUNKS_PER_THREAD 4
+
+/*
+ * Limits of the splitting, past which spans are evaluated
+ * sequentially: nested spans split (operands or "( ... )"), and
+ * bytes scanned, as a number of full splits of the whole
+ * expression. They keep nesting like 1+(1+(1+...)) linear and off
+ * the C stack.
+ */
+#define PARALLEL_MAX_LEVELS 32
+#define PARALLEL_MAX_SCANS  4
+
+/* Thread pool reused across evaluations */
+typedef struct {
+    ThreadPool pool;
+    int threads;
+} ParallelEvaluator;
+
+/*
+ * Starts 'threads' workers (0 = one per CPU).
+ * Returns 1 on success, 0 if threads or memory are unavailable.
+ */
+int parallelInit(ParallelEvaluator *pe, int threads);
+
+/* Stops the workers */
+void parallelFree(ParallelEvaluator *pe);
+
+/*
+ * Same result and errors as evaluateInfix, computed on all threads:
+ * the expression is split at its top-level operators (first + and -,
+ * else * / and %) into operands that are evaluated in parallel.
+ * + chains are summed in any grouping (results are exact, so this
+ * is safe); * / % chains keep their left-to-right order, only the
+ * runs of * between them are multiplied in parallel. Operands that
+ * are themselves large are split the same way, within
+ * PARALLEL_MAX_LEVELS / PARALLEL_MAX_SCANS.
+ * Invalid expressions are re-run on the calling thread so the error
+ * offset is exact.
+ */
+ExprStatus evaluateParallel(ParallelEvaluator *pe, const char *expr,
+                            ExprValue *result, int *errorOffset);
+
+#endif
@@ -0,0 +1,334 @@
+/*
+ * expr_vector.c
+ *
+ * Evaluates a compiled expression over columns of integers.
+ * The token program is interpreted once per block of rows, and each
+ * operator runs as a SIMD kernel (AVX2 / SSE4.1, picked at runtime)
+ * over the whole block.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "expr_vector.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+/* Applies one operator elementwise: dst[i] = a[i] op b[i] */
+typedef void (*BinaryKernel)(int *dst, const int *a, const int *b, size_t n);
+
+/* One kernel per operator, indexed by OpCode */
+typedef struct {
+    const char *name;
+    BinaryKernel ops[OP_MOD + 1];
+} KernelSet;
+
+/* ============================================================
+ * Scalar kernels
+ * Arithmetic goes through unsigned so overflow wraps instead of
+ * being undefined; INT_MIN / -1 wraps to INT_MIN like the SIMD
+ * kernels. Division/modulo by zero -> 0.
+ * ============================================================ */
+static void addScalar(int *dst, const int *a, const int *b, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
+        dst[i] = (int)((unsigned)a[i] + (unsigned)b[i]);
+}
+
+static void subScalar(int *dst, const int *a, const int *b, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
+        dst[i] = (int)((unsigned)a[i] - (unsigned)b[i]);
+}
+
+static void mulScalar(int *dst, const int *a, const int *b, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
+        dst[i] = (int)((unsigned)a[i] * (unsigned)b[i]);
+}
+
+static void divScalar(int *dst, const int *a, const int *b, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++) {
+        if (b[i] == 0)
+            dst[i] = 0;
+        else if (b[i] == -1)
+            dst[i] = (int)(0u - (unsigned)a[i]);
+        else
+            dst[i] = a[i] / b[i];
+    }
+}
+
+static void modScalar(int *dst, const int *a, const int *b, size_t n)
+{
+    size_t i;
+    for (i = 0; i < n; i++)
+        dst[i] = (b[i] == 0 || b[i] == -1) ? 0 : a[i] % b[i];
+}
+
+static const KernelSet SCALAR_KERNELS = {
+    "scalar",
+    { NULL, addScalar, subScalar, mulScalar, divScalar, modScalar }
+};
+
+#ifdef HAVE_X86_SIMD
+
+/*
+ * Integer division has no SIMD instruction, so lanes are divided in
+ * double precision and truncated. For 32-bit operands this is exact:
+ * the rounding error of the quotient is always smaller than its
+ * distance to the next integer.
+ */
+
+/* ============================================================
+ * SSE4.1 kernels (4 lanes)
+ * ============================================================ */
+__attribute__((target("sse4.1")))
+static __m128i divLanesSse(__m128i a, __m128i b)
+{
+    __m128d alo = _mm_cvtepi32_pd(a);
+    __m128d ahi = _mm_cvtepi32_pd(_mm_shuffle_epi32(a, 0xEE));
+    __m128d blo = _mm_cvtepi32_pd(b);
+    __m128d bhi = _mm_cvtepi32_pd(_mm_shuffle_epi32(b, 0xEE));
+    __m128i q = _mm_unpacklo_epi64(_mm_cvttpd_epi32(_mm_div_pd(alo, blo)),
+                                   _mm_cvttpd_epi32(_mm_div_pd(ahi, bhi)));
+    __m128i zero = _mm_cmpeq_epi32(b, _mm_setzero_si128());
+
+    return _mm_andnot_si128(zero, q);
+}
+
+#define SSE_KERNEL(name, lanes, tail)                                        \
+    __attribute__((target("sse4.1")))                                        \
+    static void name(int *dst, const int *a, const int *b, size_t n)         \
+    {                                                                        \
+        size_t i = 0;                                                        \
+        for (; i + 4 <= n; i += 4) {                                         \
+            __m128i va = _mm_loadu_si128((const __m128i *)(a + i));          \
+            __m128i vb = _mm_loadu_si128((const __m128i *)(b + i));          \
+            _mm_storeu_si128((__m128i *)(dst + i), lanes);                   \
+        }                                                                    \
+        tail(dst + i, a + i, b + i, n - i);                                  \
+    }
+
+SSE_KERNEL(addSse, _mm_add_epi32(va, vb), addScalar)
+SSE_KERNEL(subSse, _mm_sub_epi32(va, vb), subScalar)
+SSE_KERNEL(mulSse, _mm_mullo_epi32(va, vb), mulScalar)
+SSE_KERNEL(divSse, divLanesSse(va, vb), divScalar)
+SSE_KERNEL(modSse,
+           _mm_andnot_si128(_mm_cmpeq_epi32(vb, _mm_setzero_si128()),
+                            _mm_sub_epi32(va, _mm_mullo_epi32(divLanesSse(va, vb), vb))),
+           modScalar)
+
+static const KernelSet SSE_KERNELS = {
+    "sse4.1",
+    { NULL, addSse, subSse, mulSse, divSse, modSse }
+};
+
+/* ============================================================
+ * AVX2 kernels (8 lanes)
+ * ============================================================ */
+__attribute__((target("avx2")))
+static __m256i divLanesAvx2(__m256i a, __m256i b)
+{
+    __m256d alo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(a));
+    __m256d ahi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(a, 1));
+    __m256d blo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(b));
+    __m256d bhi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(b, 1));
+    __m128i qlo = _mm256_cvttpd_epi32(_mm256_div_pd(alo, blo));
+    __m128i qhi = _mm256_cvttpd_epi32(_mm256_div_pd(ahi, bhi));
+    __m256i q = _mm256_inserti128_si256(_mm256_castsi128_si256(qlo), qhi, 1);
+    __m256i zero = _mm256_cmpeq_epi32(b, _mm256_setzero_si256());
+
+    return _mm256_andnot_si256(zero, q);
+}
+
+#define AVX2_KERNEL(name, lanes, tail)                                       \
+    __attribute__((target("avx2")))                                          \
+    static void name(int *dst, const int *a, const int *b, size_t n)         \
+    {                                                                        \
+        size_t i = 0;                                                        \
+        for (; i + 8 <= n; i += 8) {                                         \
+            __m256i va = _mm256_loadu_si256((const __m256i *)(a + i));       \
+            __m256i vb = _mm256_loadu_si256((const __m256i *)(b + i));       \
+            _mm256_storeu_si256((__m256i *)(dst + i), lanes);                \
+        }                                                                    \
+        tail(dst + i, a + i, b + i, n - i);                                  \
+    }
+
+AVX2_KERNEL(addAvx2, _mm256_add_epi32(va, vb), addScalar)
+AVX2_KERNEL(subAvx2, _mm256_sub_epi32(va, vb), subScalar)
+AVX2_KERNEL(mulAvx2, _mm256_mullo_epi32(va, vb), mulScalar)
+AVX2_KERNEL(divAvx2, divLanesAvx2(va, vb), divScalar)
+AVX2_KERNEL(modAvx2,
+            _mm256_andnot_si256(_mm256_cmpeq_epi32(vb, _mm256_setzero_si256()),
+                                _mm256_sub_epi32(va, _mm256_mullo_epi32(divLanesAvx2(va, vb), vb))),
+            modScalar)
+
+static const KernelSet AVX2_KERNELS = {
+    "avx2",
+    { NULL, addAvx2, subAvx2, mulAvx2, divAvx2, modAvx2 }
+};
+
+#endif /* HAVE_X86_SIMD */
+
+/* Kernel sets, widest first */
+static const KernelSet *const KERNEL_SETS[] = {
+#ifdef HAVE_X86_SIMD
+    &AVX2_KERNELS, &SSE_KERNELS,
+#endif
+    &SCALAR_KERNELS
+};
+
+#define KERNEL_SET_COUNT ((int)(sizeof(KERNEL_SETS) / sizeof(KERNEL_SETS[0])))
+
+/* Set in use; read and written atomically, NULL until first needed */
+static const KernelSet *chosenKernels = NULL;
+
+/* ============================================================
+ * Helper: kernelsSupported
+ * ============================================================ */
+static int kernelsSupported(const KernelSet *k)
+{
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (k == &AVX2_KERNELS)
+        return __builtin_cpu_supports("avx2");
+    if (k == &SSE_KERNELS)
+        return __builtin_cpu_supports("sse4.1");
+#endif
+    return k == &SCALAR_KERNELS;
+}
+
+/* ============================================================
+ * Helper: selectKernels
+ * Picks the widest kernel set the CPU supports. Threads that get
+ * here at once all pick the same set, so the pointer is simply
+ * published with an atomic store.
+ * ============================================================ */
+static const KernelSet *selectKernels(void)
+{
+    const KernelSet *k = __atomic_load_n(&chosenKernels, __ATOMIC_ACQUIRE);
+    int i;
+
+    if (k == NULL) {
+        for (i = 0; k == NULL; i++)
+            if (kernelsSupported(KERNEL_SETS[i]))
+                k = KERNEL_SETS[i];
+        __atomic_store_n(&chosenKernels, k, __ATOMIC_RELEASE);
+    }
+    return k;
+}
+
+const char *vectorKernelName(void)
+{
+    return selectKernels()->name;
+}
+
+/* ============================================================
+ * Function: vectorUseKernels
+ * ============================================================ */
+int vectorUseKernels(const char *name)
+{
+    int i;
+
+    for (i = 0; i < KERNEL_SET_COUNT; i++) {
+        if (strcmp(KERNEL_SETS[i]->name, name) == 0 && kernelsSupported(KERNEL_SETS[i])) {
+            __atomic_store_n(&chosenKernels, KERNEL_SETS[i], __ATOMIC_RELEASE);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* ============================================================
+ * Function: evaluateColumns
+ * Runs the token program once per block of VECTOR_BLOCK_ROWS rows.
+ * The value stack holds pointers to whole blocks: variables point
+ * straight into their column (no copy), literals and intermediate
+ * results live in per-depth scratch slots, temporaries of an
+ * optimized program get a block each, and the final operator
+ * writes directly into the result column.
+ * ============================================================ */
+int evaluateColumns(const CompiledExpr *expr, const int *const *columns,
+                    size_t rows, int *result)
+{
+    const KernelSet *kernels = selectKernels();
+    const int **stack;
+    int *slots;
+    int *temps;
+    size_t base;
+
+    if (expr->count == 0) {
+        memset(result, 0, rows * sizeof(int));
+        return 1;
+    }
+
+    /* Stack slots first, then one block per temporary */
+    stack = malloc((size_t)expr->maxDepth * sizeof(*stack));
+    slots = malloc((size_t)(expr->maxDepth + expr->tempCount) *
+                   VECTOR_BLOCK_ROWS * sizeof(int));
+    if (stack == NULL || slots == NULL) {
+        free(stack);
+        free(slots);
+        return 0;
+    }
+    temps = slots + (size_t)expr->maxDepth * VECTOR_BLOCK_ROWS;
+
+    for (base = 0; base < rows; base += VECTOR_BLOCK_ROWS) {
+        size_t n = rows - base < VECTOR_BLOCK_ROWS ? rows - base : VECTOR_BLOCK_ROWS;
+        int top = -1;
+        int i;
+
+        for (i = 0; i < expr->count; i++) {
+            const Token *t = &expr->tokens[i];
+            int *dst;
+
+            if (t->op == OP_PUSH) {
+                size_t r;
+
+                dst = slots + (size_t)(top + 1) * VECTOR_BLOCK_ROWS;
+                for (r = 0; r < n; r++)
+                    dst[r] = (int)t->value;  /* Lanes are 32-bit */
+                stack[++top] = dst;
+            }
+            else if (t->op == OP_VAR) {
+                stack[++top] = columns[t->value] + base;
+            }
+            else if (t->op == OP_STORE) {
+                dst = temps + (size_t)t->value * VECTOR_BLOCK_ROWS;
+                memcpy(dst, stack[top], n * sizeof(int));
+            }
+            else if (t->op == OP_LOAD) {
+                stack[++top] = temps + (size_t)t->value * VECTOR_BLOCK_ROWS;
+            }
+            else {
+                const int *b = stack[top--];
+
+                dst = (i == expr->count - 1)
+                    ? result + base
+                    : slots + (size_t)top * VECTOR_BLOCK_ROWS;
+                kernels->ops[t->op](dst, stack[top], b, n);
+                stack[top] = dst;
+            }
+        }
+
+        /* Program without operators: copy the single operand */
+        if (stack[0] != result + base)
+            memcpy(result + base, stack[0], n * sizeof(int));
+    }
+
+    free(stack);
+    free(slots);
+    return 1;
+}
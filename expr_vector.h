@@ -0,0 +1,48 @@
+/*
+ * expr_vector.h
+ *
+ * Header file for columnar (vectorized) expression evaluation.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef EXPR_VECTOR_H
+#define EXPR_VECTOR_H
+
+#include <stddef.h>
+#include "expression.h"
+
+/* Rows processed per block (keeps the working set in L1/L2) */
+#define VECTOR_BLOCK_ROWS 512
+
+/*
+ * Evaluates one compiled expression over 'rows' rows of column data.
+ * columns[i] holds the values of variable i (see compileExpression);
+ * result[r] receives the value for row r. Columns and lanes are
+ * 32-bit: results match evaluateCompiledRow whenever every step
+ * fits in an int, and wrap around otherwise (use
+ * evaluateCompiledRow for exact values).
+ * result must not alias any column.
+ * Returns 1 on success, 0 if out of memory.
+ */
+int evaluateColumns(const CompiledExpr *expr, const int *const *columns,
+                    size_t rows, int *result);
+
+/*
+ * Name of the kernel set chosen for this CPU ("avx2", "sse4.1"
+ * or "scalar").
+ */
+const char *vectorKernelName(void);
+
+/*
+ * Makes evaluateColumns use the kernel set of that name from now on,
+ * e.g. to compare the sets with each other. Returns 1, or 0 (nothing
+ * changed) if the name is unknown or the CPU lacks the instructions.
+ * Not meant to be called while other threads evaluate.
+ */
+int vectorUseKernels(const char *name);
+
+#endif
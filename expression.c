@@ -10,9 +10,11 @@
  */
 
 #include <stdio.h>
-#include <ctype.h>
+#include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include "expression.h"
+#include "phase_stats.h"
 
 /* Stack helpers */
 #define PUSH(stack, top, val)    ((stack)[++(top)] = (val))
@@ -20,13 +22,301 @@
 #define PEEK(stack, top)         ((stack)[(top)])
 #define IS_EMPTY(top)            ((top) < 0)
 
+/*
+ * Makes room for one more push, growing the stack if it is full.
+ * Evaluates to 0 if memory runs out.
+ */
+#define RESERVE(arena, stack, local, top, cap) \
+    ((top) + 1 < (cap) || \
+     ((stack) = growStack((arena), (stack), (local), &(cap), sizeof(*(stack)))) != NULL)
+
+/* Scratch arena of the calling thread */
+static PE1_THREAD_LOCAL Arena scratchArena = ARENA_INIT;
+
+Arena *exprScratchArena(void)
+{
+    return &scratchArena;
+}
+
+void exprReleaseScratch(void)
+{
+    arenaFree(&scratchArena);
+}
+
+/* ============================================================
+ * Helper: growStack
+ * Doubles a stack. Stacks start in a local array ('local') and
+ * move into the arena the first time they fill up.
+ * Returns the new stack, or NULL if out of memory.
+ * ============================================================ */
+static void *growStack(Arena *arena, void *stack, const void *local,
+                       int *cap, size_t elemSize)
+{
+    size_t bytes = (size_t)*cap * elemSize;
+    void *grown;
+
+    if (stack == local) {
+        grown = arenaAlloc(arena, 2 * bytes);
+        if (grown != NULL)
+            memcpy(grown, local, bytes);
+    } else {
+        grown = arenaGrow(arena, stack, bytes, 2 * bytes);
+    }
+    if (grown != NULL)
+        *cap *= 2;
+    return grown;
+}
+
+/*
+ * Operand stack shared by the evaluators. Values are long long
+ * while every step fits; the first overflow promotes the stack
+ * (each entry becomes a BigInt) and evaluation carries on exactly.
+ * Slots below 'base' hold the temporaries of an optimized program.
+ */
+typedef struct {
+    Arena *arena;
+    long long local[LOCAL_STACK_SIZE];
+    long long *small;
+    BigInt *big;        /* NULL until promoted */
+    int top;
+    int cap;
+    int base;
+} ValueStack;
+
+static void initValues(ValueStack *vs, Arena *arena)
+{
+    vs->arena = arena;
+    vs->small = vs->local;
+    vs->big = NULL;
+    vs->top = -1;
+    vs->cap = LOCAL_STACK_SIZE;
+    vs->base = 0;
+}
+
+/* Releases BigInt storage (the arrays go with the arena mark) */
+static void freeValues(ValueStack *vs)
+{
+    int i;
+
+    if (vs->big != NULL) {
+        for (i = 0; i < vs->cap; i++)
+            bigFree(&vs->big[i]);
+    }
+}
+
+/* ============================================================
+ * Helper: promoteValues
+ * Converts every slot to a BigInt. Returns 0 if out of memory.
+ * ============================================================ */
+static int promoteValues(ValueStack *vs)
+{
+    BigInt *big = arenaAlloc(vs->arena, (size_t)vs->cap * sizeof(BigInt));
+    int i;
+
+    if (big == NULL)
+        return 0;
+    memset(big, 0, (size_t)vs->cap * sizeof(BigInt));
+    vs->big = big;
+    for (i = 0; i <= vs->top; i++) {
+        if (!bigSetLong(&big[i], vs->small[i]))
+            return 0;
+    }
+    return 1;
+}
+
+/* ============================================================
+ * Helper: reserveValue
+ * Makes room for one more push. Returns 0 if out of memory.
+ * ============================================================ */
+static int reserveValue(ValueStack *vs)
+{
+    int old = vs->cap;
+    void *grown;
+
+    if (vs->top + 1 < vs->cap)
+        return 1;
+    if (vs->big == NULL) {
+        grown = growStack(vs->arena, vs->small, vs->local, &vs->cap, sizeof(long long));
+        if (grown != NULL)
+            vs->small = grown;
+    } else {
+        grown = growStack(vs->arena, vs->big, NULL, &vs->cap, sizeof(BigInt));
+        if (grown != NULL) {
+            vs->big = grown;
+            memset(vs->big + old, 0, (size_t)(vs->cap - old) * sizeof(BigInt));
+        }
+    }
+    return grown != NULL;
+}
+
+static int pushValue(ValueStack *vs, long long value)
+{
+    if (!reserveValue(vs))
+        return 0;
+    if (vs->big == NULL) {
+        vs->small[++vs->top] = value;
+        return 1;
+    }
+    return bigSetLong(&vs->big[++vs->top], value);
+}
+
+/* Pushes a literal too long for 64 bits */
+static int pushDigits(ValueStack *vs, const char *digits, size_t count)
+{
+    if (!reserveValue(vs) || (vs->big == NULL && !promoteValues(vs)))
+        return 0;
+    return bigSetDecimal(&vs->big[++vs->top], digits, count);
+}
+
+/* ============================================================
+ * Helper: applySmall
+ * r = a op b in 64 bits. Returns 0 if the exact result does not
+ * fit (the caller then redoes it with BigInts).
+ * Division/modulo by zero -> 0.
+ * ============================================================ */
+static int applySmall(unsigned char op, long long a, long long b, long long *r)
+{
+    switch (op) {
+        case OP_ADD: return !__builtin_add_overflow(a, b, r);
+        case OP_SUB: return !__builtin_sub_overflow(a, b, r);
+        case OP_MUL: return !__builtin_mul_overflow(a, b, r);
+        case OP_DIV:
+            if (b == 0) {
+                *r = 0;
+                return 1;
+            }
+            if (b == -1)
+                return !__builtin_sub_overflow(0LL, a, r);  /* LLONG_MIN / -1 */
+            *r = a / b;
+            return 1;
+        default:
+            *r = (b == 0 || b == -1) ? 0 : a % b;
+            return 1;
+    }
+}
+
+/* a = a op b exactly. Returns 0 if out of memory. */
+static int applyBig(unsigned char op, BigInt *a, const BigInt *b)
+{
+    switch (op) {
+        case OP_ADD: return bigAdd(a, a, b);
+        case OP_SUB: return bigSub(a, a, b);
+        case OP_MUL: return bigMul(a, a, b);
+        case OP_DIV: return bigIsZero(b) ? bigSetLong(a, 0) : bigDivMod(a, NULL, a, b);
+        default:     return bigIsZero(b) ? bigSetLong(a, 0) : bigDivMod(NULL, a, a, b);
+    }
+}
+
+/* ============================================================
+ * Helper: applyValues
+ * Pops two values, applies op, pushes the result; promotes the
+ * stack first if the 64-bit result would overflow.
+ * Returns 0 if out of memory.
+ * ============================================================ */
+static int applyValues(ValueStack *vs, unsigned char op)
+{
+    BigInt *a, *b;
+
+    if (vs->big == NULL) {
+        long long r;
+
+        if (applySmall(op, vs->small[vs->top - 1], vs->small[vs->top], &r)) {
+            vs->small[--vs->top] = r;
+            return 1;
+        }
+        if (!promoteValues(vs))
+            return 0;
+    }
+
+    b = &vs->big[vs->top--];
+    a = &vs->big[vs->top];
+    return applyBig(op, a, b);
+}
+
+/* OP_STORE: temporary 'slot' = top (not popped) */
+static int storeValue(ValueStack *vs, int slot)
+{
+    if (vs->big == NULL) {
+        vs->small[slot] = vs->small[vs->top];
+        return 1;
+    }
+    return bigCopy(&vs->big[slot], &vs->big[vs->top]);
+}
+
+/* OP_LOAD: push temporary 'slot' */
+static int loadValue(ValueStack *vs, int slot)
+{
+    if (!reserveValue(vs))
+        return 0;
+    if (vs->big == NULL) {
+        vs->small[vs->top + 1] = vs->small[slot];
+        vs->top++;
+        return 1;
+    }
+    vs->top++;
+    return bigCopy(&vs->big[vs->top], &vs->big[slot]);
+}
+
+/* ============================================================
+ * Helper: takeResult
+ * Moves the top of the stack (0 if empty) into *result, back in
+ * 64 bits if it fits.
+ * ============================================================ */
+static void takeResult(ValueStack *vs, ExprValue *result)
+{
+    result->isBig = 0;
+    if (vs->top < vs->base)
+        result->small = 0;
+    else if (vs->big == NULL)
+        result->small = vs->small[vs->top];
+    else if (!bigToLong(&vs->big[vs->top], &result->small)) {
+        bigSwap(&result->big, &vs->big[vs->top]);
+        result->isBig = 1;
+    }
+}
+
+/* ============================================================
+ * Helper: parseLiteral
+ * Reads the digits at *p into *value, leaving *p on the last
+ * digit. Returns 0 if the literal does not fit in 64 bits.
+ * ============================================================ */
+static int parseLiteral(const char **p, long long *value)
+{
+    const char *s = *p;
+    const char *safe = s + 18;  /* 18 digits always fit */
+    long long num = 0;
+    int fits = 1;
+
+    for (; s < safe && *s >= '0' && *s <= '9'; s++)
+        num = num * 10 + (*s - '0');
+    for (; *s >= '0' && *s <= '9'; s++) {
+        if (fits && (__builtin_mul_overflow(num, 10LL, &num) ||
+                     __builtin_add_overflow(num, (long long)(*s - '0'), &num)))
+            fits = 0;
+    }
+    *p = s - 1;
+    *value = num;
+    return fits;
+}
+
+/* Pushes the literal at *p (see parseLiteral) */
+static int pushLiteral(ValueStack *vs, const char **p)
+{
+    const char *start = *p;
+    long long num;
+
+    if (parseLiteral(p, &num))
+        return pushValue(vs, num);
+    return pushDigits(vs, start, (size_t)(*p - start + 1));
+}
+
 /* ============================================================
  * Function: isOperator
  * Checks if a character is a valid arithmetic operator.
  * ============================================================ */
 int isOperator(char c)
 {
-    return (c == '+' || c == '-' || c == '*' || c == '/' || c == '%');
+    return CHAR_IS(c, CC_OPERATOR) != 0;
 }
 
 /* ============================================================
@@ -62,63 +352,69 @@ int precedence(char op)
  */
 int isValidInfix(const char *expr)
 {
-    int parenDepth = 0;
-    int expectOperand = 1;  /* 1 = expect operand, 0 = expect operator */
-    int hasContent = 0;
-    int inNumber = 0;       /* Track if we're inside a multi-digit number */
-    const char *p;
+    uint64_t t = STATS_START();
+    size_t len;
+    int ok;
 
-    if (expr == NULL || *expr == '\0')
+    if (expr == NULL)
         return 0;
+    len = strlen(expr);
+    ok = checkInfix(expr, len) == CHECK_VALID;
+    STATS_STOP(STATS_VALIDATE_INFIX, t, len, 0);
+    return ok;
+}
 
-    for (p = expr; *p != '\0'; p++) {
-        char c = *p;
+/*
+ * One class-table load per byte picks the branch, and a number is
+ * read in one tight loop.
+ */
+size_t checkInfix(const char *expr, size_t len)
+{
+    int parenDepth = 0;
+    int expectOperand = 1;  /* 1 = expect operand, 0 = expect operator */
+    size_t i = 0;
+
+    while (i < len) {
+        unsigned char cc = CHAR_CLASS[(unsigned char)expr[i]];
 
-        if (isspace((unsigned char)c)) {
-            inNumber = 0;  /* Space ends a number */
+        if (cc & CC_SPACE) {
+            i++;
             continue;
         }
 
-        hasContent = 1;
-
-        if (isdigit((unsigned char)c)) {
-            if (!expectOperand && !inNumber)  /* Digit after operand without operator */
-                return 0;
-            inNumber = 1;
-            expectOperand = 0;   /* Now expect an operator */
-        }
-        else if (isalpha((unsigned char)c)) {
-            /* REJECT ALPHABETIC CHARACTERS */
-            return 0;  /* Variables/letters are not allowed */
+        if (cc & CC_DIGIT) {
+            if (!expectOperand)     /* Operand right after an operand */
+                return i;
+            do {
+                i++;
+            } while (i < len && IS_DIGIT(expr[i]));
+            expectOperand = 0;
+            continue;
         }
-        else if (isOperator(c)) {
-            if (expectOperand)   /* Operator when operand expected */
-                return 0;
-            inNumber = 0;
-            expectOperand = 1;   /* Now expect an operand */
+
+        if (cc & CC_OPERATOR) {
+            if (expectOperand)      /* Operator when operand expected */
+                return i;
+            expectOperand = 1;
         }
-        else if (c == '(') {
-            if (!expectOperand)  /* '(' after operand without operator */
-                return 0;
-            inNumber = 0;
+        else if (expr[i] == '(') {
+            if (!expectOperand)     /* '(' after operand without operator */
+                return i;
             parenDepth++;
-            /* expectOperand stays 1 */
         }
-        else if (c == ')') {
-            if (expectOperand)   /* ')' when expecting operand */
-                return 0;
-            if (--parenDepth < 0)  /* Unmatched closing paren */
-                return 0;
-            inNumber = 0;
-            /* expectOperand stays 0 */
+        else if (expr[i] == ')') {
+            if (expectOperand || parenDepth == 0)
+                return i;
+            parenDepth--;
         }
         else {
-            return 0;  /* Invalid character */
+            return i;   /* Letters and any other character */
         }
+        i++;
     }
 
     /* Must have content, balanced parens, and end with operand or ')' */
-    return hasContent && (parenDepth == 0) && !expectOperand;
+    return (expectOperand || parenDepth != 0) ? len : CHECK_VALID;
 }
 
 /* ============================================================
@@ -144,7 +440,7 @@ static const char* appendNumberToPostfix(const char *p, char *postfix, int *idx,
         postfix[(*idx)++] = ' ';
 
     /* Copy all consecutive digits */
-    while (*p != '\0' && isdigit((unsigned char)*p)) {
+    while (*p != '\0' && IS_DIGIT(*p)) {
         postfix[(*idx)++] = *p;
         p++;
     }
@@ -159,7 +455,12 @@ static const char* appendNumberToPostfix(const char *p, char *postfix, int *idx,
  */
 void infixToPostfix(const char *infix, char *postfix)
 {
-    char opStack[MAX_STACK_SIZE];
+    uint64_t t = STATS_START();
+    Arena *arena = exprScratchArena();
+    ArenaMark mark = arenaMark(arena);
+    char localStack[LOCAL_STACK_SIZE];
+    char *opStack = localStack;
+    int cap = LOCAL_STACK_SIZE;
     int top = -1;
     int idx = 0;
     int needSpace = 0;
@@ -168,15 +469,17 @@ void infixToPostfix(const char *infix, char *postfix)
     for (p = infix; *p != '\0'; p++) {
         char c = *p;
 
-        if (isspace((unsigned char)c))
+        if (IS_SPACE(c))
             continue;
 
         /* Handle multi-digit numbers */
-        if (isdigit((unsigned char)c)) {
+        if (IS_DIGIT(c)) {
             p = appendNumberToPostfix(p, postfix, &idx, &needSpace);
         }
         /* Note: We don't handle alphabetic characters anymore since isValidInfix rejects them */
         else if (c == '(') {
+            if (!RESERVE(arena, opStack, localStack, top, cap))
+                break;
             PUSH(opStack, top, c);
         }
         else if (c == ')') {
@@ -193,158 +496,838 @@ void infixToPostfix(const char *infix, char *postfix)
                    precedence(PEEK(opStack, top)) >= precedence(c)) {
                 appendCharToPostfix(postfix, &idx, &needSpace, POP(opStack, top));
             }
+            if (!RESERVE(arena, opStack, localStack, top, cap))
+                break;
             PUSH(opStack, top, c);
         }
     }
 
     /* Pop remaining operators */
-    while (!IS_EMPTY(top))
+    while (opStack != NULL && !IS_EMPTY(top))
         appendCharToPostfix(postfix, &idx, &needSpace, POP(opStack, top));
 
     postfix[idx] = '\0';
+    arenaRelease(arena, mark);
+    STATS_STOP(STATS_TO_POSTFIX, t, (size_t)(p - infix), (size_t)idx);
 }
 
 /* ============================================================
- * Helper: parseNumber
- * Parses a multi-digit number from string, returns the value
- * Updates pointer to point past the number
+ * Helper: opcodeFor
+ * Maps an operator character to its OpCode.
  * ============================================================ */
-static int parseNumber(const char **p)
+static unsigned char opcodeFor(char c)
 {
-    int num = 0;
-    while (**p != '\0' && isdigit((unsigned char)**p)) {
-        num = num * 10 + (**p - '0');
-        (*p)++;
+    switch (c) {
+        case '+': return OP_ADD;
+        case '-': return OP_SUB;
+        case '*': return OP_MUL;
+        case '/': return OP_DIV;
+        default:  return OP_MOD;
     }
-    (*p)--;  /* Back up one since the loop will increment */
-    return num;
 }
 
+/* Operator character for each OpCode (indexed by OpCode) */
+static const char OP_SYMBOLS[] = " +-*/%";
+
 /*
  * Evaluates the postfix expression.
- * Returns the integer result.
+ * Stores the exact result in *result.
  */
-int evaluatePostfix(const char *postfix)
+ExprStatus evaluatePostfix(const char *postfix, ExprValue *result)
 {
-    int stack[MAX_STACK_SIZE];
-    int top = -1;
+    uint64_t t = STATS_START();
+    Arena *arena = exprScratchArena();
+    ArenaMark mark = arenaMark(arena);
+    ValueStack values;
+    int ok = 1;
     const char *p;
 
-    for (p = postfix; *p != '\0'; p++) {
+    initValues(&values, arena);
+
+    for (p = postfix; ok && *p != '\0'; p++) {
         char c = *p;
 
-        if (isspace((unsigned char)c))
+        if (IS_SPACE(c))
             continue;
 
         /* Handle multi-digit numbers */
-        if (isdigit((unsigned char)c)) {
-            PUSH(stack, top, parseNumber(&p));
+        if (IS_DIGIT(c))
+            ok = pushLiteral(&values, &p);
+        else if (isOperator(c))
+            ok = applyValues(&values, opcodeFor(c));
+    }
+
+    if (ok)
+        takeResult(&values, result);
+    freeValues(&values);
+    arenaRelease(arena, mark);
+    STATS_STOP(STATS_EVAL_POSTFIX, t, (size_t)(p - postfix), 0);
+    return ok ? EXPR_OK : EXPR_ERR_NO_MEMORY;
+}
+
+/* ============================================================
+ * Function: initCompiled / freeCompiled
+ * ============================================================ */
+void initCompiled(CompiledExpr *expr)
+{
+    memset(expr, 0, sizeof(*expr));
+}
+
+void freeCompiled(CompiledExpr *expr)
+{
+    free(expr->tokens);
+    initCompiled(expr);
+}
+
+/* ============================================================
+ * Helper: resetCompiled
+ * Empties a compiled expression, keeping its token storage.
+ * ============================================================ */
+static void resetCompiled(CompiledExpr *out)
+{
+    out->count = 0;
+    out->maxDepth = 0;
+    out->tempCount = 0;
+}
+
+/* ============================================================
+ * Helper: appendToken
+ * Appends a token, doubling the token array when it is full.
+ * Returns 0 if out of memory.
+ * ============================================================ */
+static int appendToken(CompiledExpr *out, unsigned char op, long long value)
+{
+    if (out->count == out->capacity) {
+        int cap = out->capacity ? out->capacity * 2 : LOCAL_STACK_SIZE;
+        Token *grown = realloc(out->tokens, (size_t)cap * sizeof(Token));
+
+        if (grown == NULL)
+            return 0;
+        out->tokens = grown;
+        out->capacity = cap;
+    }
+    out->tokens[out->count].op = op;
+    out->tokens[out->count].value = value;
+    out->count++;
+    return 1;
+}
+
+/* ============================================================
+ * Helper: emitOperand / emitOperator
+ * Append a token to a compiled expression, tracking the value
+ * stack depth. Return 0 if out of memory.
+ * ============================================================ */
+static int emitOperand(CompiledExpr *out, int *depth, unsigned char op, long long value)
+{
+    if (!appendToken(out, op, value))
+        return 0;
+    if (++*depth > out->maxDepth)
+        out->maxDepth = *depth;
+    return 1;
+}
+
+static int emitOperator(CompiledExpr *out, int *depth, char c)
+{
+    (*depth)--;
+    return appendToken(out, opcodeFor(c), 0);
+}
+
+/*
+ * Compiles infix into a token array (shunting-yard).
+ * Expects a valid expression (see isValidInfix); anything that is
+ * not a digit, operator or parenthesis is treated as whitespace.
+ * Also records the evaluation stack depth so evaluateCompiled can
+ * size its stack once.
+ */
+int compileInfix(const char *infix, CompiledExpr *out)
+{
+    Arena *arena = exprScratchArena();
+    ArenaMark mark = arenaMark(arena);
+    char localStack[LOCAL_STACK_SIZE];
+    char *opStack = localStack;
+    int cap = LOCAL_STACK_SIZE;
+    int top = -1;
+    int depth = 0;      /* Value-stack depth after the tokens so far */
+    int ok = 1;
+    const char *p;
+
+    resetCompiled(out);
+
+    for (p = infix; ok && *p != '\0'; p++) {
+        char c = *p;
+
+        if (c >= '0' && c <= '9') {
+            long long num;
+
+            /* Parse the whole literal once */
+            ok = parseLiteral(&p, &num) &&
+                 emitOperand(out, &depth, OP_PUSH, num);
+        }
+        else if (c == '(') {
+            ok = RESERVE(arena, opStack, localStack, top, cap);
+            if (ok)
+                PUSH(opStack, top, c);
+        }
+        else if (c == ')') {
+            while (ok && !IS_EMPTY(top) && PEEK(opStack, top) != '(')
+                ok = emitOperator(out, &depth, POP(opStack, top));
+            if (!IS_EMPTY(top))
+                top--;  /* Discard the '(' */
         }
         else if (isOperator(c)) {
-            int b = POP(stack, top);  /* Second operand (top of stack) */
-            int a = POP(stack, top);  /* First operand */
-            int result;
-
-            switch (c) {
-                case '+': result = a + b; break;
-                case '-': result = a - b; break;
-                case '*': result = a * b; break;
-                case '/': result = (b != 0) ? a / b : 0; break;
-                case '%': result = (b != 0) ? a % b : 0; break;
-                default:  result = 0;
+            while (ok && !IS_EMPTY(top) &&
+                   PEEK(opStack, top) != '(' &&
+                   precedence(PEEK(opStack, top)) >= precedence(c)) {
+                ok = emitOperator(out, &depth, POP(opStack, top));
             }
-            PUSH(stack, top, result);
+            if (ok)
+                ok = RESERVE(arena, opStack, localStack, top, cap);
+            if (ok)
+                PUSH(opStack, top, c);
         }
     }
 
-    return IS_EMPTY(top) ? 0 : PEEK(stack, top);
+    while (ok && !IS_EMPTY(top))
+        ok = emitOperator(out, &depth, POP(opStack, top));
+
+    arenaRelease(arena, mark);
+    return ok;
 }
 
 /* ============================================================
- * Function: clearInputBuffer
- * Clears any remaining characters in the input buffer
+ * Helper: isNameStart / isNameChar
+ * Variable names: a letter or '_', then letters, digits or '_'.
  * ============================================================ */
-static void clearInputBuffer(void)
+static int isNameStart(char c)
 {
-    int c;
-    while ((c = getchar()) != '\n' && c != EOF);
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
 }
 
-/* ============================================================
- * Function: printInvalidExpressionExamples
- * Prints examples of invalid expressions to help users
- * ============================================================ */
-static void printInvalidExpressionExamples(void)
-{
-    printf("\n");
-    printf("Examples of INVALID expressions:\n");
-    printf("  \"5 + a\"      - Contains letter 'a' (letters not allowed)\n");
-    printf("  \"5 ++ 3\"     - Consecutive operators\n");
-    printf("  \"(5+3\"       - Unbalanced parentheses (missing ')')\n");
-    printf("  \"5+3)\"       - Unbalanced parentheses (missing '(')\n");
-    printf("  \"+5+3\"       - Starts with operator\n");
-    printf("  \"5+3+\"       - Ends with operator\n");
-    printf("  \"5 3 +\"      - Missing operator between operands\n");
-    printf("  \"5 + *3\"     - Consecutive operators\n\n");
-    
-    printf("Examples of VALID expressions:\n");
-    printf("  \"5+3\"        - Simple addition\n");
-    printf("  \"10 - 4\"     - Subtraction with spaces\n");
-    printf("  \"(5+3)*2\"    - With parentheses\n");
-    printf("  \"10/2\"       - Division\n");
-    printf("  \"15%%4\"      - Modulo operator\n");
-    printf("  \"5 + 6 + (6 * 4) %% 12\"  - Complex expression\n");
+static int isNameChar(char c)
+{
+    return isNameStart(c) || (c >= '0' && c <= '9');
 }
 
 /* ============================================================
- * Function: handleExpressionEvaluator
- * Main workflow: input -> validate -> convert -> evaluate
- * Loops until user chooses to exit
+ * Helper: lookupVariable
+ * Returns the index of the name [start, start + len) in varNames,
+ * or -1 if it is not there.
  * ============================================================ */
-void handleExpressionEvaluator(void)
-{
-    char infix[MAX_EXPR_SIZE];
-    char postfix[MAX_EXPR_SIZE];
-    char choice;
-    int keepRunning = 1;
-    char *newline;
-
-    printf("\n=== Expression Evaluator ===\n");
-    printf("This program evaluates arithmetic expressions using +, -, *, /, %% operators.\n");
-    printf("Only digits, operators, parentheses, and spaces are allowed.\n");
-    printf("Variables/letters are NOT allowed.\n");
-    
-    while (keepRunning) {
-        printf("\nEnter an infix expression: ");
-        
-        if (fgets(infix, MAX_EXPR_SIZE, stdin) == NULL)
+static int lookupVariable(const char *start, size_t len,
+                          const char *const *varNames, int varCount)
+{
+    int i;
+
+    for (i = 0; i < varCount; i++) {
+        if (strncmp(varNames[i], start, len) == 0 && varNames[i][len] == '\0')
+            return i;
+    }
+    return -1;
+}
+
+/*
+ * Validating compiler with variable support.
+ * Same grammar as isValidInfix, except that names listed in
+ * varNames are accepted wherever a number is.
+ */
+ExprStatus compileExpression(const char *expr, const char *const *varNames,
+                             int varCount, CompiledExpr *out, int *errorOffset)
+{
+    Arena *arena = exprScratchArena();
+    ArenaMark mark = arenaMark(arena);
+    char localOps[LOCAL_STACK_SIZE];
+    char *ops = localOps;
+    int cap = LOCAL_STACK_SIZE;
+    int oTop = -1;
+    int depth = 0;
+    int expectOperand = 1;
+    ExprStatus status = EXPR_OK;
+    const char *p = expr;
+
+    resetCompiled(out);
+
+    if (expr == NULL) {
+        if (errorOffset != NULL)
+            *errorOffset = 0;
+        return EXPR_ERR_EMPTY;
+    }
+
+    for (; *p != '\0'; p++) {
+        char c = *p;
+
+        if ((c >= '0' && c <= '9') || (varNames != NULL && isNameStart(c))) {
+            const char *start = p;
+            unsigned char op = OP_PUSH;
+            long long value;
+
+            if (!expectOperand) {
+                status = EXPR_ERR_EXPECTED_OPERATOR;
+                break;
+            }
+            if (c >= '0' && c <= '9') {
+                if (!parseLiteral(&p, &value)) {
+                    p = start;
+                    status = EXPR_ERR_NUMBER_TOO_LARGE;
+                    break;
+                }
+            } else {
+                do {
+                    p++;
+                } while (isNameChar(*p));
+                op = OP_VAR;
+                value = lookupVariable(start, (size_t)(p - start), varNames, varCount);
+                if (value < 0) {
+                    p = start;
+                    status = EXPR_ERR_UNKNOWN_VARIABLE;
+                    break;
+                }
+                p--;
+            }
+
+            if (!emitOperand(out, &depth, op, value)) {
+                status = EXPR_ERR_NO_MEMORY;
+                break;
+            }
+            expectOperand = 0;
+        }
+        else if (isOperator(c)) {
+            if (expectOperand) {
+                status = EXPR_ERR_EXPECTED_OPERAND;
+                break;
+            }
+            while (status == EXPR_OK && !IS_EMPTY(oTop) &&
+                   PEEK(ops, oTop) != '(' &&
+                   precedence(PEEK(ops, oTop)) >= precedence(c)) {
+                if (!emitOperator(out, &depth, POP(ops, oTop)))
+                    status = EXPR_ERR_NO_MEMORY;
+            }
+            if (status != EXPR_OK || !RESERVE(arena, ops, localOps, oTop, cap)) {
+                status = EXPR_ERR_NO_MEMORY;
+                break;
+            }
+            PUSH(ops, oTop, c);
+            expectOperand = 1;
+        }
+        else if (c == '(') {
+            if (!expectOperand) {
+                status = EXPR_ERR_EXPECTED_OPERATOR;
+                break;
+            }
+            if (!RESERVE(arena, ops, localOps, oTop, cap)) {
+                status = EXPR_ERR_NO_MEMORY;
+                break;
+            }
+            PUSH(ops, oTop, c);
+        }
+        else if (c == ')') {
+            if (expectOperand) {
+                status = EXPR_ERR_EXPECTED_OPERAND;
+                break;
+            }
+            while (status == EXPR_OK && !IS_EMPTY(oTop) && PEEK(ops, oTop) != '(') {
+                if (!emitOperator(out, &depth, POP(ops, oTop)))
+                    status = EXPR_ERR_NO_MEMORY;
+            }
+            if (status != EXPR_OK)
+                break;
+            if (IS_EMPTY(oTop)) {
+                status = EXPR_ERR_UNMATCHED_CLOSE;
+                break;
+            }
+            oTop--;  /* Discard the '(' */
+        }
+        else if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            continue;
+        }
+        else {
+            status = EXPR_ERR_INVALID_CHAR;
             break;
+        }
+    }
 
-        /* Remove trailing newline */
-        if ((newline = strchr(infix, '\n')) != NULL)
-            *newline = '\0';
+    /* End of input: must close on an operand with no open '(' */
+    if (status == EXPR_OK) {
+        if (out->count == 0 && oTop < 0)
+            status = EXPR_ERR_EMPTY;
+        else if (expectOperand)
+            status = EXPR_ERR_EXPECTED_OPERAND;
+    }
+    while (status == EXPR_OK && !IS_EMPTY(oTop)) {
+        char op = POP(ops, oTop);
+        if (op == '(')
+            status = EXPR_ERR_UNMATCHED_OPEN;
+        else if (!emitOperator(out, &depth, op))
+            status = EXPR_ERR_NO_MEMORY;
+    }
+
+    arenaRelease(arena, mark);
 
-        printf("\nInfix   : %s\n", infix);
+    if (status != EXPR_OK) {
+        if (errorOffset != NULL)
+            *errorOffset = (int)(p - expr);
+        out->count = 0;
+        return status;
+    }
+    return EXPR_OK;
+}
 
-        if (!isValidInfix(infix)) {
-            printf("Invalid expression!\n");
-            printf("Use only digits, operators (+, -, *, /, %%), and parentheses.\n");
-            printf("Variables/letters are NOT allowed.\n");
-            printInvalidExpressionExamples();
-        } else {
-            infixToPostfix(infix, postfix);
-            printf("Postfix : %s\n", postfix);
-            printf("Result  : %d\n", evaluatePostfix(postfix));
+/*
+ * Evaluates a compiled expression directly over its tokens,
+ * reading variables from vars.
+ * Same semantics as evaluatePostfix (division/modulo by zero -> 0).
+ */
+ExprStatus evaluateCompiledRow(const CompiledExpr *expr, const int *vars,
+                               ExprValue *result)
+{
+    Arena *arena = exprScratchArena();
+    ArenaMark mark = arenaMark(arena);
+    ValueStack values;
+    int slots = expr->tempCount + expr->maxDepth;
+    int ok = 1;
+    const Token *t = expr->tokens;
+    const Token *end = t + expr->count;
+
+    /* Depth and temporaries are known up front: size once */
+    initValues(&values, arena);
+    if (slots > LOCAL_STACK_SIZE) {
+        values.small = arenaAlloc(arena, (size_t)slots * sizeof(long long));
+        values.cap = slots;
+        if (values.small == NULL) {
+            arenaRelease(arena, mark);
+            return EXPR_ERR_NO_MEMORY;
         }
+    }
+    if (expr->tempCount > 0)
+        memset(values.small, 0, (size_t)expr->tempCount * sizeof(long long));
+    values.base = expr->tempCount;
+    values.top = expr->tempCount - 1;
 
-        /* Ask if user wants to continue */
-        printf("\nDo you want to evaluate another expression? (y/n): ");
-        choice = getchar();
-        clearInputBuffer();  /* Clear any remaining characters */
-        
-        if (choice != 'y' && choice != 'Y') {
-            keepRunning = 0;
-            printf("Exiting Expression Evaluator. Goodbye!\n");
+    for (; ok && t < end; t++) {
+        switch (t->op) {
+            case OP_PUSH:  ok = pushValue(&values, t->value);             break;
+            case OP_VAR:   ok = pushValue(&values, vars[t->value]);       break;
+            case OP_STORE: ok = storeValue(&values, (int)t->value);       break;
+            case OP_LOAD:  ok = loadValue(&values, (int)t->value);        break;
+            default:       ok = applyValues(&values, t->op);              break;
         }
     }
-}
\ No newline at end of file
+
+    if (ok)
+        takeResult(&values, result);
+    freeValues(&values);
+    arenaRelease(arena, mark);
+    return ok ? EXPR_OK : EXPR_ERR_NO_MEMORY;
+}
+
+/*
+ * Evaluates a compiled expression that has no variables.
+ */
+ExprStatus evaluateCompiled(const CompiledExpr *expr, ExprValue *result)
+{
+    return evaluateCompiledRow(expr, NULL, result);
+}
+
+/*
+ * Writes the text postfix of a compiled expression.
+ * Output matches infixToPostfix for the same input.
+ */
+void compiledToPostfix(const CompiledExpr *expr, char *postfix)
+{
+    int idx = 0;
+    int i;
+
+    for (i = 0; i < expr->count; i++) {
+        const Token *t = &expr->tokens[i];
+
+        if (i > 0)
+            postfix[idx++] = ' ';
+        if (t->op == OP_PUSH)
+            idx += sprintf(&postfix[idx], "%lld", t->value);
+        else if (t->op == OP_VAR)
+            idx += sprintf(&postfix[idx], "$%lld", t->value);
+        else if (t->op == OP_STORE)
+            idx += sprintf(&postfix[idx], "=t%lld", t->value);
+        else if (t->op == OP_LOAD)
+            idx += sprintf(&postfix[idx], "t%lld", t->value);
+        else
+            postfix[idx++] = OP_SYMBOLS[t->op];
+    }
+    postfix[idx] = '\0';
+}
+
+/*
+ * Fused validate + shunting-yard + evaluate.
+ * Accepts exactly the expressions isValidInfix accepts and produces
+ * the same value as infixToPostfix followed by evaluatePostfix.
+ * Stops at the terminator or at 'end' (NULL: terminator only), and
+ * stores in *scanned how far it read, for the stats.
+ */
+static ExprStatus evaluateSpan(const char *expr, const char *end,
+                               ExprValue *result, int *errorOffset, size_t *scanned)
+{
+    Arena *arena = exprScratchArena();
+    ArenaMark mark = arenaMark(arena);
+    ValueStack values;
+    char localOps[LOCAL_STACK_SIZE];
+    char *ops = localOps;
+    int oCap = LOCAL_STACK_SIZE;
+    int oTop = -1;
+    int expectOperand = 1;
+    ExprStatus status = EXPR_OK;
+    const char *p = expr;
+
+    *scanned = 0;
+    if (expr == NULL) {
+        if (errorOffset != NULL)
+            *errorOffset = 0;
+        return EXPR_ERR_EMPTY;
+    }
+    initValues(&values, arena);
+
+    for (; p != end && *p != '\0'; p++) {
+        char c = *p;
+
+        if (c >= '0' && c <= '9') {
+            if (!expectOperand) {
+                status = EXPR_ERR_EXPECTED_OPERATOR;
+                break;
+            }
+            if (!pushLiteral(&values, &p)) {
+                status = EXPR_ERR_NO_MEMORY;
+                break;
+            }
+            expectOperand = 0;
+        }
+        else if (isOperator(c)) {
+            if (expectOperand) {
+                status = EXPR_ERR_EXPECTED_OPERAND;
+                break;
+            }
+            while (status == EXPR_OK && !IS_EMPTY(oTop) &&
+                   PEEK(ops, oTop) != '(' &&
+                   precedence(PEEK(ops, oTop)) >= precedence(c)) {
+                if (!applyValues(&values, opcodeFor(POP(ops, oTop))))
+                    status = EXPR_ERR_NO_MEMORY;
+            }
+            if (status != EXPR_OK || !RESERVE(arena, ops, localOps, oTop, oCap)) {
+                status = EXPR_ERR_NO_MEMORY;
+                break;
+            }
+            PUSH(ops, oTop, c);
+            expectOperand = 1;
+        }
+        else if (c == '(') {
+            if (!expectOperand) {
+                status = EXPR_ERR_EXPECTED_OPERATOR;
+                break;
+            }
+            if (!RESERVE(arena, ops, localOps, oTop, oCap)) {
+                status = EXPR_ERR_NO_MEMORY;
+                break;
+            }
+            PUSH(ops, oTop, c);
+        }
+        else if (c == ')') {
+            if (expectOperand) {
+                status = EXPR_ERR_EXPECTED_OPERAND;
+                break;
+            }
+            while (status == EXPR_OK && !IS_EMPTY(oTop) && PEEK(ops, oTop) != '(') {
+                if (!applyValues(&values, opcodeFor(POP(ops, oTop))))
+                    status = EXPR_ERR_NO_MEMORY;
+            }
+            if (status != EXPR_OK)
+                break;
+            if (IS_EMPTY(oTop)) {
+                status = EXPR_ERR_UNMATCHED_CLOSE;
+                break;
+            }
+            oTop--;  /* Discard the '(' */
+        }
+        else if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            continue;
+        }
+        else {
+            status = EXPR_ERR_INVALID_CHAR;
+            break;
+        }
+    }
+
+    /* End of input: must close on an operand with no open '(' */
+    if (status == EXPR_OK) {
+        if (values.top < 0 && oTop < 0)
+            status = EXPR_ERR_EMPTY;
+        else if (expectOperand)
+            status = EXPR_ERR_EXPECTED_OPERAND;
+    }
+    while (status == EXPR_OK && !IS_EMPTY(oTop)) {
+        char op = POP(ops, oTop);
+        if (op == '(')
+            status = EXPR_ERR_UNMATCHED_OPEN;
+        else if (!applyValues(&values, opcodeFor(op)))
+            status = EXPR_ERR_NO_MEMORY;
+    }
+
+    if (status == EXPR_OK)
+        takeResult(&values, result);
+    else if (errorOffset != NULL)
+        *errorOffset = (int)(p - expr);
+    *scanned = (size_t)(p - expr);
+
+    freeValues(&values);
+    arenaRelease(arena, mark);
+    return status;
+}
+
+ExprStatus evaluateInfix(const char *expr, ExprValue *result, int *errorOffset)
+{
+    uint64_t t = STATS_START();
+    size_t scanned;
+    ExprStatus status = evaluateSpan(expr, NULL, result, errorOffset, &scanned);
+
+    STATS_STOP(STATS_EVAL_INFIX, t, scanned, 0);
+    return status;
+}
+
+ExprStatus evaluateInfixRange(const char *expr, size_t len,
+                              ExprValue *result, int *errorOffset)
+{
+    uint64_t t = STATS_START();
+    size_t scanned;
+    ExprStatus status = evaluateSpan(expr, expr + len, result, errorOffset, &scanned);
+
+    STATS_STOP(STATS_EVAL_INFIX, t, scanned, 0);
+    return status;
+}
+
+/* ============================================================
+ * Helper: reduceFixed
+ * Applies op to the top two values of a fixed stack in 64 bits.
+ * ============================================================ */
+static ExprStatus reduceFixed(long long *values, int *top, char op)
+{
+    long long r;
+
+    if (!applySmall(opcodeFor(op), values[*top - 1], values[*top], &r))
+        return EXPR_ERR_OVERFLOW;
+    values[--*top] = r;
+    return EXPR_OK;
+}
+
+/* ============================================================
+ * Function: evaluateInfixInt64
+ * The fused pass of evaluateSpan on fixed stacks and 64-bit
+ * values only: it never allocates, and it reads exactly len bytes.
+ * Every value pushed beyond the first is preceded by a pushed
+ * operator or '(', so the value stack needs one slot more than
+ * the operator stack.
+ * ============================================================ */
+ExprStatus evaluateInfixInt64(const char *expr, size_t len,
+                              long long *result, size_t *errorOffset)
+{
+    long long values[EXPR_FIXED_DEPTH + 1];
+    char ops[EXPR_FIXED_DEPTH];
+    int vTop = -1;
+    int oTop = -1;
+    int expectOperand = 1;
+    ExprStatus status = EXPR_OK;
+    size_t i;
+
+    if (expr == NULL)
+        len = 0;
+
+    for (i = 0; i < len; i++) {
+        char c = expr[i];
+
+        if (c >= '0' && c <= '9') {
+            size_t start = i;
+            long long num = 0;
+
+            if (!expectOperand) {
+                status = EXPR_ERR_EXPECTED_OPERATOR;
+                break;
+            }
+            for (; i < len && expr[i] >= '0' && expr[i] <= '9'; i++) {
+                if (__builtin_mul_overflow(num, 10LL, &num) ||
+                    __builtin_add_overflow(num, (long long)(expr[i] - '0'), &num)) {
+                    status = EXPR_ERR_OVERFLOW;
+                    break;
+                }
+            }
+            if (status != EXPR_OK) {
+                i = start;
+                break;
+            }
+            i--;
+            PUSH(values, vTop, num);
+            expectOperand = 0;
+        }
+        else if (isOperator(c)) {
+            if (expectOperand) {
+                status = EXPR_ERR_EXPECTED_OPERAND;
+                break;
+            }
+            while (status == EXPR_OK && !IS_EMPTY(oTop) &&
+                   PEEK(ops, oTop) != '(' &&
+                   precedence(PEEK(ops, oTop)) >= precedence(c))
+                status = reduceFixed(values, &vTop, POP(ops, oTop));
+            if (status == EXPR_OK && oTop + 1 == EXPR_FIXED_DEPTH)
+                status = EXPR_ERR_TOO_DEEP;
+            if (status != EXPR_OK)
+                break;
+            PUSH(ops, oTop, c);
+            expectOperand = 1;
+        }
+        else if (c == '(') {
+            if (!expectOperand) {
+                status = EXPR_ERR_EXPECTED_OPERATOR;
+                break;
+            }
+            if (oTop + 1 == EXPR_FIXED_DEPTH) {
+                status = EXPR_ERR_TOO_DEEP;
+                break;
+            }
+            PUSH(ops, oTop, c);
+        }
+        else if (c == ')') {
+            if (expectOperand) {
+                status = EXPR_ERR_EXPECTED_OPERAND;
+                break;
+            }
+            while (status == EXPR_OK && !IS_EMPTY(oTop) && PEEK(ops, oTop) != '(')
+                status = reduceFixed(values, &vTop, POP(ops, oTop));
+            if (status != EXPR_OK)
+                break;
+            if (IS_EMPTY(oTop)) {
+                status = EXPR_ERR_UNMATCHED_CLOSE;
+                break;
+            }
+            oTop--;  /* Discard the '(' */
+        }
+        else if (c == ' ' || (c >= '\t' && c <= '\r')) {
+            continue;
+        }
+        else {
+            status = EXPR_ERR_INVALID_CHAR;
+            break;
+        }
+    }
+
+    /* End of input: must close on an operand with no open '(' */
+    if (status == EXPR_OK) {
+        if (vTop < 0 && oTop < 0)
+            status = EXPR_ERR_EMPTY;
+        else if (expectOperand)
+            status = EXPR_ERR_EXPECTED_OPERAND;
+    }
+    while (status == EXPR_OK && !IS_EMPTY(oTop)) {
+        char op = POP(ops, oTop);
+        if (op == '(')
+            status = EXPR_ERR_UNMATCHED_OPEN;
+        else
+            status = reduceFixed(values, &vTop, op);
+    }
+
+    if (status == EXPR_OK)
+        *result = values[vTop];
+    else if (errorOffset != NULL)
+        *errorOffset = i;
+    return status;
+}
+
+/* ============================================================
+ * Function: initExprValue / freeExprValue / copyExprValue
+ * ============================================================ */
+void initExprValue(ExprValue *value)
+{
+    value->isBig = 0;
+    value->small = 0;
+    bigInit(&value->big);
+}
+
+void freeExprValue(ExprValue *value)
+{
+    bigFree(&value->big);
+    initExprValue(value);
+}
+
+int copyExprValue(ExprValue *dst, const ExprValue *src)
+{
+    dst->isBig = src->isBig;
+    dst->small = src->small;
+    return !src->isBig || bigCopy(&dst->big, &src->big);
+}
+
+/* ============================================================
+ * Function: combineExprValues
+ * 64-bit when both values and the result fit, BigInt otherwise;
+ * the result is stored back in 64 bits whenever it fits.
+ * ============================================================ */
+ExprStatus combineExprValues(ExprValue *a, char op, const ExprValue *b)
+{
+    unsigned char code = opcodeFor(op);
+    BigInt widened = BIGINT_INIT;
+    const BigInt *rhs = &b->big;
+    long long r;
+    int ok;
+
+    if (!a->isBig && !b->isBig && applySmall(code, a->small, b->small, &r)) {
+        a->small = r;
+        return EXPR_OK;
+    }
+
+    if (!b->isBig) {
+        if (!bigSetLong(&widened, b->small))
+            return EXPR_ERR_NO_MEMORY;
+        rhs = &widened;
+    }
+    if (!a->isBig && !bigSetLong(&a->big, a->small)) {
+        bigFree(&widened);
+        return EXPR_ERR_NO_MEMORY;
+    }
+    a->isBig = 1;
+    ok = applyBig(code, &a->big, rhs);
+    bigFree(&widened);
+    if (!ok)
+        return EXPR_ERR_NO_MEMORY;
+    if (bigToLong(&a->big, &a->small))
+        a->isBig = 0;
+    return EXPR_OK;
+}
+
+/* ============================================================
+ * Function: exprValueTextSize / exprValueToText
+ * ============================================================ */
+size_t exprValueTextSize(const ExprValue *value)
+{
+    return value->isBig ? bigDecimalSize(&value->big) : 21;
+}
+
+size_t exprValueToText(const ExprValue *value, char *out)
+{
+    if (value->isBig)
+        return bigToDecimal(&value->big, out);
+    return (size_t)sprintf(out, "%lld", value->small);
+}
+
+/* ============================================================
+ * Function: exprStatusMessage
+ * ============================================================ */
+const char *exprStatusMessage(ExprStatus status)
+{
+    switch (status) {
+        case EXPR_OK:                    return "ok";
+        case EXPR_ERR_EMPTY:             return "empty expression";
+        case EXPR_ERR_INVALID_CHAR:      return "invalid character";
+        case EXPR_ERR_EXPECTED_OPERAND:  return "expected operand";
+        case EXPR_ERR_EXPECTED_OPERATOR: return "expected operator";
+        case EXPR_ERR_UNMATCHED_CLOSE:   return "unmatched ')'";
+        case EXPR_ERR_UNMATCHED_OPEN:    return "unmatched '('";
+        case EXPR_ERR_NO_MEMORY:         return "out of memory";
+        case EXPR_ERR_UNKNOWN_VARIABLE:  return "unknown variable";
+        case EXPR_ERR_NUMBER_TOO_LARGE:  return "number too large";
+        case EXPR_ERR_OVERFLOW:          return "result does not fit in 64 bits";
+        case EXPR_ERR_TOO_DEEP:          return "nested too deeply";
+        default:                         return "unknown error";
+    }
+}
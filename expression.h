@@ -12,8 +12,92 @@
 #ifndef EXPRESSION_H
 #define EXPRESSION_H
 
-#define MAX_EXPR_SIZE 256
-#define MAX_STACK_SIZE 128
+#include "arena.h"
+#include "bigint.h"
+#include "char_class.h"
+
+/*
+ * Expressions have no fixed size or nesting limit: stacks start
+ * small on the C stack and grow into a per-thread scratch arena.
+ */
+#define LOCAL_STACK_SIZE 64
+
+/* Pending operators and '(' evaluateInfixInt64 can hold */
+#define EXPR_FIXED_DEPTH 256
+
+/* Longest text compiledToPostfix writes for one token, separator included */
+#define MAX_TOKEN_TEXT 22
+
+/*
+ * Opcodes of the compiled (token-array) postfix form.
+ * OP_PUSH carries an integer literal, OP_VAR a variable index;
+ * OP_STORE copies the top of the stack into a temporary (without
+ * popping) and OP_LOAD pushes a temporary. The rest are operators.
+ */
+typedef enum {
+    OP_PUSH,
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_MOD,
+    OP_VAR,
+    OP_STORE,
+    OP_LOAD
+} OpCode;
+
+/* One compiled postfix token: an integer literal or an opcode */
+typedef struct {
+    unsigned char op;   /* OpCode */
+    long long value;    /* Literal (OP_PUSH), variable (OP_VAR) or temp index */
+} Token;
+
+/*
+ * Compiled postfix program. The token array is owned by the struct
+ * and reused (only grown) when another expression is compiled into
+ * it. Initialize with initCompiled or COMPILED_INIT.
+ */
+typedef struct {
+    Token *tokens;
+    int count;
+    int capacity;
+    int maxDepth;       /* Deepest value stack reached while evaluating */
+    int tempCount;      /* Temporaries used by OP_STORE / OP_LOAD */
+} CompiledExpr;
+
+#define COMPILED_INIT { NULL, 0, 0, 0, 0 }
+
+/*
+ * Exact value of an expression. Arithmetic runs on 64-bit integers
+ * with overflow checks and switches to a BigInt only when a step
+ * overflows, so isBig is set only for results outside long long.
+ * The BigInt storage is reused from one evaluation to the next:
+ * initialize once (initExprValue or EXPR_VALUE_INIT) and release
+ * with freeExprValue.
+ */
+typedef struct {
+    int isBig;
+    long long small;    /* Result when !isBig */
+    BigInt big;         /* Result when isBig */
+} ExprValue;
+
+#define EXPR_VALUE_INIT { 0, 0, BIGINT_INIT }
+
+/* Status codes returned by the fused evaluator */
+typedef enum {
+    EXPR_OK,
+    EXPR_ERR_EMPTY,             /* No content */
+    EXPR_ERR_INVALID_CHAR,      /* Letter or other disallowed character */
+    EXPR_ERR_EXPECTED_OPERAND,  /* Operator or ')' where an operand belongs */
+    EXPR_ERR_EXPECTED_OPERATOR, /* Operand or '(' where an operator belongs */
+    EXPR_ERR_UNMATCHED_CLOSE,   /* ')' without a matching '(' */
+    EXPR_ERR_UNMATCHED_OPEN,    /* '(' never closed */
+    EXPR_ERR_NO_MEMORY,         /* Stacks could not grow */
+    EXPR_ERR_UNKNOWN_VARIABLE,  /* Name not in the variable list */
+    EXPR_ERR_NUMBER_TOO_LARGE,  /* Literal beyond 64 bits (compiled forms only) */
+    EXPR_ERR_OVERFLOW,          /* Value beyond 64 bits (evaluateInfixInt64 only) */
+    EXPR_ERR_TOO_DEEP           /* Nesting beyond EXPR_FIXED_DEPTH (evaluateInfixInt64 only) */
+} ExprStatus;
 
 /*
  * Validates an infix expression.
@@ -21,16 +105,142 @@
  */
 int isValidInfix(const char *expr);
 
+/*
+ * The check behind isValidInfix, on len bytes. Returns CHECK_VALID,
+ * or the offset of the first invalid byte: len if the expression
+ * ends too early (empty, on an operator or with '(' still open).
+ */
+size_t checkInfix(const char *expr, size_t len);
+
 /*
  * Converts infix to postfix.
+ * postfix must hold at least 2 * strlen(infix) + 1 bytes.
  */
 void infixToPostfix(const char *infix, char *postfix);
 
 /*
  * Evaluates a postfix expression (supports multi-digit).
- * Returns result.
+ * Returns EXPR_OK, or EXPR_ERR_NO_MEMORY if memory runs out.
+ */
+ExprStatus evaluatePostfix(const char *postfix, ExprValue *result);
+
+/*
+ * Prepares an empty compiled expression / releases its tokens.
+ */
+void initCompiled(CompiledExpr *expr);
+void freeCompiled(CompiledExpr *expr);
+
+/*
+ * Compiles a valid infix expression into a token array.
+ * Numbers are parsed once here and never re-read.
+ * Returns 1 on success, 0 if out of memory or a literal does not
+ * fit in 64 bits.
  */
-int evaluatePostfix(const char *postfix);
+int compileInfix(const char *infix, CompiledExpr *out);
+
+/*
+ * Validates and compiles an expression that may contain named
+ * variables (letters, digits and '_', starting with a letter or '_').
+ * Each name must appear in varNames; it compiles to OP_VAR with the
+ * name's index; with varNames NULL, letters are rejected exactly as
+ * isValidInfix does. Literals must fit in 64 bits
+ * (EXPR_ERR_NUMBER_TOO_LARGE otherwise; evaluateInfix has no such
+ * limit). Returns EXPR_OK or an error code, storing the byte
+ * offset of the error in *errorOffset if it is not NULL.
+ */
+ExprStatus compileExpression(const char *expr, const char *const *varNames,
+                             int varCount, CompiledExpr *out, int *errorOffset);
+
+/*
+ * Evaluates a compiled expression (no variables).
+ * Returns EXPR_OK, or EXPR_ERR_NO_MEMORY if memory runs out.
+ */
+ExprStatus evaluateCompiled(const CompiledExpr *expr, ExprValue *result);
+
+/*
+ * Evaluates a compiled expression for one row of variable values
+ * (vars[i] is the value of variable i).
+ * Returns EXPR_OK, or EXPR_ERR_NO_MEMORY if memory runs out.
+ */
+ExprStatus evaluateCompiledRow(const CompiledExpr *expr, const int *vars,
+                               ExprValue *result);
+
+/*
+ * Writes the space-separated text postfix of a compiled expression
+ * (at most expr->count * MAX_TOKEN_TEXT + 1 bytes).
+ * Only needed when the postfix is to be printed.
+ * Variables are written as $<index>, temporaries as t<index>
+ * (loads) and =t<index> (stores).
+ */
+void compiledToPostfix(const CompiledExpr *expr, char *postfix);
+
+/*
+ * Fused engine: validates, converts and evaluates in one
+ * left-to-right pass with no intermediate postfix.
+ * On success stores the value in *result and returns EXPR_OK.
+ * On failure returns the error code and, if errorOffset is not
+ * NULL, stores the byte offset where the error was detected.
+ */
+ExprStatus evaluateInfix(const char *expr, ExprValue *result, int *errorOffset);
+
+/*
+ * evaluateInfix on the first 'len' bytes of expr. A literal is read
+ * up to its last digit, so expr[len] must not be a digit.
+ */
+ExprStatus evaluateInfixRange(const char *expr, size_t len,
+                              ExprValue *result, int *errorOffset);
+
+/*
+ * The fused engine for callers that must not allocate: fixed stacks
+ * on the C stack and 64-bit arithmetic, reading exactly len bytes
+ * (a NUL inside is an invalid character). Accepts the same
+ * expressions and gives the same values as evaluateInfix, except
+ * that a result or step beyond 64 bits is EXPR_ERR_OVERFLOW and
+ * more than EXPR_FIXED_DEPTH pending operators / open parentheses
+ * is EXPR_ERR_TOO_DEEP.
+ */
+ExprStatus evaluateInfixInt64(const char *expr, size_t len,
+                              long long *result, size_t *errorOffset);
+
+/*
+ * Prepares / releases an ExprValue.
+ */
+void initExprValue(ExprValue *value);
+void freeExprValue(ExprValue *value);
+
+/*
+ * Copies src into dst (reusing dst's storage).
+ * Returns 1 on success, 0 if out of memory.
+ */
+int copyExprValue(ExprValue *dst, const ExprValue *src);
+
+/*
+ * a = a op b, op being one of + - * / %, with the evaluators' rules
+ * (exact results, division/modulo by zero -> 0). b may alias a.
+ * Returns EXPR_OK, or EXPR_ERR_NO_MEMORY if memory runs out.
+ */
+ExprStatus combineExprValues(ExprValue *a, char op, const ExprValue *b);
+
+/*
+ * Decimal text of a value: exprValueTextSize gives the buffer size
+ * (terminator included), exprValueToText writes it and returns its
+ * length (0 if out of memory).
+ */
+size_t exprValueTextSize(const ExprValue *value);
+size_t exprValueToText(const ExprValue *value, char *out);
+
+/*
+ * Returns a short description of a status code.
+ */
+const char *exprStatusMessage(ExprStatus status);
+
+/*
+ * The calling thread's scratch arena (grown stacks live here).
+ * exprReleaseScratch returns its memory to malloc, e.g. before a
+ * worker thread exits.
+ */
+Arena *exprScratchArena(void);
+void exprReleaseScratch(void);
 
 /*
  * Checks if char is an operator.
@@ -42,9 +252,4 @@ int isOperator(char c);
  */
 int precedence(char op);
 
-/*
- * Main handler for expression evaluation.
- */
-void handleExpressionEvaluator(void);
-
 #endif
@@ -11,24 +11,38 @@
  *   and delegates tasks to specific modules.
  */
 
+#include <errno.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "expression.h"
 #include "string_ops.h"
+#include "batch.h"
+#include "mapped_file.h"
+#include "menu.h"
+#include "phase_stats.h"
+#include "server.h"
 
 /* Menu-related functions */
 void displayMainMenu(void);
 int getMenuChoice(void);
 
-/* Menu handlers */
-/* Menu handlers */
+/* Menu handlers (the others are in menu.h) */
 void handleProgramDescription(void);
-/* Other handlers are already in headers or will be linked */
 
-int main(void)
+/* Command-line (batch) mode */
+static int runCommandLine(int argc, char *argv[]);
+static int parseCount(const char *text, int *value);
+static void printUsage(const char *prog);
+
+int main(int argc, char *argv[])
 {
     int choice;
 
+    if (argc > 1)
+        return runCommandLine(argc, argv);
+
     do {
         displayMainMenu();
         choice = getMenuChoice();
@@ -57,6 +71,173 @@ int main(void)
     return 0;
 }
 
+/* ============================================================
+ * Function: runCommandLine
+ * Non-interactive mode: pe1 [options] eval|reduce|compress|expand [file]
+ * Reads records from the file (or stdin if omitted or "-") and
+ * writes to stdout or --output. Compressing / expanding a file
+ * into a file maps the input instead of reading it.
+ * pe1 [--stats] serve SOCKET answers requests on a Unix domain
+ * socket instead (server.h).
+ * ============================================================ */
+static int runCommandLine(int argc, char *argv[])
+{
+    BatchOptions opts;
+    BatchMode mode;
+    const char *modeName = NULL;
+    const char *path = NULL;
+    const char *outPath = NULL;
+    FILE *in = stdin;
+    FILE *out = stdout;
+    int stats = 0;
+    int status;
+    int i;
+
+    initBatchOptions(&opts);
+
+    for (i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+
+        if (strncmp(arg, "--cache=", 8) == 0) {
+            if (!parseCount(arg + 8, &opts.cacheCapacity)) {
+                printUsage(argv[0]);
+                return 2;
+            }
+        } else if (strncmp(arg, "--threads=", 10) == 0) {
+            if (!parseCount(arg + 10, &opts.threads)) {
+                printUsage(argv[0]);
+                return 2;
+            }
+        } else if (strncmp(arg, "--output=", 9) == 0 && arg[9] != '\0') {
+            outPath = arg + 9;
+        } else if (strcmp(arg, "--stats") == 0) {
+            stats = 1;
+        } else if (strcmp(arg, "--io=sync") == 0 || strcmp(arg, "--io=async") == 0) {
+            opts.asyncIo = arg[5] == 'a';
+        } else if (strncmp(arg, "--", 2) == 0) {
+            printUsage(argv[0]);
+            return 2;
+        } else if (modeName == NULL) {
+            modeName = arg;
+        } else if (path == NULL) {
+            path = arg;
+        } else {
+            printUsage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (modeName != NULL && strcmp(modeName, "serve") == 0) {
+        if (path == NULL || outPath != NULL) {
+            printUsage(argv[0]);
+            return 2;
+        }
+        statsEnable(stats);
+        statsInstallSignal();
+        fprintf(stderr, "%s: serving on %s\n", argv[0], path);
+        status = runServer(path);
+        if (status != 0)
+            fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        if (stats)
+            statsReport(stderr);
+        return status != 0 ? 1 : 0;
+    }
+
+    if (modeName == NULL || !parseBatchMode(modeName, &mode)) {
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    /* SIGUSR1 reports mid-run (and turns recording on if it is off) */
+    statsEnable(stats);
+    statsInstallSignal();
+
+    if (outPath != NULL && path != NULL && strcmp(path, "-") != 0 &&
+        (mode == BATCH_COMPRESS || mode == BATCH_EXPAND)) {
+        status = runMappedFile(mode, path, outPath, &opts);
+        if (status != 0)
+            fprintf(stderr, "%s -> %s: %s\n", path, outPath, strerror(errno));
+        if (stats)
+            statsReport(stderr);
+        return status != 0 ? 1 : 0;
+    }
+
+    if (path != NULL && strcmp(path, "-") != 0) {
+        in = fopen(path, "rb");
+        if (in == NULL) {
+            perror(path);
+            return 1;
+        }
+    }
+    if (outPath != NULL) {
+        out = fopen(outPath, "wb");
+        if (out == NULL) {
+            perror(outPath);
+            if (in != stdin)
+                fclose(in);
+            return 1;
+        }
+    }
+
+    status = runBatch(mode, in, out, &opts);
+    if (in != stdin)
+        fclose(in);
+    if (out != stdout && fclose(out) != 0)
+        status = -1;
+    if (stats)
+        statsReport(stderr);
+
+    if (status != 0) {
+        fprintf(stderr, "%s: I/O error\n", argv[0]);
+        return 1;
+    }
+    return 0;
+}
+
+/* ============================================================
+ * Function: parseCount
+ * Parses a whole option value as a count (0 .. INT_MAX).
+ * Returns 0 for anything else: empty, signs, trailing text,
+ * out of range.
+ * ============================================================ */
+static int parseCount(const char *text, int *value)
+{
+    char *end;
+    long n;
+
+    if (*text < '0' || *text > '9')
+        return 0;
+    errno = 0;
+    n = strtol(text, &end, 10);
+    if (*end != '\0' || errno == ERANGE || n > INT_MAX)
+        return 0;
+    *value = (int)n;
+    return 1;
+}
+
+static void printUsage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [options] [eval|reduce|compress|expand] [file]\n", prog);
+    fprintf(stderr, "       %s [--stats] serve SOCKET\n", prog);
+    fprintf(stderr, "  With no arguments, starts the interactive menu.\n");
+    fprintf(stderr, "  Otherwise reads one record per line from file (or stdin)\n");
+    fprintf(stderr, "  and writes one result per line.\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  --cache=N   cache up to N distinct expressions per thread (0 = off)\n");
+    fprintf(stderr, "  --threads=N process records on N threads (0 = one per CPU);\n");
+    fprintf(stderr, "              output stays in input order\n");
+    fprintf(stderr, "  --output=F  write results to file F instead of stdout;\n");
+    fprintf(stderr, "              compress/expand of a file into F maps the input\n");
+    fprintf(stderr, "  --io=MODE   async (default): read ahead / write behind regular\n");
+    fprintf(stderr, "              files with io_uring; sync: plain buffered stdio\n");
+    fprintf(stderr, "  --stats     report time, latency and bytes per phase on stderr\n");
+    fprintf(stderr, "              at the end (SIGUSR1 reports while running)\n");
+    fprintf(stderr, "  reduce evaluates like eval but splits each (large)\n");
+    fprintf(stderr, "  expression over the threads instead of the records\n");
+    fprintf(stderr, "  serve answers eval/compress/expand requests on the Unix\n");
+    fprintf(stderr, "  domain socket SOCKET until SIGINT or SIGTERM (server.h)\n");
+}
+
 void displayMainMenu(void)
 {
     printf("\nWelcome to this Expression Evaluator program!\n");
@@ -0,0 +1,472 @@
+/*
+ * mapped_file.c
+ *
+ * Memory-mapped file-to-file compression and expansion. The input
+ * file is mapped read-only and every line is validated and run
+ * through a compress / expand stream where it lies, with no copy
+ * through stdio. Results go to one page-aligned output buffer that
+ * is written with write(2) whenever it fills up; the streams carry
+ * runs over, so records may be bigger than the buffer. With more
+ * than one thread, large records are instead compressed / expanded
+ * on a pool directly into a mapped region of the output file.
+ * Without mmap (non-POSIX builds), mapFile reads the file into
+ * memory and runMappedFile streams through runBatch instead.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mapped_file.h"
+#include "phase_stats.h"
+#include "string_ops.h"
+#include "string_parallel.h"
+#include "string_stream.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_MMAP
+
+/* Aligned output buffer over a file descriptor */
+typedef struct {
+    int fd;
+    char *buf;
+    size_t len;
+    int failed;     /* A write failed; errno tells why */
+} MappedWriter;
+
+/* Part of the output file mapped for direct writes */
+typedef struct {
+    void *base;
+    size_t mapLen;
+    size_t skew;    /* Offset of the region in the first mapped page */
+    off_t start;    /* File offset of the region */
+} OutputRegion;
+
+/* ============================================================
+ * Function: mapFile / unmapFile
+ * ============================================================ */
+int mapFile(MappedFile *m, const char *path)
+{
+    struct stat st;
+    void *data;
+    int fd = open(path, O_RDONLY);
+
+    m->data = NULL;
+    m->size = 0;
+    if (fd < 0)
+        return -1;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (!S_ISREG(st.st_mode) || (unsigned long long)st.st_size > (size_t)-1) {
+        close(fd);
+        errno = S_ISREG(st.st_mode) ? EFBIG : EINVAL;
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  /* The mapping keeps the file open */
+    if (data == MAP_FAILED)
+        return -1;
+    madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    m->data = data;
+    m->size = (size_t)st.st_size;
+    return 0;
+}
+
+void unmapFile(MappedFile *m)
+{
+    if (m->data != NULL)
+        munmap((void *)m->data, m->size);
+    m->data = NULL;
+    m->size = 0;
+}
+
+/* ============================================================
+ * Helpers: MappedWriter
+ * flushWriter writes out the whole buffer, retrying short writes.
+ * reserveOutput makes room for 'need' (<= MAPPED_OUTPUT_SIZE)
+ * bytes and returns where to put them, or NULL after a failure.
+ * ============================================================ */
+static void flushWriter(MappedWriter *w)
+{
+    uint64_t t = STATS_START();
+    size_t done = 0;
+
+    while (!w->failed && done < w->len) {
+        ssize_t n = write(w->fd, w->buf + done, w->len - done);
+
+        if (n > 0)
+            done += (size_t)n;
+        else if (n < 0 && errno != EINTR)
+            w->failed = 1;
+    }
+    STATS_STOP(STATS_WRITE, t, 0, done);
+    w->len = 0;
+    statsPoll(stderr);  /* Also between the buffers of one huge record */
+}
+
+static char *reserveOutput(MappedWriter *w, size_t need)
+{
+    if (MAPPED_OUTPUT_SIZE - w->len < need)
+        flushWriter(w);
+    return w->failed ? NULL : w->buf + w->len;
+}
+
+static void writeText(MappedWriter *w, const char *s)
+{
+    size_t n = strlen(s);
+    char *out = reserveOutput(w, n);
+
+    if (out != NULL) {
+        memcpy(out, s, n);
+        w->len += n;
+    }
+}
+
+/* ============================================================
+ * Helper: streamFull
+ * Takes the output a stream call left at 'out'; if the stream ran
+ * out of room, flushes and returns 1 so the call is repeated.
+ * ============================================================ */
+static int streamFull(MappedWriter *w, char *out, StreamStatus status)
+{
+    w->len = (size_t)(out - w->buf);
+    if (status != STREAM_FULL)
+        return 0;
+    flushWriter(w);
+    return !w->failed;
+}
+
+/* ============================================================
+ * Helpers: compressRecord / expandRecord
+ * Run one valid record through a stream straight into the output
+ * buffer, so a record may be far bigger than the buffer.
+ * ============================================================ */
+static void compressRecord(MappedWriter *w, const char *p, const char *end)
+{
+    char *limit = w->buf + MAPPED_OUTPUT_SIZE;
+    CompressStream s;
+    StreamStatus status;
+    char *out;
+
+    compressStreamInit(&s);
+    do {
+        out = w->buf + w->len;
+        status = compressStreamFeed(&s, &p, end, &out, limit);
+    } while (streamFull(w, out, status));
+    do {
+        out = w->buf + w->len;
+        status = compressStreamFinish(&s, &out, limit);
+    } while (streamFull(w, out, status));
+}
+
+static void expandRecord(MappedWriter *w, const char *p, const char *end)
+{
+    char *limit = w->buf + MAPPED_OUTPUT_SIZE;
+    ExpandStream s;
+    StreamStatus status;
+    char *out;
+
+    expandStreamInit(&s);
+    do {
+        out = w->buf + w->len;
+        status = expandStreamFeed(&s, &p, end, &out, limit);
+    } while (streamFull(w, out, status));
+    do {
+        out = w->buf + w->len;
+        status = expandStreamFinish(&s, &out, limit);
+    } while (streamFull(w, out, status));
+}
+
+/* ============================================================
+ * Helpers: mapOutput / unmapOutput
+ * mapOutput flushes the buffer and maps the next 'size' bytes of
+ * the output file, so a parallel kernel can write its result in
+ * place; NULL if the output cannot be mapped (e.g. not a regular
+ * file). unmapOutput keeps the first 'used' of those bytes.
+ * ============================================================ */
+static char *mapOutput(MappedWriter *w, size_t size, OutputRegion *r)
+{
+    off_t start;
+    void *base;
+
+    flushWriter(w);
+    if (w->failed || (start = lseek(w->fd, 0, SEEK_CUR)) < 0 ||
+        ftruncate(w->fd, start + (off_t)size) != 0)
+        return NULL;
+
+    r->start = start;
+    r->skew = (size_t)(start % sysconf(_SC_PAGESIZE));
+    r->mapLen = size + r->skew;
+    base = mmap(NULL, r->mapLen, PROT_READ | PROT_WRITE, MAP_SHARED, w->fd,
+                start - (off_t)r->skew);
+    if (base == MAP_FAILED) {
+        if (ftruncate(w->fd, start) != 0)
+            w->failed = 1;
+        return NULL;
+    }
+    r->base = base;
+    return (char *)base + r->skew;
+}
+
+static void unmapOutput(MappedWriter *w, OutputRegion *r, size_t used)
+{
+    off_t end = r->start + (off_t)used;
+
+    munmap(r->base, r->mapLen);
+    if (ftruncate(w->fd, end) != 0 || lseek(w->fd, end, SEEK_SET) < 0)
+        w->failed = 1;
+}
+
+/* ============================================================
+ * Helpers: compressMapped / expandMapped
+ * Large records on several threads, written straight into the
+ * mapped output. Return 1 when written, -1 (compressMapped) for an
+ * invalid record, 0 to fall back to the single-threaded path.
+ * ============================================================ */
+static int compressMapped(MappedWriter *w, ThreadPool *pool, const char *line, size_t len)
+{
+    OutputRegion r;
+    char *out = mapOutput(w, len, &r);
+    size_t n;
+
+    if (out == NULL)
+        return 0;
+    n = compressParallel(pool, line, len, out);
+    unmapOutput(w, &r, (n == (size_t)-1) ? 0 : n);
+    return (n == (size_t)-1) ? -1 : 1;
+}
+
+static int expandMapped(MappedWriter *w, ThreadPool *pool, const char *line, size_t len)
+{
+    ExpandPlan plan;
+    OutputRegion r;
+    char *out;
+
+    if (!planExpansion(pool, line, len, &plan))
+        return 0;
+    out = mapOutput(w, plan.total, &r);
+    if (out != NULL) {
+        expandPlanned(pool, &plan, out);
+        unmapOutput(w, &r, plan.total);
+    }
+    freeExpandPlan(&plan);
+    return out != NULL;
+}
+
+/* ============================================================
+ * Helper: processRecord
+ * Validates the record first, so an invalid one leaves no partial
+ * output before its error line. With a pool, large records are
+ * validated and processed in parallel instead.
+ * ============================================================ */
+static void processRecord(BatchMode mode, MappedWriter *w, ThreadPool *pool,
+                          const char *line, size_t len)
+{
+    int done = 0;
+
+    if (pool != NULL && len >= STRING_PARALLEL_MIN_SIZE)
+        done = (mode == BATCH_COMPRESS) ? compressMapped(w, pool, line, len)
+                                        : expandMapped(w, pool, line, len);
+
+    if (mode == BATCH_COMPRESS && done == 0) {
+        if (!isValidStringRange(line, len))
+            done = -1;
+        else
+            compressRecord(w, line, line + len);
+    } else if (done == 0) {
+        if (!isValidCompressedRange(line, len)) {
+            writeText(w, "error: invalid compressed string\n");
+            return;
+        }
+        if (expandedSize(line, len) == (size_t)-1) {
+            writeText(w, "error: out of memory\n");
+            return;
+        }
+        expandRecord(w, line, line + len);
+    }
+
+    if (done < 0)
+        writeText(w, "error: invalid string\n");
+    else
+        writeText(w, "\n");
+}
+
+/* ============================================================
+ * Helper: sameFile
+ * 1 if both paths name the same existing file.
+ * ============================================================ */
+static int sameFile(const char *a, const char *b)
+{
+    struct stat sa, sb;
+
+    return stat(a, &sa) == 0 && stat(b, &sb) == 0 &&
+           sa.st_dev == sb.st_dev && sa.st_ino == sb.st_ino;
+}
+
+/* ============================================================
+ * Function: runMappedFile
+ * ============================================================ */
+int runMappedFile(BatchMode mode, const char *inPath, const char *outPath,
+                  const BatchOptions *opts)
+{
+    MappedFile in;
+    MappedWriter w;
+    ThreadPool poolStorage;
+    ThreadPool *pool = NULL;
+    const char *p, *end;
+    void *buf;
+    int savedErrno;
+
+    if (mode != BATCH_COMPRESS && mode != BATCH_EXPAND) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (sameFile(inPath, outPath)) {
+        errno = EINVAL;     /* Truncating a mapped input faults */
+        return -1;
+    }
+    if (mapFile(&in, inPath) != 0)
+        return -1;
+    if ((errno = posix_memalign(&buf, MAPPED_OUTPUT_ALIGN, MAPPED_OUTPUT_SIZE)) != 0) {
+        unmapFile(&in);
+        return -1;
+    }
+    if (opts->threads != 1 &&
+        poolInit(&poolStorage, opts->threads > 0 ? opts->threads : poolCpuCount(), NULL))
+        pool = &poolStorage;
+    w.fd = open(outPath, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    w.buf = buf;
+    w.len = 0;
+    w.failed = (w.fd < 0);
+
+    p = in.data;
+    end = in.data + in.size;
+    while (p < end && !w.failed) {
+        const char *nl = memchr(p, '\n', (size_t)(end - p));
+        const char *lineEnd = (nl != NULL) ? nl : end;
+        size_t len = (size_t)(lineEnd - p);
+
+        if (len > 0 && p[len - 1] == '\r')
+            len--;
+        processRecord(mode, &w, pool, p, len);
+        p = (nl != NULL) ? nl + 1 : end;
+        statsPoll(stderr);
+    }
+    flushWriter(&w);
+
+    savedErrno = errno;
+    if (w.fd >= 0 && close(w.fd) != 0 && !w.failed) {
+        savedErrno = errno;
+        w.failed = 1;
+    }
+    if (pool != NULL)
+        poolFree(pool);
+    free(buf);
+    unmapFile(&in);
+    errno = savedErrno;
+    return w.failed ? -1 : 0;
+}
+
+#else /* !HAVE_MMAP */
+
+/* ============================================================
+ * Function: mapFile / unmapFile
+ * Without mmap: the whole file read into memory.
+ * ============================================================ */
+int mapFile(MappedFile *m, const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    char *data = NULL;
+    size_t size = 0, cap = 0, n;
+
+    m->data = NULL;
+    m->size = 0;
+    if (f == NULL)
+        return -1;
+    do {
+        if (size == cap) {
+            char *grown = realloc(data, cap ? cap * 2 : BATCH_BUFFER_SIZE);
+
+            if (grown == NULL) {
+                free(data);
+                fclose(f);
+                errno = ENOMEM;
+                return -1;
+            }
+            data = grown;
+            cap = cap ? cap * 2 : BATCH_BUFFER_SIZE;
+        }
+        n = fread(data + size, 1, cap - size, f);
+        size += n;
+    } while (n > 0);
+    if (ferror(f)) {
+        free(data);
+        fclose(f);
+        errno = EIO;
+        return -1;
+    }
+    fclose(f);
+    if (size == 0)
+        free(data);
+    else
+        m->data = data;
+    m->size = size;
+    return 0;
+}
+
+void unmapFile(MappedFile *m)
+{
+    free((void *)m->data);
+    m->data = NULL;
+    m->size = 0;
+}
+
+/* ============================================================
+ * Function: runMappedFile
+ * Without mmap: plain stdio streams through runBatch, which keeps
+ * long lines in constant memory.
+ * ============================================================ */
+int runMappedFile(BatchMode mode, const char *inPath, const char *outPath,
+                  const BatchOptions *opts)
+{
+    FILE *in, *out;
+    int status;
+
+    if ((mode != BATCH_COMPRESS && mode != BATCH_EXPAND) || strcmp(inPath, outPath) == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((in = fopen(inPath, "rb")) == NULL)
+        return -1;
+    if ((out = fopen(outPath, "wb")) == NULL) {
+        fclose(in);
+        return -1;
+    }
+    status = runBatch(mode, in, out, opts);
+    if (fclose(out) != 0)
+        status = -1;
+    fclose(in);
+    return status;
+}
+
+#endif /* HAVE_MMAP */
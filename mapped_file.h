@@ -0,0 +1,56 @@
+/*
+ * mapped_file.h
+ *
+ * Header file for memory-mapped file-to-file compression and
+ * expansion.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <stddef.h>
+#include "batch.h"
+
+/* Output buffer size; a multiple of MAPPED_OUTPUT_ALIGN */
+#define MAPPED_OUTPUT_SIZE (8 << 20)
+
+/* Alignment of the output buffer (page size) */
+#define MAPPED_OUTPUT_ALIGN 4096
+
+/* Read-only mapping of a whole file */
+typedef struct {
+    const char *data;   /* NULL for an empty file */
+    size_t size;
+} MappedFile;
+
+/*
+ * Maps a regular file read-only (reads it into memory on builds
+ * without mmap). Returns 0 on success, -1 with errno set otherwise.
+ */
+int mapFile(MappedFile *m, const char *path);
+
+/* Releases a mapping made by mapFile */
+void unmapFile(MappedFile *m);
+
+/*
+ * Compresses (BATCH_COMPRESS) or expands (BATCH_EXPAND) every line
+ * of inPath into outPath, with the same one-line-per-record output
+ * as runBatch. The input is read in place from the mapping and the
+ * output is written through one aligned buffer, so record and file
+ * sizes are limited only by the address space. With opts->threads
+ * other than 1, records of STRING_PARALLEL_MIN_SIZE bytes or more
+ * are split over a thread pool. A --stats report requested with
+ * SIGUSR1 is printed between records and output buffers. Builds
+ * without mmap run the files through runBatch instead.
+ * Returns 0 on success, -1 with errno set on an I/O error (outPath
+ * naming the input file is refused with EINVAL).
+ */
+int runMappedFile(BatchMode mode, const char *inPath, const char *outPath,
+                  const BatchOptions *opts);
+
+#endif
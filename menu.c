@@ -0,0 +1,284 @@
+/*
+ * menu.c
+ *
+ * Interactive menu handlers: prompts, input and printed results.
+ * All stdio lives here (and in main.c); the modules behind it only
+ * compute.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "expression.h"
+#include "menu.h"
+#include "string_ops.h"
+
+/* ============================================================
+ * Function: clearInputBuffer
+ * Clears any remaining characters in the input buffer
+ * ============================================================ */
+static void clearInputBuffer(void)
+{
+    int c;
+    while ((c = getchar()) != '\n' && c != EOF);
+}
+
+/* ============================================================
+ * Function: readInputLine
+ * Reads one line of any length from stdin into *buf (grown as
+ * needed), without the trailing newline.
+ * Returns 1 on success, 0 at end of input or if out of memory.
+ * ============================================================ */
+static int readInputLine(char **buf, size_t *cap)
+{
+    size_t len = 0;
+
+    for (;;) {
+        if (*cap - len < 2) {
+            size_t newCap = *cap ? *cap * 2 : 256;
+            char *grown = realloc(*buf, newCap);
+            if (grown == NULL)
+                return 0;
+            *buf = grown;
+            *cap = newCap;
+        }
+        if (fgets(*buf + len, (int)(*cap - len > 0x7FFFFFFF ? 0x7FFFFFFF : *cap - len), stdin) == NULL)
+            return len > 0;
+        len += strlen(*buf + len);
+        if (len > 0 && (*buf)[len - 1] == '\n') {
+            (*buf)[len - 1] = '\0';
+            return 1;
+        }
+    }
+}
+
+/* ============================================================
+ * Function: printInvalidExpressionExamples
+ * Prints examples of invalid expressions to help users
+ * ============================================================ */
+static void printInvalidExpressionExamples(void)
+{
+    printf("\n");
+    printf("Examples of INVALID expressions:\n");
+    printf("  \"5 + a\"      - Contains letter 'a' (letters not allowed)\n");
+    printf("  \"5 ++ 3\"     - Consecutive operators\n");
+    printf("  \"(5+3\"       - Unbalanced parentheses (missing ')')\n");
+    printf("  \"5+3)\"       - Unbalanced parentheses (missing '(')\n");
+    printf("  \"+5+3\"       - Starts with operator\n");
+    printf("  \"5+3+\"       - Ends with operator\n");
+    printf("  \"5 3 +\"      - Missing operator between operands\n");
+    printf("  \"5 + *3\"     - Consecutive operators\n\n");
+    
+    printf("Examples of VALID expressions:\n");
+    printf("  \"5+3\"        - Simple addition\n");
+    printf("  \"10 - 4\"     - Subtraction with spaces\n");
+    printf("  \"(5+3)*2\"    - With parentheses\n");
+    printf("  \"10/2\"       - Division\n");
+    printf("  \"15%%4\"      - Modulo operator\n");
+    printf("  \"5 + 6 + (6 * 4) %% 12\"  - Complex expression\n");
+}
+
+/* ============================================================
+ * Function: handleExpressionEvaluator
+ * Main workflow: input -> evaluate (fused) -> show postfix
+ * Loops until user chooses to exit
+ * ============================================================ */
+void handleExpressionEvaluator(void)
+{
+    char *infix = NULL;
+    size_t infixCap = 0;
+    char *postfix;
+    char *text;
+    CompiledExpr compiled = COMPILED_INIT;
+    ExprValue result = EXPR_VALUE_INIT;
+    ExprStatus status;
+    int errorOffset;
+    char choice;
+    int keepRunning = 1;
+
+    printf("\n=== Expression Evaluator ===\n");
+    printf("This program evaluates arithmetic expressions using +, -, *, /, %% operators.\n");
+    printf("Only digits, operators, parentheses, and spaces are allowed.\n");
+    printf("Variables/letters are NOT allowed.\n");
+    
+    while (keepRunning) {
+        printf("\nEnter an infix expression: ");
+        
+        if (!readInputLine(&infix, &infixCap))
+            break;
+
+        printf("\nInfix   : %s\n", infix);
+
+        status = evaluateInfix(infix, &result, &errorOffset);
+        if (status == EXPR_ERR_NO_MEMORY) {
+            printf("Not enough memory to evaluate this expression.\n");
+        } else if (status != EXPR_OK) {
+            printf("Invalid expression: %s at position %d.\n",
+                   exprStatusMessage(status), errorOffset + 1);
+            printf("Use only digits, operators (+, -, *, /, %%), and parentheses.\n");
+            printf("Variables/letters are NOT allowed.\n");
+            printInvalidExpressionExamples();
+        } else {
+            /* Postfix text is only built for display */
+            if (compileInfix(infix, &compiled)) {
+                postfix = malloc((size_t)compiled.count * MAX_TOKEN_TEXT + 1);
+                if (postfix != NULL)
+                    compiledToPostfix(&compiled, postfix);
+            } else {
+                /* A literal beyond 64 bits: convert the text instead */
+                postfix = malloc(2 * strlen(infix) + 1);
+                if (postfix != NULL)
+                    infixToPostfix(infix, postfix);
+            }
+            if (postfix != NULL) {
+                printf("Postfix : %s\n", postfix);
+                free(postfix);
+            }
+
+            text = malloc(exprValueTextSize(&result));
+            if (text != NULL && exprValueToText(&result, text) > 0)
+                printf("Result  : %s\n", text);
+            else
+                printf("Not enough memory to print the result.\n");
+            free(text);
+        }
+
+        /* Ask if user wants to continue */
+        printf("\nDo you want to evaluate another expression? (y/n): ");
+        choice = getchar();
+        clearInputBuffer();  /* Clear any remaining characters */
+        
+        if (choice != 'y' && choice != 'Y') {
+            keepRunning = 0;
+            printf("Exiting Expression Evaluator. Goodbye!\n");
+        }
+    }
+
+    freeCompiled(&compiled);
+    freeExprValue(&result);
+    free(infix);
+}
+
+/* ============================================================
+ * Function: handleStringCompression
+ * Main workflow for string compression operation.
+ * Loops until user chooses to exit.
+ * 
+ * Steps:
+ *   1. Prompt for input string
+ *   2. Validate input (letters only)
+ *   3. If invalid, show example of correct format
+ *   4. Compress the string and display result
+ *   5. Ask if user wants to compress another string
+ * 
+ * Example of valid input: "aaabbc" -> compresses to "3a2bc"
+ * Example of invalid input: "aaabbc123" (contains digits)
+ * ============================================================ */
+void handleStringCompression(void) {
+    char input[256];
+    char output[516];  /* Expanded buffer for worst case (all single letters) */
+    char repeat;
+
+    do {
+        printf("\nEnter string to compress : ");
+        fgets(input, sizeof(input), stdin);
+        input[strcspn(input, "\n")] = 0;  /* Remove trailing newline */
+
+        if (!isValidString(input)) {
+            printf("Invalid string input.\n");
+            printf("Instructions: Use only letters (A-Z or a-z).\n");
+            printf("Example of valid input: \"aaabbc\"\n");
+            printf("Example of invalid input: \"aaabbc123\" (contains digits)\n");
+        } else {
+            compressString(input, output);
+            printf("Compressed Form : %s\n", output);
+        }
+
+        /* Ask if user wants to continue with validation */
+        do {
+            printf("Repeat? (y/n) : ");
+            scanf(" %c", &repeat);
+            getchar();  /* Clear newline from buffer */
+
+            if (repeat != 'Y' && repeat != 'y' &&
+                repeat != 'N' && repeat != 'n') {
+                printf("Invalid input. Please enter y or n only.\n");
+                printf("Example: Enter 'y' to continue, 'n' to exit\n");
+            }
+        } while (repeat != 'Y' && repeat != 'y' &&
+                repeat != 'N' && repeat != 'n');
+                       
+    } while (repeat == 'y' || repeat == 'Y');
+}
+
+/* ============================================================
+ * Function: handleStringExpansion
+ * Main workflow for string expansion operation.
+ * Loops until user chooses to exit.
+ * 
+ * Steps:
+ *   1. Prompt for compressed string
+ *   2. Validate compressed format
+ *   3. If invalid, show example of correct format
+ *   4. Expand the string and display result
+ *   5. Ask if user wants to expand another string
+ * 
+ * Example of valid input: "3a2bc" -> expands to "aaabbc"
+ * Examples of invalid inputs:
+ *   "1a"  - Count of 1 should not be shown (should be "a")
+ *   "05a" - Leading zeros not allowed
+ *   "3a2" - Ends with digit instead of letter
+ * ============================================================ */
+void handleStringExpansion(void) {
+    char input[256];
+    char *output;      /* Sized exactly for each expanded result */
+    size_t outputLen;
+    char repeat;
+
+    do {
+        printf("\nEnter string to expand : ");
+        fgets(input, sizeof(input), stdin);
+        input[strcspn(input, "\n")] = 0;  /* Remove trailing newline */
+
+        if (!isValidCompressedString(input)) {
+            printf("Invalid string input.\n");
+            printf("Instructions: Format should be [count]letter where:\n");
+            printf("  - count > 1 (optional, omitted for single letters)\n");
+            printf("  - No leading zeros (e.g., \"05a\" is invalid)\n");
+            printf("  - Count of 1 must NOT be shown (use \"a\" not \"1a\")\n");
+            printf("  - Must end with a letter\n\n");
+            printf("Examples of valid input: \"3a2bc\", \"a3b2c\", \"xyz\"\n");
+            printf("Examples of invalid input:\n");
+            printf("  \"1a\"  - Count of 1 should not be shown\n");
+            printf("  \"05a\" - Leading zeros not allowed\n");
+            printf("  \"3a2\" - Ends with digit instead of letter\n");
+        } else if ((outputLen = expandedSize(input, strlen(input))) == (size_t)-1 ||
+                   (output = malloc(outputLen + 1)) == NULL) {
+            printf("Expanded string is too large to hold in memory.\n");
+        } else {
+            expandString(input, output);
+            printf("Expanded Form : %s\n", output);
+            free(output);
+        }
+
+        /* Ask if user wants to continue with validation */
+        do {
+            printf("Repeat? (y/n) : ");
+            scanf(" %c", &repeat);
+            getchar();  /* Clear newline from buffer */
+
+            if (repeat != 'Y' && repeat != 'y' &&
+                repeat != 'N' && repeat != 'n') {
+                printf("Invalid input. Please enter y or n only.\n");
+                printf("Example: Enter 'y' to continue, 'n' to exit\n");
+            }
+        } while (repeat != 'Y' && repeat != 'y' &&
+                repeat != 'N' && repeat != 'n');
+
+    } while (repeat == 'y' || repeat == 'Y');
+}
@@ -0,0 +1,22 @@
+/*
+ * menu.h
+ *
+ * Header file for the interactive menu handlers.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef MENU_H
+#define MENU_H
+
+/* Evaluates expressions typed by the user until they stop */
+void handleExpressionEvaluator(void);
+
+/* Compresses / expands strings typed by the user until they stop */
+void handleStringCompression(void);
+void handleStringExpansion(void);
+
+#endif
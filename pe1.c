@@ -0,0 +1,180 @@
+/*
+ * pe1.c
+ *
+ * Embeddable API over the core kernels (string_ops, char_class and
+ * the fixed-stack evaluator). This layer only checks arguments,
+ * sizes outputs and maps results to status codes; the work is done
+ * by the same kernels the program uses.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <string.h>
+#include "expression.h"
+#include "pe1.h"
+#include "string_ops.h"
+
+#if PE1_MAX_DEPTH != EXPR_FIXED_DEPTH
+#error "PE1_MAX_DEPTH must equal EXPR_FIXED_DEPTH"
+#endif
+
+/* ============================================================
+ * Function: pe1StatusMessage
+ * ============================================================ */
+const char *pe1StatusMessage(Pe1Status status)
+{
+    switch (status) {
+        case PE1_OK:                    return "ok";
+        case PE1_ERR_ARGUMENT:          return "invalid argument";
+        case PE1_ERR_EMPTY:             return "empty input";
+        case PE1_ERR_INVALID:           return "invalid input";
+        case PE1_ERR_INVALID_CHAR:      return "invalid character";
+        case PE1_ERR_EXPECTED_OPERAND:  return "expected operand";
+        case PE1_ERR_EXPECTED_OPERATOR: return "expected operator";
+        case PE1_ERR_UNMATCHED_CLOSE:   return "unmatched ')'";
+        case PE1_ERR_UNMATCHED_OPEN:    return "unmatched '('";
+        case PE1_ERR_TOO_DEEP:          return "nested too deeply";
+        case PE1_ERR_OVERFLOW:          return "value does not fit in 64 bits";
+        case PE1_ERR_BUFFER_TOO_SMALL:  return "buffer too small";
+        default:                        return "unknown error";
+    }
+}
+
+/* ============================================================
+ * Helper: checked
+ * Status of a check* result: CHECK_VALID, or the offset of the
+ * first bad byte (stored in *errorOffset).
+ * ============================================================ */
+static Pe1Status checked(size_t result, size_t len, size_t *errorOffset)
+{
+    if (result == CHECK_VALID)
+        return PE1_OK;
+    if (errorOffset != NULL)
+        *errorOffset = result;
+    return (len == 0) ? PE1_ERR_EMPTY : PE1_ERR_INVALID;
+}
+
+/* Status of an evaluator result */
+static Pe1Status fromExprStatus(ExprStatus status)
+{
+    switch (status) {
+        case EXPR_OK:                    return PE1_OK;
+        case EXPR_ERR_EMPTY:             return PE1_ERR_EMPTY;
+        case EXPR_ERR_INVALID_CHAR:      return PE1_ERR_INVALID_CHAR;
+        case EXPR_ERR_EXPECTED_OPERAND:  return PE1_ERR_EXPECTED_OPERAND;
+        case EXPR_ERR_EXPECTED_OPERATOR: return PE1_ERR_EXPECTED_OPERATOR;
+        case EXPR_ERR_UNMATCHED_CLOSE:   return PE1_ERR_UNMATCHED_CLOSE;
+        case EXPR_ERR_UNMATCHED_OPEN:    return PE1_ERR_UNMATCHED_OPEN;
+        case EXPR_ERR_TOO_DEEP:          return PE1_ERR_TOO_DEEP;
+        default:                         return PE1_ERR_OVERFLOW;
+    }
+}
+
+/* ============================================================
+ * Functions: pe1ValidateString / pe1ValidateCompressed /
+ *            pe1ValidateInfix
+ * ============================================================ */
+Pe1Status pe1ValidateString(const char *in, size_t len, size_t *errorOffset)
+{
+    if (in == NULL && len > 0)
+        return PE1_ERR_ARGUMENT;
+    return checked(checkString(in, len), len, errorOffset);
+}
+
+Pe1Status pe1ValidateCompressed(const char *in, size_t len, size_t *errorOffset)
+{
+    if (in == NULL && len > 0)
+        return PE1_ERR_ARGUMENT;
+    return checked(checkCompressed(in, len), len, errorOffset);
+}
+
+Pe1Status pe1ValidateInfix(const char *expr, size_t len, size_t *errorOffset)
+{
+    if (expr == NULL && len > 0)
+        return PE1_ERR_ARGUMENT;
+    return checked(checkInfix(expr, len), len, errorOffset);
+}
+
+/* ============================================================
+ * Function: pe1Compress
+ * Whole runs are written one by one while the output might not
+ * fit; as soon as the rest of the input fits in the rest of the
+ * buffer, compressRange takes it from that run boundary. Past the
+ * capacity, runs are only counted to report the size needed.
+ * ============================================================ */
+Pe1Status pe1Compress(const char *in, size_t len, char *out, size_t cap,
+                      size_t *outLen, size_t *errorOffset)
+{
+    Pe1Status status;
+    size_t i = 0, n = 0;
+
+    if ((in == NULL && len > 0) || (out == NULL && cap > 0) || outLen == NULL)
+        return PE1_ERR_ARGUMENT;
+    if ((status = pe1ValidateString(in, len, errorOffset)) != PE1_OK)
+        return status;
+
+    while (i < len) {
+        char run[COMPRESSED_RUN_MAX];
+        size_t j = i + 1, k;
+
+        if (n <= cap && cap - n >= len - i) {
+            n += compressRange(in + i, len - i, out + n);
+            break;
+        }
+        while (j < len && in[j] == in[i])
+            j++;
+        k = compressRun(in[i], j - i, run);
+        if (n + k <= cap)
+            memcpy(out + n, run, k);
+        n += k;
+        i = j;
+    }
+
+    *outLen = n;
+    return (n <= cap) ? PE1_OK : PE1_ERR_BUFFER_TOO_SMALL;
+}
+
+/* ============================================================
+ * Functions: pe1ExpandedSize / pe1Expand
+ * ============================================================ */
+Pe1Status pe1ExpandedSize(const char *in, size_t len, size_t *size, size_t *errorOffset)
+{
+    Pe1Status status;
+
+    if ((in == NULL && len > 0) || size == NULL)
+        return PE1_ERR_ARGUMENT;
+    if ((status = pe1ValidateCompressed(in, len, errorOffset)) != PE1_OK)
+        return status;
+    *size = expandedSize(in, len);
+    return (*size == (size_t)-1) ? PE1_ERR_OVERFLOW : PE1_OK;
+}
+
+Pe1Status pe1Expand(const char *in, size_t len, char *out, size_t cap,
+                    size_t *outLen, size_t *errorOffset)
+{
+    Pe1Status status;
+    size_t n;
+
+    if ((out == NULL && cap > 0) || outLen == NULL)
+        return PE1_ERR_ARGUMENT;
+    if ((status = pe1ExpandedSize(in, len, &n, errorOffset)) != PE1_OK)
+        return status;
+    *outLen = n;
+    if (n > cap)
+        return PE1_ERR_BUFFER_TOO_SMALL;
+    expandRange(in, len, out);
+    return PE1_OK;
+}
+
+/* ============================================================
+ * Function: pe1Evaluate
+ * ============================================================ */
+Pe1Status pe1Evaluate(const char *expr, size_t len, long long *result, size_t *errorOffset)
+{
+    if ((expr == NULL && len > 0) || result == NULL)
+        return PE1_ERR_ARGUMENT;
+    return fromExprStatus(evaluateInfixInt64(expr, len, result, errorOffset));
+}
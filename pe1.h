@@ -0,0 +1,96 @@
+/*
+ * pe1.h
+ *
+ * Embeddable API (libpe1): validation, compression, expansion and
+ * evaluation for hot request paths. Every function takes its input
+ * as (pointer, length), needs no terminator, writes at most the
+ * capacity it is given, reports failures as a status code and
+ * never allocates, prints or consults the locale. Output is never
+ * NUL-terminated. All functions are safe to call from any number
+ * of threads at once.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef PE1_H
+#define PE1_H
+
+#include <stddef.h>
+
+/* Pending operators and open parentheses pe1Evaluate can hold */
+#define PE1_MAX_DEPTH 256
+
+typedef enum {
+    PE1_OK = 0,
+    PE1_ERR_ARGUMENT,           /* NULL pointer with a nonzero length or capacity */
+    PE1_ERR_EMPTY,              /* No content */
+    PE1_ERR_INVALID,            /* String / compressed string breaks the format */
+    PE1_ERR_INVALID_CHAR,       /* Expression: letter or other disallowed byte */
+    PE1_ERR_EXPECTED_OPERAND,   /* Expression: operator or ')' where an operand belongs */
+    PE1_ERR_EXPECTED_OPERATOR,  /* Expression: operand or '(' where an operator belongs */
+    PE1_ERR_UNMATCHED_CLOSE,    /* Expression: ')' without a matching '(' */
+    PE1_ERR_UNMATCHED_OPEN,     /* Expression: '(' never closed */
+    PE1_ERR_TOO_DEEP,           /* Expression: nesting beyond PE1_MAX_DEPTH */
+    PE1_ERR_OVERFLOW,           /* Value or expanded size does not fit in 64 bits */
+    PE1_ERR_BUFFER_TOO_SMALL    /* *outLen holds the capacity needed */
+} Pe1Status;
+
+/*
+ * Short description of a status ("buffer too small", ...); a
+ * static string.
+ */
+const char *pe1StatusMessage(Pe1Status status);
+
+/*
+ * Validation: PE1_OK, PE1_ERR_EMPTY or PE1_ERR_INVALID. On an error
+ * the byte offset where it was found is stored in *errorOffset, if
+ * not NULL (here and in every function below); an offset of len
+ * means the input ended too early. pe1Evaluate names expression
+ * errors more precisely.
+ *   pe1ValidateString      letters only
+ *   pe1ValidateCompressed  [count]letter runs: no leading zero, no
+ *                          count of 1, ends on a letter
+ *   pe1ValidateInfix       digits, + - * / %, parentheses, spaces
+ */
+Pe1Status pe1ValidateString(const char *in, size_t len, size_t *errorOffset);
+Pe1Status pe1ValidateCompressed(const char *in, size_t len, size_t *errorOffset);
+Pe1Status pe1ValidateInfix(const char *expr, size_t len, size_t *errorOffset);
+
+/*
+ * Validates and compresses ("aaabbc" -> "3a2bc") into out. The
+ * result is never longer than the input: with cap >= len this is
+ * one pass of the SIMD kernel. With a smaller cap the result is
+ * sized as it is written; if it does not fit, PE1_ERR_BUFFER_TOO_SMALL
+ * is returned with the capacity needed in *outLen and the contents
+ * of out are unspecified.
+ */
+Pe1Status pe1Compress(const char *in, size_t len, char *out, size_t cap,
+                      size_t *outLen, size_t *errorOffset);
+
+/*
+ * Validates a compressed string and stores its expanded length in
+ * *size (PE1_ERR_OVERFLOW if that does not fit in a size_t).
+ */
+Pe1Status pe1ExpandedSize(const char *in, size_t len, size_t *size, size_t *errorOffset);
+
+/*
+ * Validates and expands ("3a2bc" -> "aaabbc") into out. Nothing is
+ * written unless the whole result fits; otherwise
+ * PE1_ERR_BUFFER_TOO_SMALL is returned with the capacity needed in
+ * *outLen.
+ */
+Pe1Status pe1Expand(const char *in, size_t len, char *out, size_t cap,
+                    size_t *outLen, size_t *errorOffset);
+
+/*
+ * Validates and evaluates an infix expression in one pass, with
+ * the program's rules (integer division truncates, division or
+ * modulo by zero gives 0). Values are 64-bit: a literal or step
+ * beyond that is PE1_ERR_OVERFLOW.
+ */
+Pe1Status pe1Evaluate(const char *expr, size_t len, long long *result, size_t *errorOffset);
+
+#endif
@@ -0,0 +1,325 @@
+/*
+ * phase_stats.c
+ *
+ * Per-phase instrumentation. Every thread records into its own
+ * block of counters, so recording takes no lock and shares no cache
+ * line; a report adds up the blocks of all threads. A block outlives
+ * its thread: when the thread exits the block is handed to the next
+ * new thread, which keeps adding to it, so no totals are lost and
+ * short-lived pools do not leak.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "arena.h"
+#include "phase_stats.h"
+
+/* Counters of one phase in one thread */
+typedef struct {
+    uint64_t calls;
+    uint64_t ns;
+    uint64_t maxNs;
+    uint64_t bytesIn;
+    uint64_t bytesOut;
+    uint64_t buckets[STATS_BUCKETS];
+} PhaseCounters;
+
+/* Counters of one thread (or of several threads, one after another) */
+typedef struct StatsBlock {
+    struct StatsBlock *next;
+    int inUse;      /* Guarded by blocksLock */
+    PhaseCounters phases[STATS_PHASE_COUNT];
+    uint64_t counters[STATS_COUNTER_COUNT];
+} StatsBlock;
+
+static const char *const PHASE_NAMES[STATS_PHASE_COUNT] = {
+    "validate_infix", "to_postfix", "eval_postfix", "eval_infix", "eval_cached",
+    "validate_string", "validate_compressed", "compress", "expand",
+    "read", "write"
+};
+
+static const char *const COUNTER_NAMES[STATS_COUNTER_COUNT] = {
+    "cache_hits", "cache_misses"
+};
+
+volatile sig_atomic_t statsEnabled = 0;
+
+static volatile sig_atomic_t reportRequested = 0;
+
+static StatsBlock *allBlocks = NULL;
+static pthread_mutex_t blocksLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t blockKey;
+static pthread_once_t blockKeyOnce = PTHREAD_ONCE_INIT;
+static PE1_THREAD_LOCAL StatsBlock *threadBlock = NULL;
+
+/*
+ * Counters are written only by their owning thread but read by
+ * statsReport from another, so both sides use relaxed atomics (plain
+ * loads and stores on 64-bit targets).
+ */
+#define BUMP(field, n) __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+#define LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+/* ============================================================
+ * Helpers: releaseBlock / createBlockKey / threadCounters
+ * ============================================================ */
+static void releaseBlock(void *block)
+{
+    pthread_mutex_lock(&blocksLock);
+    ((StatsBlock *)block)->inUse = 0;
+    pthread_mutex_unlock(&blocksLock);
+}
+
+static void createBlockKey(void)
+{
+    pthread_key_create(&blockKey, releaseBlock);
+}
+
+/* The calling thread's block, claimed on first use; NULL if out of memory */
+static StatsBlock *threadCounters(void)
+{
+    StatsBlock *b;
+
+    if (threadBlock != NULL)
+        return threadBlock;
+
+    pthread_once(&blockKeyOnce, createBlockKey);
+    pthread_mutex_lock(&blocksLock);
+    for (b = allBlocks; b != NULL && b->inUse; b = b->next)
+        ;
+    if (b == NULL && (b = calloc(1, sizeof(StatsBlock))) != NULL) {
+        b->next = allBlocks;
+        allBlocks = b;
+    }
+    if (b != NULL)
+        b->inUse = 1;
+    pthread_mutex_unlock(&blocksLock);
+
+    if (b != NULL)
+        pthread_setspecific(blockKey, b);
+    threadBlock = b;
+    return b;
+}
+
+/* ============================================================
+ * Function: statsNow
+ * ============================================================ */
+uint64_t statsNow(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec + 1;
+}
+
+/* ============================================================
+ * Function: statsRecord
+ * ============================================================ */
+void statsRecord(StatsPhase phase, uint64_t start, size_t in, size_t out)
+{
+    StatsBlock *b = threadCounters();
+    uint64_t ns = statsNow() - start;
+    PhaseCounters *c;
+    int bucket;
+
+    if (b == NULL || (unsigned)phase >= STATS_PHASE_COUNT)
+        return;
+    c = &b->phases[phase];
+    bucket = (ns > 1) ? 63 - __builtin_clzll(ns) : 0;
+    if (bucket >= STATS_BUCKETS)
+        bucket = STATS_BUCKETS - 1;
+
+    BUMP(c->calls, 1);
+    BUMP(c->ns, ns);
+    BUMP(c->bytesIn, in);
+    BUMP(c->bytesOut, out);
+    BUMP(c->buckets[bucket], 1);
+    if (ns > c->maxNs)
+        __atomic_store_n(&c->maxNs, ns, __ATOMIC_RELAXED);
+}
+
+/* ============================================================
+ * Function: statsAdd
+ * ============================================================ */
+void statsAdd(StatsCounter counter, uint64_t n)
+{
+    StatsBlock *b = threadCounters();
+
+    if (b != NULL && (unsigned)counter < STATS_COUNTER_COUNT)
+        BUMP(b->counters[counter], n);
+}
+
+/* ============================================================
+ * Function: statsEnable / statsPhaseName
+ * ============================================================ */
+void statsEnable(int on)
+{
+    statsEnabled = on != 0;
+}
+
+const char *statsPhaseName(StatsPhase phase)
+{
+    return ((unsigned)phase < STATS_PHASE_COUNT) ? PHASE_NAMES[phase] : "unknown";
+}
+
+/* ============================================================
+ * Helper: formatNs
+ * "850ns", "12.3us", "4.1ms", "2.0s"
+ * ============================================================ */
+static const char *formatNs(double ns, char *buf, size_t size)
+{
+    if (ns < 1e3)
+        snprintf(buf, size, "%.0fns", ns);
+    else if (ns < 1e6)
+        snprintf(buf, size, "%.1fus", ns / 1e3);
+    else if (ns < 1e9)
+        snprintf(buf, size, "%.1fms", ns / 1e6);
+    else
+        snprintf(buf, size, "%.1fs", ns / 1e9);
+    return buf;
+}
+
+/* ============================================================
+ * Helper: percentile
+ * Upper end of the bucket holding the q-th fraction of the calls.
+ * ============================================================ */
+static double percentile(const PhaseCounters *c, double q)
+{
+    uint64_t want = (uint64_t)((double)c->calls * q), seen = 0;
+    int b;
+
+    for (b = 0; b < STATS_BUCKETS - 1; b++) {
+        seen += c->buckets[b];
+        if (seen > want)
+            break;
+    }
+    if (b == STATS_BUCKETS - 1 || ((uint64_t)2 << b) > c->maxNs)
+        return (double)c->maxNs;
+    return (double)((uint64_t)2 << b);
+}
+
+/* ============================================================
+ * Function: statsReport
+ * ============================================================ */
+void statsReport(FILE *out)
+{
+    PhaseCounters totals[STATS_PHASE_COUNT];
+    uint64_t counters[STATS_COUNTER_COUNT];
+    const StatsBlock *blk;
+    uint64_t lookups;
+    int p, b;
+
+    memset(totals, 0, sizeof(totals));
+    memset(counters, 0, sizeof(counters));
+    pthread_mutex_lock(&blocksLock);
+    for (blk = allBlocks; blk != NULL; blk = blk->next) {
+        for (p = 0; p < STATS_PHASE_COUNT; p++) {
+            const PhaseCounters *c = &blk->phases[p];
+            PhaseCounters *t = &totals[p];
+            uint64_t maxNs = LOAD(c->maxNs);
+
+            t->calls += LOAD(c->calls);
+            t->ns += LOAD(c->ns);
+            t->bytesIn += LOAD(c->bytesIn);
+            t->bytesOut += LOAD(c->bytesOut);
+            if (maxNs > t->maxNs)
+                t->maxNs = maxNs;
+            for (b = 0; b < STATS_BUCKETS; b++)
+                t->buckets[b] += LOAD(c->buckets[b]);
+        }
+        for (p = 0; p < STATS_COUNTER_COUNT; p++)
+            counters[p] += LOAD(blk->counters[p]);
+    }
+    pthread_mutex_unlock(&blocksLock);
+
+    fprintf(out, "%-20s %10s %10s %9s %9s %9s %9s %14s %14s %7s\n", "phase", "calls",
+            "total ms", "avg", "p50", "p99", "max", "bytes in", "bytes out", "ratio");
+    for (p = 0; p < STATS_PHASE_COUNT; p++) {
+        const PhaseCounters *t = &totals[p];
+        char avg[16], p50[16], p99[16], max[16], ratio[16] = "-";
+
+        if (t->calls == 0)
+            continue;
+        if (t->bytesIn > 0 && t->bytesOut > 0)
+            snprintf(ratio, sizeof(ratio), "%.3f", (double)t->bytesOut / (double)t->bytesIn);
+        fprintf(out, "%-20s %10llu %10.2f %9s %9s %9s %9s %14llu %14llu %7s\n",
+                PHASE_NAMES[p], (unsigned long long)t->calls, (double)t->ns / 1e6,
+                formatNs((double)t->ns / (double)t->calls, avg, sizeof(avg)),
+                formatNs(percentile(t, 0.50), p50, sizeof(p50)),
+                formatNs(percentile(t, 0.99), p99, sizeof(p99)),
+                formatNs((double)t->maxNs, max, sizeof(max)),
+                (unsigned long long)t->bytesIn, (unsigned long long)t->bytesOut, ratio);
+    }
+
+    /* Histograms: calls per latency bucket, empty buckets left out */
+    for (p = 0; p < STATS_PHASE_COUNT; p++) {
+        const PhaseCounters *t = &totals[p];
+        char upper[16];
+
+        if (t->calls == 0)
+            continue;
+        fprintf(out, "%-20s", PHASE_NAMES[p]);
+        for (b = 0; b < STATS_BUCKETS; b++) {
+            if (t->buckets[b] == 0)
+                continue;
+            if (b == STATS_BUCKETS - 1)
+                fprintf(out, " >=%s:%llu", formatNs((double)((uint64_t)1 << b), upper, sizeof(upper)),
+                        (unsigned long long)t->buckets[b]);
+            else
+                fprintf(out, " <%s:%llu", formatNs((double)((uint64_t)2 << b), upper, sizeof(upper)),
+                        (unsigned long long)t->buckets[b]);
+        }
+        fputc('\n', out);
+    }
+
+    /* Event counters, and the hit rate they give */
+    for (p = 0; p < STATS_COUNTER_COUNT; p++) {
+        if (counters[p] > 0)
+            fprintf(out, "%-20s %10llu\n", COUNTER_NAMES[p], (unsigned long long)counters[p]);
+    }
+    lookups = counters[STATS_CACHE_HITS] + counters[STATS_CACHE_MISSES];
+    if (lookups > 0)
+        fprintf(out, "%-20s %9.2f%%\n", "cache_hit_rate",
+                100.0 * (double)counters[STATS_CACHE_HITS] / (double)lookups);
+    fflush(out);
+}
+
+/* ============================================================
+ * Functions: statsInstallSignal / statsPoll
+ * The handler only sets flags; the report itself is written by
+ * statsPoll from normal code, where stdio is safe to use.
+ * ============================================================ */
+static void onReportSignal(int sig)
+{
+    (void)sig;
+    if (statsEnabled)
+        reportRequested = 1;
+    else
+        statsEnabled = 1;
+}
+
+int statsInstallSignal(void)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onReportSignal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    return sigaction(SIGUSR1, &sa, NULL) == 0 ? 0 : -1;
+}
+
+void statsPoll(FILE *out)
+{
+    if (reportRequested) {
+        reportRequested = 0;
+        statsReport(out);
+    }
+}
@@ -0,0 +1,108 @@
+/*
+ * phase_stats.h
+ *
+ * Header file for the per-phase instrumentation: call counts, time,
+ * latency histograms and bytes in/out of validation, conversion,
+ * evaluation and batch I/O.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef PHASE_STATS_H
+#define PHASE_STATS_H
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* What a recorded call was doing */
+typedef enum {
+    STATS_VALIDATE_INFIX,       /* isValidInfix */
+    STATS_TO_POSTFIX,           /* infixToPostfix */
+    STATS_EVAL_POSTFIX,         /* evaluatePostfix */
+    STATS_EVAL_INFIX,           /* evaluateInfix / evaluateInfixRange (fused), server evals */
+    STATS_EVAL_CACHED,          /* exprCacheEvaluate: hits, and misses it compiles */
+    STATS_VALIDATE_STRING,      /* isValidString / isValidStringRange */
+    STATS_VALIDATE_COMPRESSED,  /* isValidCompressedString / ...Range */
+    STATS_COMPRESS,             /* compressString / compressRange */
+    STATS_EXPAND,               /* expandString / expandRange / expandStreamFeed */
+    STATS_READ,                 /* Batch and server input reads */
+    STATS_WRITE,                /* Batch and server output writes */
+    STATS_PHASE_COUNT
+} StatsPhase;
+
+/* Events that are only counted, not timed */
+typedef enum {
+    STATS_CACHE_HITS,           /* exprCacheEvaluate found the expression */
+    STATS_CACHE_MISSES,         /* ... and had to compile it */
+    STATS_COUNTER_COUNT
+} StatsCounter;
+
+/* Latency bucket b counts calls of 2^b .. 2^(b+1) - 1 ns; the last one has no upper end */
+#define STATS_BUCKETS 32
+
+/* Nonzero while calls are being recorded (off by default) */
+extern volatile sig_atomic_t statsEnabled;
+
+/*
+ * Wrap a call as
+ *   uint64_t t = STATS_START();
+ *   ...
+ *   STATS_STOP(STATS_COMPRESS, t, inBytes, outBytes);
+ * and count an event with STATS_COUNT(STATS_CACHE_HITS, 1).
+ * When recording is off this costs one load and a branch, and the
+ * byte arguments are not evaluated. Building with -DPE1_NO_STATS
+ * removes it altogether.
+ */
+#ifndef PE1_NO_STATS
+#define STATS_START() (statsEnabled ? statsNow() : 0)
+#define STATS_STOP(phase, start, in, out) \
+    do { if (start) statsRecord((phase), (start), (in), (out)); } while (0)
+#define STATS_COUNT(counter, n) \
+    do { if (statsEnabled) statsAdd((counter), (n)); } while (0)
+#else
+#define STATS_START() ((uint64_t)0)
+#define STATS_STOP(phase, start, in, out) ((void)sizeof((start) + (in) + (out)))
+#define STATS_COUNT(counter, n) ((void)sizeof(n))
+#endif
+
+/* Monotonic clock in nanoseconds (never 0) */
+uint64_t statsNow(void);
+
+/*
+ * Adds one call of 'phase' that began at 'start' (statsNow) to the
+ * calling thread's counters. Safe from any thread.
+ */
+void statsRecord(StatsPhase phase, uint64_t start, size_t in, size_t out);
+
+/* Adds n to one of the calling thread's event counters */
+void statsAdd(StatsCounter counter, uint64_t n);
+
+/* Turns recording on or off; the totals are kept either way */
+void statsEnable(int on);
+
+/* Short name of a phase ("compress", "eval_infix", ...) */
+const char *statsPhaseName(StatsPhase phase);
+
+/*
+ * Writes the totals of every thread so far: per phase, calls, time,
+ * latency percentiles and histogram, bytes in/out and their ratio;
+ * then the event counters (cache hits, misses and hit rate).
+ */
+void statsReport(FILE *out);
+
+/*
+ * Makes SIGUSR1 ask for a report: the first signal turns recording
+ * on if it was off, later ones make the next statsPoll write one.
+ * Returns 0 on success, -1 if the handler could not be installed.
+ */
+int statsInstallSignal(void);
+
+/* Writes a report to 'out' if SIGUSR1 asked for one since the last poll */
+void statsPoll(FILE *out);
+
+#endif
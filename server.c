@@ -0,0 +1,637 @@
+/*
+ * server.c
+ *
+ * Local server mode. One thread runs an epoll loop over a listening
+ * Unix domain socket and its connections. Each connection has an
+ * input and an output buffer: whatever the socket delivers is
+ * appended to the input, every complete request in it is answered
+ * into the output in order, and the output is sent as far as the
+ * socket takes it. Requests are answered by the same kernels as
+ * batch mode, straight from and into the connection buffers, so a
+ * small request costs a read, a kernel call and a send. The loop
+ * needs epoll, so everything but the header helpers is Linux only;
+ * elsewhere runServer fails with ENOSYS.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <errno.h>
+#include "server.h"
+
+/* ============================================================
+ * Functions: serverPutHeader / serverPayloadLength
+ * ============================================================ */
+void serverPutHeader(unsigned char *header, int code, size_t len)
+{
+    header[0] = (unsigned char)code;
+    header[1] = (unsigned char)len;
+    header[2] = (unsigned char)(len >> 8);
+    header[3] = (unsigned char)(len >> 16);
+    header[4] = (unsigned char)(len >> 24);
+}
+
+size_t serverPayloadLength(const unsigned char *header)
+{
+    return (size_t)header[1] | ((size_t)header[2] << 8) |
+           ((size_t)header[3] << 16) | ((size_t)header[4] << 24);
+}
+
+#if defined(__linux__)
+
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "expression.h"
+#include "phase_stats.h"
+#include "string_ops.h"
+
+/* Bytes asked of each read */
+#define SERVER_READ_SIZE (64 * 1024)
+
+/* Buffers larger than this are given back once empty */
+#define SERVER_KEEP_BUFFER (4 * SERVER_OUTPUT_LIMIT)
+
+/* Events taken per epoll_pwait */
+#define SERVER_MAX_EVENTS 64
+
+/* While out of descriptors, accepting is retried this often (ms) */
+#define SERVER_RETRY_MS 100
+
+/* Bytes [start, len) of data are pending */
+typedef struct {
+    char *data;
+    size_t start;
+    size_t len;
+    size_t cap;
+} ConnBuffer;
+
+typedef struct Connection {
+    struct Connection *prev, *next;
+    int fd;
+    uint32_t events;    /* Interest registered with epoll */
+    int eof;            /* Client sent everything; close once answered */
+    int closing;        /* Bad request: answer nothing more, close once sent */
+    ConnBuffer in;
+    ConnBuffer out;
+} Connection;
+
+typedef struct {
+    int epollFd;
+    int listenFd;
+    int paused;         /* Out of descriptors: not accepting for now */
+    Connection *connections;
+    ExprValue value;    /* Results beyond 64 bits */
+} Server;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+/* ============================================================
+ * Helpers: reserveBuffer / resetBuffer
+ * reserveBuffer makes room for 'extra' more bytes after len,
+ * first moving the pending bytes to the front. Returns 0 if
+ * out of memory.
+ * ============================================================ */
+static int reserveBuffer(ConnBuffer *b, size_t extra)
+{
+    if (b->start > 0) {
+        memmove(b->data, b->data + b->start, b->len - b->start);
+        b->len -= b->start;
+        b->start = 0;
+    }
+    if (b->cap - b->len < extra) {
+        size_t cap = b->cap ? b->cap : SERVER_READ_SIZE;
+        char *grown;
+
+        while (cap - b->len < extra)
+            cap *= 2;
+        grown = realloc(b->data, cap);
+        if (grown == NULL)
+            return 0;
+        b->data = grown;
+        b->cap = cap;
+    }
+    return 1;
+}
+
+/* Empties a buffer, giving back what a very large message grew it to */
+static void resetBuffer(ConnBuffer *b)
+{
+    b->start = 0;
+    b->len = 0;
+    if (b->cap > SERVER_KEEP_BUFFER) {
+        free(b->data);
+        b->data = NULL;
+        b->cap = 0;
+    }
+}
+
+/* ============================================================
+ * Helpers: respond / respondError
+ * Append a whole response to the output.
+ * ============================================================ */
+static int respond(ConnBuffer *out, int status, const char *payload, size_t len)
+{
+    if (!reserveBuffer(out, SERVER_HEADER_SIZE + len))
+        return 0;
+    serverPutHeader((unsigned char *)out->data + out->len, status, len);
+    memcpy(out->data + out->len + SERVER_HEADER_SIZE, payload, len);
+    out->len += SERVER_HEADER_SIZE + len;
+    return 1;
+}
+
+static int respondError(ConnBuffer *out, int status, const char *message, size_t offset)
+{
+    char text[96];
+    int n = snprintf(text, sizeof(text), "%s at offset %zu", message, offset);
+
+    return respond(out, status, text, (size_t)n);
+}
+
+/* ============================================================
+ * Helper: evaluateRequest
+ * 64-bit values take the fixed-stack evaluator, which reads
+ * exactly len bytes. A result beyond 64 bits or a deeper nesting
+ * is evaluated again exactly; that evaluator stops at the first
+ * non-digit after a literal, so the byte after the payload (in
+ * the input buffer, which always has one spare byte) is set to a
+ * terminator for the call.
+ * ============================================================ */
+static int evaluateRequest(Server *s, char *expr, size_t len, ConnBuffer *out)
+{
+    ExprStatus status;
+    long long value;
+    size_t offset;
+    char text[24];
+    char saved;
+    int exactOffset;
+    uint64_t t = STATS_START();
+
+    status = evaluateInfixInt64(expr, len, &value, &offset);
+    STATS_STOP(STATS_EVAL_INFIX, t, len, 0);
+    if (status == EXPR_OK)
+        return respond(out, SERVER_OK, text, (size_t)sprintf(text, "%lld", value));
+    if (status != EXPR_ERR_OVERFLOW && status != EXPR_ERR_TOO_DEEP)
+        return respondError(out, SERVER_ERR_INVALID, exprStatusMessage(status), offset);
+
+    saved = expr[len];
+    expr[len] = '\0';
+    status = evaluateInfixRange(expr, len, &s->value, &exactOffset);
+    expr[len] = saved;
+
+    if (status == EXPR_OK && !s->value.isBig)
+        return respond(out, SERVER_OK, text, (size_t)sprintf(text, "%lld", s->value.small));
+    if (status == EXPR_OK) {
+        size_t size = exprValueTextSize(&s->value), n;
+
+        if (!reserveBuffer(out, SERVER_HEADER_SIZE + size))
+            return 0;
+        n = exprValueToText(&s->value, out->data + out->len + SERVER_HEADER_SIZE);
+        if (n == 0)
+            return respond(out, SERVER_ERR_NO_MEMORY, "out of memory", 13);
+        serverPutHeader((unsigned char *)out->data + out->len, SERVER_OK, n);
+        out->len += SERVER_HEADER_SIZE + n;
+        return 1;
+    }
+    return respondError(out, (status == EXPR_ERR_NO_MEMORY) ? SERVER_ERR_NO_MEMORY : SERVER_ERR_INVALID,
+                        exprStatusMessage(status), (size_t)exactOffset);
+}
+
+/* ============================================================
+ * Helpers: compressRequest / expandRequest
+ * The result is written in place after its header.
+ * ============================================================ */
+static int compressRequest(const char *in, size_t len, ConnBuffer *out)
+{
+    size_t offset = checkString(in, len), n;
+
+    if (offset != CHECK_VALID)
+        return respondError(out, SERVER_ERR_INVALID, "invalid string", offset);
+    /* Compressed form is never longer than the input */
+    if (!reserveBuffer(out, SERVER_HEADER_SIZE + len))
+        return 0;
+    n = compressRange(in, len, out->data + out->len + SERVER_HEADER_SIZE);
+    serverPutHeader((unsigned char *)out->data + out->len, SERVER_OK, n);
+    out->len += SERVER_HEADER_SIZE + n;
+    return 1;
+}
+
+static int expandRequest(const char *in, size_t len, ConnBuffer *out)
+{
+    size_t offset = checkCompressed(in, len), n;
+
+    if (offset != CHECK_VALID)
+        return respondError(out, SERVER_ERR_INVALID, "invalid compressed string", offset);
+    n = expandedSize(in, len);
+    if (n == (size_t)-1 || n > SERVER_MAX_RESPONSE)
+        return respond(out, SERVER_ERR_TOO_LARGE, "expanded string too large", 25);
+    if (!reserveBuffer(out, SERVER_HEADER_SIZE + n))
+        return 0;
+    expandRange(in, len, out->data + out->len + SERVER_HEADER_SIZE);
+    serverPutHeader((unsigned char *)out->data + out->len, SERVER_OK, n);
+    out->len += SERVER_HEADER_SIZE + n;
+    return 1;
+}
+
+/* ============================================================
+ * Helper: processInput
+ * Answers the complete requests in the input buffer, in order,
+ * until the pending output reaches SERVER_OUTPUT_LIMIT. A bad
+ * request is answered and marks the connection for closing.
+ * Returns 1 if requests may be left for later, 0 if none are,
+ * -1 if out of memory.
+ * ============================================================ */
+static int processInput(Server *s, Connection *c)
+{
+    ConnBuffer *in = &c->in;
+    int ok = 1;
+
+    while (ok && !c->closing) {
+        unsigned char *header = (unsigned char *)in->data + in->start;
+        size_t avail = in->len - in->start, len;
+
+        if (c->out.len - c->out.start >= SERVER_OUTPUT_LIMIT)
+            return 1;
+        if (avail < SERVER_HEADER_SIZE)
+            break;
+        len = serverPayloadLength(header);
+        if (len > SERVER_MAX_REQUEST) {
+            ok = respond(&c->out, SERVER_ERR_BAD_REQUEST, "request too large", 17);
+            c->closing = 1;
+            break;
+        }
+        if (avail - SERVER_HEADER_SIZE < len) {
+            /* Room for the rest of it (and the spare byte) */
+            ok = reserveBuffer(in, SERVER_HEADER_SIZE + len - avail + 1);
+            break;
+        }
+
+        switch (header[0]) {
+            case SERVER_EVAL:
+                ok = evaluateRequest(s, (char *)header + SERVER_HEADER_SIZE, len, &c->out);
+                break;
+            case SERVER_COMPRESS:
+                ok = compressRequest((char *)header + SERVER_HEADER_SIZE, len, &c->out);
+                break;
+            case SERVER_EXPAND:
+                ok = expandRequest((char *)header + SERVER_HEADER_SIZE, len, &c->out);
+                break;
+            default:
+                ok = respond(&c->out, SERVER_ERR_BAD_REQUEST, "unknown operation", 17);
+                c->closing = 1;
+                break;
+        }
+        in->start += SERVER_HEADER_SIZE + len;
+    }
+
+    if (in->start == in->len)
+        resetBuffer(in);
+    return ok ? 0 : -1;
+}
+
+/* ============================================================
+ * Helpers: readInput / writeOutput
+ * readInput returns 1 at end of input, 0 otherwise, -1 on an
+ * error. writeOutput returns 0 once the socket takes no more (or
+ * everything is sent), -1 on an error.
+ * ============================================================ */
+static int readInput(Connection *c)
+{
+    ConnBuffer *in = &c->in;
+    uint64_t t;
+    ssize_t got;
+
+    /* One byte always stays spare after the input (evaluateRequest) */
+    if (!reserveBuffer(in, SERVER_READ_SIZE + 1))
+        return -1;
+    do {
+        t = STATS_START();
+        got = read(c->fd, in->data + in->len, in->cap - in->len - 1);
+    } while (got < 0 && errno == EINTR);
+
+    if (got > 0) {
+        STATS_STOP(STATS_READ, t, (size_t)got, 0);
+        in->len += (size_t)got;
+        return 0;
+    }
+    if (got == 0)
+        return 1;
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+}
+
+static int writeOutput(Connection *c)
+{
+    ConnBuffer *out = &c->out;
+
+    while (out->start < out->len) {
+        uint64_t t = STATS_START();
+        ssize_t sent = send(c->fd, out->data + out->start, out->len - out->start, MSG_NOSIGNAL);
+
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+        }
+        STATS_STOP(STATS_WRITE, t, 0, (size_t)sent);
+        out->start += (size_t)sent;
+    }
+    resetBuffer(out);
+    return 0;
+}
+
+/* ============================================================
+ * Helper: setAccepting
+ * Watches the listening socket again, or stops watching it while
+ * no descriptor is left for a new connection (it would otherwise
+ * stay readable and wake the loop at once, again and again).
+ * Pending clients wait in the listen backlog meanwhile.
+ * ============================================================ */
+static void setAccepting(Server *s, int on)
+{
+    struct epoll_event ev;
+
+    ev.events = on ? EPOLLIN : 0;
+    ev.data.ptr = NULL;     /* The listening socket */
+    if (epoll_ctl(s->epollFd, EPOLL_CTL_MOD, s->listenFd, &ev) == 0)
+        s->paused = !on;
+}
+
+/* ============================================================
+ * Helpers: openConnection / closeConnection
+ * Closing a connection frees a descriptor, so a paused listener
+ * is resumed.
+ * ============================================================ */
+static void openConnection(Server *s, int fd)
+{
+    Connection *c = calloc(1, sizeof(Connection));
+    struct epoll_event ev;
+
+    if (c == NULL) {
+        close(fd);
+        return;
+    }
+    c->fd = fd;
+    c->events = EPOLLIN;
+    ev.events = c->events;
+    ev.data.ptr = c;
+    if (epoll_ctl(s->epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        close(fd);
+        free(c);
+        return;
+    }
+    c->next = s->connections;
+    if (c->next != NULL)
+        c->next->prev = c;
+    s->connections = c;
+}
+
+static void closeConnection(Server *s, Connection *c)
+{
+    if (c->prev != NULL)
+        c->prev->next = c->next;
+    else
+        s->connections = c->next;
+    if (c->next != NULL)
+        c->next->prev = c->prev;
+    close(c->fd);   /* Also removes it from the epoll set */
+    free(c->in.data);
+    free(c->out.data);
+    free(c);
+    if (s->paused)
+        setAccepting(s, 1);
+}
+
+/* ============================================================
+ * Helper: serviceConnection
+ * Reads (if the socket is readable), answers and sends until no
+ * more progress can be made, then asks epoll for what the
+ * connection waits on next: new input while its output is below
+ * the limit, writability while output is pending.
+ * ============================================================ */
+static void serviceConnection(Server *s, Connection *c, uint32_t events)
+{
+    struct epoll_event ev;
+    uint32_t want;
+    int more;
+
+    if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+        int r = readInput(c);
+
+        if (r < 0) {
+            closeConnection(s, c);
+            return;
+        }
+        /* Requests already received are still answered */
+        if (r > 0)
+            c->eof = 1;
+    }
+
+    do {
+        more = processInput(s, c);
+        if (more < 0 || writeOutput(c) != 0) {
+            closeConnection(s, c);
+            return;
+        }
+    } while (more && c->out.len - c->out.start < SERVER_OUTPUT_LIMIT);
+
+    /* Leaving the loop with requests left means output is pending */
+    if ((c->eof || c->closing) && c->out.start == c->out.len) {
+        closeConnection(s, c);
+        return;
+    }
+
+    want = 0;
+    if (!c->eof && !c->closing && c->out.len - c->out.start < SERVER_OUTPUT_LIMIT)
+        want |= EPOLLIN;
+    if (c->out.start < c->out.len)
+        want |= EPOLLOUT;
+    if (want != c->events) {
+        c->events = want;
+        ev.events = want;
+        ev.data.ptr = c;
+        if (epoll_ctl(s->epollFd, EPOLL_CTL_MOD, c->fd, &ev) != 0)
+            closeConnection(s, c);
+    }
+}
+
+/* ============================================================
+ * Helper: listenOn
+ * A socket file that nothing answers on is left over from an
+ * earlier server and is replaced; a live server or any other kind
+ * of file is refused with EADDRINUSE.
+ * ============================================================ */
+static int listenOn(const char *path)
+{
+    struct sockaddr_un addr;
+    struct stat st;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int live = probe >= 0 && connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0;
+
+        if (probe >= 0)
+            close(probe);
+        if (live) {
+            errno = EADDRINUSE;
+            return -1;
+        }
+        unlink(path);
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0) {
+        int saved = errno;
+
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+/* ============================================================
+ * Helper: acceptAll
+ * Accepts until none are pending. Out of descriptors (EMFILE,
+ * ENFILE) or memory, the listener is paused until a connection
+ * closes or SERVER_RETRY_MS passes.
+ * ============================================================ */
+static void acceptAll(Server *s)
+{
+    for (;;) {
+        int fd = accept(s->listenFd, NULL, NULL);
+
+        if (fd >= 0) {
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+            fcntl(fd, F_SETFL, O_NONBLOCK);
+            openConnection(s, fd);
+        } else if (errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) {
+            setAccepting(s, 0);
+            return;
+        } else if (errno != EINTR && errno != ECONNABORTED) {
+            /* EAGAIN: none left */
+            return;
+        }
+    }
+}
+
+/* Only runs inside epoll_pwait, the one place the signals are unblocked */
+static void onStopSignal(int sig)
+{
+    (void)sig;
+    stopRequested = 1;
+}
+
+/* ============================================================
+ * Function: runServer
+ * ============================================================ */
+int runServer(const char *path)
+{
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    struct epoll_event ev;
+    struct sigaction sa, oldInt, oldTerm;
+    sigset_t stopSignals, oldMask, waitMask;
+    Server s;
+    int i, n;
+
+    s.listenFd = listenOn(path);
+    if (s.listenFd < 0)
+        return -1;
+    s.epollFd = epoll_create1(EPOLL_CLOEXEC);
+    s.paused = 0;
+    s.connections = NULL;
+    initExprValue(&s.value);
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;     /* The listening socket */
+    if (s.epollFd < 0 || epoll_ctl(s.epollFd, EPOLL_CTL_ADD, s.listenFd, &ev) != 0) {
+        int saved = errno;
+
+        if (s.epollFd >= 0)
+            close(s.epollFd);
+        close(s.listenFd);
+        unlink(path);
+        errno = saved;
+        return -1;
+    }
+
+    /*
+     * SIGINT and SIGTERM stay blocked except inside epoll_pwait, so
+     * a signal arriving between the stopRequested check and the wait
+     * is held until the wait starts, and then ends it.
+     */
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &stopSignals, &oldMask);
+    waitMask = oldMask;
+    sigdelset(&waitMask, SIGINT);
+    sigdelset(&waitMask, SIGTERM);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = onStopSignal;
+    sigemptyset(&sa.sa_mask);
+    stopRequested = 0;
+    sigaction(SIGINT, &sa, &oldInt);
+    sigaction(SIGTERM, &sa, &oldTerm);
+
+    while (!stopRequested) {
+        n = epoll_pwait(s.epollFd, events, SERVER_MAX_EVENTS, s.paused ? SERVER_RETRY_MS : -1,
+                        &waitMask);
+        statsPoll(stderr);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (n == 0 && s.paused)
+            setAccepting(&s, 1);
+        for (i = 0; i < n; i++) {
+            if (events[i].data.ptr == NULL)
+                acceptAll(&s);
+            else
+                serviceConnection(&s, events[i].data.ptr, events[i].events);
+        }
+    }
+
+    while (s.connections != NULL)
+        closeConnection(&s, s.connections);
+    freeExprValue(&s.value);
+    close(s.epollFd);
+    close(s.listenFd);
+    unlink(path);
+    sigaction(SIGINT, &oldInt, NULL);
+    sigaction(SIGTERM, &oldTerm, NULL);
+    sigprocmask(SIG_SETMASK, &oldMask, NULL);
+    return 0;
+}
+
+#else
+
+int runServer(const char *path)
+{
+    (void)path;
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,82 @@
+/*
+ * server.h
+ *
+ * Header file for the local server mode: a long-running process
+ * that evaluates, compresses and expands requests sent over a Unix
+ * domain socket, so clients pay for a round trip instead of a
+ * process start per job.
+ *
+ * Protocol: every message is a 5-byte header followed by a payload.
+ *   request   [op: 1 byte]     [payload length: 4 bytes LE] [payload]
+ *   response  [status: 1 byte] [payload length: 4 bytes LE] [payload]
+ * A request payload is one record without a newline (an expression,
+ * a string or a compressed string). On SERVER_OK the response
+ * payload is the result (decimal value, compressed or expanded
+ * string); on an error it is a message such as
+ * "unmatched '(' at offset 3". A client may send any number of
+ * requests without waiting; responses come back in request order.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+
+/* Bytes in a request / response header */
+#define SERVER_HEADER_SIZE 5
+
+/* Largest request payload; a longer one closes the connection */
+#define SERVER_MAX_REQUEST (64u << 20)
+
+/* Largest response payload (expansions beyond it are refused) */
+#define SERVER_MAX_RESPONSE (256u << 20)
+
+/*
+ * Pending response bytes at which a connection stops reading new
+ * requests until the client has taken some of them.
+ */
+#define SERVER_OUTPUT_LIMIT (1 << 20)
+
+/* Request operations (header byte 0) */
+typedef enum {
+    SERVER_EVAL = 'E',
+    SERVER_COMPRESS = 'C',
+    SERVER_EXPAND = 'X'
+} ServerOp;
+
+/* Response status (header byte 0) */
+typedef enum {
+    SERVER_OK = 0,
+    SERVER_ERR_INVALID,     /* Record is not a valid expression / string */
+    SERVER_ERR_TOO_LARGE,   /* Result beyond SERVER_MAX_RESPONSE */
+    SERVER_ERR_NO_MEMORY,   /* Evaluation ran out of memory */
+    SERVER_ERR_BAD_REQUEST  /* Unknown op or oversized payload; connection closes */
+} ServerStatus;
+
+/*
+ * Encodes a header: the op or status byte and the payload length.
+ */
+void serverPutHeader(unsigned char *header, int code, size_t len);
+
+/*
+ * Payload length of an encoded header.
+ */
+size_t serverPayloadLength(const unsigned char *header);
+
+/*
+ * Listens on a Unix domain socket at 'path' (replacing a stale
+ * socket file there) and serves connections on one thread with an
+ * epoll loop until SIGINT or SIGTERM, then removes the socket file.
+ * While no file descriptor is left for a new connection, clients
+ * wait in the listen backlog until one closes. Returns 0 after a
+ * clean shutdown, -1 with errno set if the socket could not be set
+ * up (ENOSYS on systems other than Linux).
+ */
+int runServer(const char *path);
+
+#endif
@@ -0,0 +1,376 @@
+/*
+ * string_binary.c
+ *
+ * Implements the binary run-length format. Runs are found a word
+ * at a time when encoding; decoding reads a count with one compare
+ * in the common one-byte case and writes short runs with two fixed
+ * 8-byte stores instead of a memset call.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include "string_binary.h"
+#include "string_ops.h"
+
+/* Longest (count, byte) pair */
+#define BINARY_PAIR_MAX (BINARY_VARINT_MAX + 1)
+
+/* Block length + checksum */
+#define BINARY_BLOCK_HEADER 8
+
+/* Largest prime below 2^16, and the most bytes before Adler-32 sums overflow */
+#define ADLER_MOD 65521u
+#define ADLER_NMAX 5552
+
+/* Where the blocks being written stand */
+typedef struct {
+    unsigned char *out;     /* Next payload byte */
+    unsigned char *block;   /* Header of the open block */
+} BlockWriter;
+
+/* ============================================================
+ * Helpers: little-endian u32 / varints
+ * ============================================================ */
+static void putU32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static uint32_t getU32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static unsigned char *putVarint(unsigned char *p, size_t v)
+{
+    while (v >= 0x80) {
+        *p++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (unsigned char)v;
+    return p;
+}
+
+/*
+ * Reads a varint ending before end. Returns the byte after it, or
+ * NULL if it is cut off, longer than BINARY_VARINT_MAX bytes, does
+ * not fit a size_t or has a redundant zero last byte.
+ */
+static const unsigned char *getVarint(const unsigned char *p, const unsigned char *end, size_t *v)
+{
+    size_t value = 0;
+    unsigned shift = 0;
+
+    while (p < end && shift < sizeof(size_t) * 8) {
+        unsigned char b = *p++;
+        size_t bits = (size_t)(b & 0x7F);
+
+        if ((bits << shift) >> shift != bits)
+            return NULL;
+        value |= bits << shift;
+        if (b < 0x80) {
+            if (shift > 0 && b == 0)
+                return NULL;
+            *v = value;
+            return p;
+        }
+        shift += 7;
+    }
+    return NULL;
+}
+
+/* ============================================================
+ * Helper: adler32
+ * ============================================================ */
+static uint32_t adler32(const unsigned char *p, size_t len)
+{
+    uint32_t a = 1, b = 0;
+
+    while (len > 0) {
+        size_t n = (len < ADLER_NMAX) ? len : ADLER_NMAX;
+
+        len -= n;
+        while (n-- > 0) {
+            a += *p++;
+            b += a;
+        }
+        a %= ADLER_MOD;
+        b %= ADLER_MOD;
+    }
+    return b << 16 | a;
+}
+
+/* ============================================================
+ * Helpers: block writer
+ * ============================================================ */
+static void beginBlocks(BlockWriter *w, unsigned char *output, size_t total)
+{
+    unsigned char *p = output;
+
+    memcpy(p, BINARY_MAGIC, 4);
+    p[4] = BINARY_VERSION;
+    p = putVarint(p + 5, total);
+    w->block = p;
+    w->out = p + BINARY_BLOCK_HEADER;
+}
+
+static void closeBlock(BlockWriter *w)
+{
+    unsigned char *payload = w->block + BINARY_BLOCK_HEADER;
+    size_t n = (size_t)(w->out - payload);
+
+    if (n > 0) {
+        putU32(w->block, (uint32_t)n);
+        putU32(w->block + 4, adler32(payload, n));
+        w->block = w->out;
+        w->out += BINARY_BLOCK_HEADER;
+    }
+}
+
+static void putPair(BlockWriter *w, size_t count, unsigned char byte)
+{
+    if ((size_t)(w->out - w->block) - BINARY_BLOCK_HEADER > BINARY_BLOCK_SIZE - BINARY_PAIR_MAX)
+        closeBlock(w);
+    w->out = putVarint(w->out, count);
+    *w->out++ = byte;
+}
+
+/* Closes the last block and writes the end marker; returns the length */
+static size_t endBlocks(BlockWriter *w, unsigned char *output)
+{
+    closeBlock(w);
+    putU32(w->block, 0);
+    return (size_t)(w->block + 4 - output);
+}
+
+/* ============================================================
+ * Function: binaryEncodedBound
+ * Every pair takes at most 2 bytes per input byte, and every
+ * closed block holds more than half of BINARY_BLOCK_SIZE.
+ * ============================================================ */
+size_t binaryEncodedBound(size_t len)
+{
+    return 4 + 1 + BINARY_VARINT_MAX + 2 * len +
+           BINARY_BLOCK_HEADER * (len / (BINARY_BLOCK_SIZE / 4) + 1) + 4;
+}
+
+/* ============================================================
+ * Helper: runLength
+ * Length of the run starting at p, compared 8 bytes at a time.
+ * ============================================================ */
+static size_t runLength(const unsigned char *p, const unsigned char *end)
+{
+    const unsigned char *q = p + 1;
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t pattern = 0x0101010101010101ull * *p;
+
+    while (end - q >= 8) {
+        uint64_t w;
+
+        memcpy(&w, q, 8);
+        w ^= pattern;
+        if (w != 0)
+            return (size_t)(q - p) + (size_t)(__builtin_ctzll(w) >> 3);
+        q += 8;
+    }
+#endif
+    while (q < end && *q == *p)
+        q++;
+    return (size_t)(q - p);
+}
+
+/* ============================================================
+ * Function: binaryEncodeRange
+ * ============================================================ */
+size_t binaryEncodeRange(const char *input, size_t len, unsigned char *output)
+{
+    const unsigned char *p = (const unsigned char *)input, *end = p + len;
+    BlockWriter w;
+
+    beginBlocks(&w, output, len);
+    while (p < end) {
+        size_t n = runLength(p, end);
+
+        putPair(&w, n, *p);
+        p += n;
+    }
+    return endBlocks(&w, output);
+}
+
+/* ============================================================
+ * Helper: readHeader
+ * Returns the first block, or NULL if the header is not valid.
+ * ============================================================ */
+static const unsigned char *readHeader(const unsigned char *input, size_t len, size_t *total)
+{
+    if (input == NULL || len < 6 || memcmp(input, BINARY_MAGIC, 4) != 0 || input[4] != BINARY_VERSION)
+        return NULL;
+    return getVarint(input + 5, input + len, total);
+}
+
+/* ============================================================
+ * Helper: nextBlock
+ * Checks the block at *p and moves *p past it. Returns its
+ * payload with *payloadEnd set, or NULL at the end marker or on
+ * corrupt data (*p is set to NULL for the latter).
+ * ============================================================ */
+static const unsigned char *nextBlock(const unsigned char **p, const unsigned char *end,
+                                      const unsigned char **payloadEnd)
+{
+    const unsigned char *b = *p;
+    uint32_t n;
+
+    if (end - b < 4) {
+        *p = NULL;
+        return NULL;
+    }
+    n = getU32(b);
+    if (n == 0) {
+        *p = (end - b == 4) ? end : NULL;     /* Nothing may follow */
+        return NULL;
+    }
+    if (n > BINARY_BLOCK_SIZE || (size_t)(end - b) - 4 < (size_t)n + 4 ||
+        adler32(b + BINARY_BLOCK_HEADER, n) != getU32(b + 4)) {
+        *p = NULL;
+        return NULL;
+    }
+    *payloadEnd = b + BINARY_BLOCK_HEADER + n;
+    *p = *payloadEnd;
+    return b + BINARY_BLOCK_HEADER;
+}
+
+/* ============================================================
+ * Function: binaryDecodedSize
+ * ============================================================ */
+size_t binaryDecodedSize(const unsigned char *input, size_t len)
+{
+    size_t total;
+
+    return readHeader(input, len, &total) ? total : (size_t)-1;
+}
+
+/* ============================================================
+ * Function: binaryDecode
+ * 'left' counts down the bytes still owed to the header's length,
+ * so a count past it is caught before anything is written.
+ * ============================================================ */
+size_t binaryDecode(const unsigned char *input, size_t len, char *output)
+{
+    const unsigned char *end = input + len, *p, *q, *qEnd;
+    size_t total, left;
+    char *out = output;
+
+    p = readHeader(input, len, &total);
+    if (p == NULL)
+        return (size_t)-1;
+    left = total;
+
+    while ((q = nextBlock(&p, end, &qEnd)) != NULL) {
+        while (q < qEnd) {
+            size_t count;
+            uint64_t fill;
+
+            if (q[0] < 0x80 && qEnd - q >= 2) {
+                count = q[0];
+                q++;
+            } else {
+                q = getVarint(q, qEnd, &count);
+                if (q == NULL || q == qEnd)
+                    return (size_t)-1;
+            }
+            if (count == 0 || count > left)
+                return (size_t)-1;
+
+            if (count <= 16 && left >= 16) {
+                fill = 0x0101010101010101ull * *q;
+                memcpy(out, &fill, 8);
+                memcpy(out + 8, &fill, 8);
+            } else {
+                memset(out, *q, count);
+            }
+            q++;
+            out += count;
+            left -= count;
+        }
+    }
+    if (p == NULL || left != 0)
+        return (size_t)-1;
+    return total;
+}
+
+/* ============================================================
+ * Function: textToBinary
+ * Validates and sizes the text first (the header needs the
+ * length), then turns every token into one pair.
+ * ============================================================ */
+size_t textToBinary(const char *text, size_t len, unsigned char *output)
+{
+    size_t i = 0, total;
+    BlockWriter w;
+
+    if (!isValidCompressedRange(text, len))
+        return (size_t)-1;
+    total = expandedSize(text, len);
+    if (total == (size_t)-1)
+        return (size_t)-1;
+
+    beginBlocks(&w, output, total);
+    while (i < len) {
+        size_t count = 0;
+
+        while (text[i] >= '0' && text[i] <= '9')
+            count = count * 10 + (size_t)(text[i++] - '0');
+        putPair(&w, count ? count : 1, (unsigned char)text[i++]);
+    }
+    return endBlocks(&w, output);
+}
+
+/* ============================================================
+ * Function: binaryToText
+ * Pairs of the same letter in a row are merged into one run, as
+ * compressString would write them. A varint of k bytes holds
+ * fewer than 2k + 1 decimal digits, so text is at most twice the
+ * size of the pairs it came from.
+ * ============================================================ */
+size_t binaryToText(const unsigned char *input, size_t len, char *output)
+{
+    const unsigned char *end = input + len, *p, *q, *qEnd;
+    size_t total, left, count, open = 0;
+    unsigned char letter = 0;
+    char *out = output;
+
+    p = readHeader(input, len, &total);
+    if (p == NULL || total == 0)
+        return (size_t)-1;
+    left = total;
+
+    while ((q = nextBlock(&p, end, &qEnd)) != NULL) {
+        while (q < qEnd) {
+            q = getVarint(q, qEnd, &count);
+            if (q == NULL || q == qEnd || count == 0 || count > left || !IS_ALPHA(*q))
+                return (size_t)-1;
+            left -= count;
+            if (open > 0 && *q == letter) {
+                open += count;
+            } else {
+                if (open > 0)
+                    out += compressRun((char)letter, open, out);
+                letter = *q;
+                open = count;
+            }
+            q++;
+        }
+    }
+    if (p == NULL || left != 0)
+        return (size_t)-1;
+    out += compressRun((char)letter, open, out);
+    return (size_t)(out - output);
+}
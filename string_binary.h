@@ -0,0 +1,76 @@
+/*
+ * string_binary.h
+ *
+ * Header file for the binary run-length format, an alternative to
+ * the decimal text form ("3a2bc") that holds any bytes.
+ *
+ * Layout (integers little-endian, varints LEB128: 7 bits per byte,
+ * low bits first, high bit set on every byte but the last):
+ *   header  "PE1B", version byte, varint decoded length
+ *   block   u32 payload length (1..BINARY_BLOCK_SIZE),
+ *           u32 Adler-32 of the payload,
+ *           payload of (varint count, byte) pairs, count >= 1
+ *   end     u32 0
+ * A pair never spans two blocks.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef STRING_BINARY_H
+#define STRING_BINARY_H
+
+#include <stddef.h>
+
+#define BINARY_MAGIC "PE1B"
+#define BINARY_VERSION 1
+
+/* Longest varint (a 64-bit count) */
+#define BINARY_VARINT_MAX 10
+
+/* Largest block payload */
+#define BINARY_BLOCK_SIZE (64 * 1024)
+
+/* Most bytes binaryEncodeRange / textToBinary write for len input bytes */
+size_t binaryEncodedBound(size_t len);
+
+/*
+ * Encodes len raw bytes (any values, len may be 0). Output needs
+ * binaryEncodedBound(len) bytes. Returns the encoded length.
+ */
+size_t binaryEncodeRange(const char *input, size_t len, unsigned char *output);
+
+/*
+ * Decoded length from the header, or (size_t)-1 if there is no
+ * valid header. The rest of the data is not checked.
+ */
+size_t binaryDecodedSize(const unsigned char *input, size_t len);
+
+/*
+ * Decodes into exactly binaryDecodedSize() bytes of output after
+ * checking every block's checksum. Returns the decoded length, or
+ * (size_t)-1 if the data is truncated, corrupt or does not add up
+ * to the length in its header (the output is then undefined).
+ */
+size_t binaryDecode(const unsigned char *input, size_t len, char *output);
+
+/*
+ * Converts a compressed text string of len bytes to the binary
+ * format without expanding it. Output needs binaryEncodedBound(len)
+ * bytes. Returns the binary length, or (size_t)-1 if the text is
+ * not a valid compressed string (or expands past a size_t).
+ */
+size_t textToBinary(const char *text, size_t len, unsigned char *output);
+
+/*
+ * Converts binary data back to compressed text, the same text
+ * compressString would give for the decoded bytes. Writes at most
+ * 2 * len bytes, unterminated. Returns the text length, or
+ * (size_t)-1 if the data is invalid or decodes to anything but a
+ * non-empty string of letters.
+ */
+size_t binaryToText(const unsigned char *input, size_t len, char *output);
+
+#endif
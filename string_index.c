@@ -0,0 +1,148 @@
+/*
+ * string_index.c
+ *
+ * Random access into compressed strings. Building the index reads
+ * the text once and records, for every RUN_INDEX_STRIDE-th run,
+ * where it starts in the text and in the expansion. A lookup
+ * binary-searches those samples and then reads at most
+ * RUN_INDEX_STRIDE tokens, so it costs the same for "2000000000a"
+ * as for "a".
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "string_index.h"
+#include "string_ops.h"
+
+/* ============================================================
+ * Function: buildRunIndex
+ * ============================================================ */
+int buildRunIndex(RunIndex *index, const char *text, size_t len)
+{
+    size_t i = 0, runs = 0, position = 0, n = 0;
+
+    index->samples = NULL;
+    index->count = 0;
+    if (!isValidCompressedRange(text, len))
+        return 0;
+    index->total = expandedSize(text, len);
+    if (index->total == (size_t)-1)
+        return 0;
+
+    /* A run is at least one byte of text */
+    index->samples = malloc((len / RUN_INDEX_STRIDE + 1) * sizeof(RunSample));
+    if (index->samples == NULL)
+        return 0;
+    index->text = text;
+    index->len = len;
+
+    while (i < len) {
+        char letter;
+
+        if (runs++ % RUN_INDEX_STRIDE == 0) {
+            index->samples[n].offset = i;
+            index->samples[n].position = position;
+            n++;
+        }
+        position += readCompressedRun(text, &i, &letter);
+    }
+    index->count = n;
+    return 1;
+}
+
+/* ============================================================
+ * Function: freeRunIndex
+ * ============================================================ */
+void freeRunIndex(RunIndex *index)
+{
+    free(index->samples);
+    index->samples = NULL;
+    index->count = 0;
+}
+
+/* ============================================================
+ * Helper: findSample
+ * Last sample starting at or before expanded position n.
+ * ============================================================ */
+static const RunSample *findSample(const RunIndex *index, size_t n)
+{
+    size_t lo = 0, hi = index->count;
+
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+
+        if (index->samples[mid].position <= n)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return &index->samples[lo];
+}
+
+/* ============================================================
+ * Function: indexCharAt
+ * ============================================================ */
+char indexCharAt(const RunIndex *index, size_t n)
+{
+    const RunSample *s;
+    size_t i, position;
+    char letter;
+
+    if (n >= index->total)
+        return '\0';
+    s = findSample(index, n);
+    i = s->offset;
+    position = s->position;
+    for (;;) {
+        position += readCompressedRun(index->text, &i, &letter);
+        if (position > n)
+            return letter;
+    }
+}
+
+/* ============================================================
+ * Function: indexExpandSlice
+ * Finds the run holding 'from' like indexCharAt, writes the part
+ * of it inside the slice, then expands whole runs (memset) until
+ * 'to' is reached.
+ * ============================================================ */
+size_t indexExpandSlice(const RunIndex *index, size_t from, size_t to, char *output)
+{
+    const RunSample *s;
+    size_t i, position, count;
+    char *out = output;
+    char letter;
+
+    if (to > index->total)
+        to = index->total;
+    if (from >= to)
+        return 0;
+
+    s = findSample(index, from);
+    i = s->offset;
+    position = s->position;
+    do {
+        count = readCompressedRun(index->text, &i, &letter);
+        position += count;
+    } while (position <= from);
+
+    /* The run ends at 'position'; copy what lies in [from, to) */
+    count = ((position < to) ? position : to) - from;
+    memset(out, letter, count);
+    out += count;
+
+    while (position < to) {
+        count = readCompressedRun(index->text, &i, &letter);
+        if (count > to - position)
+            count = to - position;
+        memset(out, letter, count);
+        out += count;
+        position += count;
+    }
+    return (size_t)(out - output);
+}
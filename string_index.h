@@ -0,0 +1,60 @@
+/*
+ * string_index.h
+ *
+ * Header file for random access into compressed strings without
+ * expanding them.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef STRING_INDEX_H
+#define STRING_INDEX_H
+
+#include <stddef.h>
+
+/* Runs between two samples; lookups scan at most this many tokens */
+#define RUN_INDEX_STRIDE 64
+
+/* Where one sampled run starts, in the text and in the expansion */
+typedef struct {
+    size_t offset;      /* Index of the run's first count digit (or letter) */
+    size_t position;    /* Expanded position of the run's first character */
+} RunSample;
+
+/*
+ * Sampled prefix sums of the run lengths of one compressed string.
+ * The index points into the text, which must stay alive and
+ * unchanged while the index is used.
+ */
+typedef struct {
+    const char *text;
+    size_t len;
+    size_t total;       /* Expanded length */
+    RunSample *samples; /* Every RUN_INDEX_STRIDE-th run, in order */
+    size_t count;
+} RunIndex;
+
+/*
+ * Builds the index in one pass over text (len bytes, compressed
+ * form). Returns 1 on success, 0 if the text is not a valid
+ * compressed string, expands past a size_t or memory runs out.
+ */
+int buildRunIndex(RunIndex *index, const char *text, size_t len);
+
+/* Releases an index made by buildRunIndex */
+void freeRunIndex(RunIndex *index);
+
+/* Character at expanded position n, or '\0' if n >= index->total */
+char indexCharAt(const RunIndex *index, size_t n);
+
+/*
+ * Expands positions [from, to) into output (to - from bytes,
+ * unterminated); to is clamped to index->total. Returns the number
+ * of bytes written.
+ */
+size_t indexExpandSlice(const RunIndex *index, size_t from, size_t to, char *output);
+
+#endif
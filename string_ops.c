@@ -11,13 +11,17 @@
  *   Michael James Mangonen
  */
 
-#include <stdio.h>
-#include <ctype.h>
 #include <string.h>
+#include "phase_stats.h"
 #include "string_ops.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define HAVE_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
 /* ============================================================
- * Function: isValidString
+ * Function: isValidString / isValidStringRange
  * Validates a string for compression operation.
  * - Must not be NULL or empty
  * - Must contain only alphabetic characters (no digits, spaces, or symbols)
@@ -28,24 +32,37 @@
  *                           "hello!" (contains symbol)
  * ============================================================ */
 int isValidString(const char *str) {
-    int i;
-
     /* Check for NULL or empty string */
     if (str == NULL || *str == '\0') {
         return 0;
     }
+    return isValidStringRange(str, strlen(str));
+}
 
-    /* Verify each character is a letter */
-    for (i = 0; str[i] != '\0'; i++) {
-        if (!isalpha(str[i])) {
-            return 0;
-        }
+int isValidStringRange(const char *str, size_t len) {
+    uint64_t t = STATS_START();
+    int ok;
+
+    if (str == NULL) {
+        return 0;
     }
-    return 1;
+    ok = checkString(str, len) == CHECK_VALID;
+    STATS_STOP(STATS_VALIDATE_STRING, t, len, 0);
+    return ok;
+}
+
+/* Letters only, 64 bytes per step (spanAlpha) */
+size_t checkString(const char *str, size_t len) {
+    size_t n = spanAlpha(str, len);
+
+    if (len == 0) {
+        return 0;
+    }
+    return (n == len) ? CHECK_VALID : n;
 }
 
 /* ============================================================
- * Function: isValidCompressedString
+ * Function: isValidCompressedString / isValidCompressedRange
  * Validates a compressed string for expansion operation.
  * Rules:
  *   - Must not be NULL or empty
@@ -64,90 +81,383 @@ int isValidString(const char *str) {
  *   "3a2"     - Ends with digit instead of letter
  * ============================================================ */
 int isValidCompressedString(const char *str) {
-    int i = 0;
-    int hasDigit;
-
     /* Check for NULL or empty string */
     if (str == NULL || *str == '\0') {
         return 0;
     }
+    return isValidCompressedRange(str, strlen(str));
+}
 
-    while (str[i] != '\0') {
-        hasDigit = 0;
-        
-        /* Check for digit(s) indicating repeat count */
-        if (isdigit(str[i])) {
-            hasDigit = 1;
-            
-            /* No leading zeros allowed */
-            if (str[i] == '0') {
-                return 0;
-            }
-
-            /* Count of 1 must not be explicitly shown */
-            if (str[i] == '1' && !isdigit(str[i+1])) {
-                return 0;
-            }
-            
-            /* Skip over all digits of the count */
-            while (isdigit(str[i])) {
-                i++;
-            }
+int isValidCompressedRange(const char *str, size_t len) {
+    uint64_t t = STATS_START();
+    int ok;
+
+    if (str == NULL) {
+        return 0;
+    }
+    ok = checkCompressed(str, len) == CHECK_VALID;
+    STATS_STOP(STATS_VALIDATE_COMPRESSED, t, len, 0);
+    return ok;
+}
+
+/*
+ * Finds the first rule broken in one 64-byte block from its class
+ * masks. 'digitBefore' is 1 if the byte before the block is a
+ * digit, 'digitAfter' if the byte after it is. A count starts at a
+ * digit with no digit before it and ends at one with no digit
+ * after it; a count that starts with '0', or is a lone '1', is
+ * invalid, as is any byte that is neither digit nor letter.
+ */
+static uint64_t blockErrors(const BlockClasses *c, uint64_t digitBefore, uint64_t digitAfter) {
+    uint64_t starts = c->digit & ~((c->digit << 1) | digitBefore);
+    uint64_t ends = c->digit & ~((c->digit >> 1) | (digitAfter << 63));
+
+    return ~(c->alpha | c->digit) | (starts & c->zero) | (starts & ends & c->one);
+}
+
+/*
+ * The same rules as the original byte-by-byte check, 64 bytes per
+ * step: whole blocks are classified in place, the tail from a
+ * copy padded with NULs (which are neither digits nor letters,
+ * and are masked off). A count cut off by the end of the input
+ * is reported at len.
+ */
+size_t checkCompressed(const char *str, size_t len) {
+    BlockClasses classes;
+    uint64_t digitBefore = 0, errors;
+    size_t i = 0;
+
+    if (len == 0) {
+        return 0;
+    }
+
+    for (; i + CLASS_BLOCK <= len; i += CLASS_BLOCK) {
+        uint64_t digitAfter = (i + CLASS_BLOCK < len) ? (IS_DIGIT(str[i + CLASS_BLOCK]) != 0) : 0;
+
+        classifyBlock(str + i, &classes);
+        errors = blockErrors(&classes, digitBefore, digitAfter);
+        if (errors != 0) {
+            return i + (size_t)lowestSetBit(errors);
         }
+        digitBefore = classes.digit >> 63;
+    }
+
+    if (i < len) {
+        char tail[CLASS_BLOCK] = { 0 };
+
+        memcpy(tail, str + i, len - i);
+        classifyBlock(tail, &classes);
+        errors = blockErrors(&classes, digitBefore, 0) & (((uint64_t)1 << (len - i)) - 1);
+        if (errors != 0) {
+            return i + (size_t)lowestSetBit(errors);
+        }
+    }
+
+    /* Must end with a letter */
+    return IS_DIGIT(str[len - 1]) ? len : CHECK_VALID;
+}
+
+/* Two-digit decimal strings "00" .. "99" */
+static const char DIGIT_PAIRS[] =
+    "0001020304050607080910111213141516171819202122232425262728293031323334353637383940414243444546474849"
+    "5051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+/* ============================================================
+ * Helper: writeCount
+ * Writes the decimal digits of count, two at a time from the
+ * right; returns how many.
+ * ============================================================ */
+static size_t writeCount(size_t count, char *output) {
+    char digits[24];
+    size_t n = sizeof(digits);
+
+    while (count >= 100) {
+        const char *pair = &DIGIT_PAIRS[(count % 100) * 2];
+
+        count /= 100;
+        digits[--n] = pair[1];
+        digits[--n] = pair[0];
+    }
+    if (count >= 10) {
+        digits[--n] = DIGIT_PAIRS[count * 2 + 1];
+        digits[--n] = DIGIT_PAIRS[count * 2];
+    } else {
+        digits[--n] = (char)('0' + count);
+    }
+
+    memcpy(output, digits + n, sizeof(digits) - n);
+    return sizeof(digits) - n;
+}
+
+/* ============================================================
+ * Helper: writeRun / Function: compressRun
+ * Writes one run (count + letter, or the letter alone).
+ * ============================================================ */
+static inline size_t writeRun(char c, size_t count, char *output) {
+    size_t j;
+
+    if (count < 10) {
+        /* Short runs (the common case) skip the digit loop */
+        output[0] = (char)('0' + count);
+        output[count > 1] = c;
+        return 1 + (count > 1);
+    }
+    j = writeCount(count, output);
+    output[j] = c;
+    return j + 1;
+}
+
+size_t compressRun(char letter, size_t count, char *output) {
+    return writeRun(letter, count, output);
+}
+
+/* Compresses input[0..len) into output, returns the output length */
+typedef size_t (*CompressKernel)(const char *input, size_t len, char *output);
+
+/* ============================================================
+ * Scalar kernel
+ * Compares input[i] with input[i + 1] one byte at a time.
+ * ============================================================ */
+static size_t compressScalar(const char *input, size_t len, char *output) {
+    size_t i = 0, j = 0;
+    size_t count;
+
+    while (i < len) {
+        count = 1;
         
-        /* After digits (if any), must have a letter */
-        if (!isalpha(str[i])) {
-            return 0;
+        /* Count consecutive identical characters */
+        while (i + 1 < len && input[i] == input[i + 1]) {
+            count++;
+            i++;
         }
 
-        /* Move past the letter */
+        /* Write count if more than one occurrence */
+        j += writeRun(input[i], count, &output[j]);
         i++;
     }
-    return 1;
+    return j;
+}
+
+#ifdef HAVE_X86_SIMD
+
+/*
+ * The SIMD kernels compare 32 bytes with the same 32 bytes shifted
+ * by one (input[pos + k] vs input[pos + k - 1]); every mismatch is
+ * a run boundary. Boundaries are taken from the mask with ctz, so a
+ * long run costs one compare per 32 bytes. A block that is all
+ * boundaries after a single-letter run is copied as it is.
+ */
+#define COMPRESS_KERNEL(name, isa, boundaries)                                \
+    __attribute__((target(isa)))                                              \
+    static size_t name(const char *input, size_t len, char *output)           \
+    {                                                                         \
+        size_t runStart = 0, pos = 1, j = 0;                                  \
+                                                                              \
+        if (len == 0)                                                         \
+            return 0;                                                         \
+        for (; pos + 32 <= len; pos += 32) {                                  \
+            const char *p = input + pos;                                      \
+            unsigned mask = (boundaries);                                     \
+                                                                              \
+            if (mask == 0xFFFFFFFFu && runStart + 1 == pos) {                 \
+                memcpy(output + j, input + runStart, 32);                     \
+                j += 32;                                                      \
+                runStart = pos + 31;                                          \
+                continue;                                                     \
+            }                                                                 \
+            while (mask != 0) {                                               \
+                size_t end = pos + (size_t)__builtin_ctz(mask);               \
+                                                                              \
+                j += writeRun(input[runStart], end - runStart, output + j);   \
+                runStart = end;                                               \
+                mask &= mask - 1;                                             \
+            }                                                                 \
+        }                                                                     \
+        for (; pos < len; pos++) {                                            \
+            if (input[pos] != input[pos - 1]) {                               \
+                j += writeRun(input[runStart], pos - runStart, output + j);   \
+                runStart = pos;                                               \
+            }                                                                 \
+        }                                                                     \
+        return j + writeRun(input[runStart], len - runStart, output + j);     \
+    }
+
+/* Boundary masks: bit k set if p[k] != p[k - 1] */
+__attribute__((target("sse2")))
+static inline unsigned boundariesSse2(const char *p) {
+    __m128i lo = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p),
+                                _mm_loadu_si128((const __m128i *)(p - 1)));
+    __m128i hi = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + 16)),
+                                _mm_loadu_si128((const __m128i *)(p + 15)));
+
+    return ~((unsigned)_mm_movemask_epi8(lo) |
+             ((unsigned)_mm_movemask_epi8(hi) << 16));
+}
+
+__attribute__((target("avx2")))
+static inline unsigned boundariesAvx2(const char *p) {
+    __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p),
+                                   _mm256_loadu_si256((const __m256i *)(p - 1)));
+
+    return ~(unsigned)_mm256_movemask_epi8(eq);
+}
+
+COMPRESS_KERNEL(compressSse2, "sse2", boundariesSse2(p))
+COMPRESS_KERNEL(compressAvx2, "avx2", boundariesAvx2(p))
+
+#endif /* HAVE_X86_SIMD */
+
+/* A compression kernel and its name (compressKernelName) */
+typedef struct {
+    const char *name;
+    CompressKernel run;
+} CompressKernelInfo;
+
+#ifdef HAVE_X86_SIMD
+static const CompressKernelInfo AVX2_COMPRESS = { "avx2", compressAvx2 };
+static const CompressKernelInfo SSE2_COMPRESS = { "sse2", compressSse2 };
+#endif
+static const CompressKernelInfo SCALAR_COMPRESS = { "scalar", compressScalar };
+
+/* Widest first */
+static const CompressKernelInfo *const COMPRESS_KERNELS[] = {
+#ifdef HAVE_X86_SIMD
+    &AVX2_COMPRESS, &SSE2_COMPRESS,
+#endif
+    &SCALAR_COMPRESS
+};
+
+#define COMPRESS_KERNEL_COUNT (sizeof(COMPRESS_KERNELS) / sizeof(COMPRESS_KERNELS[0]))
+
+/* Kernel in use; read and written atomically, NULL until first needed */
+static const CompressKernelInfo *chosenCompress = NULL;
+
+/* ============================================================
+ * Helper: compressKernelSupported
+ * ============================================================ */
+static int compressKernelSupported(const CompressKernelInfo *k) {
+#ifdef HAVE_X86_SIMD
+    __builtin_cpu_init();
+    if (k == &AVX2_COMPRESS)
+        return __builtin_cpu_supports("avx2");
+    if (k == &SSE2_COMPRESS)
+        return __builtin_cpu_supports("sse2");
+#endif
+    return k == &SCALAR_COMPRESS;
+}
+
+/* ============================================================
+ * Helper: selectCompressKernel
+ * Picks the widest kernel the CPU supports. Threads that get here
+ * at once all pick the same kernel, so the name and function are
+ * published together with one atomic pointer store.
+ * ============================================================ */
+static const CompressKernelInfo *selectCompressKernel(void) {
+    const CompressKernelInfo *k = __atomic_load_n(&chosenCompress, __ATOMIC_ACQUIRE);
+    size_t i;
+
+    if (k == NULL) {
+        for (i = 0; k == NULL; i++)
+            if (compressKernelSupported(COMPRESS_KERNELS[i]))
+                k = COMPRESS_KERNELS[i];
+        __atomic_store_n(&chosenCompress, k, __ATOMIC_RELEASE);
+    }
+    return k;
+}
+
+const char *compressKernelName(void) {
+    return selectCompressKernel()->name;
+}
+
+/* ============================================================
+ * Function: compressUseKernel
+ * ============================================================ */
+int compressUseKernel(const char *name) {
+    size_t i;
+
+    for (i = 0; i < COMPRESS_KERNEL_COUNT; i++) {
+        if (strcmp(COMPRESS_KERNELS[i]->name, name) == 0 &&
+            compressKernelSupported(COMPRESS_KERNELS[i])) {
+            __atomic_store_n(&chosenCompress, COMPRESS_KERNELS[i], __ATOMIC_RELEASE);
+            return 1;
+        }
+    }
+    return 0;
 }
 
 /* ============================================================
- * Function: compressString
+ * Function: compressString / compressRange
  * Compresses a string by replacing consecutive repeated letters
  * with count + letter (e.g., "aaabb" -> "3a2b").
  * 
  * Algorithm:
- *   1. Traverse the input string character by character
- *   2. Count consecutive occurrences of each letter
- *   3. If count > 1, write the count followed by the letter
- *   4. If count == 1, write just the letter
+ *   1. Find the run boundaries (input[i] != input[i - 1]),
+ *      32 bytes at a time with SIMD when available
+ *   2. If a run is longer than 1, write its count then the letter
+ *   3. If its count is 1, write just the letter
  * 
  * Parameters:
  *   input  - Original uncompressed string (must be valid)
  *   output - Buffer to store compressed result
  * ============================================================ */
 void compressString(const char *input, char *output) {
-    int i = 0, j = 0;
-    int count;
+    output[compressRange(input, strlen(input), output)] = '\0';
+}
 
-    while (input[i] != '\0') {
-        count = 1;
-        
-        /* Count consecutive identical characters */
-        while (input[i] == input[i + 1]) {
-            count++;
-            i++;
-        }
+size_t compressRange(const char *input, size_t len, char *output) {
+    uint64_t t = STATS_START();
+    size_t n = selectCompressKernel()->run(input, len, output);
 
-        /* Write count if more than one occurrence */
-        if (count > 1) {
-            j += sprintf(&output[j], "%d", count);
-        }
+    STATS_STOP(STATS_COMPRESS, t, len, n);
+    return n;
+}
+
+/* ============================================================
+ * Function: readCompressedRun
+ * Reads the token at input[*i] of a valid compressed string,
+ * moves *i past it and returns its count (1 without digits).
+ * ============================================================ */
+size_t readCompressedRun(const char *input, size_t *i, char *letter) {
+    size_t count = 0, j = *i;
 
-        /* Write the character itself */
-        output[j++] = input[i];
+    while (input[j] >= '0' && input[j] <= '9') {
+        count = count * 10 + (size_t)(input[j] - '0');
+        j++;
+    }
+    *letter = input[j];
+    *i = j + 1;
+    return count ? count : 1;
+}
+
+/* ============================================================
+ * Function: expandedSize
+ * Length of a (valid) compressed string once expanded, or
+ * (size_t)-1 if it does not fit in a size_t.
+ * ============================================================ */
+size_t expandedSize(const char *input, size_t len) {
+    size_t i = 0, total = 0;
+
+    while (i < len) {
+        size_t count = 0;
+
+        while (i < len && input[i] >= '0' && input[i] <= '9') {
+            if (count > ((size_t)-1 - 9) / 10)
+                return (size_t)-1;
+            count = count * 10 + (size_t)(input[i] - '0');
+            i++;
+        }
+        if (count == 0)
+            count = 1;
+        if (total > (size_t)-1 - count)
+            return (size_t)-1;
+        total += count;
         i++;
     }
-    output[j] = '\0';
+    return total;
 }
 
 /* ============================================================
- * Function: expandString
+ * Function: expandString / expandRange
  * Expands a compressed string back to its original form.
  * Handles multi-digit counts and single letters.
  * 
@@ -155,148 +465,58 @@ void compressString(const char *input, char *output) {
  *   1. Traverse the compressed string
  *   2. If digits are found, parse them into a count
  *   3. If no digits, count defaults to 1
- *   4. Write the following letter 'count' times
+ *   4. Fill the next 'count' bytes with the letter (memset, so
+ *      long runs are written at memory bandwidth)
  * 
  * Parameters:
  *   input  - Compressed string (must be valid)
- *   output - Buffer to store expanded result
+ *   output - Buffer of at least expandedSize() + 1 bytes
  * ============================================================ */
 void expandString(const char *input, char *output) {
-    int i = 0, j = 0;
-    int count;
+    output[expandRange(input, strlen(input), output)] = '\0';
+}
 
-    while (input[i] != '\0') {
-        count = 0;
+size_t expandRange(const char *input, size_t len, char *output) {
+    uint64_t t = STATS_START();
+    size_t i = 0, j = 0;
+    size_t count;
 
-        /* Parse the count if digits are present */
-        while (isdigit(input[i])) {
-            count = count * 10 + (input[i] - '0');
-            i++;
+    while (i < len) {
+        /* No count: a single letter */
+        if (input[i] > '9' || input[i] < '0') {
+            output[j++] = input[i++];
+            continue;
         }
 
-        /* If no count specified, default to 1 */
-        if (count == 0)
-            count = 1;
+        /* Parse the count */
+        count = 0;
+        while (input[i] >= '0' && input[i] <= '9') {
+            count = count * 10 + (size_t)(input[i] - '0');
+            i++;
+        }
 
         /* Write the letter 'count' times */
-        while (count-- > 0) {
-            output[j++] = input[i];
-        }
+        memset(&output[j], input[i], count);
+        j += count;
         i++;
     }
-    output[j] = '\0';    
+    STATS_STOP(STATS_EXPAND, t, len, j);
+    return j;
 }
 
 /* ============================================================
- * Function: handleStringCompression
- * Main workflow for string compression operation.
- * Loops until user chooses to exit.
- * 
- * Steps:
- *   1. Prompt for input string
- *   2. Validate input (letters only)
- *   3. If invalid, show example of correct format
- *   4. Compress the string and display result
- *   5. Ask if user wants to compress another string
- * 
- * Example of valid input: "aaabbc" -> compresses to "3a2bc"
- * Example of invalid input: "aaabbc123" (contains digits)
+ * Function: expandStringBounded
+ * expandString for a buffer of known size: nothing is written
+ * unless the whole result and its terminator fit.
  * ============================================================ */
-void handleStringCompression(void) {
-    char input[256];
-    char output[516];  /* Expanded buffer for worst case (all single letters) */
-    char repeat;
-
-    do {
-        printf("\nEnter string to compress : ");
-        fgets(input, sizeof(input), stdin);
-        input[strcspn(input, "\n")] = 0;  /* Remove trailing newline */
-
-        if (!isValidString(input)) {
-            printf("Invalid string input.\n");
-            printf("Instructions: Use only letters (A-Z or a-z).\n");
-            printf("Example of valid input: \"aaabbc\"\n");
-            printf("Example of invalid input: \"aaabbc123\" (contains digits)\n");
-        } else {
-            compressString(input, output);
-            printf("Compressed Form : %s\n", output);
-        }
+size_t expandStringBounded(const char *input, char *output, size_t size) {
+    size_t len = strlen(input);
+    size_t n = expandedSize(input, len);
 
-        /* Ask if user wants to continue with validation */
-        do {
-            printf("Repeat? (y/n) : ");
-            scanf(" %c", &repeat);
-            getchar();  /* Clear newline from buffer */
-
-            if (repeat != 'Y' && repeat != 'y' &&
-                repeat != 'N' && repeat != 'n') {
-                printf("Invalid input. Please enter y or n only.\n");
-                printf("Example: Enter 'y' to continue, 'n' to exit\n");
-            }
-        } while (repeat != 'Y' && repeat != 'y' &&
-                repeat != 'N' && repeat != 'n');
-                       
-    } while (repeat == 'y' || repeat == 'Y');
+    if (n == (size_t)-1 || n >= size) {
+        return (size_t)-1;
+    }
+    expandRange(input, len, output);
+    output[n] = '\0';
+    return n;
 }
-
-/* ============================================================
- * Function: handleStringExpansion
- * Main workflow for string expansion operation.
- * Loops until user chooses to exit.
- * 
- * Steps:
- *   1. Prompt for compressed string
- *   2. Validate compressed format
- *   3. If invalid, show example of correct format
- *   4. Expand the string and display result
- *   5. Ask if user wants to expand another string
- * 
- * Example of valid input: "3a2bc" -> expands to "aaabbc"
- * Examples of invalid inputs:
- *   "1a"  - Count of 1 should not be shown (should be "a")
- *   "05a" - Leading zeros not allowed
- *   "3a2" - Ends with digit instead of letter
- * ============================================================ */
-void handleStringExpansion(void) {
-    char input[256];
-    char output[516];  /* Buffer for expanded result */
-    char repeat;
-
-    do {
-        printf("\nEnter string to expand : ");
-        fgets(input, sizeof(input), stdin);
-        input[strcspn(input, "\n")] = 0;  /* Remove trailing newline */
-
-        if (!isValidCompressedString(input)) {
-            printf("Invalid string input.\n");
-            printf("Instructions: Format should be [count]letter where:\n");
-            printf("  - count > 1 (optional, omitted for single letters)\n");
-            printf("  - No leading zeros (e.g., \"05a\" is invalid)\n");
-            printf("  - Count of 1 must NOT be shown (use \"a\" not \"1a\")\n");
-            printf("  - Must end with a letter\n\n");
-            printf("Examples of valid input: \"3a2bc\", \"a3b2c\", \"xyz\"\n");
-            printf("Examples of invalid input:\n");
-            printf("  \"1a\"  - Count of 1 should not be shown\n");
-            printf("  \"05a\" - Leading zeros not allowed\n");
-            printf("  \"3a2\" - Ends with digit instead of letter\n");
-        } else {
-            expandString(input, output);
-            printf("Expanded Form : %s\n", output);
-        }
-
-        /* Ask if user wants to continue with validation */
-        do {
-            printf("Repeat? (y/n) : ");
-            scanf(" %c", &repeat);
-            getchar();  /* Clear newline from buffer */
-
-            if (repeat != 'Y' && repeat != 'y' &&
-                repeat != 'N' && repeat != 'n') {
-                printf("Invalid input. Please enter y or n only.\n");
-                printf("Example: Enter 'y' to continue, 'n' to exit\n");
-            }
-        } while (repeat != 'Y' && repeat != 'y' &&
-                repeat != 'N' && repeat != 'n');
-
-    } while (repeat == 'y' || repeat == 'Y');
-}
\ No newline at end of file
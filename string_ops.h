@@ -12,6 +12,9 @@
 #ifndef STRING_OPS_H
 #define STRING_OPS_H
 
+#include <stddef.h>
+#include "char_class.h"
+
 /* Validates input string */
 int isValidString(const char *str);
 
@@ -21,11 +24,64 @@ int isValidCompressedString(const char *str);
 /* Compresses string */
 void compressString(const char *input, char *output);
 
-/* Expands string */
+/* Expands string; output needs expandedSize() + 1 bytes */
 void expandString(const char *input, char *output);
 
-/* Menu handlers */
-void handleStringCompression(void);
-void handleStringExpansion(void);
+/*
+ * Expands into a buffer of 'size' bytes. Returns the expanded
+ * length, or (size_t)-1 without writing anything if the result and
+ * its terminator do not fit.
+ */
+size_t expandStringBounded(const char *input, char *output, size_t size);
+
+/*
+ * Same as the above on the first 'len' bytes of a buffer that
+ * need not be NUL-terminated (e.g. a memory-mapped file). The
+ * Range kernels do not terminate the output and return its length;
+ * compressRange writes at most len bytes, expandRange exactly
+ * expandedSize(input, len) bytes.
+ */
+int isValidStringRange(const char *str, size_t len);
+int isValidCompressedRange(const char *str, size_t len);
+size_t compressRange(const char *input, size_t len, char *output);
+size_t expandRange(const char *input, size_t len, char *output);
+
+/*
+ * The validators behind isValidStringRange / isValidCompressedRange.
+ * They return CHECK_VALID (char_class.h) for valid input, otherwise
+ * the offset of the first invalid byte: len if the input ends too
+ * early (it is empty, or ends in a count).
+ */
+size_t checkString(const char *str, size_t len);
+size_t checkCompressed(const char *str, size_t len);
+
+/* Longest compressed form of one run: up to 20 count digits + letter */
+#define COMPRESSED_RUN_MAX 24
+
+/*
+ * Writes 'count' copies of letter in compressed form ("12a", or "a"
+ * for a count of 1). Returns the length, at most COMPRESSED_RUN_MAX.
+ */
+size_t compressRun(char letter, size_t count, char *output);
+
+/* Name of the compressRange kernel in use ("avx2", "sse2", "scalar") */
+const char *compressKernelName(void);
+
+/*
+ * Makes compressRange use the kernel of that name from now on, e.g.
+ * to compare the kernels with each other. Returns 1, or 0 (nothing
+ * changed) if the name is unknown or the CPU lacks the instructions.
+ * Not meant to be called while other threads compress.
+ */
+int compressUseKernel(const char *name);
+
+/*
+ * Reads the run at input[*i] of a valid compressed string: returns
+ * its count, sets *letter and moves *i to the next run.
+ */
+size_t readCompressedRun(const char *input, size_t *i, char *letter);
+
+/* Expanded length of a valid compressed string, (size_t)-1 if too large */
+size_t expandedSize(const char *input, size_t len);
 
 #endif
\ No newline at end of file
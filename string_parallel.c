@@ -0,0 +1,255 @@
+/*
+ * string_parallel.c
+ *
+ * Multi-threaded compression and expansion of one large string.
+ * Compression cuts the input into equal chunks; each chunk keeps
+ * its first and last run apart (they may continue into the
+ * neighbours) and compresses the runs in between on its own. The
+ * boundary runs are then merged in order on the calling thread,
+ * which also fixes every chunk's output offset. Expansion cuts the
+ * compressed string at token boundaries, sizes every segment, and
+ * a prefix sum over the sizes gives each segment its place in the
+ * output.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "string_parallel.h"
+
+/* One chunk of the input to compress */
+typedef struct {
+    TaskGroup *group;
+    const char *start;
+    size_t len;
+    size_t headLen;     /* First run, up to the chunk's end */
+    size_t tailLen;     /* Last run (the whole chunk if headLen == len) */
+    char *body;         /* Compressed runs between head and tail */
+    size_t bodyLen;
+    char lead[2 * COMPRESSED_RUN_MAX];  /* Merged runs written before body */
+    size_t leadLen;
+    size_t offset;      /* Output position of lead + body */
+    char *output;
+    int valid;
+    int failed;         /* No memory for body */
+} CompressChunk;
+
+/* ============================================================
+ * Helper: chunkCount
+ * ============================================================ */
+static size_t chunkCount(const ThreadPool *pool, size_t len)
+{
+    size_t n = (size_t)pool->count * STRING_CHUNKS_PER_THREAD;
+    size_t most = len / (STRING_PARALLEL_MIN_SIZE / STRING_CHUNKS_PER_THREAD) + 1;
+
+    return n < most ? n : most;
+}
+
+/* ============================================================
+ * Helper: compressChunk (pool task)
+ * ============================================================ */
+static void compressChunk(void *arg, int worker)
+{
+    CompressChunk *c = arg;
+    const char *p = c->start;
+    size_t n = c->len, h = 1, t;
+
+    (void)worker;
+    c->valid = isValidStringRange(p, n);
+    if (c->valid) {
+        while (h < n && p[h] == p[0])
+            h++;
+        c->headLen = h;
+        c->tailLen = n;
+        if (h < n) {
+            t = n - 1;
+            while (t > h && p[t - 1] == p[n - 1])
+                t--;
+            c->tailLen = n - t;
+            if (t > h) {
+                c->body = malloc(t - h);
+                if (c->body == NULL)
+                    c->failed = 1;
+                else
+                    c->bodyLen = compressRange(p + h, t - h, c->body);
+            }
+        }
+    }
+    poolFinishTask(c->group);
+}
+
+/* ============================================================
+ * Helper: placeChunk (pool task)
+ * ============================================================ */
+static void placeChunk(void *arg, int worker)
+{
+    CompressChunk *c = arg;
+
+    (void)worker;
+    memcpy(c->output + c->offset, c->lead, c->leadLen);
+    if (c->bodyLen > 0)
+        memcpy(c->output + c->offset + c->leadLen, c->body, c->bodyLen);
+    poolFinishTask(c->group);
+}
+
+/* ============================================================
+ * Function: compressParallel
+ * The open run starts as the first chunk's head and grows while
+ * the next chunk starts with the same letter; it is written into
+ * the lead of the chunk where it ends.
+ * ============================================================ */
+size_t compressParallel(ThreadPool *pool, const char *input, size_t len, char *output)
+{
+    CompressChunk *chunks;
+    size_t n = chunkCount(pool, len);
+    size_t i, offset = 0, openCount = 0;
+    char openLetter = 0;
+    int valid = 1, failed = 0;
+
+    if (n < 2)
+        return isValidStringRange(input, len) ? compressRange(input, len, output) : (size_t)-1;
+    chunks = calloc(n, sizeof(CompressChunk));
+    if (chunks == NULL)
+        return isValidStringRange(input, len) ? compressRange(input, len, output) : (size_t)-1;
+
+    for (i = 0; i < n; i++) {
+        chunks[i].start = input + len / n * i;
+        chunks[i].len = (i + 1 < n) ? len / n : len - len / n * i;
+        chunks[i].output = output;
+    }
+    poolRunTasks(pool, compressChunk, chunks, sizeof(CompressChunk), n);
+
+    for (i = 0; i < n; i++) {
+        valid &= chunks[i].valid;
+        failed |= chunks[i].failed;
+    }
+
+    if (valid && !failed) {
+        for (i = 0; i < n; i++) {
+            CompressChunk *c = &chunks[i];
+
+            if (openCount > 0 && c->start[0] == openLetter) {
+                openCount += c->headLen;
+            } else {
+                if (openCount > 0)
+                    c->leadLen = compressRun(openLetter, openCount, c->lead);
+                openLetter = c->start[0];
+                openCount = c->headLen;
+            }
+            if (c->headLen < c->len) {
+                c->leadLen += compressRun(openLetter, openCount, c->lead + c->leadLen);
+                openLetter = c->start[c->len - 1];
+                openCount = c->tailLen;
+            }
+            c->offset = offset;
+            offset += c->leadLen + c->bodyLen;
+        }
+        poolRunTasks(pool, placeChunk, chunks, sizeof(CompressChunk), n);
+        offset += compressRun(openLetter, openCount, output + offset);
+    }
+
+    for (i = 0; i < n; i++)
+        free(chunks[i].body);
+    free(chunks);
+
+    if (!valid)
+        return (size_t)-1;
+    if (failed)
+        return compressRange(input, len, output);
+    return offset;
+}
+
+/* ============================================================
+ * Helpers: sizeSegment / expandSegment (pool tasks)
+ * ============================================================ */
+static void sizeSegment(void *arg, int worker)
+{
+    ExpandSegment *s = arg;
+
+    (void)worker;
+    s->valid = (s->len == 0) || isValidCompressedRange(s->start, s->len);
+    s->size = s->valid ? expandedSize(s->start, s->len) : 0;
+    poolFinishTask(s->group);
+}
+
+static void expandSegment(void *arg, int worker)
+{
+    ExpandSegment *s = arg;
+
+    (void)worker;
+    expandRange(s->start, s->len, s->output + s->offset);
+    poolFinishTask(s->group);
+}
+
+/* ============================================================
+ * Function: planExpansion
+ * A segment boundary is moved forward until it follows a letter,
+ * so no count is split. The string is valid exactly when every
+ * segment is.
+ * ============================================================ */
+int planExpansion(ThreadPool *pool, const char *input, size_t len, ExpandPlan *plan)
+{
+    size_t n = chunkCount(pool, len);
+    size_t i, prev = 0, total = 0;
+    int ok = len > 0;
+
+    plan->segments = calloc(n, sizeof(ExpandSegment));
+    plan->count = n;
+    plan->total = 0;
+    if (plan->segments == NULL)
+        return 0;
+
+    for (i = 0; i < n; i++) {
+        size_t b = (i + 1 < n) ? len / n * (i + 1) : len;
+
+        if (b < prev)
+            b = prev;
+        while (b > 0 && b < len && input[b - 1] >= '0' && input[b - 1] <= '9')
+            b++;
+        plan->segments[i].start = input + prev;
+        plan->segments[i].len = b - prev;
+        prev = b;
+    }
+    poolRunTasks(pool, sizeSegment, plan->segments, sizeof(ExpandSegment), n);
+
+    for (i = 0; i < n && ok; i++) {
+        ExpandSegment *s = &plan->segments[i];
+
+        if (!s->valid || s->size == (size_t)-1 || total > (size_t)-1 - s->size) {
+            ok = 0;
+        } else {
+            s->offset = total;
+            total += s->size;
+        }
+    }
+
+    if (!ok) {
+        freeExpandPlan(plan);
+        return 0;
+    }
+    plan->total = total;
+    return 1;
+}
+
+/* ============================================================
+ * Function: expandPlanned / freeExpandPlan
+ * ============================================================ */
+void expandPlanned(ThreadPool *pool, ExpandPlan *plan, char *output)
+{
+    size_t i;
+
+    for (i = 0; i < plan->count; i++)
+        plan->segments[i].output = output;
+    poolRunTasks(pool, expandSegment, plan->segments, sizeof(ExpandSegment), plan->count);
+}
+
+void freeExpandPlan(ExpandPlan *plan)
+{
+    free(plan->segments);
+    plan->segments = NULL;
+    plan->count = 0;
+}
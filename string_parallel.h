@@ -0,0 +1,69 @@
+/*
+ * string_parallel.h
+ *
+ * Header file for multi-threaded compression/expansion of one
+ * large string.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef STRING_PARALLEL_H
+#define STRING_PARALLEL_H
+
+#include <stddef.h>
+#include "string_ops.h"
+#include "thread_pool.h"
+
+/* Inputs shorter than this are worth splitting no further */
+#define STRING_PARALLEL_MIN_SIZE (256 * 1024)
+
+/* Chunks per pool thread */
+#define STRING_CHUNKS_PER_THREAD 4
+
+/* One piece of a compressed string and where its expansion goes */
+typedef struct {
+    TaskGroup *group;
+    const char *start;
+    size_t len;
+    size_t size;        /* Expanded length */
+    size_t offset;      /* Output position (prefix sum of sizes) */
+    char *output;
+    int valid;
+} ExpandSegment;
+
+/* Segments of a compressed string, ready to expand */
+typedef struct {
+    ExpandSegment *segments;
+    size_t count;
+    size_t total;       /* Expanded length of the whole string */
+} ExpandPlan;
+
+/*
+ * compressRange on the pool: the input is cut into chunks that are
+ * validated and compressed in parallel, runs crossing chunk
+ * boundaries are merged, and the pieces are copied to their final
+ * offsets in parallel. The output is the same as compressRange's
+ * (at most len bytes). Returns its length, or (size_t)-1 if the
+ * input is not a valid string.
+ */
+size_t compressParallel(ThreadPool *pool, const char *input, size_t len, char *output);
+
+/*
+ * Splits a compressed string at token boundaries, validates the
+ * segments and sizes their expansions in parallel, then places
+ * them with a prefix sum. Returns 1 with plan->total set, or 0
+ * (nothing to free) if the input is invalid, expands past a
+ * size_t or memory runs out.
+ */
+int planExpansion(ThreadPool *pool, const char *input, size_t len, ExpandPlan *plan);
+
+/* Expands every segment straight into output (plan->total bytes) */
+void expandPlanned(ThreadPool *pool, ExpandPlan *plan, char *output);
+
+/* Releases a plan made by planExpansion */
+void freeExpandPlan(ExpandPlan *plan);
+
+#endif
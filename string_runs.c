@@ -0,0 +1,125 @@
+/*
+ * string_runs.c
+ *
+ * Compare, concatenate and count compressed strings run by run.
+ * Each operation reads every token once (or, for concatenation,
+ * only the two tokens at the seam), so its cost follows the
+ * number of runs and never the expanded length.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <string.h>
+#include "string_runs.h"
+#include "string_ops.h"
+
+/* ============================================================
+ * Function: compareCompressed
+ * Walks both strings a run at a time, keeping how much of the
+ * current run of each side is left, and skips the shorter of the
+ * two remainders while the letters match.
+ * ============================================================ */
+int compareCompressed(const char *a, size_t aLen, const char *b, size_t bLen)
+{
+    size_t i = 0, j = 0, leftA = 0, leftB = 0;
+    char letterA = 0, letterB = 0;
+
+    for (;;) {
+        size_t step;
+
+        if (leftA == 0 && i < aLen)
+            leftA = readCompressedRun(a, &i, &letterA);
+        if (leftB == 0 && j < bLen)
+            leftB = readCompressedRun(b, &j, &letterB);
+        if (leftA == 0 || leftB == 0)
+            return (leftA > 0) - (leftB > 0);
+        if (letterA != letterB)
+            return ((unsigned char)letterA < (unsigned char)letterB) ? -1 : 1;
+
+        step = (leftA < leftB) ? leftA : leftB;
+        leftA -= step;
+        leftB -= step;
+    }
+}
+
+/* ============================================================
+ * Function: concatCompressed
+ * ============================================================ */
+size_t concatCompressed(const char *a, size_t aLen, const char *b, size_t bLen, char *output)
+{
+    size_t last, i, j = 0, countA, countB;
+    char letterA, letterB;
+    char *out = output;
+
+    if (aLen == 0 || bLen == 0) {
+        memcpy(out, a, aLen);
+        memcpy(out + aLen, b, bLen);
+        return aLen + bLen;
+    }
+
+    /* Start of a's last run */
+    last = aLen - 1;
+    while (last > 0 && a[last - 1] >= '0' && a[last - 1] <= '9')
+        last--;
+    i = last;
+    countA = readCompressedRun(a, &i, &letterA);
+    countB = readCompressedRun(b, &j, &letterB);
+
+    if (letterA != letterB) {
+        memcpy(out, a, aLen);
+        memcpy(out + aLen, b, bLen);
+        return aLen + bLen;
+    }
+    if (countA > (size_t)-1 - countB)
+        return (size_t)-1;
+
+    memcpy(out, a, last);
+    out += last;
+    out += compressRun(letterA, countA + countB, out);
+    memcpy(out, b + j, bLen - j);
+    out += bLen - j;
+    return (size_t)(out - output);
+}
+
+/* ============================================================
+ * Function: letterHistogram
+ * ============================================================ */
+void letterHistogram(const char *text, size_t len, size_t counts[256])
+{
+    size_t i = 0;
+
+    while (i < len) {
+        char letter;
+        size_t count = readCompressedRun(text, &i, &letter);
+
+        counts[(unsigned char)letter] += count;
+    }
+}
+
+/* ============================================================
+ * Function: runStatistics
+ * ============================================================ */
+void runStatistics(const char *text, size_t len, RunStats *stats)
+{
+    size_t i = 0;
+
+    memset(stats, 0, sizeof(*stats));
+    while (i < len) {
+        char letter;
+        size_t count = readCompressedRun(text, &i, &letter);
+        unsigned k = 0;
+
+        while (count >> k > 1)
+            k++;
+        stats->buckets[k]++;
+        stats->runs++;
+        stats->total += count;
+        if (stats->shortest == 0 || count < stats->shortest)
+            stats->shortest = count;
+        if (count > stats->longest)
+            stats->longest = count;
+    }
+}
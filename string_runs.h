@@ -0,0 +1,53 @@
+/*
+ * string_runs.h
+ *
+ * Header file for operations on compressed strings that work run
+ * by run, without expanding them. Every input must be a valid
+ * compressed string (isValidCompressedRange) whose expansion fits
+ * a size_t (expandedSize).
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef STRING_RUNS_H
+#define STRING_RUNS_H
+
+#include <stddef.h>
+
+/* Run lengths are bucketed by powers of two: [1], [2,3], [4,7], ... */
+#define RUN_LENGTH_BUCKETS (sizeof(size_t) * 8)
+
+/* Run-length statistics of one compressed string */
+typedef struct {
+    size_t runs;
+    size_t total;       /* Expanded length */
+    size_t shortest;
+    size_t longest;
+    size_t buckets[RUN_LENGTH_BUCKETS];    /* Runs of length [2^k, 2^(k+1)) */
+} RunStats;
+
+/*
+ * Orders the expansions of a and b like strcmp / memcmp would,
+ * with a shorter prefix first. Returns <0, 0 or >0; 0 also when the
+ * texts differ but expand the same ("2a3a" and "5a").
+ */
+int compareCompressed(const char *a, size_t aLen, const char *b, size_t bLen);
+
+/*
+ * Writes the compressed form of expand(a) + expand(b): the texts
+ * joined, with a's last run and b's first merged if they share a
+ * letter. Writes at most aLen + bLen bytes, unterminated. Returns
+ * the length, or (size_t)-1 if the merged run overflows a size_t.
+ */
+size_t concatCompressed(const char *a, size_t aLen, const char *b, size_t bLen, char *output);
+
+/* Adds how often every letter occurs in the expansion to counts[letter] */
+void letterHistogram(const char *text, size_t len, size_t counts[256]);
+
+/* Fills stats for the runs of text as written (runs are not merged) */
+void runStatistics(const char *text, size_t len, RunStats *stats);
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ * string_stream.c
+ *
+ * Incremental compression and expansion over chunks of any size,
+ * in constant memory. The compressor keeps the last (still open)
+ * run of each chunk and runs compressRange over everything before
+ * it; the expander keeps a partly read count or a partly written
+ * run. Chunk boundaries never change the output.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <string.h>
+#include "phase_stats.h"
+#include "string_stream.h"
+
+/* ============================================================
+ * Function: compressStreamInit
+ * ============================================================ */
+void compressStreamInit(CompressStream *s)
+{
+    s->count = 0;
+    s->letter = 0;
+    s->failed = 0;
+}
+
+/* ============================================================
+ * Function: compressStreamFeed
+ * Takes the input in pieces small enough that their output fits:
+ * the open run is extended over the piece's leading letters (and
+ * written once a different letter shows up), the piece up to its
+ * last run goes through compressRange, and that last run becomes
+ * the new open run.
+ * ============================================================ */
+StreamStatus compressStreamFeed(CompressStream *s, const char **in, const char *inEnd,
+                                char **out, char *outEnd)
+{
+    while (!s->failed && *in < inEnd) {
+        const char *p = *in;
+        size_t room = (size_t)(outEnd - *out);
+        size_t m = (size_t)(inEnd - p);
+        size_t k = 0, last;
+
+        if (room <= COMPRESSED_RUN_MAX)
+            return STREAM_FULL;
+        if (m > room - COMPRESSED_RUN_MAX)
+            m = room - COMPRESSED_RUN_MAX;
+        if (!isValidStringRange(p, m)) {
+            s->failed = 1;
+            break;
+        }
+
+        /* Extend the open run */
+        if (s->count > 0) {
+            while (k < m && p[k] == s->letter)
+                k++;
+            s->count += k;
+            if (k == m) {
+                *in += m;
+                continue;
+            }
+            *out += compressRun(s->letter, s->count, *out);
+        }
+
+        /* Everything before the piece's last run is complete */
+        last = m - 1;
+        while (last > k && p[last - 1] == p[m - 1])
+            last--;
+        *out += compressRange(p + k, last - k, *out);
+
+        s->letter = p[m - 1];
+        s->count = m - last;
+        *in += m;
+    }
+    return s->failed ? STREAM_INVALID : STREAM_OK;
+}
+
+/* ============================================================
+ * Function: compressStreamFinish
+ * Writes the open run. An empty stream is invalid, as is "".
+ * ============================================================ */
+StreamStatus compressStreamFinish(CompressStream *s, char **out, char *outEnd)
+{
+    if (s->failed || s->count == 0) {
+        s->failed = 1;
+        return STREAM_INVALID;
+    }
+    if ((size_t)(outEnd - *out) < COMPRESSED_RUN_MAX)
+        return STREAM_FULL;
+    *out += compressRun(s->letter, s->count, *out);
+    s->count = 0;
+    return STREAM_OK;
+}
+
+/* ============================================================
+ * Function: expandStreamInit
+ * ============================================================ */
+void expandStreamInit(ExpandStream *s)
+{
+    s->count = 0;
+    s->digits = 0;
+    s->pending = 0;
+    s->letter = 0;
+    s->sawToken = 0;
+    s->failed = 0;
+}
+
+/* ============================================================
+ * Helper: writePending
+ * Writes as much of the pending run as fits. Returns 1 once it
+ * is fully written.
+ * ============================================================ */
+static int writePending(ExpandStream *s, char **out, char *outEnd)
+{
+    size_t room = (size_t)(outEnd - *out);
+    size_t n = (s->pending < room) ? s->pending : room;
+
+    memset(*out, s->letter, n);
+    *out += n;
+    s->pending -= n;
+    return s->pending == 0;
+}
+
+/* ============================================================
+ * Function: expandStreamFeed
+ * Reads one byte at a time with the same rules as
+ * isValidCompressedString: no leading zero, no count of 1, and
+ * every count followed by a letter. Counts that overflow a size_t
+ * are rejected too.
+ * ============================================================ */
+StreamStatus expandStreamFeed(ExpandStream *s, const char **in, const char *inEnd,
+                              char **out, char *outEnd)
+{
+    uint64_t t = STATS_START();
+    const char *p = *in;
+    const char *outStart = *out;
+
+    while (!s->failed) {
+        char c;
+
+        if (s->pending > 0 && !writePending(s, out, outEnd))
+            break;
+        if (p == inEnd)
+            break;
+        c = *p;
+
+        if (c >= '0' && c <= '9') {
+            if ((c == '0' && s->digits == 0) ||
+                s->count > ((size_t)-1 - 9) / 10) {
+                s->failed = 1;
+                break;
+            }
+            s->count = s->count * 10 + (size_t)(c - '0');
+            s->digits++;
+        } else if (IS_ALPHA(c) && !(s->digits == 1 && s->count == 1)) {
+            s->sawToken = 1;
+            if (s->digits == 0 && *out < outEnd) {
+                *(*out)++ = c;      /* Single letter: no run to keep */
+            } else {
+                s->letter = c;
+                s->pending = (s->digits > 0) ? s->count : 1;
+                s->count = 0;
+                s->digits = 0;
+            }
+        } else {
+            s->failed = 1;
+            break;
+        }
+        p++;
+    }
+
+    STATS_STOP(STATS_EXPAND, t, (size_t)(p - *in), (size_t)(*out - outStart));
+    *in = p;
+    if (s->failed)
+        return STREAM_INVALID;
+    return (s->pending > 0) ? STREAM_FULL : STREAM_OK;
+}
+
+/* ============================================================
+ * Function: expandStreamFinish
+ * Writes what is left of the last run. The input must have ended
+ * on a letter.
+ * ============================================================ */
+StreamStatus expandStreamFinish(ExpandStream *s, char **out, char *outEnd)
+{
+    if (s->failed || s->digits > 0 || !s->sawToken) {
+        s->failed = 1;
+        return STREAM_INVALID;
+    }
+    if (s->pending > 0 && !writePending(s, out, outEnd))
+        return STREAM_FULL;
+    return STREAM_OK;
+}
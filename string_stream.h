@@ -0,0 +1,72 @@
+/*
+ * string_stream.h
+ *
+ * Header file for incremental (streaming) compression/expansion.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef STRING_STREAM_H
+#define STRING_STREAM_H
+
+#include <stddef.h>
+#include "string_ops.h"
+
+/*
+ * Result of a feed / finish call.
+ * The stream functions take the unread input as [*in, inEnd) and
+ * the free output room as [*out, outEnd), and advance both
+ * pointers past what they used.
+ */
+typedef enum {
+    STREAM_OK,          /* All input used (finish: stream complete) */
+    STREAM_FULL,        /* Output room ran out; call again with more */
+    STREAM_INVALID      /* Not a valid string; the stream is dead */
+} StreamStatus;
+
+/* Compression state: the run still open at the end of the input */
+typedef struct {
+    size_t count;       /* Length of the open run (0: none yet) */
+    char letter;
+    int failed;
+} CompressStream;
+
+/* Expansion state: a count or a run split across feeds */
+typedef struct {
+    size_t count;       /* Value of the count digits read so far */
+    int digits;         /* How many count digits were read */
+    size_t pending;     /* Copies of 'letter' not yet written */
+    char letter;
+    int sawToken;       /* At least one letter was read */
+    int failed;
+} ExpandStream;
+
+/*
+ * compressStreamFeed consumes all input as long as at least
+ * COMPRESSED_RUN_MAX bytes of output room are left. Runs that
+ * continue past the end of a chunk are carried over, so the
+ * concatenated output equals compressString of the concatenated
+ * input. Invalid input (a non-letter, or no letters at all at
+ * finish) gives STREAM_INVALID; output written so far is then
+ * meaningless.
+ */
+void compressStreamInit(CompressStream *s);
+StreamStatus compressStreamFeed(CompressStream *s, const char **in, const char *inEnd,
+                                char **out, char *outEnd);
+StreamStatus compressStreamFinish(CompressStream *s, char **out, char *outEnd);
+
+/*
+ * Same for expansion: counts whose digits straddle two chunks are
+ * carried over, and a long run is written as far as the output
+ * room allows and resumed on the next call (with no more input if
+ * need be). The input must follow isValidCompressedString's rules.
+ */
+void expandStreamInit(ExpandStream *s);
+StreamStatus expandStreamFeed(ExpandStream *s, const char **in, const char *inEnd,
+                              char **out, char *outEnd);
+StreamStatus expandStreamFinish(ExpandStream *s, char **out, char *outEnd);
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ * check.h
+ *
+ * Minimal harness for the differential tests run by "make check".
+ * Each test program includes this once, records failures with
+ * CHECK / CHECK_MSG and ends main with checkDone. Inputs come from
+ * a fixed-seed generator, so a failure reproduces on every run.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Failures before a test stops printing them (it still counts them) */
+#define CHECK_MAX_REPORTS 20
+
+static int checkFailures = 0;
+static int checkCount = 0;
+
+/* Records one check; prints the first CHECK_MAX_REPORTS failures */
+#define CHECK_MSG(cond, ...)                                                 \
+    do {                                                                     \
+        checkCount++;                                                        \
+        if (!(cond) && checkFailures++ < CHECK_MAX_REPORTS) {                \
+            fprintf(stderr, "%s:%d: check failed: ", __FILE__, __LINE__);    \
+            fprintf(stderr, __VA_ARGS__);                                    \
+            fputc('\n', stderr);                                             \
+        }                                                                    \
+    } while (0)
+
+#define CHECK(cond) CHECK_MSG(cond, "%s", #cond)
+
+/* Prints the summary line; returns main's exit status */
+static inline int checkDone(const char *name)
+{
+    printf("%-24s %6d checks, %d failed\n", name, checkCount, checkFailures);
+    return checkFailures == 0 ? 0 : 1;
+}
+
+/* Fixed-seed generator shared by the tests */
+static inline unsigned checkRandom(unsigned *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 8;
+}
+
+/* Random integer in [lo, hi] */
+static inline int checkRange(unsigned *seed, int lo, int hi)
+{
+    return lo + (int)(checkRandom(seed) % (unsigned)(hi - lo + 1));
+}
+
+/*
+ * Writes a random infix expression of about 'operands' operands into
+ * buf (cap bytes, at least 64 per operand): literals of 1..maxDigits
+ * digits, every operator, random spacing and parentheses. One in
+ * 'invalidOdds' expressions (0: never) gets one byte corrupted.
+ * Returns its length.
+ */
+static inline size_t checkExpression(unsigned *seed, char *buf, size_t cap, int operands,
+                                     int maxDigits, int invalidOdds)
+{
+    static const char OPS[] = "+-*/%";
+    static const char BAD[] = "()+*x 9.";
+    size_t n = 0;
+    int open = 0, k, d;
+
+    for (k = 0; k < operands && n + 64 < cap; k++) {
+        if (k > 0) {
+            if (checkRandom(seed) % 3 == 0)
+                buf[n++] = ' ';
+            buf[n++] = OPS[checkRandom(seed) % 5];
+            if (checkRandom(seed) % 3 == 0)
+                buf[n++] = ' ';
+        }
+        while (k + 1 < operands && checkRandom(seed) % 4 == 0 && open < 40) {
+            buf[n++] = '(';
+            open++;
+        }
+        buf[n++] = (char)('1' + checkRandom(seed) % 9);
+        for (d = checkRange(seed, 1, maxDigits); d > 1; d--)
+            buf[n++] = (char)('0' + checkRandom(seed) % 10);
+        while (open > 0 && checkRandom(seed) % 3 == 0) {
+            buf[n++] = ')';
+            open--;
+        }
+    }
+    while (open-- > 0)
+        buf[n++] = ')';
+    if (invalidOdds > 0 && checkRandom(seed) % (unsigned)invalidOdds == 0)
+        buf[checkRandom(seed) % n] = BAD[checkRandom(seed) % (sizeof(BAD) - 1)];
+    buf[n] = '\0';
+    return n;
+}
+
+/*
+ * Writes 'len' letters in runs of 1..maxRun from a 'letters'-letter
+ * alphabet (upper and lower case) into buf and NUL-terminates it.
+ */
+static inline void checkLetters(unsigned *seed, char *buf, size_t len, int letters, int maxRun)
+{
+    size_t n = 0;
+
+    while (n < len) {
+        int i = checkRange(seed, 0, letters - 1);
+        char c = (char)((i % 2) ? 'A' + i / 2 : 'a' + i / 2);
+        int run = checkRange(seed, 1, maxRun);
+
+        while (run-- > 0 && n < len)
+            buf[n++] = c;
+    }
+    buf[n] = '\0';
+}
+
+#endif
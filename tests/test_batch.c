@@ -0,0 +1,355 @@
+/*
+ * test_batch.c
+ *
+ * Differential test of batch mode (batch.h): every eval, reduce,
+ * compress and expand run, serial or threaded, with or without the
+ * cache and async I/O, and every file-to-file run (mapped_file.h),
+ * must give line for line what the original isValidInfix /
+ * infixToPostfix / evaluatePostfix and isValidString /
+ * compressString / isValidCompressedString / expandString give for
+ * the same records.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include "check.h"
+#include "batch.h"
+#include "expression.h"
+#include "mapped_file.h"
+#include "string_ops.h"
+
+/* Records per generated input */
+#define EXPR_RECORDS 3000
+#define STRING_RECORDS 600
+
+/* Letters in each of the long records (split over threads) */
+#define LONG_RECORD (600 * 1024)
+
+/* Files of the runMappedFile checks */
+#define MAPPED_INPUT "test_batch.in"
+#define MAPPED_OUTPUT "test_batch.out"
+
+/* Growable text */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Text;
+
+static void append(Text *t, const char *s, size_t n)
+{
+    if (t->len + n + 1 > t->cap) {
+        size_t cap = t->cap ? t->cap : 4096;
+
+        while (cap < t->len + n + 1)
+            cap *= 2;
+        if ((t->data = realloc(t->data, cap)) == NULL)
+            exit(2);
+        t->cap = cap;
+    }
+    memcpy(t->data + t->len, s, n);
+    t->len += n;
+    t->data[t->len] = '\0';
+}
+
+static void appendLine(Text *t, const char *s)
+{
+    append(t, s, strlen(s));
+    append(t, "\n", 1);
+}
+
+/* ============================================================
+ * Baseline results of one record
+ * ============================================================ */
+static void expectEval(Text *expected, const char *line)
+{
+    char *postfix, *text;
+    ExprValue value = EXPR_VALUE_INIT;
+
+    if (!isValidInfix(line)) {
+        appendLine(expected, "error:");
+        return;
+    }
+    postfix = malloc(2 * strlen(line) + 1);
+    if (postfix == NULL)
+        exit(2);
+    infixToPostfix(line, postfix);
+    if (evaluatePostfix(postfix, &value) != EXPR_OK ||
+        (text = malloc(exprValueTextSize(&value))) == NULL)
+        exit(2);
+    exprValueToText(&value, text);
+    appendLine(expected, text);
+    free(text);
+    free(postfix);
+    freeExprValue(&value);
+}
+
+static void expectCompress(Text *expected, const char *line)
+{
+    char *packed;
+
+    if (!isValidString(line)) {
+        appendLine(expected, "error:");
+        return;
+    }
+    if ((packed = malloc(strlen(line) + 1)) == NULL)
+        exit(2);
+    compressString(line, packed);
+    appendLine(expected, packed);
+    free(packed);
+}
+
+static void expectExpand(Text *expected, const char *line)
+{
+    char *text;
+
+    if (!isValidCompressedString(line)) {
+        appendLine(expected, "error:");
+        return;
+    }
+    if ((text = malloc(expandedSize(line, strlen(line)) + 1)) == NULL)
+        exit(2);
+    expandString(line, text);
+    appendLine(expected, text);
+    free(text);
+}
+
+/* ============================================================
+ * Inputs: random records plus the edge cases of each mode
+ * ============================================================ */
+static void makeExpressions(Text *input)
+{
+    static const char *EDGES[] = {
+        "", "   ", "(", ")", "1 2", "1/0", "7 % 0", "-5", "((((((9))))))",
+        "9223372036854775807 + 1", "0 - 9223372036854775807 - 1",
+        "123456789012345678901234567890 * 98765432109876543210"
+    };
+    unsigned seed = 101;
+    char buf[4096];
+    size_t i;
+
+    for (i = 0; i < sizeof(EDGES) / sizeof(EDGES[0]); i++)
+        appendLine(input, EDGES[i]);
+    for (i = 0; i < EXPR_RECORDS; i++) {
+        checkExpression(&seed, buf, sizeof(buf), checkRange(&seed, 1, 20),
+                        (i % 5 == 0) ? 19 : 4, 8);
+        appendLine(input, buf);
+    }
+}
+
+/* A record of LONG_RECORD letters in short runs, compressed or not,
+ * with one bad byte near the end if 'corrupt' */
+static void appendLong(Text *input, unsigned *seed, int compressed, int corrupt)
+{
+    char *buf = malloc(LONG_RECORD + 1), *packed = malloc(LONG_RECORD + 1);
+    char *record = compressed ? packed : buf;
+
+    if (buf == NULL || packed == NULL)
+        exit(2);
+    checkLetters(seed, buf, LONG_RECORD, 52, 3);
+    compressString(buf, packed);
+    if (corrupt)
+        record[strlen(record) - 5] = compressed ? '-' : '7';
+    appendLine(input, record);
+    free(buf);
+    free(packed);
+}
+
+static void makeLetters(Text *input)
+{
+    static const char *EDGES[] = { "", "a", "Zz", "aaaaaaaaaaaa", "ab1", "a b", "3a" };
+    unsigned seed = 202;
+    char buf[8192];
+    size_t i;
+
+    for (i = 0; i < sizeof(EDGES) / sizeof(EDGES[0]); i++)
+        appendLine(input, EDGES[i]);
+    for (i = 0; i < STRING_RECORDS; i++) {
+        checkLetters(&seed, buf, (size_t)checkRange(&seed, 1, 4000),
+                     checkRange(&seed, 1, 52), checkRange(&seed, 1, 30));
+        if (i % 10 == 0)
+            buf[checkRandom(&seed) % strlen(buf)] = '7';
+        appendLine(input, buf);
+    }
+    appendLong(input, &seed, 0, 0);
+    appendLong(input, &seed, 0, 1);
+}
+
+static void makeCompressed(Text *input)
+{
+    static const char *EDGES[] = { "", "a", "1a", "0a", "01a", "12", "a12", "2a3b", "99z" };
+    unsigned seed = 303;
+    char buf[8192], packed[8192];
+    size_t i;
+
+    for (i = 0; i < sizeof(EDGES) / sizeof(EDGES[0]); i++)
+        appendLine(input, EDGES[i]);
+    for (i = 0; i < STRING_RECORDS; i++) {
+        checkLetters(&seed, buf, (size_t)checkRange(&seed, 1, 4000),
+                     checkRange(&seed, 1, 52), checkRange(&seed, 1, 300));
+        compressString(buf, packed);
+        if (i % 10 == 0)
+            packed[checkRandom(&seed) % strlen(packed)] = '-';
+        appendLine(input, packed);
+    }
+    appendLong(input, &seed, 1, 0);
+    appendLong(input, &seed, 1, 1);
+}
+
+/* ============================================================
+ * Helper: runOn
+ * runBatch over a temporary file; returns the output.
+ * ============================================================ */
+static void runOn(BatchMode mode, const Text *input, const BatchOptions *opts, Text *output)
+{
+    FILE *in = tmpfile(), *out = tmpfile();
+    char buf[65536];
+    size_t n;
+
+    if (in == NULL || out == NULL || fwrite(input->data, 1, input->len, in) != input->len)
+        exit(2);
+    rewind(in);
+    CHECK(runBatch(mode, in, out, opts) == 0);
+    rewind(out);
+    output->len = 0;
+    while ((n = fread(buf, 1, sizeof(buf), out)) > 0)
+        append(output, buf, n);
+    fclose(in);
+    fclose(out);
+}
+
+/* ============================================================
+ * Helper: compareLines
+ * An "error:" expectation matches any error line; anything else
+ * must match exactly.
+ * ============================================================ */
+static void compareLines(const char *label, const Text *expected, const Text *actual)
+{
+    const char *e = expected->data, *a = actual->data;
+    int line = 1;
+
+    CHECK_MSG(a != NULL, "%s: no output", label);
+    if (a == NULL)
+        return;
+    while (*e != '\0' && *a != '\0') {
+        size_t el = strcspn(e, "\n"), al = strcspn(a, "\n");
+        int same = (el == 6 && strncmp(e, "error:", 6) == 0)
+            ? (al > 6 && strncmp(a, "error: ", 7) == 0)
+            : (el == al && memcmp(e, a, el) == 0);
+
+        CHECK_MSG(same, "%s: line %d: expected %.*s, got %.*s", label, line,
+                  (int)(el < 60 ? el : 60), e, (int)(al < 60 ? al : 60), a);
+        e += el + (e[el] == '\n');
+        a += al + (a[al] == '\n');
+        line++;
+    }
+    CHECK_MSG(*e == '\0' && *a == '\0', "%s: %s output ends early at line %d",
+              label, *e != '\0' ? "actual" : "expected", line);
+}
+
+/* Runs one mode under every option set */
+static void checkMode(const char *name, BatchMode mode, const Text *input, const Text *expected)
+{
+    static const int THREADS[] = { 1, 4 };
+    Text output = { NULL, 0, 0 };
+    int t, async, cache;
+
+    for (t = 0; t < 2; t++) {
+        for (async = 0; async < 2; async++) {
+            for (cache = 0; cache < 2; cache++) {
+                BatchOptions opts;
+                char label[64];
+
+                initBatchOptions(&opts);
+                opts.threads = THREADS[t];
+                opts.asyncIo = async;
+                if (!cache)
+                    opts.cacheCapacity = 0;
+                snprintf(label, sizeof(label), "%s threads=%d io=%s cache=%d", name,
+                         opts.threads, async ? "async" : "sync", opts.cacheCapacity);
+                runOn(mode, input, &opts, &output);
+                compareLines(label, expected, &output);
+            }
+        }
+    }
+    free(output.data);
+}
+
+/* ============================================================
+ * Helper: checkMapped
+ * runMappedFile from file to file, on one thread and on four.
+ * ============================================================ */
+static void checkMapped(const char *name, BatchMode mode, const Text *input, const Text *expected)
+{
+    Text output = { NULL, 0, 0 };
+    int threads;
+
+    for (threads = 1; threads <= 4; threads += 3) {
+        BatchOptions opts;
+        FILE *f = fopen(MAPPED_INPUT, "wb");
+        char label[64], buf[65536];
+        size_t n;
+
+        if (f == NULL || fwrite(input->data, 1, input->len, f) != input->len || fclose(f) != 0)
+            exit(2);
+        initBatchOptions(&opts);
+        opts.threads = threads;
+        CHECK(runMappedFile(mode, MAPPED_INPUT, MAPPED_OUTPUT, &opts) == 0);
+        if ((f = fopen(MAPPED_OUTPUT, "rb")) == NULL)
+            exit(2);
+        output.len = 0;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+            append(&output, buf, n);
+        fclose(f);
+        snprintf(label, sizeof(label), "%s mapped threads=%d", name, threads);
+        compareLines(label, expected, &output);
+    }
+    remove(MAPPED_INPUT);
+    remove(MAPPED_OUTPUT);
+    free(output.data);
+}
+
+/* Expected output of every line of input */
+static void expectAll(const Text *input, void (*expect)(Text *, const char *), Text *expected)
+{
+    char *copy = malloc(input->len + 1), *line, *nl;
+
+    if (copy == NULL)
+        exit(2);
+    memcpy(copy, input->data, input->len + 1);
+    for (line = copy; *line != '\0'; line = nl + 1) {
+        nl = strchr(line, '\n');
+        *nl = '\0';
+        expect(expected, line);
+    }
+    free(copy);
+}
+
+int main(void)
+{
+    Text input = { NULL, 0, 0 }, expected = { NULL, 0, 0 };
+
+    makeExpressions(&input);
+    expectAll(&input, expectEval, &expected);
+    checkMode("eval", BATCH_EVAL, &input, &expected);
+    checkMode("reduce", BATCH_REDUCE, &input, &expected);
+
+    input.len = expected.len = 0;
+    makeLetters(&input);
+    expectAll(&input, expectCompress, &expected);
+    checkMode("compress", BATCH_COMPRESS, &input, &expected);
+    checkMapped("compress", BATCH_COMPRESS, &input, &expected);
+
+    input.len = expected.len = 0;
+    makeCompressed(&input);
+    expectAll(&input, expectExpand, &expected);
+    checkMode("expand", BATCH_EXPAND, &input, &expected);
+    checkMapped("expand", BATCH_EXPAND, &input, &expected);
+
+    free(input.data);
+    free(expected.data);
+    return checkDone("test_batch");
+}
@@ -0,0 +1,236 @@
+/*
+ * test_bigint.c
+ *
+ * Differential test of the checked 64-bit arithmetic and its BigInt
+ * promotion (combineExprValues, bigint.h): results that fit in 128
+ * bits must match __int128 arithmetic, and isBig must be set exactly
+ * when a result leaves long long (both ways: promotion on overflow,
+ * demotion when a BigInt result fits again). Longer values are
+ * checked through the division identities and a decimal round trip.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <limits.h>
+#include "check.h"
+#include "expression.h"
+
+/* Random operand pairs per class */
+#define PAIRS 20000
+
+/* Longest random decimal operand */
+#define MAX_DIGITS 300
+
+typedef __int128 Wide;
+
+static const char OPS[] = "+-*/%";
+
+static int fitsLong(Wide v)
+{
+    return v >= LLONG_MIN && v <= LLONG_MAX;
+}
+
+/* Decimal text of a Wide */
+static const char *wideText(Wide v, char *buf)
+{
+    char digits[48];
+    unsigned __int128 u = (v < 0) ? -(unsigned __int128)v : (unsigned __int128)v;
+    int n = 0, k = 0;
+
+    do {
+        digits[n++] = (char)('0' + (int)(u % 10));
+        u /= 10;
+    } while (u != 0);
+    if (v < 0)
+        buf[k++] = '-';
+    while (n > 0)
+        buf[k++] = digits[--n];
+    buf[k] = '\0';
+    return buf;
+}
+
+/* Sets a value from decimal text (optional '-'), normalized */
+static void setValue(ExprValue *v, const char *text)
+{
+    int negative = (*text == '-');
+    BigInt zero = BIGINT_INIT;
+
+    text += negative;
+    if (!bigSetDecimal(&v->big, text, strlen(text)) ||
+        (negative && !bigSub(&v->big, &zero, &v->big)))
+        exit(2);
+    v->isBig = !bigToLong(&v->big, &v->small);
+}
+
+/* Text of a value (static buffer per slot) */
+static const char *text(const ExprValue *v, int slot)
+{
+    static char buf[4][2 * MAX_DIGITS + 8];
+
+    if (exprValueTextSize(v) > sizeof(buf[0]) || exprValueToText(v, buf[slot]) == 0)
+        exit(2);
+    return buf[slot];
+}
+
+/* a op b under the evaluators' rules: / and % by zero give 0 */
+static Wide wideApply(Wide a, char op, Wide b)
+{
+    switch (op) {
+        case '+': return a + b;
+        case '-': return a - b;
+        case '*': return a * b;
+        case '/': return (b == 0) ? 0 : a / b;
+        default:  return (b == 0) ? 0 : a % b;
+    }
+}
+
+/* ============================================================
+ * Helper: checkWide
+ * a op b through combineExprValues against __int128 (operands and
+ * result must fit in 127 bits).
+ * ============================================================ */
+static void checkWide(Wide a, char op, Wide b)
+{
+    ExprValue va = EXPR_VALUE_INIT, vb = EXPR_VALUE_INIT;
+    Wide want = wideApply(a, op, b);
+    char ta[48], tb[48], tw[48];
+    int fits = fitsLong(want);
+
+    setValue(&va, wideText(a, ta));
+    setValue(&vb, wideText(b, tb));
+    CHECK(combineExprValues(&va, op, &vb) == EXPR_OK);
+    CHECK_MSG(strcmp(text(&va, 0), wideText(want, tw)) == 0, "%s %c %s = %s, expected %s",
+              ta, op, tb, text(&va, 0), tw);
+    CHECK_MSG(va.isBig == !fits, "%s %c %s: isBig %d for %s", ta, op, tb, va.isBig, tw);
+    freeExprValue(&va);
+    freeExprValue(&vb);
+}
+
+/* Random Wide of 1..bits bits, either sign */
+static Wide randomWide(unsigned *seed, int bits)
+{
+    unsigned __int128 u = 0;
+    int i, n = checkRange(seed, 1, bits);
+
+    for (i = 0; i < 4; i++)
+        u = (u << 32) | (checkRandom(seed) ^ (checkRandom(seed) << 16));
+    u >>= 128 - n;
+    return (checkRandom(seed) % 2) ? -(Wide)u : (Wide)u;
+}
+
+/* Random decimal of 1..maxDigits digits, either sign */
+static void randomDecimal(unsigned *seed, char *buf, int maxDigits)
+{
+    int n = checkRange(seed, 1, maxDigits), k = 0, i;
+
+    if (checkRandom(seed) % 2)
+        buf[k++] = '-';
+    buf[k++] = (char)('1' + checkRandom(seed) % 9);
+    for (i = 1; i < n; i++)
+        buf[k++] = (char)('0' + checkRandom(seed) % 10);
+    buf[k] = '\0';
+}
+
+/* ============================================================
+ * Helper: checkIdentities
+ * Long operands: (a*b)/b == a, (a*b)%b == 0, (a/b)*b + a%b == a
+ * with |a%b| < |b| and the sign of a, (a+b)-b == a, and the text
+ * of every result reads back to the same value.
+ * ============================================================ */
+static void checkIdentities(const char *ta, const char *tb)
+{
+    ExprValue a = EXPR_VALUE_INIT, b = EXPR_VALUE_INIT, x = EXPR_VALUE_INIT,
+              y = EXPR_VALUE_INIT, back = EXPR_VALUE_INIT;
+    BigInt ra = BIGINT_INIT, rb = BIGINT_INIT;
+
+    setValue(&a, ta);
+    setValue(&b, tb);
+    CHECK_MSG(strcmp(text(&a, 0), ta) == 0, "round trip %s -> %s", ta, text(&a, 0));
+
+    /* (a*b)/b == a, (a*b)%b == 0 */
+    copyExprValue(&x, &a);
+    CHECK(combineExprValues(&x, '*', &b) == EXPR_OK);
+    copyExprValue(&y, &x);
+    CHECK(combineExprValues(&x, '/', &b) == EXPR_OK);
+    CHECK_MSG(strcmp(text(&x, 1), ta) == 0, "(%s * %s) / b = %s", ta, tb, text(&x, 1));
+    CHECK_MSG(!x.isBig == !a.isBig, "(%s * %s) / b: isBig %d", ta, tb, x.isBig);
+    CHECK(combineExprValues(&y, '%', &b) == EXPR_OK);
+    CHECK_MSG(!y.isBig && y.small == 0, "(%s * %s) %% b = %s", ta, tb, text(&y, 1));
+
+    /* (a/b)*b + a%b == a, |a%b| < |b|, a%b has the sign of a */
+    copyExprValue(&x, &a);
+    copyExprValue(&y, &a);
+    CHECK(combineExprValues(&x, '/', &b) == EXPR_OK);
+    CHECK(combineExprValues(&y, '%', &b) == EXPR_OK);
+    if (y.isBig)
+        bigCopy(&ra, &y.big);
+    else
+        bigSetLong(&ra, y.small);
+    if (b.isBig)
+        bigCopy(&rb, &b.big);
+    else
+        bigSetLong(&rb, b.small);
+    ra.negative = rb.negative = 0;
+    CHECK_MSG(bigCompare(&ra, &rb) < 0, "|%s %% %s| >= |b|", ta, tb);
+    CHECK_MSG(ra.len == 0 || (text(&y, 1)[0] == '-') == (ta[0] == '-'),
+              "sign of %s %% %s = %s", ta, tb, text(&y, 1));
+    CHECK(combineExprValues(&x, '*', &b) == EXPR_OK);
+    CHECK(combineExprValues(&x, '+', &y) == EXPR_OK);
+    CHECK_MSG(strcmp(text(&x, 1), ta) == 0, "(%s / %s) * b + a %% b = %s", ta, tb, text(&x, 1));
+
+    /* (a+b)-b == a, normalized on the way back */
+    copyExprValue(&x, &a);
+    CHECK(combineExprValues(&x, '+', &b) == EXPR_OK);
+    setValue(&back, text(&x, 2));
+    CHECK_MSG(back.isBig == x.isBig && strcmp(text(&back, 3), text(&x, 2)) == 0,
+              "%s + %s: not normalized (%s)", ta, tb, text(&x, 2));
+    CHECK(combineExprValues(&x, '-', &b) == EXPR_OK);
+    CHECK_MSG(strcmp(text(&x, 1), ta) == 0 && x.isBig == a.isBig, "(%s + %s) - b = %s",
+              ta, tb, text(&x, 1));
+
+    bigFree(&ra);
+    bigFree(&rb);
+    freeExprValue(&a);
+    freeExprValue(&b);
+    freeExprValue(&x);
+    freeExprValue(&y);
+    freeExprValue(&back);
+}
+
+int main(void)
+{
+    static const Wide EDGES[] = {
+        0, 1, -1, 2, -2, 3, 10, INT_MAX, INT_MIN, (Wide)INT_MAX + 1, 3037000499LL, 3037000500LL,
+        LLONG_MAX, LLONG_MIN, LLONG_MAX - 1, LLONG_MIN + 1, (Wide)LLONG_MAX + 1,
+        (Wide)LLONG_MIN - 1, (Wide)LLONG_MAX * 2, -(Wide)LLONG_MAX * 2, (Wide)1 << 100
+    };
+    const int edges = (int)(sizeof(EDGES) / sizeof(EDGES[0]));
+    static char ta[MAX_DIGITS + 2], tb[MAX_DIGITS + 2];
+    unsigned seed = 606;
+    int i, j, k;
+
+    /* Every operator on every pair of edges (products kept in range) */
+    for (i = 0; i < edges; i++)
+        for (j = 0; j < edges; j++)
+            for (k = 0; k < 5; k++)
+                if (OPS[k] != '*' || (fitsLong(EDGES[i]) && fitsLong(EDGES[j])))
+                    checkWide(EDGES[i], OPS[k], EDGES[j]);
+
+    /* Near the 64-bit edge: promotion and demotion */
+    for (i = 0; i < PAIRS; i++) {
+        checkWide(randomWide(&seed, 64), OPS[i % 5], randomWide(&seed, (i % 5 == 2) ? 63 : 64));
+        checkWide(randomWide(&seed, 100), OPS[i % 5], randomWide(&seed, (i % 5 == 2) ? 26 : 100));
+        checkWide(randomWide(&seed, 63), OPS[i % 5], randomWide(&seed, 8));
+    }
+
+    /* Long values */
+    for (i = 0; i < PAIRS / 10; i++) {
+        randomDecimal(&seed, ta, (i % 3 == 0) ? 20 : MAX_DIGITS);
+        randomDecimal(&seed, tb, (i % 2 == 0) ? 19 : MAX_DIGITS);
+        checkIdentities(ta, tb);
+    }
+    return checkDone("test_bigint");
+}
@@ -0,0 +1,189 @@
+/*
+ * test_binary.c
+ *
+ * Differential test of the binary run-length format
+ * (string_binary.h): any bytes must decode back to themselves,
+ * text converted to binary must decode to what expandString gives,
+ * and binary converted back must be the text compressString gives.
+ * Runs cross block ends and need multi-byte varints on purpose.
+ * Every truncation and every single-byte change of an encoding
+ * must be rejected, and no call may write past the size its
+ * header promises.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include "check.h"
+#include "string_binary.h"
+#include "string_ops.h"
+
+/* Longest random input (several blocks of single-byte runs) */
+#define MAX_LEN (5 * BINARY_BLOCK_SIZE)
+
+/* Random inputs per shape */
+#define INPUTS 60
+
+/* Bytes after every output that no call may touch */
+#define GUARD 64
+
+static char raw[MAX_LEN + 1], text[2 * MAX_LEN + GUARD], back[MAX_LEN + GUARD];
+static unsigned char encoded[2 * MAX_LEN + 64 + GUARD];
+
+/* Fills the guard after n bytes of out */
+static void setGuard(void *out, size_t n)
+{
+    memset((char *)out + n, 0x5a, GUARD);
+}
+
+static int guardIntact(const void *out, size_t n)
+{
+    const unsigned char *g = (const unsigned char *)out + n;
+    size_t i;
+
+    for (i = 0; i < GUARD; i++)
+        if (g[i] != 0x5a)
+            return 0;
+    return 1;
+}
+
+/* ============================================================
+ * Helper: checkRoundTrip
+ * raw[0..len) through binaryEncodeRange and binaryDecode.
+ * ============================================================ */
+static size_t checkRoundTrip(const char *name, size_t len)
+{
+    size_t bound = binaryEncodedBound(len), n, m;
+
+    setGuard(encoded, bound);
+    n = binaryEncodeRange(raw, len, encoded);
+    CHECK_MSG(n <= bound && guardIntact(encoded, bound), "%s (%zu bytes): encoded %zu, bound %zu",
+              name, len, n, bound);
+    CHECK_MSG(binaryDecodedSize(encoded, n) == len, "%s: decoded size %zu, expected %zu",
+              name, binaryDecodedSize(encoded, n), len);
+    setGuard(back, len);
+    m = binaryDecode(encoded, n, back);
+    CHECK_MSG(m == len && memcmp(back, raw, len) == 0 && guardIntact(back, len),
+              "%s (%zu bytes): round trip gave %zd bytes", name, len, (ssize_t)m);
+    return n;
+}
+
+/* ============================================================
+ * Helper: checkText
+ * Letters raw[0..len) against the text functions: the compressed
+ * text converts to binary that decodes to the letters, and the
+ * binary of the letters converts to that same text.
+ * ============================================================ */
+static void checkText(const char *name, size_t len)
+{
+    size_t textLen, n, m;
+
+    raw[len] = '\0';
+    compressString(raw, text);
+    textLen = strlen(text);
+
+    setGuard(encoded, binaryEncodedBound(textLen));
+    n = textToBinary(text, textLen, encoded);
+    CHECK_MSG(n != (size_t)-1 && guardIntact(encoded, binaryEncodedBound(textLen)),
+              "%s: textToBinary failed or overran", name);
+    if (n == (size_t)-1)
+        return;
+    m = binaryDecode(encoded, n, back);
+    CHECK_MSG(m == len && memcmp(back, raw, len) == 0, "%s: text -> binary -> bytes", name);
+
+    n = binaryEncodeRange(raw, len, encoded);
+    setGuard(back, 2 * n < MAX_LEN ? 2 * n : MAX_LEN);
+    m = binaryToText(encoded, n, back);
+    CHECK_MSG(m == textLen && memcmp(back, text, textLen) == 0,
+              "%s: binary -> text (%zd bytes, expected %zu)", name, (ssize_t)m, textLen);
+    CHECK_MSG(2 * n >= MAX_LEN || guardIntact(back, 2 * n),
+              "%s: binaryToText wrote past 2 * len", name);
+}
+
+/* ============================================================
+ * Helper: checkDamage
+ * Every truncation and every single-byte change of a short
+ * encoding must be rejected.
+ * ============================================================ */
+static void checkDamage(const char *name, size_t len)
+{
+    size_t n = binaryEncodeRange(raw, len, encoded), i;
+
+    for (i = 0; i < n; i++) {
+        CHECK_MSG(binaryDecode(encoded, i, back) == (size_t)-1, "%s: truncated to %zu of %zu bytes accepted",
+                  name, i, n);
+    }
+    for (i = 0; i < n; i++) {
+        unsigned char saved = encoded[i];
+        size_t size;
+
+        encoded[i] ^= (unsigned char)(1u << (i % 8));
+        size = binaryDecodedSize(encoded, n);
+        CHECK_MSG(size > MAX_LEN || binaryDecode(encoded, n, back) == (size_t)-1,
+                  "%s: byte %zu of %zu changed, accepted", name, i, n);
+        encoded[i] = saved;
+    }
+}
+
+/* Random bytes of any value in runs of 1..maxRun */
+static void randomBytes(unsigned *seed, size_t len, int maxRun)
+{
+    size_t n = 0;
+
+    while (n < len) {
+        char c = (char)(checkRandom(seed) & 0xff);
+        int run = checkRange(seed, 1, maxRun);
+
+        while (run-- > 0 && n < len)
+            raw[n++] = c;
+    }
+}
+
+int main(void)
+{
+    /* Run lengths at the varint edges */
+    static const size_t EDGES[] = { 1, 2, 127, 128, 129, 16383, 16384, 16385, 2 * BINARY_BLOCK_SIZE + 7 };
+    unsigned seed = 1111;
+    size_t i, len;
+
+    checkRoundTrip("empty", 0);
+    CHECK(binaryToText(encoded, binaryEncodeRange(raw, 0, encoded), back) == (size_t)-1);
+    CHECK(textToBinary("3a0b", 4, encoded) == (size_t)-1);
+    CHECK(textToBinary("", 0, encoded) == (size_t)-1);
+    CHECK(textToBinary("99999999999999999999999a", 24, encoded) == (size_t)-1);
+    CHECK(binaryDecodedSize((const unsigned char *)"PE1", 3) == (size_t)-1);
+
+    for (i = 0; i < sizeof(EDGES) / sizeof(EDGES[0]); i++) {
+        memset(raw, 'k', EDGES[i]);
+        raw[EDGES[i]] = 'j';
+        checkRoundTrip("edge run", EDGES[i] + 1);
+        checkText("edge run", EDGES[i] + 1);
+    }
+
+    /* Single-byte runs fill a block and cut pairs at its end */
+    for (len = BINARY_BLOCK_SIZE / 2 - 3; len <= BINARY_BLOCK_SIZE / 2 + 3; len++) {
+        randomBytes(&seed, 2 * len, 1);
+        checkRoundTrip("block end", 2 * len);
+    }
+
+    for (i = 0; i < INPUTS; i++) {
+        len = (size_t)checkRange(&seed, 0, MAX_LEN);
+        randomBytes(&seed, len, (i % 2) ? 3 : 300);
+        checkRoundTrip("random bytes", len);
+
+        len = (size_t)checkRange(&seed, 1, MAX_LEN / 2);
+        checkLetters(&seed, raw, len, checkRange(&seed, 1, 8), (i % 3) ? 40 : 20000);
+        checkRoundTrip("letters", len);
+        checkText("letters", len);
+
+        randomBytes(&seed, 64, 5);
+        checkDamage("short", (size_t)checkRange(&seed, 1, 64));
+    }
+
+    /* binaryToText takes letters only */
+    memcpy(raw, "aa7bb", 5);
+    CHECK(binaryToText(encoded, binaryEncodeRange(raw, 5, encoded), back) == (size_t)-1);
+    return checkDone("test_binary");
+}
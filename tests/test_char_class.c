@@ -0,0 +1,218 @@
+/*
+ * test_char_class.c
+ *
+ * Differential test of the character-class kernels (char_class.c):
+ * every kernel this CPU supports (classifyUseKernel) must classify
+ * a block and span letters as the CHAR_CLASS table does, bytes
+ * from 0x80 up included. Through each kernel, checkString and
+ * checkCompressed must report the offset the byte-by-byte rules
+ * give on digit / letter / junk input, with counts across 64-byte
+ * blocks and input ending anywhere in a block.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include "check.h"
+#include "char_class.h"
+#include "string_ops.h"
+
+/* Longest input, and random inputs per kernel */
+#define MAX_LEN (5 * CLASS_BLOCK)
+#define INPUTS 20000
+
+static const char *KERNELS[] = { "scalar", "sse2", "avx2" };
+
+/* Bytes past the input are digits, so a kernel that reads them shows it */
+static char input[MAX_LEN + CLASS_BLOCK];
+
+/* ============================================================
+ * Helper: tableClasses
+ * The masks of one block from CHAR_CLASS, a byte at a time.
+ * ============================================================ */
+static void tableClasses(const char *s, BlockClasses *c)
+{
+    int k;
+
+    memset(c, 0, sizeof(*c));
+    for (k = 0; k < CLASS_BLOCK; k++) {
+        c->alpha |= (uint64_t)(IS_ALPHA(s[k]) != 0) << k;
+        c->digit |= (uint64_t)(IS_DIGIT(s[k]) != 0) << k;
+        c->zero |= (uint64_t)(s[k] == '0') << k;
+        c->one |= (uint64_t)(s[k] == '1') << k;
+    }
+}
+
+/* ============================================================
+ * Helper: byteRules
+ * The original byte-by-byte check of a compressed string: a count
+ * starts at a digit with no digit before it and ends at a digit
+ * with no digit after it. A count that starts with '0', or is a
+ * lone '1', is invalid, as is any byte that is neither digit nor
+ * letter. A count cut off by the end is reported at len.
+ * ============================================================ */
+static size_t byteRules(const char *s, size_t len)
+{
+    size_t i;
+
+    if (len == 0)
+        return 0;
+    for (i = 0; i < len; i++) {
+        int start = IS_DIGIT(s[i]) && (i == 0 || !IS_DIGIT(s[i - 1]));
+        int end = IS_DIGIT(s[i]) && (i + 1 == len || !IS_DIGIT(s[i + 1]));
+
+        if (!IS_DIGIT(s[i]) && !IS_ALPHA(s[i]))
+            return i;
+        if (start && (s[i] == '0' || (end && s[i] == '1')))
+            return i;
+    }
+    return IS_DIGIT(s[len - 1]) ? len : CHECK_VALID;
+}
+
+/* First byte that is not a letter, or CHECK_VALID */
+static size_t letterRules(const char *s, size_t len)
+{
+    size_t i;
+
+    if (len == 0)
+        return 0;
+    for (i = 0; i < len && IS_ALPHA(s[i]); i++)
+        ;
+    return (i == len) ? CHECK_VALID : i;
+}
+
+/* ============================================================
+ * Helper: checkBlock
+ * classifyBlock at s against the table.
+ * ============================================================ */
+static void checkBlock(const char *kernel, const char *s)
+{
+    BlockClasses got, want;
+
+    classifyBlock(s, &got);
+    tableClasses(s, &want);
+    CHECK_MSG(got.alpha == want.alpha && got.digit == want.digit && got.zero == want.zero &&
+              got.one == want.one, "%s: classifyBlock differs from the table", kernel);
+}
+
+/* ============================================================
+ * Helper: checkValidators
+ * spanAlpha, checkString and checkCompressed on input[0..len)
+ * against the table and the byte rules.
+ * ============================================================ */
+static void checkValidators(const char *kernel, const char *shape, size_t len)
+{
+    char saved[CLASS_BLOCK];
+    size_t want = byteRules(input, len), span = letterRules(input, len), got;
+
+    memcpy(saved, input + len, CLASS_BLOCK);
+    memset(input + len, '7', CLASS_BLOCK);
+    got = checkCompressed(input, len);
+    CHECK_MSG(got == want, "%s, %s (%zu bytes): checkCompressed %zd, byte rules %zd", kernel, shape,
+              len, (ssize_t)got, (ssize_t)want);
+    got = checkString(input, len);
+    CHECK_MSG(got == span, "%s, %s (%zu bytes): checkString %zd, expected %zd", kernel, shape, len,
+              (ssize_t)got, (ssize_t)span);
+    CHECK_MSG(spanAlpha(input, len) == ((span == CHECK_VALID) ? len : span),
+              "%s, %s (%zu bytes): spanAlpha %zu", kernel, shape, len, spanAlpha(input, len));
+    memcpy(input + len, saved, CLASS_BLOCK);
+}
+
+/* Random compressed-looking text: mostly counts and letters, some junk */
+static void randomText(unsigned *seed, size_t len, int junkOdds)
+{
+    static const char JUNK[] = " -.\x80\xff\x7f\t/:@[`{";
+    size_t i = 0;
+
+    while (i < len) {
+        unsigned r = checkRandom(seed) % 100;
+
+        if (junkOdds > 0 && r < (unsigned)junkOdds) {
+            input[i++] = JUNK[checkRandom(seed) % (sizeof(JUNK) - 1)];
+        } else if (r < 50) {
+            int digits = checkRange(seed, 1, (r % 7 == 0) ? 90 : 4);
+
+            while (digits-- > 0 && i < len)
+                input[i++] = (char)('0' + checkRandom(seed) % 10);
+        } else {
+            input[i++] = (char)((r % 2 ? 'a' : 'A') + checkRandom(seed) % 26);
+        }
+    }
+}
+
+/* ============================================================
+ * Helper: checkKernel
+ * Every shape through one kernel.
+ * ============================================================ */
+static void checkKernel(unsigned *seed, const char *kernel)
+{
+    static const char *COUNTS[] = { "0", "1", "9", "10", "01", "12", "11", "1000", "0123" };
+    char block[CLASS_BLOCK];
+    size_t len, at, i;
+    int b, k;
+
+    /* Every byte value, alone and at every position */
+    for (b = 0; b < 256; b++) {
+        memset(block, b, CLASS_BLOCK);
+        checkBlock(kernel, block);
+        for (k = 0; k < CLASS_BLOCK; k += 7) {
+            memset(block, 'q', CLASS_BLOCK);
+            block[k] = (char)b;
+            checkBlock(kernel, block);
+        }
+    }
+    for (i = 0; i < (size_t)INPUTS / 10; i++) {
+        for (k = 0; k < CLASS_BLOCK; k++)
+            block[k] = (char)checkRandom(seed);
+        checkBlock(kernel, block);
+    }
+
+    /* A count on every side of each block boundary, input ending anywhere */
+    for (at = CLASS_BLOCK - 4; at <= 3 * CLASS_BLOCK + 4; at++) {
+        for (i = 0; i < sizeof(COUNTS) / sizeof(COUNTS[0]); i++) {
+            size_t n = strlen(COUNTS[i]);
+
+            memset(input, 'x', MAX_LEN);
+            memcpy(input + at - n / 2, COUNTS[i], n);
+            for (len = at - 3; len <= at + 3; len++)
+                checkValidators(kernel, "count at a boundary", len);
+            checkValidators(kernel, "count at a boundary", MAX_LEN);
+        }
+    }
+
+    /* A non-letter at every offset of letters */
+    for (at = 0; at < 3 * CLASS_BLOCK; at++) {
+        memset(input, 'k', MAX_LEN);
+        input[at] = (char)((at % 3 == 0) ? 0x80 : (at % 3 == 1) ? '5' : '\0');
+        checkValidators(kernel, "one non-letter", (at % 2) ? at + 1 : 3 * CLASS_BLOCK);
+    }
+
+    for (i = 0; i < INPUTS; i++) {
+        len = (size_t)checkRange(seed, 0, (i % 4 == 0) ? MAX_LEN : 2 * CLASS_BLOCK + 8);
+        randomText(seed, len, (i % 3 == 0) ? 0 : (i % 3 == 1) ? 1 : 10);
+        checkValidators(kernel, "random", len);
+    }
+}
+
+int main(void)
+{
+    const char *initial = classifyKernelName();
+    unsigned seed = 1717;
+    size_t k;
+
+    CHECK(!classifyUseKernel("neon"));
+    CHECK(strcmp(classifyKernelName(), initial) == 0);
+
+    for (k = 0; k < sizeof(KERNELS) / sizeof(KERNELS[0]); k++) {
+        if (!classifyUseKernel(KERNELS[k])) {
+            printf("test_char_class: no %s on this CPU, skipped\n", KERNELS[k]);
+            continue;
+        }
+        CHECK(strcmp(classifyKernelName(), KERNELS[k]) == 0);
+        checkKernel(&seed, KERNELS[k]);
+    }
+    CHECK(classifyUseKernel(initial));
+    return checkDone("test_char_class");
+}
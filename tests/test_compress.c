@@ -0,0 +1,137 @@
+/*
+ * test_compress.c
+ *
+ * Differential test of the compressRange kernels (string_ops.c):
+ * every kernel this CPU supports (compressUseKernel) must give
+ * what the scalar kernel gives, byte for byte, and write no more
+ * than len bytes. The inputs take every length from 0 to 70,
+ * run-free blocks that take the 32-byte copy, blocks that only
+ * look run-free, and runs that end just before, on and just after
+ * every 32-byte step.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include "check.h"
+#include "string_ops.h"
+
+/* Longest input */
+#define MAX_LEN 5000
+
+/* Random inputs per kernel */
+#define INPUTS 2000
+
+/* Bytes after every output that no call may touch */
+#define GUARD 64
+
+static const char *KERNELS[] = { "avx2", "sse2" };
+
+static char input[MAX_LEN + 1], want[MAX_LEN + 1], got[MAX_LEN + GUARD];
+
+/* ============================================================
+ * Helper: checkInput
+ * The kernel in use against the scalar one on input[0..len).
+ * ============================================================ */
+static void checkInput(const char *kernel, const char *shape, size_t len)
+{
+    size_t wantLen, n, i;
+
+    compressUseKernel("scalar");
+    wantLen = compressRange(input, len, want);
+    compressUseKernel(kernel);
+
+    memset(got, 0x5a, len + GUARD);
+    n = compressRange(input, len, got);
+    CHECK_MSG(n == wantLen && memcmp(got, want, n) == 0, "%s, %s (%zu bytes): %zu bytes, scalar %zu",
+              kernel, shape, len, n, wantLen);
+    for (i = len; i < len + GUARD; i++) {
+        if (got[i] != 0x5a) {
+            CHECK_MSG(0, "%s, %s (%zu bytes): wrote past len", kernel, shape, len);
+            break;
+        }
+    }
+}
+
+/* Alternating letters: no two neighbours equal */
+static void runFree(size_t from, size_t to)
+{
+    size_t i;
+
+    for (i = from; i < to; i++)
+        input[i] = (i % 2) ? 'b' : 'c';
+}
+
+/* ============================================================
+ * Helper: checkKernel
+ * Every shape through one kernel.
+ * ============================================================ */
+static void checkKernel(unsigned *seed, const char *kernel)
+{
+    size_t len, at, run;
+    int i;
+
+    for (len = 0; len <= 70; len++) {
+        memset(input, 'q', len);
+        checkInput(kernel, "one run", len);
+        runFree(0, len);
+        checkInput(kernel, "run-free", len);
+        checkLetters(seed, input, len, 3, 3);
+        checkInput(kernel, "short runs", len);
+        checkLetters(seed, input, len, 2, 40);
+        checkInput(kernel, "long runs", len);
+    }
+
+    /* Run-free blocks after a run that ends just before, on or after a step */
+    for (run = 1; run <= 70; run++) {
+        memset(input, 'a', run);
+        runFree(run, 200);
+        checkInput(kernel, "run then run-free", 200);
+
+        /* The block looks run-free but its first byte continues the run */
+        input[run] = 'a';
+        checkInput(kernel, "run into run-free", 200);
+    }
+
+    /* Runs ending around every 32-byte step, in run-free text */
+    for (at = 1; at <= 3 * 32 + 2; at++) {
+        for (run = 2; run <= 40; run += 19) {
+            runFree(0, 160);
+            if (at >= run)
+                memset(input + at - run, 'z', run);
+            checkInput(kernel, "run across a step", 160);
+            input[at] = 'z';
+            checkInput(kernel, "run across a step", 160);
+        }
+    }
+
+    for (i = 0; i < INPUTS; i++) {
+        len = (size_t)checkRange(seed, 0, (i % 10 == 0) ? MAX_LEN : 300);
+        checkLetters(seed, input, len, checkRange(seed, 1, 6), (i % 3 == 0) ? 1 : (i % 3 == 1) ? 8 : 2000);
+        checkInput(kernel, "random", len);
+    }
+}
+
+int main(void)
+{
+    const char *initial = compressKernelName();
+    unsigned seed = 1616;
+    size_t k;
+
+    CHECK(compressUseKernel("scalar"));
+    CHECK(!compressUseKernel("neon"));
+    CHECK(strcmp(compressKernelName(), "scalar") == 0);
+
+    for (k = 0; k < sizeof(KERNELS) / sizeof(KERNELS[0]); k++) {
+        if (!compressUseKernel(KERNELS[k])) {
+            printf("test_compress: no %s on this CPU, skipped\n", KERNELS[k]);
+            continue;
+        }
+        CHECK(strcmp(compressKernelName(), KERNELS[k]) == 0);
+        checkKernel(&seed, KERNELS[k]);
+    }
+    CHECK(compressUseKernel(initial));
+    return checkDone("test_compress");
+}
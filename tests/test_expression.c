@@ -0,0 +1,180 @@
+/*
+ * test_expression.c
+ *
+ * Differential test of the expression engines: checkInfix, the
+ * compiled form (compileInfix / compileExpression /
+ * evaluateCompiled), the fused evaluator (evaluateInfix /
+ * evaluateInfixRange), the fixed-stack evaluateInfixInt64 and the
+ * cache (exprCacheEvaluate) must agree
+ * with isValidInfix / infixToPostfix / evaluatePostfix on every
+ * expression.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include "check.h"
+#include "expression.h"
+#include "expr_cache.h"
+#include "phase_stats.h"
+
+/* Random expressions per run */
+#define EXPRESSIONS 20000
+
+/* Longest generated expression */
+#define EXPR_CAP 8192
+
+/* Decimal text of a value (static buffer of the caller) */
+static const char *valueText(const ExprValue *v, char *buf, size_t cap)
+{
+    if (exprValueTextSize(v) > cap || exprValueToText(v, buf) == 0)
+        snprintf(buf, cap, "<too long>");
+    return buf;
+}
+
+/* Two values are equal if their texts are */
+static int sameValue(const ExprValue *a, const ExprValue *b)
+{
+    static char ta[EXPR_CAP], tb[EXPR_CAP];
+
+    return strcmp(valueText(a, ta, sizeof(ta)), valueText(b, tb, sizeof(tb))) == 0;
+}
+
+/* ============================================================
+ * Helper: baseline
+ * The original pipeline. Returns 1 and sets *value if expr is valid.
+ * ============================================================ */
+static int baseline(const char *expr, ExprValue *value)
+{
+    static char postfix[2 * EXPR_CAP + 1];
+
+    if (!isValidInfix(expr))
+        return 0;
+    infixToPostfix(expr, postfix);
+    CHECK_MSG(evaluatePostfix(postfix, value) == EXPR_OK, "evaluatePostfix failed: %s", expr);
+    return 1;
+}
+
+/* ============================================================
+ * Helper: checkEngines
+ * Runs expr through every engine and compares with the baseline.
+ * ============================================================ */
+static void checkEngines(const char *expr, ExprCache *cache)
+{
+    static char copy[EXPR_CAP + 2];
+    ExprValue expected = EXPR_VALUE_INIT, v = EXPR_VALUE_INIT;
+    CompiledExpr compiled = COMPILED_INIT;
+    size_t len = strlen(expr), at;
+    int valid = baseline(expr, &expected);
+    ExprStatus status;
+    long long small;
+    int offset;
+
+    CHECK_MSG((checkInfix(expr, len) == CHECK_VALID) == valid, "checkInfix: %s", expr);
+
+    status = evaluateInfix(expr, &v, &offset);
+    CHECK_MSG((status == EXPR_OK) == valid, "evaluateInfix status %d: %s", status, expr);
+    CHECK_MSG(!valid || sameValue(&v, &expected), "evaluateInfix value: %s", expr);
+    CHECK_MSG(valid || (offset >= 0 && (size_t)offset <= len),
+              "evaluateInfix offset %d: %s", offset, expr);
+
+    /* A range must not read past its end: follow it with junk */
+    memcpy(copy, expr, len);
+    copy[len] = ')';
+    copy[len + 1] = '\0';
+    status = evaluateInfixRange(copy, len, &v, NULL);
+    CHECK_MSG((status == EXPR_OK) == valid, "evaluateInfixRange status %d: %s", status, expr);
+    CHECK_MSG(!valid || sameValue(&v, &expected), "evaluateInfixRange value: %s", expr);
+
+    status = compileExpression(expr, NULL, 0, &compiled, &offset);
+    if (status != EXPR_ERR_NUMBER_TOO_LARGE) {
+        CHECK_MSG((status == EXPR_OK) == valid, "compileExpression status %d: %s", status, expr);
+        if (status == EXPR_OK) {
+            CHECK(evaluateCompiled(&compiled, &v) == EXPR_OK);
+            CHECK_MSG(sameValue(&v, &expected), "evaluateCompiled value: %s", expr);
+        }
+    }
+    if (valid && compileInfix(expr, &compiled)) {
+        CHECK(evaluateCompiled(&compiled, &v) == EXPR_OK);
+        CHECK_MSG(sameValue(&v, &expected), "compileInfix value: %s", expr);
+    }
+
+    /*
+     * 64 bits: exact when it answers; an overflow (even of a step
+     * before a syntax error) or too deep nesting is a refusal
+     */
+    status = evaluateInfixInt64(expr, len, &small, &at);
+    if (status == EXPR_OK)
+        CHECK_MSG(valid && !expected.isBig && small == expected.small,
+                  "evaluateInfixInt64 value %lld: %s", small, expr);
+    else if (status != EXPR_ERR_OVERFLOW && status != EXPR_ERR_TOO_DEEP)
+        CHECK_MSG(!valid && at <= len, "evaluateInfixInt64 status %d: %s", status, expr);
+
+    /* Miss, then hit */
+    if (cache != NULL) {
+        int round;
+
+        for (round = 0; round < 2; round++) {
+            status = exprCacheEvaluate(cache, expr, &v, &offset);
+            CHECK_MSG((status == EXPR_OK) == valid, "exprCacheEvaluate status %d: %s", status, expr);
+            CHECK_MSG(!valid || sameValue(&v, &expected), "exprCacheEvaluate value: %s", expr);
+        }
+    }
+
+    freeCompiled(&compiled);
+    freeExprValue(&expected);
+    freeExprValue(&v);
+}
+
+int main(void)
+{
+    static const char *EDGES[] = {
+        "", " ", "(", ")", "()", "1 2", "1+", "+1", "1++2", "(1)(2)", "1/0", "0/0",
+        "5 % 0", "(7 - 9) % 4", "(0 - 7) / 2", "2 * (3 + 4) - 5 / (1 + 1)",
+        "9223372036854775807", "9223372036854775808", "9223372036854775807 + 1",
+        "0 - 9223372036854775807 - 1", "(0 - 9223372036854775807 - 1) / (0 - 1)",
+        "(0 - 9223372036854775807 - 1) % (0 - 1)", "99999999999 * 99999999999",
+        "123456789012345678901234567890 / 7", "12345678901234567890123 % 97",
+        "a + 1", "1 +\t2\n", "((((((((((1))))))))))"
+    };
+    static char buf[EXPR_CAP];
+    ExprCache cache;
+    unsigned seed = 1;
+    size_t i;
+
+    if (!exprCacheInit(&cache, 256))
+        return 2;
+    for (i = 0; i < sizeof(EDGES) / sizeof(EDGES[0]); i++)
+        checkEngines(EDGES[i], &cache);
+    for (i = 0; i < EXPRESSIONS; i++) {
+        checkExpression(&seed, buf, sizeof(buf), checkRange(&seed, 1, 40),
+                        (i % 4 == 0) ? 19 : 3, 6);
+        checkEngines(buf, (i % 4 == 0) ? &cache : NULL);
+    }
+
+    /* Nesting deeper than the fixed stacks */
+    for (i = 0; i < 300; i++)
+        buf[i] = '(';
+    buf[i++] = '1';
+    while (i < 601)
+        buf[i++] = ')';
+    buf[i] = '\0';
+    checkEngines(buf, &cache);
+
+    /* NULL input while the phase stats are recording */
+    {
+        ExprValue v = EXPR_VALUE_INIT;
+        int offset = -1;
+
+        statsEnable(1);
+        CHECK(evaluateInfix(NULL, &v, &offset) == EXPR_ERR_EMPTY && offset == 0);
+        CHECK(evaluateInfix("1 + 2", &v, &offset) == EXPR_OK && v.small == 3);
+        statsEnable(0);
+        freeExprValue(&v);
+    }
+
+    exprCacheFree(&cache);
+    return checkDone("test_expression");
+}
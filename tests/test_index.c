@@ -0,0 +1,123 @@
+/*
+ * test_index.c
+ *
+ * Differential test of the random-access index (string_index.h):
+ * every character and slice read through a RunIndex must be what
+ * expandString gives, at every position near a sample, a run
+ * boundary and both ends, and buildRunIndex must accept exactly
+ * the strings isValidCompressedRange accepts.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include "check.h"
+#include "string_index.h"
+#include "string_ops.h"
+
+/* Longest expansion */
+#define MAX_LEN (1 << 20)
+
+/* Random strings, and random lookups per string */
+#define STRINGS 200
+#define LOOKUPS 300
+
+static char letters[MAX_LEN + 1], packed[MAX_LEN + 1], slice[MAX_LEN + 1];
+
+/* ============================================================
+ * Helper: checkIndex
+ * Builds an index over the compressed form of letters[0..len) and
+ * reads it back.
+ * ============================================================ */
+static void checkIndex(unsigned *seed, const char *name, size_t len)
+{
+    RunIndex index;
+    size_t n, i, run;
+
+    letters[len] = '\0';
+    compressString(letters, packed);
+    n = strlen(packed);
+    if (!buildRunIndex(&index, packed, n)) {
+        CHECK_MSG(0, "%s (%zu letters): index not built", name, len);
+        return;
+    }
+    CHECK_MSG(index.total == len, "%s: total %zu, expected %zu", name, index.total, len);
+
+    /* Both sides of every run boundary, and the ends */
+    for (i = 0, run = 0; i <= len; i++) {
+        if (i == 0 || i == len || letters[i] != letters[i - 1] || ++run % 7 == 0)
+            CHECK_MSG(indexCharAt(&index, i) == letters[i], "%s: char at %zu is '%c', expected '%c'",
+                      name, i, indexCharAt(&index, i), letters[i]);
+    }
+    CHECK(indexCharAt(&index, len + 1) == '\0');
+    CHECK(indexCharAt(&index, (size_t)-1) == '\0');
+
+    /* Random slices, clamped at the end */
+    for (i = 0; i < LOOKUPS; i++) {
+        size_t from = (size_t)checkRange(seed, 0, (int)len);
+        size_t to = from + (size_t)checkRange(seed, 0, (i % 10 == 0) ? (int)len : 300);
+        size_t want = ((to < len) ? to : len) - from, got;
+
+        got = indexExpandSlice(&index, from, to, slice);
+        CHECK_MSG(got == want && memcmp(slice, letters + from, want) == 0,
+                  "%s: slice [%zu, %zu) gave %zu bytes, expected %zu", name, from, to, got, want);
+    }
+    CHECK(indexExpandSlice(&index, len, len + 10, slice) == 0);
+    CHECK(indexExpandSlice(&index, 0, len, slice) == len && memcmp(slice, letters, len) == 0);
+    freeRunIndex(&index);
+}
+
+/* ============================================================
+ * Helper: checkValidity
+ * buildRunIndex against isValidCompressedRange on text.
+ * ============================================================ */
+static void checkValidity(const char *text)
+{
+    RunIndex index;
+    size_t len = strlen(text);
+    int built = buildRunIndex(&index, text, len);
+    int valid = isValidCompressedRange(text, len) && expandedSize(text, len) != (size_t)-1;
+
+    CHECK_MSG(built == valid, "\"%s\": built %d, valid %d", text, built, valid);
+    if (built) {
+        CHECK(index.total == expandedSize(text, len));
+        freeRunIndex(&index);
+    }
+}
+
+int main(void)
+{
+    static const char *TEXTS[] = {
+        "a", "3a", "12ab", "1a", "0a", "03a", "a1", "", "3", "a-b", "99999999999999999999a",
+        "18446744073709551615a", "18446744073709551615ab", "9223372036854775807a9223372036854775807b"
+    };
+    static const int STRIDES[] = { 1, RUN_INDEX_STRIDE - 1, RUN_INDEX_STRIDE, RUN_INDEX_STRIDE + 1,
+                                   3 * RUN_INDEX_STRIDE, 3 * RUN_INDEX_STRIDE + 1 };
+    unsigned seed = 1212;
+    size_t i, len;
+
+    for (i = 0; i < sizeof(TEXTS) / sizeof(TEXTS[0]); i++)
+        checkValidity(TEXTS[i]);
+
+    /* Run counts around multiples of the sample stride */
+    for (i = 0; i < sizeof(STRIDES) / sizeof(STRIDES[0]); i++) {
+        size_t r;
+
+        for (r = 0, len = 0; r < (size_t)STRIDES[i]; r++) {
+            size_t run = (r % 5 == 0) ? 1 : r % 13 + 1;
+
+            memset(letters + len, (r % 2) ? 'b' : 'a', run);
+            len += run;
+        }
+        checkIndex(&seed, "stride edge", len);
+    }
+
+    for (i = 0; i < STRINGS; i++) {
+        len = (size_t)checkRange(&seed, 1, (i % 10 == 0) ? MAX_LEN : 5000);
+        checkLetters(&seed, letters, len, checkRange(&seed, 1, 8), (i % 4 == 0) ? 1000 : 12);
+        checkIndex(&seed, "random", len);
+    }
+    return checkDone("test_index");
+}
@@ -0,0 +1,225 @@
+/*
+ * test_jit.c
+ *
+ * Differential test of the x86-64 JIT (expr_jit.h): on every row,
+ * jitEvaluate must give exactly what evaluateCompiledRow gives,
+ * status included. Rows hit the edges of int, products that
+ * overflow 64 bits, / and % by zero and by -1, and results of
+ * exactly LLONG_MIN (the value native code reports overflow with).
+ * A JitExpr left at JIT_DEFAULT_THRESHOLD must switch to native
+ * code after that many rows and keep agreeing across the switch.
+ * Where the JIT is unavailable, jitEvaluate is the interpreter and
+ * the comparison still runs.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <limits.h>
+#include "check.h"
+#include "expression.h"
+#include "expr_optimize.h"
+#include "expr_jit.h"
+
+/* Random expressions per run, rows per expression */
+#define EXPRESSIONS 3000
+#define ROWS 32
+
+/* Longest generated expression */
+#define EXPR_CAP 4096
+
+/* Room a tree of at most 6 levels still needs when it stops growing */
+#define TREE_RESERVE 512
+
+static const char *VAR_NAMES[] = { "x", "y", "z" };
+
+/* Leaves: variables, constants and subtrees near the 64-bit edges */
+static const char *LEAVES[] = {
+    "x", "y", "z", "0", "1", "3", "(0 - 1)", "2147483647", "4294967296", "(x * 4294967296)",
+    "9223372036854775807", "(0 - 9223372036854775807 - 1)", "(x / (y - y))", "(z % 0)"
+};
+
+static const char OPS[] = "+-*/%";
+
+/*
+ * Expressions with rows that land on LLONG_MIN exactly, overflow
+ * on the way, or divide LLONG_MIN by -1
+ */
+static const char *FIXED[] = {
+    "x * 4294967296 * 2147483648",
+    "0 - 9223372036854775807 - 1 + x",
+    "(0 - 9223372036854775807 - 1 + x) / (y - 1 + 1)",
+    "(0 - 9223372036854775807 - 1 + x) % y",
+    "x * y * z * x * y * z",
+    "(x * y + z) * (x * y + z) - (x * y + z) % 97",
+    "x / y + y % z - z / (x - x + 1)",
+    "((x + 1) * (y + 2) * (z + 3) + (x + 4) * (y + 5)) / ((z % 13) + 1)"
+};
+
+/* Rows for FIXED: the int edges, and LLONG_MIN made on purpose */
+static const int EDGE_ROWS[][3] = {
+    { -1, 1, 1 }, { 0, -1, 1 }, { 1, -1, -1 }, { INT_MIN, -1, 0 }, { INT_MAX, INT_MAX, INT_MAX },
+    { INT_MIN, INT_MIN, INT_MIN }, { INT_MIN, INT_MAX, -1 }, { 0, 0, 0 }, { -2, 0, -3 },
+    { 2, 1, 1 }, { 1, 2, 3 }
+};
+
+/* ============================================================
+ * Helper: makeTree
+ * Appends a random expression of about 'depth' levels.
+ * ============================================================ */
+static size_t makeTree(unsigned *seed, char *buf, size_t n, int depth)
+{
+    if (depth <= 0 || n + TREE_RESERVE >= EXPR_CAP || checkRandom(seed) % 5 == 0) {
+        const char *leaf = LEAVES[checkRandom(seed) % (sizeof(LEAVES) / sizeof(LEAVES[0]))];
+
+        memcpy(buf + n, leaf, strlen(leaf));
+        return n + strlen(leaf);
+    }
+    buf[n++] = '(';
+    n = makeTree(seed, buf, n, depth - 1);
+    buf[n++] = ' ';
+    buf[n++] = OPS[checkRandom(seed) % 5];
+    buf[n++] = ' ';
+    n = makeTree(seed, buf, n, depth - 1);
+    buf[n++] = ')';
+    return n;
+}
+
+/* Column values: the edges of int and of the operators, then random */
+static int pickValue(unsigned *seed)
+{
+    static const int EDGES[] = { 0, 1, -1, 2, -2, INT_MAX, INT_MIN, 65536, -65536 };
+
+    if (checkRandom(seed) % 3 == 0)
+        return EDGES[checkRandom(seed) % (sizeof(EDGES) / sizeof(EDGES[0]))];
+    if (checkRandom(seed) % 2 == 0)
+        return (int)checkRandom(seed);
+    return (int)(checkRandom(seed) % 201) - 100;
+}
+
+/* Decimal text of a value */
+static const char *valueText(const ExprValue *v, char *buf, size_t cap)
+{
+    if (exprValueTextSize(v) > cap || exprValueToText(v, buf) == 0)
+        snprintf(buf, cap, "<too long>");
+    return buf;
+}
+
+/* ============================================================
+ * Helper: checkRow
+ * jitEvaluate against evaluateCompiledRow on one row.
+ * ============================================================ */
+static void checkRow(const char *text, const CompiledExpr *expr, JitExpr *jit, const int *vars)
+{
+    static char ta[EXPR_CAP], tb[EXPR_CAP];
+    ExprValue a = EXPR_VALUE_INIT, b = EXPR_VALUE_INIT;
+    ExprStatus sa = evaluateCompiledRow(expr, vars, &a);
+    ExprStatus sb = jitEvaluate(jit, vars, &b);
+
+    CHECK_MSG(sa == sb, "%s (x=%d y=%d z=%d): status %d, jit %d",
+              text, vars[0], vars[1], vars[2], sa, sb);
+    if (sa == EXPR_OK && sb == EXPR_OK)
+        CHECK_MSG(strcmp(valueText(&a, ta, sizeof(ta)), valueText(&b, tb, sizeof(tb))) == 0,
+                  "%s (x=%d y=%d z=%d): %s, jit %s", text, vars[0], vars[1], vars[2], ta, tb);
+    freeExprValue(&a);
+    freeExprValue(&b);
+}
+
+/* ============================================================
+ * Helper: checkRandomRows
+ * Compiles text (optimized or not) straight to native code and
+ * compares it on ROWS random rows.
+ * ============================================================ */
+static void checkRandomRows(unsigned *seed, const char *text, int optimize)
+{
+    CompiledExpr expr = COMPILED_INIT;
+    JitExpr jit;
+    int r;
+
+    if (compileExpression(text, VAR_NAMES, 3, &expr, NULL) != EXPR_OK) {
+        CHECK_MSG(0, "cannot compile %s", text);
+        return;
+    }
+    if (optimize)
+        CHECK(optimizeCompiled(&expr));
+    jitInit(&jit, &expr, 0);
+    jitCompile(&jit);
+
+    for (r = 0; r < ROWS; r++) {
+        int vars[3];
+
+        vars[0] = pickValue(seed);
+        vars[1] = pickValue(seed);
+        vars[2] = pickValue(seed);
+        checkRow(text, &expr, &jit, vars);
+    }
+    jitFree(&jit);
+    freeCompiled(&expr);
+}
+
+/* ============================================================
+ * Helper: checkHot
+ * A JitExpr at JIT_DEFAULT_THRESHOLD over 2 * threshold rows: the
+ * edge rows come both before and after it turns native.
+ * ============================================================ */
+static void checkHot(unsigned *seed, const char *text)
+{
+    size_t edges = sizeof(EDGE_ROWS) / sizeof(EDGE_ROWS[0]);
+    CompiledExpr expr = COMPILED_INIT;
+    JitExpr jit;
+    long r;
+
+    if (compileExpression(text, VAR_NAMES, 3, &expr, NULL) != EXPR_OK || !optimizeCompiled(&expr)) {
+        CHECK_MSG(0, "cannot compile %s", text);
+        freeCompiled(&expr);
+        return;
+    }
+    jitInit(&jit, &expr, JIT_DEFAULT_THRESHOLD);
+
+    for (r = 0; r < 2 * JIT_DEFAULT_THRESHOLD; r++) {
+        int vars[3];
+
+        if (r == JIT_DEFAULT_THRESHOLD)
+            CHECK_MSG(jit.native == NULL, "%s: native before %d rows", text, JIT_DEFAULT_THRESHOLD);
+        if ((size_t)r % 100 < edges) {
+            memcpy(vars, EDGE_ROWS[(size_t)r % 100], sizeof(vars));
+        } else {
+            vars[0] = pickValue(seed);
+            vars[1] = pickValue(seed);
+            vars[2] = pickValue(seed);
+        }
+        checkRow(text, &expr, &jit, vars);
+    }
+    CHECK_MSG(!jitAvailable() || jit.native != NULL, "%s: still interpreted after %d rows",
+              text, 2 * JIT_DEFAULT_THRESHOLD);
+    jitFree(&jit);
+    freeCompiled(&expr);
+}
+
+int main(void)
+{
+    static char buf[EXPR_CAP];
+    unsigned seed = 1313;
+    size_t i;
+
+    for (i = 0; i < sizeof(FIXED) / sizeof(FIXED[0]); i++)
+        checkHot(&seed, FIXED[i]);
+
+    for (i = 0; i < EXPRESSIONS; i++) {
+        size_t n = makeTree(&seed, buf, 0, checkRange(&seed, 1, 6));
+
+        buf[n] = '\0';
+        checkRandomRows(&seed, buf, (int)(i % 2));
+    }
+
+    /* An operand stack deeper than the JIT's registers and frame */
+    for (i = 0; i < 300; i++)
+        memcpy(buf + 5 * i, "y * (", 5);
+    buf[5 * i] = 'x';
+    memset(buf + 5 * i + 1, ')', 300);
+    buf[6 * i + 1] = '\0';
+    checkRandomRows(&seed, buf, 0);
+    return checkDone("test_jit");
+}
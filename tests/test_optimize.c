@@ -0,0 +1,166 @@
+/*
+ * test_optimize.c
+ *
+ * Differential test of optimizeCompiled (expr_optimize.h): on every
+ * row, an optimized program must give exactly what the program it
+ * came from gives, status included. The expressions repeat
+ * subtrees and fold constants on purpose, with / and % by zero,
+ * by -1 and overflowing products inside the shared or folded parts.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <limits.h>
+#include "check.h"
+#include "expression.h"
+#include "expr_optimize.h"
+
+/* Random expressions per run, rows per expression */
+#define EXPRESSIONS 4000
+#define ROWS 24
+
+/* Longest generated expression */
+#define EXPR_CAP 4096
+
+/* Room a tree of at most 7 levels still needs when it stops growing */
+#define TREE_RESERVE 512
+
+static const char *VAR_NAMES[] = { "x", "y", "z" };
+
+/* Leaves: variables, constants and the subtrees that trap */
+static const char *LEAVES[] = {
+    "x", "y", "z", "0", "1", "7", "2147483647", "(y - y)", "(x / (y - y))", "(5 % 0)",
+    "(x % (z - z))", "(0 - 1)", "(x / (0 - 1))", "(9223372036854775807 * 3)", "(4 / 2 * 3)"
+};
+
+static const char OPS[] = "+-*/%";
+
+/* ============================================================
+ * Helper: makeTree
+ * Appends a random expression of about 'depth' levels; a subtree
+ * already written is often written again, so the optimizer has
+ * something to share.
+ * ============================================================ */
+static size_t makeTree(unsigned *seed, char *buf, size_t n, int depth,
+                       const char **seen, size_t *seenLen, int *seenCount)
+{
+    size_t start = n;
+
+    if (*seenCount > 0 && checkRandom(seed) % 3 == 0) {
+        int k = (int)(checkRandom(seed) % (unsigned)*seenCount);
+
+        if (n + seenLen[k] + TREE_RESERVE < EXPR_CAP) {
+            memcpy(buf + n, seen[k], seenLen[k]);
+            return n + seenLen[k];
+        }
+    }
+    if (depth <= 0 || n + TREE_RESERVE >= EXPR_CAP) {
+        const char *leaf = LEAVES[checkRandom(seed) % (sizeof(LEAVES) / sizeof(LEAVES[0]))];
+
+        memcpy(buf + n, leaf, strlen(leaf));
+        return n + strlen(leaf);
+    }
+    buf[n++] = '(';
+    n = makeTree(seed, buf, n, depth - 1, seen, seenLen, seenCount);
+    buf[n++] = ' ';
+    buf[n++] = OPS[checkRandom(seed) % 5];
+    buf[n++] = ' ';
+    n = makeTree(seed, buf, n, depth - 1 - (int)(checkRandom(seed) % 2), seen, seenLen, seenCount);
+    buf[n++] = ')';
+
+    if (*seenCount < 16) {
+        seen[*seenCount] = buf + start;
+        seenLen[(*seenCount)++] = n - start;
+    }
+    return n;
+}
+
+/* Column values: the edges of int and of the operators, then random */
+static int pickValue(unsigned *seed)
+{
+    static const int EDGES[] = { 0, 1, -1, 2, INT_MAX, INT_MIN, 65536 };
+
+    if (checkRandom(seed) % 3 == 0)
+        return EDGES[checkRandom(seed) % (sizeof(EDGES) / sizeof(EDGES[0]))];
+    return (int)(checkRandom(seed) % 201) - 100;
+}
+
+/* Decimal text of a value */
+static const char *valueText(const ExprValue *v, char *buf, size_t cap)
+{
+    if (exprValueTextSize(v) > cap || exprValueToText(v, buf) == 0)
+        snprintf(buf, cap, "<too long>");
+    return buf;
+}
+
+/* ============================================================
+ * Helper: checkOptimized
+ * Compiles text, optimizes a copy and compares both on ROWS rows.
+ * ============================================================ */
+static void checkOptimized(unsigned *seed, const char *text)
+{
+    static char ta[EXPR_CAP], tb[EXPR_CAP];
+    CompiledExpr plain = COMPILED_INIT, optimized = COMPILED_INIT;
+    ExprValue a = EXPR_VALUE_INIT, b = EXPR_VALUE_INIT;
+    int r;
+
+    if (compileExpression(text, VAR_NAMES, 3, &plain, NULL) != EXPR_OK ||
+        compileExpression(text, VAR_NAMES, 3, &optimized, NULL) != EXPR_OK) {
+        CHECK_MSG(0, "cannot compile %s", text);
+        freeCompiled(&plain);
+        return;
+    }
+    CHECK(optimizeCompiled(&optimized));
+    CHECK_MSG(optimized.count <= plain.count, "optimized program grew: %s", text);
+
+    for (r = 0; r < ROWS; r++) {
+        int vars[3];
+        ExprStatus sa, sb;
+
+        vars[0] = pickValue(seed);
+        vars[1] = pickValue(seed);
+        vars[2] = pickValue(seed);
+        sa = evaluateCompiledRow(&plain, vars, &a);
+        sb = evaluateCompiledRow(&optimized, vars, &b);
+        CHECK_MSG(sa == sb, "%s (x=%d y=%d z=%d): status %d, optimized %d",
+                  text, vars[0], vars[1], vars[2], sa, sb);
+        if (sa == EXPR_OK && sb == EXPR_OK)
+            CHECK_MSG(strcmp(valueText(&a, ta, sizeof(ta)), valueText(&b, tb, sizeof(tb))) == 0,
+                      "%s (x=%d y=%d z=%d): %s, optimized %s",
+                      text, vars[0], vars[1], vars[2], ta, tb);
+    }
+
+    freeExprValue(&a);
+    freeExprValue(&b);
+    freeCompiled(&plain);
+    freeCompiled(&optimized);
+}
+
+int main(void)
+{
+    static const char *EDGES[] = {
+        "x", "7", "5 % 0", "x / 0", "(x / (y - y)) + (x / (y - y))",
+        "(5 % 0) * (5 % 0) + x", "(x % (z - z)) - (x % (z - z)) * y",
+        "(x + y) * (x + y) / ((x + y) % 13 + 1)", "(0 - 2147483647 - 1) / (0 - 1) + x",
+        "(9223372036854775807 + 1) * x", "(9223372036854775807 * 3) / (9223372036854775807 * 3)",
+        "x * y * z * x * y * z * x * y * z", "((x / 0) % (y / 0)) + ((x / 0) % (y / 0))"
+    };
+    static char buf[EXPR_CAP];
+    const char *seen[16];
+    size_t seenLen[16], i;
+    unsigned seed = 505;
+
+    for (i = 0; i < sizeof(EDGES) / sizeof(EDGES[0]); i++)
+        checkOptimized(&seed, EDGES[i]);
+    for (i = 0; i < EXPRESSIONS; i++) {
+        int seenCount = 0;
+        size_t n = makeTree(&seed, buf, 0, checkRange(&seed, 1, 7), seen, seenLen, &seenCount);
+
+        buf[n] = '\0';
+        checkOptimized(&seed, buf);
+    }
+    return checkDone("test_optimize");
+}
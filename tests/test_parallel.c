@@ -0,0 +1,198 @@
+/*
+ * test_parallel.c
+ *
+ * Differential test of evaluateParallel (expr_parallel.h): on
+ * expressions large enough to be split, the result (or the error
+ * and its offset) must be what evaluateInfix gives. Includes the
+ * shapes that defeat splitting: 1+(1+(1+...)) nested to the end of
+ * a 240 KB line, deep wrapping and long * / % chains.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <time.h>
+#include "check.h"
+#include "expr_parallel.h"
+
+/* Nested shapes: bytes per expression */
+#define DEEP_BYTES (240 * 1024)
+
+/* A nested shape must not take longer than this (seconds) */
+#define DEEP_SECONDS 5.0
+
+/* Growable text */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Text;
+
+static void append(Text *t, const char *s)
+{
+    size_t n = strlen(s);
+
+    if (t->len + n + 1 > t->cap) {
+        size_t cap = t->cap ? t->cap : 4096;
+
+        while (cap < t->len + n + 1)
+            cap *= 2;
+        if ((t->data = realloc(t->data, cap)) == NULL)
+            exit(2);
+        t->cap = cap;
+    }
+    memcpy(t->data + t->len, s, n + 1);
+    t->len += n;
+}
+
+static double nowSeconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Two values are equal if their texts are */
+static int sameValue(const ExprValue *a, const ExprValue *b)
+{
+    char *ta = malloc(exprValueTextSize(a)), *tb = malloc(exprValueTextSize(b));
+    int same;
+
+    if (ta == NULL || tb == NULL)
+        exit(2);
+    exprValueToText(a, ta);
+    exprValueToText(b, tb);
+    same = strcmp(ta, tb) == 0;
+    free(ta);
+    free(tb);
+    return same;
+}
+
+/* ============================================================
+ * Helper: checkParallel
+ * evaluateParallel against evaluateInfix on one expression.
+ * ============================================================ */
+static void checkParallel(ParallelEvaluator *pe, const char *name, const char *expr)
+{
+    ExprValue expected = EXPR_VALUE_INIT, v = EXPR_VALUE_INIT;
+    int wantOffset = -1, offset = -1;
+    ExprStatus want = evaluateInfix(expr, &expected, &wantOffset);
+    double t0 = nowSeconds();
+    ExprStatus status = evaluateParallel(pe, expr, &v, &offset);
+
+    t0 = nowSeconds() - t0;
+    CHECK_MSG(status == want, "%s: status %d, expected %d", name, status, want);
+    if (status == EXPR_OK && want == EXPR_OK)
+        CHECK_MSG(sameValue(&v, &expected), "%s: wrong value", name);
+    else
+        CHECK_MSG(offset == wantOffset, "%s: offset %d, expected %d", name, offset, wantOffset);
+    CHECK_MSG(t0 < DEEP_SECONDS, "%s: %.1fs", name, t0);
+    freeExprValue(&expected);
+    freeExprValue(&v);
+}
+
+/* ============================================================
+ * Shapes
+ * ============================================================ */
+
+/* head + "(" ... repeated, then the leaf and the closing ")" */
+static void nested(Text *t, const char *head, const char *leaf)
+{
+    size_t levels = DEEP_BYTES / (strlen(head) + 2), i;
+
+    t->len = 0;
+    for (i = 0; i < levels; i++) {
+        append(t, head);
+        append(t, "(");
+    }
+    append(t, leaf);
+    for (i = 0; i < levels; i++)
+        append(t, ")");
+}
+
+/* A flat chain of random operands and operators from ops */
+static void chain(Text *t, unsigned *seed, const char *ops, size_t bytes)
+{
+    char buf[64];
+    size_t nops = strlen(ops);
+
+    t->len = 0;
+    while (t->len < bytes) {
+        snprintf(buf, sizeof(buf), "%d %c ", checkRange(seed, 1, 999),
+                 ops[checkRandom(seed) % nops]);
+        append(t, buf);
+    }
+    append(t, "7");
+}
+
+/* Random expressions of random size, wrapped and concatenated */
+static void mixed(Text *t, unsigned *seed, size_t bytes)
+{
+    static char buf[8192];
+
+    t->len = 0;
+    while (t->len < bytes) {
+        checkExpression(seed, buf, sizeof(buf), checkRange(seed, 1, 100), 12, 0);
+        append(t, "(");
+        append(t, buf);
+        append(t, (checkRandom(seed) % 2) ? ") + " : ") * ");
+    }
+    append(t, "1");
+}
+
+int main(void)
+{
+    static const char *NESTED[][3] = {
+        { "1+(1+(...))", "1+", "1" },
+        { "2*(2*(...))", "2*", "2" },
+        { "(((...)))", "", "1+2" },
+        { "7-(5%(...))", "7 - 5 % ", "3" },
+        { "1+(2*(...)) / 0", "1+2*", "1/0" },
+        { "unbalanced", "1+", "1)" }
+    };
+    ParallelEvaluator pe;
+    Text t = { NULL, 0, 0 };
+    unsigned seed = 707;
+    size_t i;
+
+    if (!parallelInit(&pe, 4))
+        return 2;
+
+    for (i = 0; i < sizeof(NESTED) / sizeof(NESTED[0]); i++) {
+        nested(&t, NESTED[i][1], NESTED[i][2]);
+        checkParallel(&pe, NESTED[i][0], t.data);
+    }
+
+    /* Deep wrapping around a large sum */
+    chain(&t, &seed, "+-", 300 * 1024);
+    {
+        Text w = { NULL, 0, 0 };
+
+        for (i = 0; i < 5000; i++)
+            append(&w, "(");
+        append(&w, t.data);
+        for (i = 0; i < 5000; i++)
+            append(&w, ")");
+        checkParallel(&pe, "wrapped sum", w.data);
+        free(w.data);
+    }
+
+    for (i = 0; i < 4; i++) {
+        chain(&t, &seed, "+-", 200 * 1024 * (i + 1));
+        checkParallel(&pe, "sum", t.data);
+        chain(&t, &seed, "*/%", 100 * 1024 * (i + 1));
+        checkParallel(&pe, "* / % chain", t.data);
+        chain(&t, &seed, "+-*/%", 200 * 1024 * (i + 1));
+        checkParallel(&pe, "chain", t.data);
+        mixed(&t, &seed, 300 * 1024 * (i + 1));
+        checkParallel(&pe, "mixed", t.data);
+        t.data[checkRandom(&seed) % t.len] = 'x';
+        checkParallel(&pe, "mixed, invalid", t.data);
+    }
+
+    free(t.data);
+    parallelFree(&pe);
+    return checkDone("test_parallel");
+}
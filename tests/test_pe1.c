@@ -0,0 +1,344 @@
+/*
+ * test_pe1.c
+ *
+ * Differential test of the embeddable API (pe1.h), linked against
+ * libpe1.a so the library build (-DPE1_NO_STATS) is what runs.
+ * pe1Compress / pe1Expand / pe1ExpandedSize must give what
+ * compressRange / expandRange / expandedSize give at every capacity
+ * from 0 to one past the result: the exact size needed in *outLen
+ * when it does not fit, nothing at or past out[cap], and for
+ * pe1Expand nothing written at all. pe1Evaluate must agree with
+ * evaluateInfix wherever the value fits in 64 bits, and every
+ * function must report the status and offset the tables below
+ * expect.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include "check.h"
+#include "expression.h"
+#include "pe1.h"
+#include "string_ops.h"
+
+/* Longest random input, and random inputs per run */
+#define MAX_LEN 300
+#define INPUTS 400
+
+/* Random expressions per run */
+#define EXPRESSIONS 20000
+
+/* Longest generated expression */
+#define EXPR_CAP 4096
+
+/* Byte after out[cap - 1] no call may touch */
+#define CANARY 0x5a
+
+/* No offset stored */
+#define NO_OFFSET ((size_t)-7)
+
+static char letters[MAX_LEN + 1], want[4 * MAX_LEN], out[4 * MAX_LEN];
+
+/* Expected status and *errorOffset of one input */
+typedef struct {
+    const char *in;
+    Pe1Status status;
+    size_t offset;              /* NO_OFFSET: left alone */
+} Pe1Case;
+
+static const Pe1Case STRING_CASES[] = {
+    { "", PE1_ERR_EMPTY, 0 }, { "a", PE1_OK, NO_OFFSET }, { "aaBBc", PE1_OK, NO_OFFSET },
+    { "ab3", PE1_ERR_INVALID, 2 }, { "a b", PE1_ERR_INVALID, 1 }, { "-", PE1_ERR_INVALID, 0 },
+    { "abc\x80", PE1_ERR_INVALID, 3 }
+};
+
+static const Pe1Case COMPRESSED_CASES[] = {
+    { "", PE1_ERR_EMPTY, 0 }, { "a", PE1_OK, NO_OFFSET }, { "3a2bc", PE1_OK, NO_OFFSET },
+    { "3", PE1_ERR_INVALID, 1 }, { "ab12", PE1_ERR_INVALID, 4 }, { "0a", PE1_ERR_INVALID, 0 },
+    { "a03b", PE1_ERR_INVALID, 1 }, { "1a", PE1_ERR_INVALID, 0 }, { "a1b", PE1_ERR_INVALID, 1 },
+    { "3a-b", PE1_ERR_INVALID, 2 }, { "10a", PE1_OK, NO_OFFSET }, { "a\xff", PE1_ERR_INVALID, 1 }
+};
+
+static const Pe1Case INFIX_CASES[] = {
+    { "", PE1_ERR_EMPTY, 0 }, { "1", PE1_OK, NO_OFFSET }, { "(1 + 2) * 3", PE1_OK, NO_OFFSET },
+    { "1 +", PE1_ERR_INVALID, 3 }, { "(1", PE1_ERR_INVALID, 2 }, { "1)", PE1_ERR_INVALID, 1 },
+    { "1 x", PE1_ERR_INVALID, 2 }, { "+1", PE1_ERR_INVALID, 0 }
+};
+
+/* pe1Evaluate: statuses and offsets, overflow and depth included */
+static const Pe1Case EVALUATE_CASES[] = {
+    { "", PE1_ERR_EMPTY, 0 }, { "   ", PE1_ERR_EMPTY, 3 }, { "1 x", PE1_ERR_INVALID_CHAR, 2 },
+    { "1 +", PE1_ERR_EXPECTED_OPERAND, 3 }, { "1 2", PE1_ERR_EXPECTED_OPERATOR, 2 },
+    { "1)", PE1_ERR_UNMATCHED_CLOSE, 1 }, { "(1", PE1_ERR_UNMATCHED_OPEN, 2 },
+    { "9223372036854775807", PE1_OK, NO_OFFSET }, { "9223372036854775808", PE1_ERR_OVERFLOW, 0 },
+    { "9223372036854775807 + 1", PE1_ERR_OVERFLOW, NO_OFFSET },
+    { "(0-9223372036854775807-1)/(0-1)", PE1_ERR_OVERFLOW, NO_OFFSET },
+    { "(0-9223372036854775807-1)%(0-1)", PE1_OK, NO_OFFSET },
+    { "99999999999 * 99999999999", PE1_ERR_OVERFLOW, NO_OFFSET }
+};
+
+/* ============================================================
+ * Helper: checkCases
+ * Runs a validator over a table of cases.
+ * ============================================================ */
+static void checkCases(const char *name, Pe1Status (*validate)(const char *, size_t, size_t *),
+                       const Pe1Case *cases, size_t count)
+{
+    size_t i;
+
+    for (i = 0; i < count; i++) {
+        size_t offset = NO_OFFSET;
+        Pe1Status status = validate(cases[i].in, strlen(cases[i].in), &offset);
+
+        CHECK_MSG(status == cases[i].status && offset == cases[i].offset,
+                  "%s(\"%s\"): status %d offset %zd, expected %d offset %zd", name, cases[i].in,
+                  status, (ssize_t)offset, cases[i].status, (ssize_t)cases[i].offset);
+    }
+}
+
+/* ============================================================
+ * Helper: checkCompress
+ * pe1Compress on letters[0..len) at every capacity from 0 to
+ * len + 1 (below the result, the run-by-run path).
+ * ============================================================ */
+static void checkCompress(size_t len)
+{
+    size_t wantLen = compressRange(letters, len, want), cap;
+
+    for (cap = 0; cap <= len + 1; cap++) {
+        size_t outLen = NO_OFFSET, offset = NO_OFFSET;
+        Pe1Status status;
+
+        out[cap] = (char)CANARY;
+        status = pe1Compress(letters, len, out, cap, &outLen, &offset);
+        CHECK_MSG(outLen == wantLen && offset == NO_OFFSET && (unsigned char)out[cap] == CANARY,
+                  "pe1Compress (%zu letters, cap %zu): *outLen %zu, expected %zu", len, cap, outLen,
+                  wantLen);
+        if (wantLen <= cap)
+            CHECK_MSG(status == PE1_OK && memcmp(out, want, wantLen) == 0,
+                      "pe1Compress (%zu letters, cap %zu): status %d", len, cap, status);
+        else
+            CHECK_MSG(status == PE1_ERR_BUFFER_TOO_SMALL,
+                      "pe1Compress (%zu letters, cap %zu): status %d, expected too small", len, cap,
+                      status);
+    }
+}
+
+/* ============================================================
+ * Helper: checkExpand
+ * pe1ExpandedSize and pe1Expand on packed[0..len) at every
+ * capacity from 0 to the expanded size + 1.
+ * ============================================================ */
+static void checkExpand(const char *packed, size_t len)
+{
+    size_t wantLen, size = NO_OFFSET, cap;
+
+    if (!isValidCompressedRange(packed, len))
+        return;
+    wantLen = expandRange(packed, len, want);
+    CHECK(pe1ExpandedSize(packed, len, &size, NULL) == PE1_OK && size == wantLen);
+
+    for (cap = 0; cap <= wantLen + 1; cap++) {
+        size_t outLen = NO_OFFSET, offset = NO_OFFSET;
+        Pe1Status status;
+
+        memset(out, CANARY, cap + 1);
+        status = pe1Expand(packed, len, out, cap, &outLen, &offset);
+        CHECK_MSG(outLen == wantLen && offset == NO_OFFSET && (unsigned char)out[cap] == CANARY,
+                  "pe1Expand (%zu bytes, cap %zu): *outLen %zu, expected %zu", len, cap, outLen,
+                  wantLen);
+        if (wantLen <= cap) {
+            CHECK_MSG(status == PE1_OK && memcmp(out, want, wantLen) == 0,
+                      "pe1Expand (%zu bytes, cap %zu): status %d", len, cap, status);
+        } else {
+            /* Nothing written */
+            CHECK_MSG(status == PE1_ERR_BUFFER_TOO_SMALL && (cap == 0 || (unsigned char)out[0] == CANARY),
+                      "pe1Expand (%zu bytes, cap %zu): status %d, expected too small", len, cap,
+                      status);
+        }
+    }
+}
+
+/* ============================================================
+ * Helper: checkEvaluate
+ * pe1Evaluate against evaluateInfix. A value beyond 64 bits, or a
+ * step beyond them, is PE1_ERR_OVERFLOW; so is a step that
+ * overflows before a syntax error, and nesting past
+ * PE1_MAX_DEPTH is PE1_ERR_TOO_DEEP. Otherwise status and offset
+ * must match.
+ * ============================================================ */
+static void checkEvaluate(const char *expr)
+{
+    static const Pe1Status FROM_EXPR[] = {
+        PE1_OK, PE1_ERR_EMPTY, PE1_ERR_INVALID_CHAR, PE1_ERR_EXPECTED_OPERAND,
+        PE1_ERR_EXPECTED_OPERATOR, PE1_ERR_UNMATCHED_CLOSE, PE1_ERR_UNMATCHED_OPEN
+    };
+    static char copy[EXPR_CAP + 2];
+    ExprValue v = EXPR_VALUE_INIT;
+    size_t len = strlen(expr), offset = NO_OFFSET;
+    long long result = 0;
+    int wantOffset = -1;
+    ExprStatus wantStatus = evaluateInfix(expr, &v, &wantOffset);
+    Pe1Status status;
+
+    /* The range must not be read past its end: follow it with junk */
+    memcpy(copy, expr, len);
+    copy[len] = ')';
+    copy[len + 1] = '\0';
+    status = pe1Evaluate(copy, len, &result, &offset);
+
+    if (status == PE1_ERR_OVERFLOW || status == PE1_ERR_TOO_DEEP) {
+        CHECK_MSG(wantStatus != EXPR_OK || v.isBig || status == PE1_ERR_OVERFLOW,
+                  "pe1Evaluate status %d: %s", status, expr);
+    } else if (wantStatus == EXPR_OK) {
+        CHECK_MSG(status == PE1_OK && !v.isBig && result == v.small,
+                  "pe1Evaluate status %d value %lld: %s", status, result, expr);
+    } else {
+        CHECK_MSG((size_t)wantStatus < sizeof(FROM_EXPR) / sizeof(FROM_EXPR[0]) &&
+                  status == FROM_EXPR[wantStatus] && offset == (size_t)wantOffset,
+                  "pe1Evaluate status %d offset %zd, evaluateInfix %d offset %d: %s", status,
+                  (ssize_t)offset, wantStatus, wantOffset, expr);
+    }
+    freeExprValue(&v);
+}
+
+/* ============================================================
+ * Helper: checkArguments
+ * NULL with a nonzero length or capacity, or a missing *outLen.
+ * ============================================================ */
+static void checkArguments(void)
+{
+    size_t n = NO_OFFSET;
+    long long result;
+
+    CHECK(pe1ValidateString(NULL, 1, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(pe1ValidateCompressed(NULL, 1, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(pe1ValidateInfix(NULL, 1, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(pe1Compress(NULL, 1, out, 4, &n, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(pe1Compress("ab", 2, NULL, 4, &n, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(pe1Compress("ab", 2, out, 4, NULL, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(pe1ExpandedSize(NULL, 1, &n, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(pe1ExpandedSize("a", 1, NULL, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(pe1Expand(NULL, 1, out, 4, &n, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(pe1Expand("a", 1, NULL, 4, &n, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(pe1Expand("a", 1, out, 4, NULL, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(pe1Evaluate(NULL, 1, &result, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(pe1Evaluate("1", 1, NULL, NULL) == PE1_ERR_ARGUMENT);
+    CHECK(n == NO_OFFSET);
+
+    /* NULL with a zero length is empty input, and NULL out with cap 0 is a size query */
+    CHECK(pe1ValidateString(NULL, 0, NULL) == PE1_ERR_EMPTY);
+    CHECK(pe1Evaluate(NULL, 0, &result, NULL) == PE1_ERR_EMPTY);
+    CHECK(pe1Compress("aab", 3, NULL, 0, &n, NULL) == PE1_ERR_BUFFER_TOO_SMALL && n == 3);
+    CHECK(pe1Expand("3a2b", 4, NULL, 0, &n, NULL) == PE1_ERR_BUFFER_TOO_SMALL && n == 5);
+}
+
+/* ============================================================
+ * Helper: checkMessages
+ * Every status has its own message; anything else is unknown.
+ * ============================================================ */
+static void checkMessages(void)
+{
+    const char *unknown = pe1StatusMessage((Pe1Status)(PE1_ERR_BUFFER_TOO_SMALL + 1));
+    int s, t;
+
+    CHECK(strcmp(unknown, "unknown error") == 0);
+    for (s = PE1_OK; s <= PE1_ERR_BUFFER_TOO_SMALL; s++) {
+        CHECK_MSG(strcmp(pe1StatusMessage((Pe1Status)s), unknown) != 0, "status %d has no message", s);
+        for (t = PE1_OK; t < s; t++)
+            CHECK_MSG(strcmp(pe1StatusMessage((Pe1Status)s), pe1StatusMessage((Pe1Status)t)) != 0,
+                      "statuses %d and %d share a message", t, s);
+    }
+}
+
+int main(void)
+{
+    static const char *PACKED[] = {
+        "a", "3a2bc", "10a", "2a2a", "99b", "1000z", "a300bc"
+    };
+    static char buf[EXPR_CAP];
+    unsigned seed = 1414;
+    size_t i, n, offset, size;
+
+    checkMessages();
+    checkArguments();
+    checkCases("pe1ValidateString", pe1ValidateString, STRING_CASES,
+               sizeof(STRING_CASES) / sizeof(STRING_CASES[0]));
+    checkCases("pe1ValidateCompressed", pe1ValidateCompressed, COMPRESSED_CASES,
+               sizeof(COMPRESSED_CASES) / sizeof(COMPRESSED_CASES[0]));
+    checkCases("pe1ValidateInfix", pe1ValidateInfix, INFIX_CASES,
+               sizeof(INFIX_CASES) / sizeof(INFIX_CASES[0]));
+
+    for (i = 0; i < sizeof(EVALUATE_CASES) / sizeof(EVALUATE_CASES[0]); i++) {
+        const Pe1Case *c = &EVALUATE_CASES[i];
+        long long result;
+
+        offset = NO_OFFSET;
+        CHECK_MSG(pe1Evaluate(c->in, strlen(c->in), &result, &offset) == c->status &&
+                  (c->offset == NO_OFFSET || offset == c->offset),
+                  "pe1Evaluate(\"%s\"): offset %zd, expected status %d offset %zd", c->in,
+                  (ssize_t)offset, c->status, (ssize_t)c->offset);
+        checkEvaluate(c->in);
+    }
+
+    /* Invalid input: the same status and offset from every entry point */
+    for (i = 0; i < sizeof(COMPRESSED_CASES) / sizeof(COMPRESSED_CASES[0]); i++) {
+        const Pe1Case *c = &COMPRESSED_CASES[i];
+
+        offset = NO_OFFSET;
+        CHECK_MSG(pe1Expand(c->in, strlen(c->in), out, sizeof(out), &n, &offset) == c->status &&
+                  offset == c->offset, "pe1Expand(\"%s\"): offset %zd", c->in, (ssize_t)offset);
+        offset = NO_OFFSET;
+        CHECK_MSG(pe1ExpandedSize(c->in, strlen(c->in), &size, &offset) == c->status &&
+                  offset == c->offset, "pe1ExpandedSize(\"%s\"): offset %zd", c->in, (ssize_t)offset);
+    }
+    for (i = 0; i < sizeof(STRING_CASES) / sizeof(STRING_CASES[0]); i++) {
+        const Pe1Case *c = &STRING_CASES[i];
+
+        offset = NO_OFFSET;
+        CHECK_MSG(pe1Compress(c->in, strlen(c->in), out, sizeof(out), &n, &offset) == c->status &&
+                  offset == c->offset, "pe1Compress(\"%s\"): offset %zd", c->in, (ssize_t)offset);
+    }
+
+    /* Expanded sizes beyond 64 bits */
+    CHECK(pe1ExpandedSize("18446744073709551615ab", 22, &size, NULL) == PE1_ERR_OVERFLOW);
+    CHECK(pe1Expand("99999999999999999999a", 21, out, sizeof(out), &n, NULL) == PE1_ERR_OVERFLOW);
+    CHECK(pe1ExpandedSize("9223372036854775808a", 20, &size, NULL) == PE1_OK &&
+          size == (size_t)9223372036854775808ULL);
+
+    for (i = 0; i < sizeof(PACKED) / sizeof(PACKED[0]); i++)
+        checkExpand(PACKED[i], strlen(PACKED[i]));
+
+    /* Runs long enough for multi-digit counts, and single letters */
+    for (i = 0; i < INPUTS; i++) {
+        size_t len = (size_t)checkRange(&seed, 0, MAX_LEN);
+
+        checkLetters(&seed, letters, len, checkRange(&seed, 1, 6), (i % 3 == 0) ? 1 : (i % 3 == 1) ? 4 : 150);
+        if (len == 0)
+            continue;
+        checkCompress(len);
+        n = compressRange(letters, len, buf);
+        checkExpand(buf, n);
+    }
+
+    for (i = 0; i < EXPRESSIONS; i++) {
+        checkExpression(&seed, buf, sizeof(buf), checkRange(&seed, 1, 30), (i % 4 == 0) ? 19 : 3, 5);
+        checkEvaluate(buf);
+    }
+
+    /* Nesting past PE1_MAX_DEPTH */
+    for (i = 0; i < PE1_MAX_DEPTH + 1; i++)
+        buf[i] = '(';
+    buf[i++] = '1';
+    while (i < 2 * (PE1_MAX_DEPTH + 1) + 1)
+        buf[i++] = ')';
+    buf[i] = '\0';
+    {
+        long long result;
+
+        CHECK(pe1Evaluate(buf, i, &result, NULL) == PE1_ERR_TOO_DEEP);
+    }
+    return checkDone("test_pe1");
+}
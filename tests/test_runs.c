@@ -0,0 +1,210 @@
+/*
+ * test_runs.c
+ *
+ * Differential test of the run-by-run operations (string_runs.h)
+ * against expanding first: compareCompressed must order like
+ * strcmp on the expansions, concatCompressed must give what
+ * compressRange gives on the joined letters (and never write past
+ * aLen + bLen), and letterHistogram / runStatistics must count what
+ * a pass over the expansion counts. Texts are also split into more
+ * runs than compressRange writes ("5a" as "2a3a"), so equal
+ * expansions come from different texts.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include "check.h"
+#include "string_ops.h"
+#include "string_runs.h"
+
+/* Longest expansion */
+#define MAX_LEN 4000
+
+/* Random pairs per run */
+#define PAIRS 3000
+
+/* Bytes after every output that no call may touch */
+#define GUARD 64
+
+static char lettersA[MAX_LEN + 1], lettersB[MAX_LEN + 1], joined[2 * MAX_LEN + 1];
+static char packedA[MAX_LEN + 1], packedB[MAX_LEN + 1], want[2 * MAX_LEN + 1];
+static char out[2 * MAX_LEN + GUARD], expanded[2 * MAX_LEN + 1];
+
+/* Sign of a comparison */
+static int sign(int c)
+{
+    return (c > 0) - (c < 0);
+}
+
+/* ============================================================
+ * Helper: pack
+ * Compressed form of letters[0..len); with 'split' set, some runs
+ * are written as two ("5a" as "2a3a"). Returns the length.
+ * ============================================================ */
+static size_t pack(unsigned *seed, const char *letters, size_t len, int split, char *packed)
+{
+    size_t i = 0, n = 0;
+
+    while (i < len) {
+        size_t j = i + 1, first;
+
+        while (j < len && letters[j] == letters[i])
+            j++;
+        first = j - i;
+        if (split && first > 1 && checkRandom(seed) % 2 == 0) {
+            first = (size_t)checkRange(seed, 1, (int)(j - i) - 1);
+            n += compressRun(letters[i], first, packed + n);
+            first = j - i - first;
+        }
+        n += compressRun(letters[i], first, packed + n);
+        i = j;
+    }
+    return n;
+}
+
+/* ============================================================
+ * Helper: checkCounts
+ * letterHistogram and runStatistics of packed[0..n) against a pass
+ * over its expansion letters[0..len). Runs are only compared when
+ * the text was not split.
+ * ============================================================ */
+static void checkCounts(const char *packed, size_t n, const char *letters, size_t len, int split)
+{
+    size_t counts[256], wantCounts[256], buckets[RUN_LENGTH_BUCKETS];
+    size_t runs = 0, shortest = (size_t)-1, longest = 0, sum = 0, i, k;
+    RunStats stats;
+
+    /* letterHistogram adds to what is there */
+    for (i = 0; i < 256; i++)
+        counts[i] = wantCounts[i] = i;
+    for (i = 0; i < len; i++)
+        wantCounts[(unsigned char)letters[i]]++;
+    letterHistogram(packed, n, counts);
+    for (i = 0; i < 256; i++) {
+        CHECK_MSG(counts[i] == wantCounts[i], "letterHistogram: '%c' counted %zu, expected %zu",
+                  (int)i, counts[i] - i, wantCounts[i] - i);
+        sum += counts[i] - i;
+    }
+    CHECK_MSG(sum == len, "letterHistogram: %zu letters, expected %zu", sum, len);
+
+    memset(buckets, 0, sizeof(buckets));
+    for (i = 0; i < len; i = k) {
+        size_t run, b = 0;
+
+        for (k = i + 1; k < len && letters[k] == letters[i]; k++)
+            ;
+        run = k - i;
+        runs++;
+        shortest = (run < shortest) ? run : shortest;
+        longest = (run > longest) ? run : longest;
+        while ((run >> b) > 1)
+            b++;
+        buckets[b]++;
+    }
+
+    runStatistics(packed, n, &stats);
+    CHECK_MSG(stats.total == len, "runStatistics: total %zu, expected %zu", stats.total, len);
+    for (i = 0, sum = 0; i < RUN_LENGTH_BUCKETS; i++)
+        sum += stats.buckets[i];
+    CHECK_MSG(sum == stats.runs, "runStatistics: %zu runs in buckets, %zu runs", sum, stats.runs);
+    if (split) {
+        CHECK_MSG(stats.runs >= runs && stats.shortest <= shortest && stats.longest <= longest,
+                  "runStatistics of a split text: %zu runs %zu..%zu, expanded %zu runs %zu..%zu",
+                  stats.runs, stats.shortest, stats.longest, runs, shortest, longest);
+        return;
+    }
+    CHECK_MSG(stats.runs == runs && (runs == 0 || (stats.shortest == shortest && stats.longest == longest)),
+              "runStatistics: %zu runs %zu..%zu, expected %zu runs %zu..%zu",
+              stats.runs, stats.shortest, stats.longest, runs, shortest, longest);
+    CHECK_MSG(memcmp(stats.buckets, buckets, sizeof(buckets)) == 0, "runStatistics: buckets differ");
+}
+
+/* ============================================================
+ * Helper: checkPair
+ * Compares, joins and counts letters A and B through their
+ * compressed forms (split or not).
+ * ============================================================ */
+static void checkPair(unsigned *seed, size_t aLen, size_t bLen)
+{
+    int splitA = (int)(checkRandom(seed) % 2), splitB = (int)(checkRandom(seed) % 2);
+    size_t na, nb, n, wantLen;
+    int got, expected;
+
+    lettersA[aLen] = '\0';
+    lettersB[bLen] = '\0';
+    na = pack(seed, lettersA, aLen, splitA, packedA);
+    nb = pack(seed, lettersB, bLen, splitB, packedB);
+
+    expected = sign(strcmp(lettersA, lettersB));
+    got = sign(compareCompressed(packedA, na, packedB, nb));
+    CHECK_MSG(got == expected, "compareCompressed(%.*s, %.*s) = %d, expected %d",
+              (int)(na < 60 ? na : 60), packedA, (int)(nb < 60 ? nb : 60), packedB, got, expected);
+    CHECK(sign(compareCompressed(packedB, nb, packedA, na)) == -expected);
+
+    memcpy(joined, lettersA, aLen);
+    memcpy(joined + aLen, lettersB, bLen);
+    wantLen = compressRange(joined, aLen + bLen, want);
+    memset(out + na + nb, 0x5a, GUARD);
+    n = concatCompressed(packedA, na, packedB, nb, out);
+    CHECK_MSG(n != (size_t)-1 && n <= na + nb, "concatCompressed: %zd bytes, bound %zu", (ssize_t)n,
+              na + nb);
+    CHECK_MSG(out[na + nb] == 0x5a && out[na + nb + GUARD - 1] == 0x5a,
+              "concatCompressed wrote past aLen + bLen");
+    if (n == (size_t)-1 || n > na + nb)
+        return;
+    if (!splitA && !splitB)
+        CHECK_MSG(n == wantLen && memcmp(out, want, n) == 0,
+                  "concatCompressed of %zu and %zu letters differs from compressRange", aLen, bLen);
+    CHECK_MSG(isValidCompressedRange(out, n) || n == 0, "concatCompressed: invalid output");
+    CHECK_MSG(expandedSize(out, n) == aLen + bLen && expandRange(out, n, expanded) == aLen + bLen &&
+              memcmp(expanded, joined, aLen + bLen) == 0, "concatCompressed: expansion differs");
+
+    checkCounts(packedA, na, lettersA, aLen, splitA);
+}
+
+int main(void)
+{
+    unsigned seed = 1515;
+    size_t i, n;
+
+    /* Equal texts split differently, and prefixes */
+    CHECK(compareCompressed("2a3a", 4, "5a", 2) == 0);
+    CHECK(compareCompressed("a4a", 3, "2a3a", 4) == 0);
+    CHECK(compareCompressed("3ab", 3, "2a2b", 4) < 0);
+    CHECK(compareCompressed("4a", 2, "5a", 2) < 0);
+    CHECK(compareCompressed("", 0, "a", 1) < 0 && compareCompressed("a", 1, "", 0) > 0);
+    CHECK(compareCompressed("", 0, "", 0) == 0);
+    CHECK(compareCompressed("2aB", 3, "2ab", 3) < 0);
+
+    /* The merged run overflows only past SIZE_MAX */
+    CHECK(concatCompressed("9223372036854775808a", 20, "9223372036854775808a", 20, out) == (size_t)-1);
+    n = concatCompressed("b9223372036854775807a", 21, "9223372036854775808ac", 21, out);
+    CHECK(n == 23 && memcmp(out, "b18446744073709551615ac", 23) == 0);
+    n = concatCompressed("9223372036854775808a", 20, "9223372036854775808b", 20, out);
+    CHECK(n == 40 && memcmp(out, "9223372036854775808a9223372036854775808b", 40) == 0);
+    CHECK(concatCompressed("", 0, "3a", 2, out) == 2 && memcmp(out, "3a", 2) == 0);
+
+    for (i = 0; i < PAIRS; i++) {
+        size_t aLen = (size_t)checkRange(&seed, 0, (i % 10 == 0) ? MAX_LEN : 60);
+        size_t bLen = (size_t)checkRange(&seed, 0, (i % 10 == 0) ? MAX_LEN : 60);
+        int letters = checkRange(&seed, 1, 3), maxRun = (i % 3 == 0) ? 300 : 4;
+
+        checkLetters(&seed, lettersA, aLen, letters, maxRun);
+        checkLetters(&seed, lettersB, bLen, letters, maxRun);
+
+        /* Often B shares a prefix with A, or all of it */
+        if (i % 3 == 1) {
+            size_t shared = (size_t)checkRange(&seed, 0, (int)(aLen < bLen ? aLen : bLen));
+
+            memcpy(lettersB, lettersA, shared);
+        } else if (i % 3 == 2) {
+            memcpy(lettersB, lettersA, aLen);
+            bLen = aLen;
+        }
+        checkPair(&seed, aLen, bLen);
+    }
+    return checkDone("test_runs");
+}
@@ -0,0 +1,459 @@
+/*
+ * test_server.c
+ *
+ * Protocol test of the local server (server.h), run in a child
+ * process on a socket in the working directory. Pipelined requests
+ * of every kind, sent in random pieces while the responses are
+ * read, must be answered in order with what evaluateInfix,
+ * compressRange and expandRange give. Bad requests must close the
+ * connection after their answer. With no file descriptor left the
+ * server must neither spin nor drop waiting clients, and SIGTERM
+ * must end it cleanly.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include "check.h"
+
+#if defined(__linux__)
+
+#include <pthread.h>
+#include <signal.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "expression.h"
+#include "server.h"
+#include "string_ops.h"
+
+#define SOCKET_PATH "test_server.sock"
+
+/* Pipelined requests per run */
+#define REQUESTS 3000
+
+/* Connections opened against a server limited to a few descriptors */
+#define CROWD 12
+#define CROWD_FD_LIMIT 10
+
+/* Most CPU the crowded server may use while it waits (seconds) */
+#define IDLE_CPU 0.2
+
+/* Growable bytes */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Bytes;
+
+static void append(Bytes *b, const void *p, size_t n)
+{
+    if (b->len + n > b->cap) {
+        size_t cap = b->cap ? b->cap : 4096;
+
+        while (cap < b->len + n)
+            cap *= 2;
+        if ((b->data = realloc(b->data, cap)) == NULL)
+            exit(2);
+        b->cap = cap;
+    }
+    memcpy(b->data + b->len, p, n);
+    b->len += n;
+}
+
+static void appendMessage(Bytes *b, int code, const char *payload, size_t len)
+{
+    unsigned char header[SERVER_HEADER_SIZE];
+
+    serverPutHeader(header, code, len);
+    append(b, header, sizeof(header));
+    append(b, payload, len);
+}
+
+static void appendError(Bytes *b, int code, const char *message, size_t offset)
+{
+    char text[128];
+    int n = snprintf(text, sizeof(text), "%s at offset %zu", message, offset);
+
+    appendMessage(b, code, text, (size_t)n);
+}
+
+/* ============================================================
+ * Server process
+ * ============================================================ */
+
+/* Starts a server, optionally limited to 'fdLimit' descriptors */
+static pid_t startServer(int fdLimit)
+{
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        if (fdLimit > 0) {
+            struct rlimit rl;
+
+            getrlimit(RLIMIT_NOFILE, &rl);
+            rl.rlim_cur = (rlim_t)fdLimit;
+            setrlimit(RLIMIT_NOFILE, &rl);
+        }
+        _exit(runServer(SOCKET_PATH) == 0 ? 0 : 1);
+    }
+    if (pid < 0)
+        exit(2);
+    return pid;
+}
+
+/* Stops it with SIGTERM; returns 1 if it exited cleanly and removed its socket */
+static int stopServer(pid_t pid)
+{
+    int status;
+
+    kill(pid, SIGTERM);
+    if (waitpid(pid, &status, 0) != pid)
+        return 0;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 && access(SOCKET_PATH, F_OK) != 0;
+}
+
+/* CPU seconds a process has used */
+static double cpuSeconds(pid_t pid)
+{
+    char path[64], buf[1024], *p;
+    unsigned long utime, stime;
+    FILE *f;
+
+    snprintf(path, sizeof(path), "/proc/%d/stat", (int)pid);
+    if ((f = fopen(path, "r")) == NULL)
+        return -1;
+    p = fgets(buf, sizeof(buf), f);
+    fclose(f);
+    if (p == NULL || (p = strrchr(buf, ')')) == NULL ||
+        sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2)
+        return -1;
+    return (double)(utime + stime) / (double)sysconf(_SC_CLK_TCK);
+}
+
+/* Connects, retrying while the server starts; a 10 s receive timeout */
+static int connectServer(void)
+{
+    struct sockaddr_un addr;
+    struct timeval tv = { 10, 0 };
+    int tries;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, SOCKET_PATH);
+    for (tries = 0; tries < 500; tries++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+        if (fd < 0)
+            exit(2);
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+            setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            return fd;
+        }
+        close(fd);
+        usleep(10000);
+    }
+    exit(2);
+}
+
+static int sendAll(int fd, const char *p, size_t n)
+{
+    while (n > 0) {
+        ssize_t sent = send(fd, p, n, MSG_NOSIGNAL);
+
+        if (sent <= 0)
+            return 0;
+        p += sent;
+        n -= (size_t)sent;
+    }
+    return 1;
+}
+
+/* Reads exactly n bytes; returns the number read before EOF or an error */
+static size_t recvAll(int fd, char *p, size_t n)
+{
+    size_t done = 0;
+
+    while (done < n) {
+        ssize_t got = recv(fd, p + done, n - done, 0);
+
+        if (got <= 0)
+            break;
+        done += (size_t)got;
+    }
+    return done;
+}
+
+/* ============================================================
+ * Expected responses
+ * ============================================================ */
+static void expectEval(Bytes *want, const char *expr, size_t len)
+{
+    ExprValue v = EXPR_VALUE_INIT;
+    char *copy = malloc(len + 1), *text;
+    int offset = 0;
+    ExprStatus status;
+
+    if (copy == NULL)
+        exit(2);
+    memcpy(copy, expr, len);
+    copy[len] = '\0';
+    status = evaluateInfix(copy, &v, &offset);
+    if (status == EXPR_OK) {
+        if ((text = malloc(exprValueTextSize(&v))) == NULL)
+            exit(2);
+        appendMessage(want, SERVER_OK, text, exprValueToText(&v, text));
+        free(text);
+    } else {
+        appendError(want, SERVER_ERR_INVALID, exprStatusMessage(status), (size_t)offset);
+    }
+    freeExprValue(&v);
+    free(copy);
+}
+
+static void expectCompress(Bytes *want, const char *in, size_t len)
+{
+    size_t offset = checkString(in, len);
+    char *out;
+
+    if (offset != CHECK_VALID) {
+        appendError(want, SERVER_ERR_INVALID, "invalid string", offset);
+        return;
+    }
+    if ((out = malloc(len + 1)) == NULL)
+        exit(2);
+    appendMessage(want, SERVER_OK, out, compressRange(in, len, out));
+    free(out);
+}
+
+static void expectExpand(Bytes *want, const char *in, size_t len)
+{
+    size_t offset = checkCompressed(in, len), n;
+    char *out;
+
+    if (offset != CHECK_VALID) {
+        appendError(want, SERVER_ERR_INVALID, "invalid compressed string", offset);
+        return;
+    }
+    n = expandedSize(in, len);
+    if (n == (size_t)-1 || n > SERVER_MAX_RESPONSE) {
+        appendMessage(want, SERVER_ERR_TOO_LARGE, "expanded string too large", 25);
+        return;
+    }
+    if ((out = malloc(n + 1)) == NULL)
+        exit(2);
+    expandRange(in, len, out);
+    appendMessage(want, SERVER_OK, out, n);
+    free(out);
+}
+
+/* One random request into req, its expected response into want */
+static void addRequest(unsigned *seed, Bytes *req, Bytes *want)
+{
+    static char buf[8192], packed[8192];
+    size_t len;
+
+    switch (checkRandom(seed) % 7) {
+        case 0:
+        case 1:
+        case 2:
+            /* Small, big and deeply nested values, some invalid */
+            len = checkExpression(seed, buf, sizeof(buf), checkRange(seed, 1, 30),
+                                  (checkRandom(seed) % 3 == 0) ? 19 : 3, 8);
+            if (checkRandom(seed) % 8 == 0)
+                buf[checkRandom(seed) % len] = "()+x 7"[checkRandom(seed) % 6];
+            if (checkRandom(seed) % 20 == 0) {
+                len = 0;
+                while (len < 300)
+                    buf[len++] = '(';
+                buf[len++] = '2';
+                while (len < 601)
+                    buf[len++] = ')';
+            }
+            appendMessage(req, SERVER_EVAL, buf, len);
+            expectEval(want, buf, len);
+            break;
+        case 3:
+        case 4:
+            len = (size_t)checkRange(seed, 1, 4000);
+            checkLetters(seed, buf, len, 6, 12);
+            if (checkRandom(seed) % 6 == 0)
+                buf[checkRandom(seed) % len] = (checkRandom(seed) % 2) ? '\0' : '5';
+            appendMessage(req, SERVER_COMPRESS, buf, len);
+            expectCompress(want, buf, len);
+            break;
+        case 5:
+            len = (size_t)checkRange(seed, 1, 2000);
+            checkLetters(seed, buf, len, 6, 200);
+            len = compressRange(buf, len, packed);
+            if (checkRandom(seed) % 6 == 0)
+                packed[checkRandom(seed) % len] = "0-1"[checkRandom(seed) % 3];
+            appendMessage(req, SERVER_EXPAND, packed, len);
+            expectExpand(want, packed, len);
+            break;
+        default:
+            /* Expansions past the output limit, and past the largest response */
+            len = (size_t)sprintf(packed, "%da%s", checkRange(seed, 1, 3 * SERVER_OUTPUT_LIMIT),
+                                  (checkRandom(seed) % 10 == 0) ? "999999999b" : "c");
+            appendMessage(req, SERVER_EXPAND, packed, len);
+            expectExpand(want, packed, len);
+            break;
+    }
+}
+
+/* Sends a buffer in random pieces of 1..5000 bytes */
+typedef struct {
+    int fd;
+    const Bytes *data;
+    unsigned seed;
+} Sender;
+
+static void *sendPieces(void *arg)
+{
+    Sender *s = arg;
+    size_t done = 0;
+
+    while (done < s->data->len) {
+        size_t n = (size_t)checkRange(&s->seed, 1, 5000);
+
+        if (n > s->data->len - done)
+            n = s->data->len - done;
+        if (!sendAll(s->fd, s->data->data + done, n))
+            break;
+        done += n;
+    }
+    shutdown(s->fd, SHUT_WR);
+    return NULL;
+}
+
+/* ============================================================
+ * Helper: checkPipelined
+ * Sends req in pieces from a thread while the responses are read,
+ * which must be exactly want, then end of stream.
+ * ============================================================ */
+static void checkPipelined(const char *name, const Bytes *req, const Bytes *want)
+{
+    int fd = connectServer();
+    Sender sender = { fd, req, 42 };
+    pthread_t thread;
+    char *got = malloc(want->len + 1);
+    size_t n, i;
+
+    if (got == NULL)
+        exit(2);
+    pthread_create(&thread, NULL, sendPieces, &sender);
+    n = recvAll(fd, got, want->len);
+    for (i = 0; i < n && got[i] == want->data[i]; i++)
+        ;
+    CHECK_MSG(n == want->len && i == n, "%s: %zu of %zu response bytes, first difference at %zu",
+              name, n, want->len, i);
+    CHECK_MSG(recvAll(fd, got, 1) == 0, "%s: bytes after the last response", name);
+    pthread_join(thread, NULL);
+    close(fd);
+    free(got);
+}
+
+/* ============================================================
+ * Helper: checkCrowd
+ * More clients than the server has descriptors for: it must stay
+ * idle while they wait, and answer every one of them as the
+ * earlier ones leave.
+ * ============================================================ */
+static void checkCrowd(void)
+{
+    pid_t pid = startServer(CROWD_FD_LIMIT);
+    int fds[CROWD], i;
+    char reply[SERVER_HEADER_SIZE + 2];
+    Bytes req = { NULL, 0, 0 };
+    double cpu;
+
+    appendMessage(&req, SERVER_EVAL, "6*7", 3);
+    for (i = 0; i < CROWD; i++) {
+        fds[i] = connectServer();
+        CHECK(sendAll(fds[i], req.data, req.len));
+    }
+    usleep(300000);
+    cpu = cpuSeconds(pid);
+    usleep(500000);
+    cpu = cpuSeconds(pid) - cpu;
+    CHECK_MSG(cpu >= 0 && cpu < IDLE_CPU, "server out of descriptors used %.2fs of CPU in 0.5s", cpu);
+
+    for (i = 0; i < CROWD; i++) {
+        size_t n = recvAll(fds[i], reply, sizeof(reply));
+
+        CHECK_MSG(n == SERVER_HEADER_SIZE + 2 && reply[0] == SERVER_OK &&
+                  memcmp(reply + SERVER_HEADER_SIZE, "42", 2) == 0,
+                  "client %d of %d: %zu response bytes", i, CROWD, n);
+        close(fds[i]);
+    }
+    CHECK(stopServer(pid));
+    free(req.data);
+}
+
+int main(void)
+{
+    Bytes req = { NULL, 0, 0 }, want = { NULL, 0, 0 };
+    unsigned seed = 1313;
+    char reply[256];
+    pid_t pid;
+    int fd, i;
+    size_t n;
+
+    unlink(SOCKET_PATH);
+    pid = startServer(0);
+
+    for (i = 0; i < REQUESTS; i++)
+        addRequest(&seed, &req, &want);
+    checkPipelined("pipelined", &req, &want);
+
+    /* A bad request is answered, then the connection closes */
+    req.len = want.len = 0;
+    appendMessage(&req, SERVER_EVAL, "1+1", 3);
+    appendMessage(&want, SERVER_OK, "2", 1);
+    appendMessage(&req, 'Q', "1+1", 3);
+    appendMessage(&want, SERVER_ERR_BAD_REQUEST, "unknown operation", 17);
+    appendMessage(&req, SERVER_EVAL, "2+2", 3);
+    checkPipelined("unknown operation", &req, &want);
+
+    fd = connectServer();
+    serverPutHeader((unsigned char *)reply, SERVER_COMPRESS, (size_t)SERVER_MAX_REQUEST + 1);
+    CHECK(sendAll(fd, reply, SERVER_HEADER_SIZE));
+    n = recvAll(fd, reply, sizeof(reply));
+    CHECK_MSG(n == SERVER_HEADER_SIZE + 17 && reply[0] == SERVER_ERR_BAD_REQUEST,
+              "oversized request: %zu response bytes", n);
+    close(fd);
+
+    /* A client that leaves without reading does not stop the server */
+    fd = connectServer();
+    req.len = 0;
+    appendMessage(&req, SERVER_EXPAND, "3000000a", 8);
+    CHECK(sendAll(fd, req.data, req.len));
+    close(fd);
+    req.len = want.len = 0;
+    appendMessage(&req, SERVER_COMPRESS, "aaab", 4);
+    appendMessage(&want, SERVER_OK, "3ab", 3);
+    checkPipelined("after a client left", &req, &want);
+
+    CHECK_MSG(stopServer(pid), "SIGTERM: no clean exit");
+
+    checkCrowd();
+
+    free(req.data);
+    free(want.data);
+    return checkDone("test_server");
+}
+
+#else
+
+int main(void)
+{
+    return checkDone("test_server");
+}
+
+#endif
@@ -0,0 +1,361 @@
+/*
+ * test_stream.c
+ *
+ * Differential test of the streaming compressor / expander
+ * (string_stream.h) and of the long lines batch mode streams
+ * through them. Every input is fed in pieces cut at every position
+ * (inside a count, inside a run, between runs) and with output room
+ * down to the minimum, and must give what compressString /
+ * expandString give in one go. Lines longer than the batch buffer
+ * must come out of runBatch, from a file or a pipe, as the short
+ * ones do.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include "check.h"
+#include "batch.h"
+#include "string_ops.h"
+#include "string_stream.h"
+
+/* Random strings per run */
+#define STRINGS 300
+
+/* Letters of the long batch lines (several reader buffers) */
+#define LONG_LINE (3 * BATCH_BUFFER_SIZE + 12345)
+
+static const char *LETTERS[] = {
+    "a", "ab", "aab", "abbbbbbbbbbbb", "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab",
+    "zzzzzzzzzzZZZZZZZZZZzzzzzzzzzz", "qwertyQWERTY"
+};
+
+/* ============================================================
+ * Helper: runStream
+ * Compresses (or expands) text fed at the given cut points, with
+ * 'room' bytes of output per call. Returns the output length, or
+ * (size_t)-1 if the stream found the text invalid.
+ * ============================================================ */
+static size_t runStream(int expand, const char *text, size_t len, const size_t *cuts, int ncuts,
+                        size_t room, char *out, size_t cap)
+{
+    CompressStream cs;
+    ExpandStream es;
+    StreamStatus status = STREAM_OK;
+    size_t written = 0, from = 0;
+    int k;
+
+    compressStreamInit(&cs);
+    expandStreamInit(&es);
+    for (k = 0; k <= ncuts && status != STREAM_INVALID; k++) {
+        size_t to = (k < ncuts) ? cuts[k] : len;
+        const char *p = text + from;
+
+        do {
+            char *o = out + written;
+            char *end = o + ((cap - written < room) ? cap - written : room);
+
+            status = expand ? expandStreamFeed(&es, &p, text + to, &o, end)
+                            : compressStreamFeed(&cs, &p, text + to, &o, end);
+            written = (size_t)(o - out);
+        } while (status == STREAM_FULL);
+        CHECK_MSG(status == STREAM_INVALID || p == text + to, "feed stopped early");
+        from = to;
+    }
+    while (status == STREAM_OK || status == STREAM_FULL) {
+        char *o = out + written;
+        char *end = o + ((cap - written < room) ? cap - written : room);
+
+        status = expand ? expandStreamFinish(&es, &o, end) : compressStreamFinish(&cs, &o, end);
+        written = (size_t)(o - out);
+        if (status == STREAM_OK)
+            return written;
+    }
+    return (size_t)-1;
+}
+
+/* ============================================================
+ * Helper: checkStreams
+ * Feeds text cut at every single position, and in pieces of 1..5
+ * bytes, against the one-shot function.
+ * ============================================================ */
+static void checkStreams(int expand, const char *text)
+{
+    static char want[1 << 16], got[1 << 16];
+    size_t len = strlen(text), wantLen = (size_t)-1, cuts[1 << 12], cut, n;
+    size_t minRoom = expand ? 1 : COMPRESSED_RUN_MAX + 1, room;
+    int valid = expand ? isValidCompressedString(text) : isValidString(text);
+    int ncuts, step;
+
+    if (valid && expand && expandedSize(text, len) >= sizeof(want))
+        return;
+    if (valid) {
+        if (expand)
+            expandString(text, want);
+        else
+            compressString(text, want);
+        wantLen = strlen(want);
+    }
+
+    for (room = minRoom; room < minRoom + 3; room++) {
+        for (cut = 0; cut <= len; cut++) {
+            n = runStream(expand, text, len, &cut, 1, room, got, sizeof(got));
+            CHECK_MSG(n == wantLen && (n == (size_t)-1 || memcmp(got, want, n) == 0),
+                      "%s of %.40s cut at %zu, room %zu: %zd bytes, expected %zd",
+                      expand ? "expand" : "compress", text, cut, room, (ssize_t)n, (ssize_t)wantLen);
+        }
+    }
+    for (step = 1; step <= 5 && len / (size_t)step < sizeof(cuts) / sizeof(cuts[0]); step++) {
+        for (ncuts = 0; (size_t)(ncuts + 1) * (size_t)step < len; ncuts++)
+            cuts[ncuts] = (size_t)(ncuts + 1) * (size_t)step;
+        n = runStream(expand, text, len, cuts, ncuts, (step % 2) ? minRoom : sizeof(got), got, sizeof(got));
+        CHECK_MSG(n == wantLen && (n == (size_t)-1 || memcmp(got, want, n) == 0),
+                  "%s of %.40s in pieces of %d", expand ? "expand" : "compress", text, step);
+    }
+}
+
+/* ============================================================
+ * Long batch lines
+ * ============================================================ */
+
+/* Growable text */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Text;
+
+static void append(Text *t, const char *s, size_t n)
+{
+    if (t->len + n + 1 > t->cap) {
+        size_t cap = t->cap ? t->cap : 4096;
+
+        while (cap < t->len + n + 1)
+            cap *= 2;
+        if ((t->data = realloc(t->data, cap)) == NULL)
+            exit(2);
+        t->cap = cap;
+    }
+    memcpy(t->data + t->len, s, n);
+    t->len += n;
+    t->data[t->len] = '\0';
+}
+
+/* Feeds a pipe from a thread while runBatch reads the other end */
+typedef struct {
+    int fd;
+    const Text *input;
+} PipeFeeder;
+
+static void *feedPipe(void *arg)
+{
+    PipeFeeder *f = arg;
+    size_t done = 0;
+
+    while (done < f->input->len) {
+        ssize_t n = write(f->fd, f->input->data + done, f->input->len - done);
+
+        if (n <= 0)
+            break;
+        done += (size_t)n;
+    }
+    close(f->fd);
+    return NULL;
+}
+
+/* runBatch over a temporary file, or a pipe; returns the output */
+static void runOn(BatchMode mode, const Text *input, const BatchOptions *opts, int usePipe,
+                  Text *output)
+{
+    FILE *in, *out = tmpfile();
+    PipeFeeder feeder;
+    pthread_t thread;
+    char buf[65536];
+    size_t n;
+    int fds[2];
+
+    if (usePipe) {
+        if (pipe(fds) != 0 || (in = fdopen(fds[0], "rb")) == NULL)
+            exit(2);
+        feeder.fd = fds[1];
+        feeder.input = input;
+        pthread_create(&thread, NULL, feedPipe, &feeder);
+    } else if ((in = tmpfile()) == NULL || fwrite(input->data, 1, input->len, in) != input->len) {
+        exit(2);
+    } else {
+        rewind(in);
+    }
+    if (out == NULL)
+        exit(2);
+    CHECK(runBatch(mode, in, out, opts) == 0);
+    if (usePipe)
+        pthread_join(thread, NULL);
+    rewind(out);
+    output->len = 0;
+    while ((n = fread(buf, 1, sizeof(buf), out)) > 0)
+        append(output, buf, n);
+    fclose(in);
+    fclose(out);
+}
+
+/*
+ * Letters for a long line: short runs, so the compressed form is
+ * longer than a buffer too, and a long run across the first buffer
+ * end
+ */
+static void longLetters(unsigned *seed, char *buf, size_t len)
+{
+    checkLetters(seed, buf, len, 6, 3);
+    memset(buf + BATCH_BUFFER_SIZE - 20, 'k', 40);
+}
+
+/* Whether got[0..n) is the compressed form of letters[0..len) */
+static int matchesPrefix(const char *got, size_t n, const char *letters, size_t len, char *scratch)
+{
+    static char want[2 * LONG_LINE + 1];
+
+    memcpy(scratch, letters, len);
+    scratch[len] = '\0';
+    compressString(scratch, want);
+    return strlen(want) == n && memcmp(got, want, n) == 0;
+}
+
+/* ============================================================
+ * Helper: checkLongLines
+ * Long valid lines, one ending in "\r\n" with the '\r' as the last
+ * byte of a buffer, one cut short by a NUL, one invalid early and
+ * one invalid late, between short lines.
+ * ============================================================ */
+static void checkLongLines(void)
+{
+    static const int THREADS[] = { 1, 4 };
+    char *letters = malloc(LONG_LINE + 1), *packed = malloc(2 * LONG_LINE + 1);
+    char *scratch = malloc(LONG_LINE + 1);
+    Text input = { NULL, 0, 0 }, packedInput = { NULL, 0, 0 }, output = { NULL, 0, 0 };
+    unsigned seed = 808;
+    const char *line;
+    size_t packedLen, crAt;
+    int t, async, usePipe;
+
+    if (letters == NULL || packed == NULL || scratch == NULL)
+        exit(2);
+    longLetters(&seed, letters, LONG_LINE);
+    compressString(letters, packed);
+    packedLen = strlen(packed);
+
+    /* Compress input: short, long, long + "\r", long with NUL, short,
+     * invalid early, invalid late */
+    append(&input, "aaab\n", 5);
+    append(&input, letters, LONG_LINE);
+    append(&input, "\n", 1);
+    crAt = 2 * BATCH_BUFFER_SIZE - 1 - input.len % BATCH_BUFFER_SIZE;
+    append(&input, letters, crAt);
+    append(&input, "\r\n", 2);
+    append(&input, letters, LONG_LINE);
+    input.data[input.len - LONG_LINE / 2] = '\0';
+    append(&input, "junk\nzz\n", 8);
+    append(&input, "7", 1);
+    append(&input, letters, LONG_LINE);
+    append(&input, "\n", 1);
+    append(&input, letters, LONG_LINE);
+    append(&input, "7\n", 2);
+
+    /* Expand input: short, long + "\r", invalid early, invalid late */
+    append(&packedInput, "3a\n", 3);
+    append(&packedInput, packed, packedLen);
+    append(&packedInput, "\r\n", 2);
+    append(&packedInput, "-", 1);
+    append(&packedInput, packed, packedLen);
+    append(&packedInput, "\n", 1);
+    append(&packedInput, packed, packedLen);
+    append(&packedInput, "1\n", 2);
+
+    for (t = 0; t < 2; t++) {
+        for (async = 0; async < 2; async++) {
+            for (usePipe = 0; usePipe < 2; usePipe++) {
+                BatchOptions opts;
+                char *nl;
+
+                initBatchOptions(&opts);
+                opts.threads = THREADS[t];
+                opts.asyncIo = async;
+
+                runOn(BATCH_COMPRESS, &input, &opts, usePipe, &output);
+                line = output.data;
+                CHECK(strncmp(line, "3ab\n", 4) == 0);
+                line += 4;
+                CHECK_MSG(strncmp(line, packed, packedLen) == 0 && line[packedLen] == '\n',
+                          "long line, threads=%d async=%d pipe=%d", opts.threads, async, usePipe);
+                line += packedLen + 1;
+                nl = strchr(line, '\n');
+                CHECK_MSG(nl != NULL && matchesPrefix(line, (size_t)(nl - line), letters, crAt, scratch),
+                          "line ending in \\r at the buffer end, pipe=%d", usePipe);
+                line = (nl != NULL) ? nl + 1 : line;
+                nl = strchr(line, '\n');
+                CHECK_MSG(nl != NULL && matchesPrefix(line, (size_t)(nl - line), letters,
+                                                      LONG_LINE - LONG_LINE / 2, scratch),
+                          "line cut by a NUL, pipe=%d", usePipe);
+                line = (nl != NULL) ? nl + 1 : line;
+                CHECK(strncmp(line, "2z\nerror: invalid string\n", 25) == 0);
+                line += (strncmp(line, "2z\nerror: invalid string\n", 25) == 0) ? 25 : 0;
+                nl = strchr(line, '\n');
+                CHECK_MSG(nl != NULL && nl - line > 21 && strncmp(nl - 22, " error: invalid string", 22) == 0,
+                          "late error, pipe=%d", usePipe);
+                CHECK(nl != NULL && nl[1] == '\0');
+
+                runOn(BATCH_EXPAND, &packedInput, &opts, usePipe, &output);
+                line = output.data;
+                CHECK(strncmp(line, "aaa\n", 4) == 0);
+                line += 4;
+                CHECK_MSG(strncmp(line, letters, LONG_LINE) == 0 && line[LONG_LINE] == '\n',
+                          "long expansion, threads=%d async=%d pipe=%d", opts.threads, async, usePipe);
+                line += LONG_LINE + 1;
+                CHECK(strncmp(line, "error: invalid compressed string\n", 33) == 0);
+                line += 33;
+                nl = strchr(line, '\n');
+                CHECK_MSG(nl != NULL && nl - line > 33 &&
+                          strncmp(nl - 33, " error: invalid compressed string", 33) == 0,
+                          "late expand error, pipe=%d", usePipe);
+            }
+        }
+    }
+    free(letters);
+    free(packed);
+    free(scratch);
+    free(input.data);
+    free(packedInput.data);
+    free(output.data);
+}
+
+int main(void)
+{
+    static char buf[4096], packed[4096];
+    unsigned seed = 909;
+    size_t i;
+
+    for (i = 0; i < sizeof(LETTERS) / sizeof(LETTERS[0]); i++) {
+        checkStreams(0, LETTERS[i]);
+        compressString(LETTERS[i], packed);
+        checkStreams(1, packed);
+    }
+    checkStreams(0, "ab7c");
+    checkStreams(1, "12a10b");
+    checkStreams(1, "1a");
+    checkStreams(1, "012a");
+    checkStreams(1, "3a2");
+    checkStreams(1, "123456789012345678901234567890a");
+    for (i = 0; i < STRINGS; i++) {
+        checkLetters(&seed, buf, (size_t)checkRange(&seed, 1, 200), checkRange(&seed, 1, 6),
+                     checkRange(&seed, 1, 150));
+        checkStreams(0, buf);
+        compressString(buf, packed);
+        checkStreams(1, packed);
+    }
+
+    checkLongLines();
+    return checkDone("test_stream");
+}
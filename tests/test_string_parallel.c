@@ -0,0 +1,170 @@
+/*
+ * test_string_parallel.c
+ *
+ * Differential test of the multi-threaded compressor and expander
+ * (string_parallel.h): compressParallel must give what
+ * compressRange gives, and planExpansion / expandPlanned what
+ * isValidCompressedRange / expandRange give, on strings large
+ * enough to be cut into chunks. The shapes put runs, counts and
+ * invalid bytes across the chunk boundaries on purpose.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include "check.h"
+#include "string_parallel.h"
+
+/* Largest string (several chunks per thread) */
+#define MAX_LEN (3 * 1024 * 1024)
+
+/* Random strings per pool */
+#define STRINGS 12
+
+static char input[MAX_LEN + 1], packed[MAX_LEN + 1], want[MAX_LEN + 1], got[MAX_LEN + 1];
+
+/* Where chunk k of n starts, as compressParallel and planExpansion cut */
+static size_t chunkStart(size_t len, size_t n, size_t k)
+{
+    return len / n * k;
+}
+
+/* ============================================================
+ * Helper: checkCompress
+ * compressParallel against compressRange on input[0..len).
+ * ============================================================ */
+static void checkCompress(ThreadPool *pool, const char *name, size_t len)
+{
+    size_t wantLen = isValidStringRange(input, len) ? compressRange(input, len, want) : (size_t)-1;
+    size_t n = compressParallel(pool, input, len, got);
+
+    CHECK_MSG(n == wantLen && (n == (size_t)-1 || memcmp(got, want, n) == 0),
+              "compress %s (%zu bytes, %d threads): %zd bytes, expected %zd",
+              name, len, pool->count, (ssize_t)n, (ssize_t)wantLen);
+}
+
+/* ============================================================
+ * Helper: checkExpand
+ * planExpansion / expandPlanned against expandRange on
+ * packed[0..len).
+ * ============================================================ */
+static void checkExpand(ThreadPool *pool, const char *name, size_t len)
+{
+    int valid = isValidCompressedRange(packed, len);
+    size_t size = valid ? expandedSize(packed, len) : (size_t)-1;
+    ExpandPlan plan;
+
+    if (valid && size > MAX_LEN)
+        return;
+    if (!planExpansion(pool, packed, len, &plan)) {
+        CHECK_MSG(!valid, "expand %s (%zu bytes, %d threads): rejected", name, len, pool->count);
+        return;
+    }
+    CHECK_MSG(valid, "expand %s (%zu bytes, %d threads): accepted", name, len, pool->count);
+    if (valid) {
+        CHECK_MSG(plan.total == size, "expand %s: %zu bytes, expected %zu", name, plan.total, size);
+        expandRange(packed, len, want);
+        expandPlanned(pool, &plan, got);
+        CHECK_MSG(plan.total == size && memcmp(got, want, size) == 0, "expand %s (%zu bytes, %d threads)",
+                  name, len, pool->count);
+    }
+    freeExpandPlan(&plan);
+}
+
+/* ============================================================
+ * Shapes
+ * ============================================================ */
+
+/* One letter throughout: a single run across every chunk */
+static void oneRun(size_t len)
+{
+    memset(input, 'q', len);
+}
+
+/* Random runs, with a run of 'r' across every chunk boundary */
+static void runsAcross(unsigned *seed, size_t len, size_t chunks)
+{
+    size_t k;
+
+    checkLetters(seed, input, len, 6, 9);
+    for (k = 1; k < chunks; k++) {
+        size_t at = chunkStart(len, chunks, k);
+        size_t from = at - (size_t)checkRange(seed, 0, 5), to = at + (size_t)checkRange(seed, 0, 5);
+
+        memset(input + from, 'r', to - from);
+    }
+}
+
+/* Letters in compressed form with a long count across every boundary */
+static size_t countsAcross(unsigned *seed, size_t len, size_t chunks)
+{
+    size_t k, n;
+
+    checkLetters(seed, input, len, 10, 30);
+    n = compressRange(input, len, packed);
+    for (k = 1; k < chunks; k++) {
+        size_t at = chunkStart(n, chunks, k) - 2;
+
+        /* "12" + "3456"... ends on a letter past the boundary */
+        packed[at] = '1';
+        packed[at + 1] = '2';
+        packed[at + 2] = (char)('0' + checkRange(seed, 0, 9));
+        packed[at + 3] = 'x';
+    }
+    return n;
+}
+
+int main(void)
+{
+    static const int THREADS[] = { 2, 4, 7 };
+    unsigned seed = 1010;
+    int t, i;
+
+    for (t = 0; t < 3; t++) {
+        ThreadPool pool;
+        size_t chunks;
+
+        if (!poolInit(&pool, THREADS[t], NULL))
+            return 2;
+        chunks = (size_t)pool.count * STRING_CHUNKS_PER_THREAD;
+
+        oneRun(MAX_LEN);
+        checkCompress(&pool, "one run", MAX_LEN);
+        input[MAX_LEN - 1] = '7';
+        checkCompress(&pool, "one run, invalid last byte", MAX_LEN);
+        packed[0] = '3';
+        packed[1] = 'q';
+        checkExpand(&pool, "tiny", 2);
+
+        for (i = 0; i < STRINGS; i++) {
+            size_t len = (size_t)checkRange(&seed, STRING_PARALLEL_MIN_SIZE / 2, MAX_LEN);
+            size_t n, k;
+
+            runsAcross(&seed, len, chunks);
+            checkCompress(&pool, "runs across boundaries", len);
+            n = compressRange(input, len, packed);
+            checkExpand(&pool, "runs across boundaries", n);
+
+            /* An invalid byte right at a boundary, or next to it */
+            k = chunkStart(len, chunks, (size_t)checkRange(&seed, 1, (int)chunks - 1));
+            input[k - 1 + (size_t)checkRange(&seed, 0, 2)] = (i % 2) ? '-' : '5';
+            checkCompress(&pool, "invalid at a boundary", len);
+
+            n = countsAcross(&seed, len, chunks);
+            checkExpand(&pool, "counts across boundaries", n);
+
+            /* Corrupt counts: leading zero, lone 1, trailing count */
+            k = chunkStart(n, chunks, (size_t)checkRange(&seed, 1, (int)chunks - 1));
+            memcpy(packed + k - 1, (i % 3 == 0) ? "x0" : (i % 3 == 1) ? "x1" : "1x", 2);
+            if (i % 3 != 2)
+                packed[k + 1] = 'y';
+            checkExpand(&pool, "corrupt count at a boundary", n);
+            packed[n - 1] = '4';
+            checkExpand(&pool, "trailing count", n);
+        }
+        poolFree(&pool);
+    }
+    return checkDone("test_string_parallel");
+}
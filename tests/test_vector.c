@@ -0,0 +1,158 @@
+/*
+ * test_vector.c
+ *
+ * Differential test of evaluateColumns (expr_vector.h): every
+ * kernel set the CPU supports (avx2, sse4.1, scalar), on plain and
+ * optimized programs, must give for each row what a row-at-a-time
+ * 32-bit evaluation of the same tokens gives, including / and %
+ * by zero, by -1 and INT_MIN / -1. Rows whose steps all fit in an
+ * int must also match evaluateCompiledRow.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <limits.h>
+#include "check.h"
+#include "expression.h"
+#include "expr_optimize.h"
+#include "expr_vector.h"
+
+/* Not a multiple of any vector width or of VECTOR_BLOCK_ROWS */
+#define ROWS 1237
+
+static const char *VAR_NAMES[] = { "x", "y", "z" };
+
+static const char *EXPRESSIONS[] = {
+    "x", "7", "x + y", "x - y * z", "x / y", "x % y", "y / x % z",
+    "x / 0", "x % 0", "(x - x) / (y - y)", "x / (y - y + 1) % (z - z)",
+    "(x * y + z) / (y - z) % 7", "x * y * z - x / y + z % x",
+    "(x + y) * (x + y) / ((x + y) % 13 + 1)", "2147483647 + x", "x * 65536 * 65536",
+    "(x / y) * (x / y) - (x % y) * (x % y)"
+};
+
+/* Column values: the edges of int and of the operators, then random */
+static int pickValue(unsigned *seed)
+{
+    static const int EDGES[] = { 0, 1, -1, 2, -2, 7, INT_MAX, INT_MIN, INT_MIN + 1, 65536 };
+
+    if (checkRandom(seed) % 3 == 0)
+        return EDGES[checkRandom(seed) % (sizeof(EDGES) / sizeof(EDGES[0]))];
+    return (int)(checkRandom(seed) % 2001) - 1000;
+}
+
+/* ============================================================
+ * Helper: referenceRow
+ * The token program on one row in 32-bit lanes: wrapping + - *,
+ * / and % by zero give 0, / by -1 negates (INT_MIN stays INT_MIN)
+ * and % by -1 gives 0. *exact is cleared if a step left the int
+ * range (the exact evaluators then differ).
+ * ============================================================ */
+static int referenceRow(const CompiledExpr *expr, const int *vars, int *exact)
+{
+    long long stack[64], temps[64];
+    int top = -1, i;
+
+    *exact = 1;
+    for (i = 0; i < expr->count; i++) {
+        const Token *t = &expr->tokens[i];
+        long long a, b, r;
+
+        switch (t->op) {
+            case OP_PUSH:
+                stack[++top] = (int)t->value;
+                continue;
+            case OP_VAR:
+                stack[++top] = vars[t->value];
+                continue;
+            case OP_STORE:
+                temps[t->value] = stack[top];
+                continue;
+            case OP_LOAD:
+                stack[++top] = temps[t->value];
+                continue;
+        }
+        b = stack[top--];
+        a = stack[top];
+        switch (t->op) {
+            case OP_ADD: r = a + b; break;
+            case OP_SUB: r = a - b; break;
+            case OP_MUL: r = a * b; break;
+            case OP_DIV: r = (b == 0) ? 0 : a / b; break;
+            default:     r = (b == 0 || b == -1) ? 0 : a % b; break;
+        }
+        if (r < INT_MIN || r > INT_MAX)
+            *exact = 0;
+        stack[top] = (int)(unsigned)(unsigned long long)r;
+    }
+    return (int)stack[0];
+}
+
+/* Runs one program on one kernel set against the reference */
+static void checkProgram(const char *kernels, const char *text, const CompiledExpr *expr,
+                         const int *const *columns)
+{
+    static int result[ROWS];
+    ExprValue v = EXPR_VALUE_INIT;
+    int r;
+
+    memset(result, 0x55, sizeof(result));
+    CHECK(evaluateColumns(expr, columns, ROWS, result));
+    for (r = 0; r < ROWS; r++) {
+        int vars[3], exact, want;
+
+        vars[0] = columns[0][r];
+        vars[1] = columns[1][r];
+        vars[2] = columns[2][r];
+        want = referenceRow(expr, vars, &exact);
+        CHECK_MSG(result[r] == want, "%s: %s row %d (x=%d y=%d z=%d): %d, expected %d",
+                  kernels, text, r, vars[0], vars[1], vars[2], result[r], want);
+        if (exact && r % 7 == 0) {
+            CHECK(evaluateCompiledRow(expr, vars, &v) == EXPR_OK);
+            CHECK_MSG(!v.isBig && v.small == want, "%s: %s row %d: evaluateCompiledRow %lld, lanes %d",
+                      kernels, text, r, v.small, want);
+        }
+    }
+    freeExprValue(&v);
+}
+
+int main(void)
+{
+    static const char *KERNELS[] = { "scalar", "sse4.1", "avx2" };
+    static int x[ROWS], y[ROWS], z[ROWS];
+    const int *columns[3] = { x, y, z };
+    unsigned seed = 404;
+    size_t e, k;
+    int r;
+
+    for (r = 0; r < ROWS; r++) {
+        x[r] = pickValue(&seed);
+        y[r] = pickValue(&seed);
+        z[r] = pickValue(&seed);
+    }
+    /* Make sure the worst case is there */
+    x[5] = INT_MIN;
+    y[5] = -1;
+
+    for (k = 0; k < sizeof(KERNELS) / sizeof(KERNELS[0]); k++) {
+        if (!vectorUseKernels(KERNELS[k])) {
+            printf("test_vector: %s kernels not supported here, skipped\n", KERNELS[k]);
+            continue;
+        }
+        for (e = 0; e < sizeof(EXPRESSIONS) / sizeof(EXPRESSIONS[0]); e++) {
+            CompiledExpr expr = COMPILED_INIT;
+
+            if (compileExpression(EXPRESSIONS[e], VAR_NAMES, 3, &expr, NULL) != EXPR_OK) {
+                CHECK_MSG(0, "cannot compile %s", EXPRESSIONS[e]);
+                continue;
+            }
+            checkProgram(KERNELS[k], EXPRESSIONS[e], &expr, columns);
+            CHECK(optimizeCompiled(&expr));
+            checkProgram(KERNELS[k], EXPRESSIONS[e], &expr, columns);
+            freeCompiled(&expr);
+        }
+    }
+    return checkDone("test_vector");
+}
@@ -0,0 +1,294 @@
+/*
+ * thread_pool.c
+ *
+ * Work-stealing thread pool. Each worker owns a queue; submitted
+ * tasks are spread over the queues round-robin, a worker pops its
+ * own queue from the back (newest first) and idle workers steal
+ * from the front of the others (oldest first), so uneven tasks
+ * even out without a single shared queue.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "thread_pool.h"
+
+#define QUEUE_INITIAL_CAP 64
+
+/* Start-up argument of a worker thread */
+typedef struct {
+    ThreadPool *pool;
+    int index;
+} WorkerStart;
+
+/* ============================================================
+ * Helpers: WorkQueue operations (caller holds q->lock)
+ * ============================================================ */
+static int queuePushBack(WorkQueue *q, PoolJob job)
+{
+    if (q->count == q->cap) {
+        int cap = q->cap ? q->cap * 2 : QUEUE_INITIAL_CAP;
+        PoolJob *grown = malloc((size_t)cap * sizeof(PoolJob));
+        int i;
+
+        if (grown == NULL)
+            return 0;
+        for (i = 0; i < q->count; i++)
+            grown[i] = q->jobs[(q->head + i) % q->cap];
+        free(q->jobs);
+        q->jobs = grown;
+        q->head = 0;
+        q->cap = cap;
+    }
+    q->jobs[(q->head + q->count) % q->cap] = job;
+    q->count++;
+    return 1;
+}
+
+static int queuePopBack(WorkQueue *q, PoolJob *job)
+{
+    if (q->count == 0)
+        return 0;
+    q->count--;
+    *job = q->jobs[(q->head + q->count) % q->cap];
+    return 1;
+}
+
+static int queuePopFront(WorkQueue *q, PoolJob *job)
+{
+    if (q->count == 0)
+        return 0;
+    *job = q->jobs[q->head];
+    q->head = (q->head + 1) % q->cap;
+    q->count--;
+    return 1;
+}
+
+/* ============================================================
+ * Helper: takeJob
+ * Own queue first, then steal, starting from the next worker so
+ * thieves spread out. Returns 1 if a job was taken.
+ * ============================================================ */
+static int takeJob(ThreadPool *pool, int self, PoolJob *job)
+{
+    int found;
+    int i;
+
+    pthread_mutex_lock(&pool->queues[self].lock);
+    found = queuePopBack(&pool->queues[self], job);
+    pthread_mutex_unlock(&pool->queues[self].lock);
+
+    for (i = 1; !found && i < pool->count; i++) {
+        WorkQueue *victim = &pool->queues[(self + i) % pool->count];
+
+        pthread_mutex_lock(&victim->lock);
+        found = queuePopFront(victim, job);
+        pthread_mutex_unlock(&victim->lock);
+    }
+
+    if (found) {
+        pthread_mutex_lock(&pool->lock);
+        pool->pending--;
+        pthread_mutex_unlock(&pool->lock);
+    }
+    return found;
+}
+
+/* ============================================================
+ * Helper: workerMain
+ * Runs tasks until the pool is stopping and no work is left.
+ * ============================================================ */
+static void *workerMain(void *arg)
+{
+    WorkerStart *start = arg;
+    ThreadPool *pool = start->pool;
+    int self = start->index;
+    PoolJob job;
+
+    free(start);
+    for (;;) {
+        if (takeJob(pool, self, &job)) {
+            job.fn(job.arg, self);
+            continue;
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        while (pool->pending == 0 && !pool->stopping)
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->pending == 0 && pool->stopping) {
+            pthread_mutex_unlock(&pool->lock);
+            break;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    if (pool->onExit != NULL)
+        pool->onExit();
+    return NULL;
+}
+
+/* ============================================================
+ * Function: poolInit
+ * ============================================================ */
+int poolInit(ThreadPool *pool, int threads, PoolExitHook onExit)
+{
+    int i;
+
+    memset(pool, 0, sizeof(*pool));
+    if (threads < 1)
+        threads = 1;
+
+    pool->threads = malloc((size_t)threads * sizeof(pthread_t));
+    pool->queues = calloc((size_t)threads, sizeof(WorkQueue));
+    if (pool->threads == NULL || pool->queues == NULL) {
+        free(pool->threads);
+        free(pool->queues);
+        return 0;
+    }
+    pool->count = threads;
+    pool->onExit = onExit;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    for (i = 0; i < threads; i++)
+        pthread_mutex_init(&pool->queues[i].lock, NULL);
+
+    for (i = 0; i < threads; i++) {
+        WorkerStart *start = malloc(sizeof(WorkerStart));
+
+        if (start == NULL)
+            break;
+        start->pool = pool;
+        start->index = i;
+        if (pthread_create(&pool->threads[i], NULL, workerMain, start) != 0) {
+            free(start);
+            break;
+        }
+        pool->started++;
+    }
+
+    if (pool->started < threads) {
+        poolFree(pool);
+        return 0;
+    }
+    return 1;
+}
+
+/* ============================================================
+ * Function: poolSubmit
+ * ============================================================ */
+int poolSubmit(ThreadPool *pool, PoolTask fn, void *arg)
+{
+    WorkQueue *q;
+    PoolJob job;
+    int ok;
+
+    job.fn = fn;
+    job.arg = arg;
+
+    pthread_mutex_lock(&pool->lock);
+    q = &pool->queues[pool->next++ % (unsigned)pool->count];
+    pthread_mutex_unlock(&pool->lock);
+
+    pthread_mutex_lock(&q->lock);
+    ok = queuePushBack(q, job);
+    pthread_mutex_unlock(&q->lock);
+    if (!ok)
+        return 0;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->pending++;
+    pthread_cond_signal(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    return 1;
+}
+
+/* ============================================================
+ * Function: poolFree
+ * ============================================================ */
+void poolFree(ThreadPool *pool)
+{
+    int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->started; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    for (i = 0; i < pool->count; i++) {
+        pthread_mutex_destroy(&pool->queues[i].lock);
+        free(pool->queues[i].jobs);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    free(pool->threads);
+    free(pool->queues);
+    memset(pool, 0, sizeof(*pool));
+}
+
+/* ============================================================
+ * Function: poolCpuCount
+ * ============================================================ */
+int poolCpuCount(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return n > 0 ? (int)n : 1;
+}
+
+/* ============================================================
+ * Functions: poolStartTasks / poolFinishTask / poolWaitTasks /
+ *            poolRunTasks
+ * ============================================================ */
+void poolFinishTask(TaskGroup *group)
+{
+    pthread_mutex_lock(&group->lock);
+    if (--group->outstanding == 0)
+        pthread_cond_signal(&group->done);
+    pthread_mutex_unlock(&group->lock);
+}
+
+void poolStartTasks(ThreadPool *pool, TaskGroup *group, PoolTask fn,
+                    void *tasks, size_t size, size_t count)
+{
+    size_t i;
+
+    pthread_mutex_init(&group->lock, NULL);
+    pthread_cond_init(&group->done, NULL);
+    group->outstanding = (int)count;
+
+    for (i = 0; i < count; i++) {
+        void *task = (char *)tasks + i * size;
+
+        *(TaskGroup **)task = group;
+        if (!poolSubmit(pool, fn, task))
+            fn(task, pool->count);
+    }
+}
+
+void poolWaitTasks(TaskGroup *group)
+{
+    pthread_mutex_lock(&group->lock);
+    while (group->outstanding > 0)
+        pthread_cond_wait(&group->done, &group->lock);
+    pthread_mutex_unlock(&group->lock);
+
+    pthread_mutex_destroy(&group->lock);
+    pthread_cond_destroy(&group->done);
+}
+
+void poolRunTasks(ThreadPool *pool, PoolTask fn, void *tasks,
+                  size_t size, size_t count)
+{
+    TaskGroup group;
+
+    poolStartTasks(pool, &group, fn, tasks, size, count);
+    poolWaitTasks(&group);
+}
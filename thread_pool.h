@@ -0,0 +1,101 @@
+/*
+ * thread_pool.h
+ *
+ * Header file for the work-stealing thread pool.
+ *
+ * Developers:
+ *   Joe Hanna Cantero
+ *   Charisse Lorejo
+ *   Michael James Mangaron
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+#include <stddef.h>
+
+/*
+ * A task; 'worker' is the index (0..threads-1) of the pool thread
+ * running it, or 'threads' when it runs on a thread outside the
+ * pool, so per-worker state takes threads + 1 slots.
+ */
+typedef void (*PoolTask)(void *arg, int worker);
+
+/* Called by each worker thread just before it exits */
+typedef void (*PoolExitHook)(void);
+
+/* One queued task */
+typedef struct {
+    PoolTask fn;
+    void *arg;
+} PoolJob;
+
+/* Per-worker double-ended queue (ring buffer) */
+typedef struct {
+    pthread_mutex_t lock;
+    PoolJob *jobs;
+    int head;
+    int count;
+    int cap;
+} WorkQueue;
+
+/*
+ * Fixed set of worker threads, each with its own queue. A worker
+ * takes the newest task from its own queue and, when that is empty,
+ * steals the oldest task from another worker's queue.
+ */
+typedef struct {
+    pthread_t *threads;
+    WorkQueue *queues;
+    int count;
+    int started;
+    pthread_mutex_t lock;   /* Guards pending/stopping */
+    pthread_cond_t wake;
+    int pending;            /* Tasks queued but not yet taken */
+    int stopping;
+    unsigned next;          /* Round-robin target for poolSubmit */
+    PoolExitHook onExit;
+} ThreadPool;
+
+/*
+ * Starts 'threads' workers (at least 1). onExit may be NULL.
+ * Returns 1 on success, 0 if threads or memory are unavailable.
+ */
+int poolInit(ThreadPool *pool, int threads, PoolExitHook onExit);
+
+/*
+ * Queues a task. Returns 1 on success, 0 if out of memory.
+ * Safe to call from any thread, including a running task.
+ */
+int poolSubmit(ThreadPool *pool, PoolTask fn, void *arg);
+
+/* Runs every queued task to completion, then joins and frees the pool */
+void poolFree(ThreadPool *pool);
+
+/* Number of online CPUs (at least 1) */
+int poolCpuCount(void);
+
+/* Completion counter for one batch of tasks */
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+    int outstanding;
+} TaskGroup;
+
+/*
+ * poolStartTasks submits 'count' tasks laid out 'size' bytes apart
+ * in 'tasks', each starting with its TaskGroup pointer (filled in
+ * here); a task that cannot be queued runs on the calling thread,
+ * with worker index pool->count.
+ * Every task must call poolFinishTask when done, and poolWaitTasks
+ * blocks until all of them have. poolRunTasks does both.
+ */
+void poolStartTasks(ThreadPool *pool, TaskGroup *group, PoolTask fn,
+                    void *tasks, size_t size, size_t count);
+void poolFinishTask(TaskGroup *group);
+void poolWaitTasks(TaskGroup *group);
+void poolRunTasks(ThreadPool *pool, PoolTask fn, void *tasks,
+                  size_t size, size_t count);
+
+#endif